@@ -0,0 +1,158 @@
+/*
+ * audio.alsa.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <alsa/asoundlib.h>
+#include <vector>
+
+#include "audio.h"
+#include "dsp.h"
+#include "logging.h"
+
+namespace oemros {
+
+// how many blocks ALSA buffers; more is safer and adds latency
+#define ALSA_BUFFER_BLOCKS 4
+
+// Talks to an ALSA PCM as interleaved 16 bit samples which every sound card
+// can do. An xrun is recovered from right away and reported to the stream.
+class alsa_audio : public audio_backend {
+    private:
+        const std::string device;
+        snd_pcm_t* pcm = nullptr;
+        direction which = direction::capture;
+        audio_format format;
+        std::vector<int16_t> raw;
+
+        bool recover(const int& error_in);
+
+    public:
+        alsa_audio(const std::string& device_in) : device(device_in) { }
+        ~alsa_audio();
+        virtual bool open(const direction& direction_in, audio_format& format_inout) override;
+        virtual status transfer(float* block_inout) override;
+        virtual void close() override;
+        virtual std::chrono::microseconds get_delay() override;
+};
+
+alsa_audio::~alsa_audio() {
+    close();
+}
+
+bool alsa_audio::open(const direction& direction_in, audio_format& format_inout) {
+    close();
+
+    which = direction_in;
+    format = format_inout;
+    raw.resize(format.block_samples());
+
+    auto stream = which == direction::capture ? SND_PCM_STREAM_CAPTURE : SND_PCM_STREAM_PLAYBACK;
+    auto result = snd_pcm_open(&pcm, device.c_str(), stream, 0);
+
+    if (result < 0) {
+        log_error("could not open ALSA device ", device, ": ", snd_strerror(result));
+        pcm = nullptr;
+        return false;
+    }
+
+    auto latency = format.block_period().count() * ALSA_BUFFER_BLOCKS;
+    result = snd_pcm_set_params(pcm, SND_PCM_FORMAT_S16, SND_PCM_ACCESS_RW_INTERLEAVED,
+                                format.channels, format.rate, 1, latency);
+
+    if (result < 0) {
+        log_error("could not set up ALSA device ", device, ": ", snd_strerror(result));
+        close();
+        return false;
+    }
+
+    if (which == direction::capture) snd_pcm_start(pcm);
+
+    return true;
+}
+
+bool alsa_audio::recover(const int& error_in) {
+    auto result = snd_pcm_recover(pcm, error_in, 1);
+
+    if (result < 0) {
+        log_error("could not recover ALSA device ", device, ": ", snd_strerror(result));
+        return false;
+    }
+
+    if (which == direction::capture) snd_pcm_start(pcm);
+    return true;
+}
+
+audio_backend::status alsa_audio::transfer(float* block_inout) {
+    if (pcm == nullptr) return status::failed;
+
+    auto samples = format.block_samples();
+    auto frames = (snd_pcm_uframes_t)format.block_frames;
+    snd_pcm_uframes_t done = 0;
+    bool lost = false;
+
+    if (which == direction::playback) {
+        dsp_get_kernels().f32_to_s16(block_inout, raw.data(), samples);
+    }
+
+    while(done < frames) {
+        auto position = raw.data() + done * format.channels;
+        auto result = which == direction::capture
+                    ? snd_pcm_readi(pcm, position, frames - done)
+                    : snd_pcm_writei(pcm, position, frames - done);
+
+        if (result == -EAGAIN) continue;
+
+        if (result < 0) {
+            if (! recover(result)) return status::failed;
+            lost = true;
+            continue;
+        }
+
+        done += result;
+    }
+
+    if (which == direction::capture) {
+        dsp_get_kernels().s16_to_f32(raw.data(), block_inout, samples);
+    }
+
+    return lost ? status::xrun : status::ok;
+}
+
+void alsa_audio::close() {
+    if (pcm == nullptr) return;
+
+    if (which == direction::playback) snd_pcm_drain(pcm);
+    snd_pcm_close(pcm);
+    pcm = nullptr;
+}
+
+// captured frames that were not read yet or written frames that were not
+// played yet
+std::chrono::microseconds alsa_audio::get_delay() {
+    snd_pcm_sframes_t frames = 0;
+    if (pcm == nullptr || snd_pcm_delay(pcm, &frames) < 0 || frames < 0) return std::chrono::microseconds(0);
+    return std::chrono::microseconds(frames * 1000000LL / format.rate);
+}
+
+std::shared_ptr<audio_backend> make_alsa_audio(const std::string& device_in) {
+    return std::make_shared<alsa_audio>(device_in);
+}
+
+}
@@ -0,0 +1,426 @@
+/*
+ * audio.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <thread>
+
+#include "audio.h"
+#include "dsp.h"
+#include "logging.h"
+#include "system.h"
+#include "system.unix.h"
+
+namespace oemros {
+
+// SCHED_FIFO priority of the audio threads
+#define AUDIO_REALTIME_PRIORITY 70
+// a paced backend this many blocks behind gives up catching up
+#define AUDIO_MAX_LAG_BLOCKS 8
+#define AUDIO_WAV_HEADER_BYTES 44
+#define AUDIO_WAV_PCM 1
+#define AUDIO_WAV_FLOAT 3
+#define AUDIO_WAV_EXTENSIBLE 0xFFFE
+
+audio_ring::audio_ring(const size_t& block_size_in, const size_t& blocks_in)
+: block_size(block_size_in), queue(block_size_in * blocks_in + 1) {
+    assert(block_size > 0);
+    assert(blocks_in > 0);
+}
+
+// spsc_queue takes partial pushes so the space is checked first
+bool audio_ring::push_block(const float* block_in) {
+    if (queue.write_available() < block_size) {
+        overruns++;
+        return false;
+    }
+
+    queue.push(block_in, block_size);
+    return true;
+}
+
+bool audio_ring::pop_block(float* block_out) {
+    if (queue.read_available() < block_size) return false;
+
+    queue.pop(block_out, block_size);
+    return true;
+}
+
+size_t audio_ring::readable() const {
+    return queue.read_available() / block_size;
+}
+
+size_t audio_ring::writable() const {
+    return queue.write_available() / block_size;
+}
+
+void audio_ring::drain() {
+    queue.consume_all([](const float&) { });
+}
+
+// keeps a backend with no clock of its own running at the sample rate; a
+// caller that fell far behind starts over from now instead of bursting
+static void audio_pace(std::chrono::steady_clock::time_point& next_block_in, const std::chrono::microseconds& period_in) {
+    auto now = std::chrono::steady_clock::now();
+
+    next_block_in += period_in;
+    if (next_block_in + period_in * AUDIO_MAX_LAG_BLOCKS < now) next_block_in = now;
+    if (next_block_in > now) std::this_thread::sleep_until(next_block_in);
+}
+
+bool null_audio::open(const direction& direction_in, audio_format& format_inout) {
+    which = direction_in;
+    period = format_inout.block_period();
+    block_samples = format_inout.block_samples();
+    next_block = std::chrono::steady_clock::now();
+    return true;
+}
+
+audio_backend::status null_audio::transfer(float* block_inout) {
+    if (which == direction::capture) std::fill(block_inout, block_inout + block_samples, 0.0f);
+    audio_pace(next_block, period);
+    return status::ok;
+}
+
+static uint32_t wav_get32(const uint8_t* bytes_in) {
+    return bytes_in[0] | bytes_in[1] << 8 | bytes_in[2] << 16 | (uint32_t)bytes_in[3] << 24;
+}
+
+static uint16_t wav_get16(const uint8_t* bytes_in) {
+    return bytes_in[0] | bytes_in[1] << 8;
+}
+
+static void wav_put32(uint8_t* bytes_out, const uint32_t& value_in) {
+    for(size_t i = 0; i < 4; i++) bytes_out[i] = value_in >> (i * 8);
+}
+
+static void wav_put16(uint8_t* bytes_out, const uint16_t& value_in) {
+    bytes_out[0] = value_in;
+    bytes_out[1] = value_in >> 8;
+}
+
+wav_audio::~wav_audio() {
+    close();
+}
+
+// walks the chunks until the data chunk and leaves the file at its start
+bool wav_audio::read_header(audio_format& format_inout) {
+    uint8_t riff[12];
+    if (fread(riff, 1, sizeof(riff), file) != sizeof(riff)) return false;
+    if (memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) return false;
+
+    bool have_format = false;
+
+    while(1) {
+        uint8_t chunk[8];
+        if (fread(chunk, 1, sizeof(chunk), file) != sizeof(chunk)) return false;
+
+        auto size = wav_get32(chunk + 4);
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            uint8_t fmt[40] = { 0 };
+            auto wanted = std::min<size_t>(size, sizeof(fmt));
+            if (fread(fmt, 1, wanted, file) != wanted) return false;
+            if (size > wanted && fseek(file, size - wanted, SEEK_CUR) != 0) return false;
+
+            auto tag = wav_get16(fmt);
+            // the real format of an extensible file is in its subformat
+            if (tag == AUDIO_WAV_EXTENSIBLE && size >= 26) tag = wav_get16(fmt + 24);
+
+            format_inout.channels = wav_get16(fmt + 2);
+            format_inout.rate = wav_get32(fmt + 4);
+            file_bits = wav_get16(fmt + 14);
+            file_float = tag == AUDIO_WAV_FLOAT;
+
+            if (tag != AUDIO_WAV_PCM && tag != AUDIO_WAV_FLOAT) return false;
+            if (file_float && file_bits != 32) return false;
+            if (! file_float && file_bits != 16 && file_bits != 32) return false;
+            if (format_inout.channels == 0 || format_inout.rate == 0) return false;
+
+            have_format = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            data_bytes = data_left = size;
+            return have_format;
+        } else if (fseek(file, size + (size & 1), SEEK_CUR) != 0) {
+            return false;
+        }
+    }
+}
+
+// the sizes are filled in again by close()
+bool wav_audio::write_header() {
+    uint8_t header[AUDIO_WAV_HEADER_BYTES];
+    auto block_align = format.channels * 4;
+
+    memcpy(header, "RIFF", 4);
+    wav_put32(header + 4, 36 + data_bytes);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    wav_put32(header + 16, 16);
+    wav_put16(header + 20, AUDIO_WAV_FLOAT);
+    wav_put16(header + 22, format.channels);
+    wav_put32(header + 24, format.rate);
+    wav_put32(header + 28, format.rate * block_align);
+    wav_put16(header + 32, block_align);
+    wav_put16(header + 34, 32);
+    memcpy(header + 36, "data", 4);
+    wav_put32(header + 40, data_bytes);
+
+    return fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+bool wav_audio::open(const direction& direction_in, audio_format& format_inout) {
+    close();
+
+    which = direction_in;
+    data_bytes = data_left = 0;
+    file = fopen(path.c_str(), which == direction::capture ? "rb" : "wb");
+
+    if (file == nullptr) {
+        log_error("could not open ", path, ": ", errno_str(errno));
+        return false;
+    }
+
+    if (which == direction::capture) {
+        if (! read_header(format_inout)) {
+            log_error("could not read a WAV header from ", path);
+            close();
+            return false;
+        }
+    } else {
+        file_bits = 32;
+        file_float = true;
+        format = format_inout;
+        if (! write_header()) {
+            log_error("could not write WAV header to ", path);
+            close();
+            return false;
+        }
+    }
+
+    format = format_inout;
+    raw.resize(format.block_samples() * file_bits / 8);
+    period = format.block_period();
+    next_block = std::chrono::steady_clock::now();
+
+    return true;
+}
+
+audio_backend::status wav_audio::transfer(float* block_inout) {
+    if (file == nullptr) return status::failed;
+
+    auto samples = format.block_samples();
+    auto sample_bytes = file_bits / 8;
+
+    if (which == direction::playback) {
+        memcpy(raw.data(), block_inout, samples * sizeof(float));
+        if (fwrite(raw.data(), sample_bytes, samples, file) != samples) return status::failed;
+        data_bytes += samples * sample_bytes;
+    } else {
+        size_t got = 0;
+
+        while(got < samples) {
+            if (data_left < sample_bytes) {
+                if (! loop || data_bytes < sample_bytes) break;
+                if (fseek(file, -(long)(data_bytes - data_left), SEEK_CUR) != 0) return status::failed;
+                data_left = data_bytes;
+            }
+
+            auto wanted = std::min<uint64_t>(samples - got, data_left / sample_bytes);
+            auto read = fread(raw.data() + got * sample_bytes, sample_bytes, wanted, file);
+            data_left -= read * sample_bytes;
+            got += read;
+            if (read < wanted) {
+                data_left = 0;
+                break;
+            }
+        }
+
+        if (got == 0) return status::ended;
+
+        // samples are little endian in the file and used as they are like
+        // the float ones are when written
+        if (file_float) {
+            memcpy(block_inout, raw.data(), got * sizeof(float));
+        } else if (file_bits == 16) {
+            dsp_get_kernels().s16_to_f32(reinterpret_cast<const int16_t*>(raw.data()), block_inout, got);
+        } else {
+            dsp_get_kernels().s32_to_f32(reinterpret_cast<const int32_t*>(raw.data()), block_inout, got);
+        }
+
+        std::fill(block_inout + got, block_inout + samples, 0.0f);
+    }
+
+    if (paced) audio_pace(next_block, period);
+
+    return status::ok;
+}
+
+void wav_audio::close() {
+    if (file == nullptr) return;
+
+    if (which == direction::playback) {
+        if (fseek(file, 0, SEEK_SET) != 0 || ! write_header()) {
+            log_error("could not finish WAV header of ", path);
+        }
+    }
+
+    fclose(file);
+    file = nullptr;
+}
+
+std::shared_ptr<audio_backend> make_audio_backend(const std::string& engine_in, const std::string& device_in) {
+    if (engine_in == "null") return std::make_shared<null_audio>();
+    if (engine_in == "wav") return std::make_shared<wav_audio>(device_in);
+
+#ifdef OEMROS_ALSA
+    if (engine_in == "alsa") return make_alsa_audio(device_in);
+#endif
+
+    return nullptr;
+}
+
+audio_stream::audio_stream(const std::string& name_in, const direction& direction_in, std::shared_ptr<audio_backend> backend_in,
+                           const audio_format& format_in, const size_t& ring_blocks_in)
+: backend(backend_in), format(format_in), ring(format_in.block_samples(), ring_blocks_in), which(direction_in), name(name_in) {
+    assert(backend != nullptr);
+}
+
+audio_stream::~audio_stream() {
+    stop();
+}
+
+// the ring is sized for the format asked for so a device that wants a
+// different block size is refused
+bool audio_stream::start() {
+    if (running) return true;
+
+    auto wanted_samples = format.block_samples();
+
+    if (! backend->open(which, format)) {
+        log_error("could not open audio device for ", name);
+        return false;
+    }
+
+    if (format.block_samples() != wanted_samples) {
+        log_error("audio device for ", name, " has ", format.channels, " channels which is not what was asked for");
+        backend->close();
+        return false;
+    }
+
+    // a stream that ended on its own still has its thread around
+    if (worker.joinable()) worker.join();
+
+    ended = false;
+    running = true;
+    worker = boost::thread([this] { be_worker(); });
+
+    return true;
+}
+
+void audio_stream::stop() {
+    running = false;
+    if (worker.joinable()) worker.join();
+}
+
+audio_stream::stats_type audio_stream::get_stats() const {
+    stats_type result;
+
+    result.blocks = blocks;
+    result.xruns = xruns;
+    result.overruns = ring.overruns;
+    result.underruns = underruns;
+    result.running = running;
+    result.ended = ended;
+
+    return result;
+}
+
+void audio_stream::be_worker() {
+    if (! oemros_unix::os_set_thread_realtime(AUDIO_REALTIME_PRIORITY)) {
+        log_verbose("audio thread for ", name, " could not get realtime priority");
+    }
+
+    std::vector<float> block(format.block_samples());
+    bool playing = false;
+
+    while(running) {
+        if (which == direction::playback) {
+            if (ring.pop_block(block.data())) {
+                playing = true;
+                if (handler) handler(block.data(), block.size());
+            } else {
+                // silence between transmissions is not an underrun
+                if (playing) underruns++;
+                playing = false;
+                std::fill(block.begin(), block.end(), 0.0f);
+            }
+        }
+
+        auto result = backend->transfer(block.data());
+
+        if (result == audio_backend::status::xrun) {
+            xruns++;
+        } else if (result == audio_backend::status::ended) {
+            log_verbose("audio for ", name, " ended");
+            ended = true;
+            break;
+        } else if (result == audio_backend::status::failed) {
+            log_error("audio device for ", name, " failed");
+            break;
+        }
+
+        blocks++;
+
+        if (which == direction::capture) {
+            if (handler) handler(block.data(), block.size());
+            if (queueing) ring.push_block(block.data());
+        }
+    }
+
+    backend->close();
+    running = false;
+}
+
+audio_engine::~audio_engine() {
+    stop();
+}
+
+std::shared_ptr<audio_stream> audio_engine::add(const std::string& name_in, const audio_stream::direction& direction_in,
+                                                const std::string& engine_in, const std::string& device_in, const audio_format& format_in,
+                                                const size_t& ring_blocks_in) {
+    auto backend = make_audio_backend(engine_in, device_in);
+
+    if (backend == nullptr) {
+        log_error("unknown audio engine for ", name_in, ": ", engine_in);
+        return nullptr;
+    }
+
+    auto stream = std::make_shared<audio_stream>(name_in, direction_in, backend, format_in, ring_blocks_in);
+    streams.push_back(stream);
+    return stream;
+}
+
+void audio_engine::stop() {
+    for(auto&& i : streams) i->stop();
+}
+
+}
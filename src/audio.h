@@ -0,0 +1,242 @@
+/*
+ * audio.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <boost/lockfree/spsc_queue.hpp>
+#include <boost/thread.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "object.h"
+
+namespace oemros {
+
+// samples are float from -1 to 1 and interleaved when there is more than
+// one channel; audio always moves in whole blocks of block_frames frames
+struct audio_format {
+    unsigned int rate = 48000;
+    unsigned int channels = 1;
+    size_t block_frames = 256;
+
+    size_t block_samples() const { return block_frames * channels; }
+    std::chrono::microseconds block_period() const {
+        return std::chrono::microseconds(block_frames * 1000000ULL / rate);
+    }
+};
+
+// Moves whole blocks from exactly one producer thread to exactly one
+// consumer thread without locks. A block that does not fit is dropped and
+// counted as an overrun; asking for a block that is not there is counted
+// as an underrun by the caller.
+class audio_ring {
+    private:
+        const size_t block_size;
+        boost::lockfree::spsc_queue<float> queue;
+
+    public:
+        std::atomic<uint64_t> overruns{0};
+
+        audio_ring(const size_t& block_size_in, const size_t& blocks_in);
+        size_t get_block_size() const { return block_size; }
+        // producer only
+        bool push_block(const float* block_in);
+        // consumer only
+        bool pop_block(float* block_out);
+        // blocks the consumer could pop right now
+        size_t readable() const;
+        // producer only; blocks that would fit right now
+        size_t writable() const;
+        // consumer only; throws away everything queued
+        void drain();
+};
+
+// One audio device in one direction. transfer() moves one block and blocks
+// for as long as the device needs to keep real time.
+class audio_backend : public baseobj {
+    public:
+        enum class direction {
+            capture,
+            playback,
+        };
+
+        enum class status {
+            ok,
+            // the device lost samples but has recovered
+            xrun,
+            // a capture file has nothing more to give
+            ended,
+            failed,
+        };
+
+        // the backend may change the format to what the device can do
+        virtual bool open(const direction& direction_in, audio_format& format_inout) = 0;
+        virtual status transfer(float* block_inout) = 0;
+        virtual void close() = 0;
+        // how much audio sits in the device between transfer() and the
+        // outside world; only called from the thread that calls transfer()
+        virtual std::chrono::microseconds get_delay() { return std::chrono::microseconds(0); }
+};
+
+// capture makes silence and playback throws the audio away; both keep real time
+class null_audio : public audio_backend {
+    private:
+        std::chrono::microseconds period{0};
+        std::chrono::steady_clock::time_point next_block;
+        size_t block_samples = 0;
+        direction which = direction::capture;
+
+    public:
+        virtual bool open(const direction& direction_in, audio_format& format_inout) override;
+        virtual status transfer(float* block_inout) override;
+        virtual void close() override { }
+};
+
+// Capture reads a WAV file and playback writes one. 16 and 32 bit integer
+// and 32 bit float files can be read; written files are 32 bit float. With
+// paced set the file moves at the speed of the sample rate like a sound
+// card would and otherwise as fast as the caller goes.
+class wav_audio : public audio_backend {
+    private:
+        const std::string path;
+        FILE* file = nullptr;
+        direction which = direction::capture;
+        audio_format format;
+        unsigned int file_bits = 32;
+        bool file_float = true;
+        uint64_t data_bytes = 0;
+        uint64_t data_left = 0;
+        std::vector<uint8_t> raw;
+        std::chrono::microseconds period{0};
+        std::chrono::steady_clock::time_point next_block;
+
+        bool read_header(audio_format& format_inout);
+        bool write_header();
+
+    public:
+        bool paced = true;
+        // start the file over when it runs out instead of ending
+        bool loop = false;
+
+        wav_audio(const std::string& path_in) : path(path_in) { }
+        ~wav_audio();
+        virtual bool open(const direction& direction_in, audio_format& format_inout) override;
+        virtual status transfer(float* block_inout) override;
+        virtual void close() override;
+};
+
+// engine_in is alsa, wav or null like audio.engine in the config and
+// device_in is what audio.device says
+std::shared_ptr<audio_backend> make_audio_backend(const std::string& engine_in, const std::string& device_in);
+
+#ifdef OEMROS_ALSA
+std::shared_ptr<audio_backend> make_alsa_audio(const std::string& device_in);
+#endif
+
+// A device in one direction with its own thread that runs at realtime
+// priority when the system allows it. Capture blocks go into the ring and
+// playback blocks come out of it; the other end of the ring belongs to
+// whoever is using the stream. A block handler runs on the audio thread for
+// each captured block before it is queued or for each block taken from the
+// ring before it is played and must not block or allocate.
+class audio_stream : public baseobj {
+    public:
+        using direction = audio_backend::direction;
+        using handler_type = std::function<void (float* block_inout, const size_t& samples_in)>;
+
+        struct stats_type {
+            uint64_t blocks = 0;
+            // lost by the device
+            uint64_t xruns = 0;
+            // captured blocks nobody took in time
+            uint64_t overruns = 0;
+            // playback ran dry in the middle of something
+            uint64_t underruns = 0;
+            bool running = false;
+            bool ended = false;
+        };
+
+    private:
+        std::shared_ptr<audio_backend> backend;
+        audio_format format;
+        audio_ring ring;
+        handler_type handler;
+        bool queueing = true;
+        std::atomic<bool> running{false};
+        std::atomic<bool> ended{false};
+        std::atomic<uint64_t> blocks{0};
+        std::atomic<uint64_t> xruns{0};
+        std::atomic<uint64_t> underruns{0};
+        boost::thread worker;
+
+        void be_worker();
+
+    public:
+        const direction which;
+        const std::string name;
+
+        audio_stream(const std::string& name_in, const direction& direction_in, std::shared_ptr<audio_backend> backend_in,
+                     const audio_format& format_in, const size_t& ring_blocks_in = 8);
+        ~audio_stream();
+        // opens the device; the format may change to what the device can do
+        bool start();
+        void stop();
+        const audio_format& get_format() const { return format; }
+        // handler only; for capture how long ago the device had the newest
+        // sample of the block and for playback how long until the device
+        // plays the first sample of the block
+        std::chrono::microseconds get_device_delay() { return backend->get_delay(); }
+        // set before start()
+        void set_handler(const handler_type& handler_in) { handler = handler_in; }
+        // capture only and set before start(); when off blocks only go to
+        // the handler
+        void set_queueing(const bool& queueing_in) { queueing = queueing_in; }
+        // capture only; false if no block was ready
+        bool read(float* block_out) { return ring.pop_block(block_out); }
+        size_t readable() const { return ring.readable(); }
+        // playback only; false if the ring was full and the block was dropped
+        bool write(const float* block_in) { return ring.push_block(block_in); }
+        // playback only; blocks write() would take right now
+        size_t writable() const { return ring.writable(); }
+        stats_type get_stats() const;
+};
+
+// Owns every audio stream so they can be listed and shut down together.
+class audio_engine : public baseobj {
+    private:
+        std::vector<std::shared_ptr<audio_stream>> streams;
+
+    public:
+        ~audio_engine();
+        std::shared_ptr<audio_stream> add(const std::string& name_in, const audio_stream::direction& direction_in,
+                                          const std::string& engine_in, const std::string& device_in, const audio_format& format_in,
+                                          const size_t& ring_blocks_in = 8);
+        const std::vector<std::shared_ptr<audio_stream>>& get_streams() const { return streams; }
+        void stop();
+};
+
+}
@@ -0,0 +1,626 @@
+/*
+ * bench_dsp.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+// Checks every set of DSP kernels this CPU can run against the scalar ones,
+// checks that the tone decoder finds every CTCSS tone and DCS code under
+// voice and finds nothing in voice or noise alone and checks that the
+// spectrum puts full scale tones in the right bins at 0 dBFS for audio and
+// IQ, holds and lets go of peaks and that its ring turns away a viewer the
+// writer has lapped. Then it reports how fast
+// each kernel in each set goes and how many channels a tone decoder can keep
+// up with. The exit status is not 0 if any check failed.
+//
+// usage: bench_dsp [seconds per kernel] [samples per block]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "dsp.h"
+#include "logging.h"
+#include "spectrum.h"
+#include "tone.h"
+
+using clock_type = std::chrono::steady_clock;
+using oemros::dsp_kernels;
+
+// sums may be added up in a different order but nothing else may differ
+#define BENCH_SUM_TOLERANCE 1e-9
+#define BENCH_GOERTZEL_BINS 56
+#define BENCH_TONE_RATE 48000
+#define BENCH_FFT_SIZE 2048
+// audio each tone is checked against and the levels in it
+#define BENCH_TONE_SECONDS 2.0
+#define BENCH_TONE_LEVEL 0.1
+#define BENCH_VOICE_LEVEL 0.3
+#define BENCH_NOISE_LEVEL 0.02
+// audio with no tone that nothing may be found in
+#define BENCH_QUIET_SECONDS 20.0
+#define BENCH_DCS_BAUD 134.4
+// a full scale tone right on a bin reads 0 dBFS to within this
+#define BENCH_SPECTRUM_DB 0.05
+// the image of an IQ tone stays under this
+#define BENCH_SPECTRUM_IMAGE_DB -100
+// a tone that stopped a second ago has averaged out to under this
+#define BENCH_SPECTRUM_GONE_DB -60
+
+static std::vector<float> make_floats(std::mt19937& random_in, const size_t& count_in) {
+    std::uniform_real_distribution<float> full_scale(-1.0f, 1.0f);
+    std::uniform_int_distribution<int> pick(0, 31);
+    std::vector<float> result(count_in);
+
+    // mostly normal audio with the values at and past the edges mixed in
+    for(auto&& i : result) {
+        switch(pick(random_in)) {
+        case 0: i = 1.0f; break;
+        case 1: i = -1.0f; break;
+        case 2: i = full_scale(random_in) * 70000.0f; break;
+        case 3: i = std::numeric_limits<float>::quiet_NaN(); break;
+        case 4: i = 0.5f / 32768.0f; break;
+        default: i = full_scale(random_in);
+        }
+    }
+
+    return result;
+}
+
+template <typename T>
+static std::vector<T> make_integers(std::mt19937& random_in, const size_t& count_in) {
+    std::uniform_int_distribution<T> full_scale(std::numeric_limits<T>::min(), std::numeric_limits<T>::max());
+    std::vector<T> result(count_in);
+    for(auto&& i : result) i = full_scale(random_in);
+    return result;
+}
+
+// NaN in the same place counts as the same
+static bool same_floats(const std::vector<float>& left_in, const std::vector<float>& right_in) {
+    for(size_t i = 0; i < left_in.size(); i++) {
+        if (std::isnan(left_in[i]) && std::isnan(right_in[i])) continue;
+        if (std::memcmp(&left_in[i], &right_in[i], sizeof(float)) != 0) return false;
+    }
+
+    return true;
+}
+
+static bool close_enough(const double& left_in, const double& right_in) {
+    return std::fabs(left_in - right_in) <= BENCH_SUM_TOLERANCE * std::max(1.0, std::fabs(right_in));
+}
+
+// every length up to a few vectors long so each tail gets used and some
+// long ones; start offsets move the data off of vector alignment
+static size_t check(const dsp_kernels& kernels_in) {
+    const auto& scalar = oemros::dsp_scalar_kernels;
+    std::mt19937 random(1);
+    size_t failures = 0;
+
+    auto fail = [&](const char* kernel_in, const size_t& count_in) {
+        std::cout << "    " << kernels_in.name << " " << kernel_in << " differs from scalar with " << count_in << " samples" << std::endl;
+        failures++;
+    };
+
+    std::vector<size_t> counts;
+    for(size_t i = 0; i <= 40; i++) counts.push_back(i);
+    counts.push_back(4099);
+    counts.push_back(65536);
+
+    for(auto count : counts) {
+        for(size_t start = 0; start < 3; start++) {
+            auto floats = make_floats(random, count + start);
+            auto s16 = make_integers<int16_t>(random, count + start);
+            auto s32 = make_integers<int32_t>(random, count + start);
+
+            std::vector<float> float_want(count), float_got(count);
+            std::vector<int16_t> s16_want(count), s16_got(count);
+            std::vector<int32_t> s32_want(count), s32_got(count);
+
+            scalar.s16_to_f32(s16.data() + start, float_want.data(), count);
+            kernels_in.s16_to_f32(s16.data() + start, float_got.data(), count);
+            if (! same_floats(float_want, float_got)) fail("s16_to_f32", count);
+
+            scalar.s32_to_f32(s32.data() + start, float_want.data(), count);
+            kernels_in.s32_to_f32(s32.data() + start, float_got.data(), count);
+            if (! same_floats(float_want, float_got)) fail("s32_to_f32", count);
+
+            scalar.f32_to_s16(floats.data() + start, s16_want.data(), count);
+            kernels_in.f32_to_s16(floats.data() + start, s16_got.data(), count);
+            if (s16_want != s16_got) fail("f32_to_s16", count);
+
+            scalar.f32_to_s32(floats.data() + start, s32_want.data(), count);
+            kernels_in.f32_to_s32(floats.data() + start, s32_got.data(), count);
+            if (s32_want != s32_got) fail("f32_to_s32", count);
+
+            float_want.assign(floats.begin() + start, floats.end());
+            float_got = float_want;
+            scalar.ramp_gain(float_want.data(), count, 0.25f, 1.0f / 4096);
+            kernels_in.ramp_gain(float_got.data(), count, 0.25f, 1.0f / 4096);
+            if (! same_floats(float_want, float_got)) fail("ramp_gain", count);
+
+            float_want.assign(floats.begin() + start, floats.end());
+            float_got = float_want;
+            scalar.offset(float_want.data(), count, -0.125f);
+            kernels_in.offset(float_got.data(), count, -0.125f);
+            if (! same_floats(float_want, float_got)) fail("offset", count);
+
+            // NaN would make every sum NaN so measure takes real audio
+            auto audio = floats;
+            for(auto&& i : audio) if (std::isnan(i)) i = 0;
+
+            float peak_want, peak_got;
+            double sum_want, sum_got, squares_want, squares_got;
+            scalar.measure(audio.data() + start, count, &peak_want, &sum_want, &squares_want);
+            kernels_in.measure(audio.data() + start, count, &peak_got, &sum_got, &squares_got);
+            if (std::memcmp(&peak_want, &peak_got, sizeof(float)) != 0 || ! close_enough(sum_got, sum_want)
+                || ! close_enough(squares_got, squares_want)) fail("measure", count);
+        }
+    }
+
+    // a bank of every width a tone decoder could use run over one run of
+    // audio and then carried on over a second like a decoder would
+    for(size_t bins = oemros::dsp_bank_width; bins <= 8 * oemros::dsp_bank_width; bins += oemros::dsp_bank_width) {
+        auto audio = make_floats(random, 400);
+        for(auto&& i : audio) if (std::isnan(i) || std::fabs(i) > 1) i = 0;
+
+        std::vector<float> coefficients(bins);
+        for(size_t i = 0; i < bins; i++) coefficients[i] = 2 * std::cos(2 * M_PI * (60 + i * 3.7) / 1600);
+
+        std::vector<float> s1_want(bins, 0), s2_want(bins, 0), s1_got(bins, 0), s2_got(bins, 0);
+        for(size_t half = 0; half < 2; half++) {
+            scalar.goertzel(audio.data() + half * 200, 200, coefficients.data(), s1_want.data(), s2_want.data(), bins);
+            kernels_in.goertzel(audio.data() + half * 200, 200, coefficients.data(), s1_got.data(), s2_got.data(), bins);
+        }
+
+        if (! same_floats(s1_want, s1_got) || ! same_floats(s2_want, s2_got)) fail("goertzel", bins);
+    }
+
+    // every pass of a transform and then the whole transform
+    for(size_t size = 2; size <= 4096; size *= 2) {
+        auto re = make_floats(random, size), im = make_floats(random, size);
+        for(auto&& i : re) if (std::isnan(i) || std::fabs(i) > 1) i = 0;
+        for(auto&& i : im) if (std::isnan(i) || std::fabs(i) > 1) i = 0;
+
+        std::vector<float> twiddle_re(size / 2), twiddle_im(size / 2);
+        for(size_t k = 0; k < size / 2; k++) {
+            twiddle_re[k] = std::cos(M_PI * k / size);
+            twiddle_im[k] = -std::sin(M_PI * k / size);
+        }
+
+        for(size_t half = 1; half < size; half *= 2) {
+            auto re_want = re, im_want = im, re_got = re, im_got = im;
+            scalar.fft_stage(re_want.data(), im_want.data(), size, half, twiddle_re.data(), twiddle_im.data());
+            kernels_in.fft_stage(re_got.data(), im_got.data(), size, half, twiddle_re.data(), twiddle_im.data());
+            if (! same_floats(re_want, re_got) || ! same_floats(im_want, im_got)) fail("fft_stage", half);
+        }
+
+        auto re_want = re, im_want = im, re_got = re, im_got = im;
+        oemros::dsp_fft(size, scalar).forward(re_want.data(), im_want.data());
+        oemros::dsp_fft(size, kernels_in).forward(re_got.data(), im_got.data());
+        if (! same_floats(re_want, re_got) || ! same_floats(im_want, im_got)) fail("fft", size);
+    }
+
+    return failures;
+}
+
+static void time_kernel(const char* name_in, const double& seconds_in, const size_t& samples_in, const std::function<void ()>& run_in) {
+    auto deadline = clock_type::now() + std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(seconds_in));
+    auto started = clock_type::now();
+    uint64_t blocks = 0;
+
+    // the clock is only looked at every so often so it does not show up
+    while(clock_type::now() < deadline) {
+        for(size_t i = 0; i < 64; i++) run_in();
+        blocks += 64;
+    }
+
+    auto elapsed = std::chrono::duration<double>(clock_type::now() - started).count();
+    auto per_second = blocks * samples_in / elapsed;
+
+    std::cout << "    " << std::left << std::setw(12) << name_in << std::right << std::setw(10) << per_second / 1e6 << " Msamples/sec "
+              << std::setw(8) << elapsed / blocks * 1e9 / samples_in << " nsec/sample" << std::endl;
+}
+
+static void bench(const dsp_kernels& kernels_in, const double& seconds_in, const size_t& samples_in) {
+    std::mt19937 random(2);
+    auto floats = make_floats(random, samples_in);
+    for(auto&& i : floats) if (std::isnan(i) || std::fabs(i) > 1) i = 0;
+    auto s16 = make_integers<int16_t>(random, samples_in);
+    auto s32 = make_integers<int32_t>(random, samples_in);
+    std::vector<float> float_out(samples_in);
+    std::vector<int16_t> s16_out(samples_in);
+    std::vector<int32_t> s32_out(samples_in);
+    float peak;
+    double sum, squares;
+
+    std::cout << kernels_in.name << ":" << std::endl;
+    time_kernel("s16_to_f32", seconds_in, samples_in, [&] { kernels_in.s16_to_f32(s16.data(), float_out.data(), samples_in); });
+    time_kernel("f32_to_s16", seconds_in, samples_in, [&] { kernels_in.f32_to_s16(floats.data(), s16_out.data(), samples_in); });
+    time_kernel("s32_to_f32", seconds_in, samples_in, [&] { kernels_in.s32_to_f32(s32.data(), float_out.data(), samples_in); });
+    time_kernel("f32_to_s32", seconds_in, samples_in, [&] { kernels_in.f32_to_s32(floats.data(), s32_out.data(), samples_in); });
+    // a gain of 1 keeps the samples from running off to infinity or 0
+    time_kernel("ramp_gain", seconds_in, samples_in, [&] { kernels_in.ramp_gain(floats.data(), samples_in, 1.0f, 0.0f); });
+    time_kernel("offset", seconds_in, samples_in, [&] { kernels_in.offset(floats.data(), samples_in, 0.0f); });
+    time_kernel("measure", seconds_in, samples_in, [&] { kernels_in.measure(floats.data(), samples_in, &peak, &sum, &squares); });
+
+    // a panadapter sized transform with the time per sample being per point
+    oemros::dsp_fft fft(BENCH_FFT_SIZE, kernels_in);
+    std::vector<float> re(BENCH_FFT_SIZE, 0), im(BENCH_FFT_SIZE, 0);
+    time_kernel("fft", seconds_in, BENCH_FFT_SIZE, [&] {
+        std::copy(floats.begin(), floats.begin() + std::min(samples_in, re.size()), re.begin());
+        std::fill(im.begin(), im.end(), 0.0f);
+        fft.forward(re.data(), im.data());
+    });
+
+    // a CTCSS sized bank with the time per sample being for all the bins
+    std::vector<float> coefficients(BENCH_GOERTZEL_BINS, 1.9f), s1(BENCH_GOERTZEL_BINS, 0), s2(BENCH_GOERTZEL_BINS, 0);
+    time_kernel("goertzel", seconds_in, samples_in, [&] {
+        kernels_in.goertzel(floats.data(), samples_in, coefficients.data(), s1.data(), s2.data(), BENCH_GOERTZEL_BINS);
+        // keeps the state from growing without bound
+        std::fill(s1.begin(), s1.end(), 0.0f);
+        std::fill(s2.begin(), s2.end(), 0.0f);
+    });
+}
+
+// something in the voice band for the tone filters to keep out; the
+// syllable rate keeps it from being steady
+static float bench_voice(std::mt19937& random_in, const double& t_in) {
+    std::normal_distribution<float> noise(0, BENCH_NOISE_LEVEL);
+    auto syllables = 0.5 + 0.5 * std::sin(2 * M_PI * 4 * t_in);
+    auto voice = 0.6 * std::sin(2 * M_PI * 450 * t_in) + 0.3 * std::sin(2 * M_PI * 900 * t_in + 1) + 0.1 * std::sin(2 * M_PI * 1800 * t_in + 2);
+    return BENCH_VOICE_LEVEL * syllables * voice + noise(random_in);
+}
+
+// of every code that shows up in some turn of word_in the one a radio
+// would report: sent the right way up first and then the lowest
+static oemros::tone_code bench_dcs_expected(const uint32_t& word_in) {
+    oemros::tone_code best;
+
+    for(size_t turn = 0; turn < 23; turn++) {
+        auto turned = ((word_in >> turn) | (word_in << (23 - turn))) & 0x7fffff;
+
+        for(auto inverted : { false, true }) {
+            for(auto code : oemros::dcs_codes()) {
+                auto word = oemros::dcs_word(code);
+                if (inverted) word = ~word & 0x7fffff;
+                if (word != turned) continue;
+
+                auto candidate = oemros::tone_code::dcs(code, inverted);
+                auto better = best.kind == oemros::tone_code::kind_type::none
+                            || (candidate.inverted != best.inverted ? ! candidate.inverted : candidate.value < best.value);
+                if (better) best = candidate;
+            }
+        }
+    }
+
+    return best;
+}
+
+// runs audio_in through a new decoder; fails if it ends up on anything but
+// want_in or ever published something other than want_in on the way
+static size_t check_tone_run(const std::vector<float>& audio_in, const oemros::tone_code& want_in, const char* what_in) {
+    oemros::tone_decoder decoder(BENCH_TONE_RATE);
+    std::vector<oemros::tone_code> published;
+
+    auto watch = decoder.detected.subscribe([&](const oemros::value_source<oemros::tone_code>& detected_in) {
+        published.push_back(detected_in.get());
+    });
+
+    for(size_t i = 0; i < audio_in.size(); i += 256) {
+        decoder.process(audio_in.data() + i, std::min<size_t>(256, audio_in.size() - i));
+    }
+
+    size_t failures = 0;
+
+    for(auto&& i : published) {
+        if (i.kind == oemros::tone_code::kind_type::none || i == want_in) continue;
+        std::cout << "    " << what_in << " " << oemros::tone_name(want_in) << ": found " << oemros::tone_name(i) << " on the way" << std::endl;
+        failures++;
+    }
+
+    if (decoder.detected.get() != want_in) {
+        std::cout << "    " << what_in << " " << oemros::tone_name(want_in) << ": ended on " << oemros::tone_name(decoder.detected.get()) << std::endl;
+        failures++;
+    }
+
+    return failures;
+}
+
+// every tone and every code both ways up under voice and noise plus a long
+// run of each with no tone at all
+static size_t check_tone() {
+    std::mt19937 random(1);
+    std::uniform_real_distribution<double> start(0, 1);
+    std::vector<float> audio((size_t)(BENCH_TONE_SECONDS * BENCH_TONE_RATE));
+    size_t failures = 0;
+
+    for(auto hertz : oemros::ctcss_tones()) {
+        auto phase = 2 * M_PI * start(random);
+
+        for(size_t i = 0; i < audio.size(); i++) {
+            auto t = (double)i / BENCH_TONE_RATE;
+            audio[i] = BENCH_TONE_LEVEL * std::sin(2 * M_PI * hertz * t + phase) + bench_voice(random, t);
+        }
+
+        failures += check_tone_run(audio, oemros::tone_code::ctcss(hertz), "CTCSS");
+    }
+
+    for(auto inverted : { false, true }) {
+        for(auto code : oemros::dcs_codes()) {
+            auto word = oemros::dcs_word(code);
+            if (inverted) word = ~word & 0x7fffff;
+            // the receiver starts listening somewhere in the middle of a word
+            auto offset = start(random) * 23;
+
+            for(size_t i = 0; i < audio.size(); i++) {
+                auto t = (double)i / BENCH_TONE_RATE;
+                auto bit = (size_t)(t * BENCH_DCS_BAUD + offset) % 23;
+                auto level = (word >> bit) & 1 ? BENCH_TONE_LEVEL : - BENCH_TONE_LEVEL;
+                audio[i] = level + bench_voice(random, t);
+            }
+
+            failures += check_tone_run(audio, bench_dcs_expected(word), "DCS");
+        }
+    }
+
+    std::vector<float> quiet((size_t)(BENCH_QUIET_SECONDS * BENCH_TONE_RATE));
+    std::normal_distribution<float> noise(0, BENCH_TONE_LEVEL);
+
+    for(size_t i = 0; i < quiet.size(); i++) quiet[i] = bench_voice(random, (double)i / BENCH_TONE_RATE);
+    failures += check_tone_run(quiet, oemros::tone_code(), "voice");
+
+    for(auto&& i : quiet) i = noise(random);
+    failures += check_tone_run(quiet, oemros::tone_code(), "noise");
+
+    return failures;
+}
+
+// the newest frame of spectrum_in copied out; false if there is none
+static bool spectrum_frame(oemros::spectrum& spectrum_in, std::vector<float>& power_out, std::vector<float>& peak_out) {
+    auto& ring = spectrum_in.get_ring();
+
+    return ring.view(ring.latest(), [&](const oemros::spectrum_ring::view_type& view_in) {
+        power_out.assign(view_in.power, view_in.power + view_in.bins);
+        peak_out.assign(view_in.peak, view_in.peak + view_in.bins);
+    });
+}
+
+// one second of a full scale tone hertz_in from the center, or silence when
+// level_in is 0; IQ goes round the way positive frequencies do
+static void spectrum_feed(oemros::spectrum& spectrum_in, const double& hertz_in, const double& level_in, const double& seconds_in) {
+    auto& config = spectrum_in.get_config();
+    auto step = config.iq ? 2 : 1;
+    std::vector<float> block(256 * step);
+    size_t sample = 0;
+
+    for(size_t done = 0; done < seconds_in * config.rate; done += 256) {
+        for(size_t i = 0; i < 256; i++, sample++) {
+            auto phase = 2 * M_PI * hertz_in * sample / config.rate;
+            block[i * step] = level_in * std::cos(phase);
+            if (config.iq) block[i * step + 1] = level_in * std::sin(phase);
+        }
+
+        spectrum_in.process(block.data(), 256);
+    }
+}
+
+// a full scale tone on bin_in has to be the loudest bin at 0 dBFS and on
+// IQ the bin on the other side of the center has to stay empty; audio tones
+// are kept clear of 0 Hz where the window mixes in their negative image
+static size_t check_spectrum_tone(const bool& iq_in, const long& bin_in) {
+    oemros::spectrum_config config;
+    config.iq = iq_in;
+    config.size = BENCH_FFT_SIZE;
+    config.rate = BENCH_TONE_RATE;
+    oemros::spectrum spectrum(config);
+
+    auto hertz = bin_in * spectrum.get_hertz_per_bin();
+    auto want = (size_t)(bin_in - std::lround(spectrum.get_first_hertz() / spectrum.get_hertz_per_bin()));
+    spectrum_feed(spectrum, hertz, 1.0, 1.0);
+
+    std::vector<float> power, peak;
+    if (! spectrum_frame(spectrum, power, peak)) {
+        std::cout << "    spectrum published nothing" << std::endl;
+        return 1;
+    }
+
+    auto loudest = (size_t)(std::max_element(power.begin(), power.end()) - power.begin());
+    auto what = iq_in ? "IQ" : "audio";
+    size_t failures = 0;
+
+    if (loudest != want || std::fabs(power[want]) > BENCH_SPECTRUM_DB) {
+        std::cout << "    " << what << " tone at " << hertz << " Hz: loudest bin " << loudest << " at " << power[loudest]
+                  << " dBFS, wanted bin " << want << " at 0" << std::endl;
+        failures++;
+    }
+
+    auto image = (size_t)(2 * (long)(spectrum.get_bins() / 2) - (long)want);
+    if (iq_in && bin_in != 0 && power[image] > BENCH_SPECTRUM_IMAGE_DB) {
+        std::cout << "    IQ tone at " << hertz << " Hz: its image reads " << power[image] << " dBFS" << std::endl;
+        failures++;
+    }
+
+    return failures;
+}
+
+// peak hold falls back at the configured rate after the tone stops, holds
+// when that is 0 and starts over after reset_peak()
+static size_t check_spectrum_peak() {
+    size_t failures = 0;
+
+    for(auto decay : { 20.0f, 0.0f }) {
+        oemros::spectrum_config config;
+        config.size = BENCH_FFT_SIZE;
+        config.rate = BENCH_TONE_RATE;
+        config.peak_decay_db = decay;
+        oemros::spectrum spectrum(config);
+
+        auto bin = (size_t)100;
+        spectrum_feed(spectrum, bin * spectrum.get_hertz_per_bin(), 1.0, 1.0);
+        spectrum_feed(spectrum, 0, 0.0, 1.0);
+
+        std::vector<float> power, peak;
+        spectrum_frame(spectrum, power, peak);
+
+        // a second of silence is a second of decay give or take the frame
+        // it took the average to fall under the peak
+        auto want = -decay;
+        auto slop = std::max(2 * decay / config.frame_rate, (float)BENCH_SPECTRUM_DB);
+        if (power.empty() || power[bin] > BENCH_SPECTRUM_GONE_DB || std::fabs(peak[bin] - want) > slop) {
+            std::cout << "    peak decaying " << decay << " dB/s: power " << (power.empty() ? 0 : power[bin]) << " dBFS and peak "
+                      << (peak.empty() ? 0 : peak[bin]) << " dBFS a second after the tone, wanted the peak at " << want << std::endl;
+            failures++;
+        }
+
+        spectrum.reset_peak();
+        spectrum_feed(spectrum, 0, 0.0, 0.1);
+        spectrum_frame(spectrum, power, peak);
+
+        if (peak.empty() || peak[bin] > BENCH_SPECTRUM_GONE_DB) {
+            std::cout << "    peak decaying " << decay << " dB/s: still " << (peak.empty() ? 0 : peak[bin]) << " dBFS after a reset" << std::endl;
+            failures++;
+        }
+    }
+
+    return failures;
+}
+
+// a frame can be viewed until the writer comes around to its slot again
+// and a view the writer starts on while it is looking is thrown away
+static size_t check_spectrum_ring() {
+    oemros::spectrum_ring ring(4, 8);
+    size_t failures = 0;
+    float* power;
+    float* peak;
+
+    auto write = [&](const float& value_in) {
+        ring.begin(power, peak);
+        std::fill(power, power + ring.get_bins(), value_in);
+        std::fill(peak, peak + ring.get_bins(), value_in);
+        ring.publish(oemros::spectrum_ring::clock_type::now());
+    };
+
+    long seen = 0;
+    auto look = [&](const oemros::spectrum_ring::view_type& view_in) { seen = std::lround(view_in.power[0]); };
+
+    if (ring.view(0, look) || ring.view(1, look)) failures++;
+
+    write(1);
+    if (! ring.view(1, look) || seen != 1) failures++;
+
+    for(float i = 2; i <= 4; i++) write(i);
+    if (! ring.view(1, look) || ! ring.view(4, look) || seen != 4) failures++;
+
+    // the fifth frame goes where the first one was
+    write(5);
+    if (ring.view(1, look) || ! ring.view(5, look) || seen != 5) failures++;
+
+    // the sixth goes where the second one is while it is being looked at
+    if (ring.view(2, [&](const oemros::spectrum_ring::view_type&) { write(6); })) failures++;
+    if (ring.view(2, look) || ! ring.view(6, look) || seen != 6) failures++;
+
+    if (failures) std::cout << "    the spectrum ring let a lapped viewer through or turned away a good one" << std::endl;
+    return failures;
+}
+
+static size_t check_spectrum() {
+    size_t failures = 0;
+
+    for(auto bin : { 10L, 100L, 511L, 1000L }) failures += check_spectrum_tone(false, bin);
+    for(auto bin : { -1000L, -100L, 0L, 100L, 1000L }) failures += check_spectrum_tone(true, bin);
+    failures += check_spectrum_peak();
+    failures += check_spectrum_ring();
+
+    return failures;
+}
+
+// how many receive channels one core could decode tones on
+static void bench_tone(const double& seconds_in, const size_t& samples_in) {
+    std::vector<float> audio(BENCH_TONE_RATE);
+    for(size_t i = 0; i < audio.size(); i++) {
+        auto t = (double)i / BENCH_TONE_RATE;
+        audio[i] = 0.1 * std::sin(2 * M_PI * 100 * t) + 0.4 * std::sin(2 * M_PI * 800 * t);
+    }
+
+    oemros::tone_decoder decoder(BENCH_TONE_RATE);
+    size_t position = 0;
+
+    auto deadline = clock_type::now() + std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(seconds_in));
+    auto started = clock_type::now();
+    uint64_t samples = 0;
+
+    while(clock_type::now() < deadline) {
+        for(size_t i = 0; i < 64; i++) {
+            if (position + samples_in > audio.size()) position = 0;
+            decoder.process(audio.data() + position, samples_in);
+            position += samples_in;
+        }
+
+        samples += 64 * samples_in;
+    }
+
+    auto elapsed = std::chrono::duration<double>(clock_type::now() - started).count();
+    auto channels = samples / elapsed / BENCH_TONE_RATE;
+
+    std::cout << "tone decoder: " << channels << " channels per core at " << BENCH_TONE_RATE << " Hz, found "
+              << oemros::tone_name(decoder.detected.get()) << std::endl;
+}
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 0.5;
+    size_t samples = argc > 2 ? std::atoi(argv[2]) : 256;
+
+    auto logging = logjam::logengine::get_engine();
+    logging->add_destination(std::make_shared<oemros::log_console>(logjam::loglevel::error));
+    logging->start();
+
+    size_t failures = 0;
+    auto all = oemros::dsp_all_kernels();
+
+    std::cout << "checking against scalar" << std::endl;
+    for(auto i : all) {
+        if (i == &oemros::dsp_scalar_kernels) continue;
+        auto failed = check(*i);
+        std::cout << "    " << i->name << ": " << (failed ? "FAILED" : "ok") << std::endl;
+        failures += failed;
+    }
+
+    std::cout << "checking the tone decoder" << std::endl;
+    auto tone_failures = check_tone();
+    std::cout << "    " << (tone_failures ? "FAILED" : "ok") << std::endl;
+    failures += tone_failures;
+
+    std::cout << "checking the spectrum" << std::endl;
+    auto spectrum_failures = check_spectrum();
+    std::cout << "    " << (spectrum_failures ? "FAILED" : "ok") << std::endl;
+    failures += spectrum_failures;
+
+    std::cout << "default kernels: " << oemros::dsp_get_kernels().name << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for(auto i : all) bench(*i, seconds, samples);
+    bench_tone(seconds, samples);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,223 @@
+/*
+ * bench_ft8.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+// Decodes FT8 or FT4 slots over and over and reports how long a slot takes
+// with every stage in one job and split the way the decoder does by
+// default. Each file is one slot recorded from its start; the first
+// channel is decoded. With no files a busy slot is made up and the exit
+// status is not 0 if a signal that should have decoded did not.
+//
+// usage: bench_ft8 [ft8|ft4] [slot.wav ...]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "audio.h"
+#include "ft8.h"
+#include "logging.h"
+
+using oemros::ft8_mode;
+
+#define BENCH_RUNS 5
+#define BENCH_RATE 48000
+// made up signals run from this far under the noise in 2500 Hz up to 24 dB over it
+#define BENCH_WEAKEST_DB -20
+// made up signals this strong have to decode; FT4 needs about 3 dB more
+// than FT8 for its shorter symbols
+#define BENCH_REQUIRED_DB_FT8 -15
+#define BENCH_REQUIRED_DB_FT4 -12
+
+struct bench_result {
+    std::vector<oemros::ft8_message> messages;
+    double msec = 0;
+};
+
+// decodes the slot runs_in times and returns the messages of the last run
+// with the average time a slot took
+static bench_result decode(const ft8_mode& mode_in, const unsigned int& rate_in, const size_t& jobs_in,
+                           const std::vector<float>& slot_in, const size_t& runs_in) {
+    oemros::ft8_config config;
+    config.mode = mode_in;
+    config.rate = rate_in;
+    if (jobs_in != 0) config.jobs = jobs_in;
+
+    auto decoder = std::make_shared<oemros::ft8_decoder>(config);
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t done = 0;
+    bench_result result;
+    std::vector<oemros::ft8_message> messages;
+
+    auto decoded_subscription = decoder->decoded.subscribe([&](const oemros::ft8_message& message_in) {
+        std::lock_guard<std::mutex> lock(mutex);
+        messages.push_back(message_in);
+    });
+
+    auto finished_subscription = decoder->finished.subscribe([&](const oemros::ft8_slot_stats& stats_in) {
+        std::lock_guard<std::mutex> lock(mutex);
+        result.msec += stats_in.elapsed.count() / 1000.0;
+        done++;
+        finished.notify_all();
+    });
+
+    for(size_t i = 0; i < runs_in; i++) {
+        std::unique_lock<std::mutex> lock(mutex);
+        messages.clear();
+        lock.unlock();
+
+        decoder->decode_slot(slot_in.data(), slot_in.size(), oemros::ft8_decoder::clock_type::time_point());
+
+        lock.lock();
+        finished.wait(lock, [&] { return done > i; });
+    }
+
+    result.messages = messages;
+    result.msec /= runs_in;
+    return result;
+}
+
+static void report(const ft8_mode& mode_in, const unsigned int& rate_in, const std::vector<float>& slot_in) {
+    auto single = decode(mode_in, rate_in, 1, slot_in, BENCH_RUNS);
+    auto split = decode(mode_in, rate_in, 0, slot_in, BENCH_RUNS);
+
+    std::cout << std::fixed << std::setprecision(1);
+    for(auto& i : split.messages) {
+        std::cout << "    " << std::setw(6) << i.hertz << " Hz " << std::showpos << std::setw(5) << i.snr
+                  << " dB " << std::setprecision(2) << i.dt << std::noshowpos << std::setprecision(1) << " s  "
+                  << i.text << std::endl;
+    }
+
+    std::cout << "    " << split.messages.size() << " decoded; " << single.msec << " ms a slot in one job, "
+              << split.msec << " ms split up" << std::endl;
+}
+
+static bool read_slot(const std::string& path_in, const ft8_mode& mode_in, unsigned int& rate_out, std::vector<float>& slot_out) {
+    oemros::wav_audio file(path_in);
+    oemros::audio_format format;
+    file.paced = false;
+
+    if (! file.open(oemros::audio_backend::direction::capture, format)) return false;
+
+    auto wanted = (size_t)(oemros::ft8_slot_seconds(mode_in) * format.rate);
+    std::vector<float> block(format.block_samples());
+    rate_out = format.rate;
+    slot_out.clear();
+
+    while(slot_out.size() < wanted) {
+        auto status = file.transfer(block.data());
+        if (status == oemros::audio_backend::status::ended) break;
+        if (status == oemros::audio_backend::status::failed) return false;
+        for(size_t i = 0; i < format.block_frames; i++) slot_out.push_back(block[i * format.channels]);
+    }
+
+    slot_out.resize(wanted, 0.0f);
+    return true;
+}
+
+// every signal is a standard message at its own frequency with the
+// strength and start time stepping through their ranges
+static bool made_up(const ft8_mode& mode_in) {
+    auto spacing = mode_in == ft8_mode::ft8 ? 60.0f : 100.0f;
+    std::vector<float> slot((size_t)(oemros::ft8_slot_seconds(mode_in) * BENCH_RATE), 0.0f);
+    std::vector<std::pair<std::string, float>> sent;
+    std::mt19937 random(1);
+    std::normal_distribution<float> gaussian(0.0f, 0.01f);
+    // white noise spreads its power over half the sample rate
+    auto noise_2500 = 0.01 * 0.01 * 2500 / (BENCH_RATE / 2);
+
+    for(float hertz = 300; hertz < 2900; hertz += spacing) {
+        auto count = sent.size();
+        char text[32];
+        std::snprintf(text, sizeof(text), "K%zuAB%c W%zuXY%c %+03d", count % 10, (int)('A' + count % 26),
+                      count / 10 % 10, (int)('A' + count * 7 % 26), -(int)(count % 20));
+
+        oemros::ft8_payload payload;
+        oemros::ft8_pack(text, payload);
+        float snr = BENCH_WEAKEST_DB + (int)(count % 25);
+        sent.emplace_back(oemros::ft8_unpack(payload), snr);
+
+        std::vector<float> signal(oemros::ft8_transmit_samples(mode_in, BENCH_RATE), 0.0f);
+        auto amplitude = std::sqrt(2 * noise_2500 * std::pow(10.0, snr / 10));
+        oemros::ft8_synthesize(mode_in, oemros::ft8_tones(mode_in, payload), hertz, BENCH_RATE, amplitude, signal.data());
+
+        auto start = (size_t)((0.25 + count * 37 % 20 * 0.05) * BENCH_RATE);
+        for(size_t i = 0; i < signal.size() && start + i < slot.size(); i++) slot[start + i] += signal[i];
+    }
+
+    for(auto& i : slot) i += gaussian(random);
+
+    std::cout << "made up slot with " << sent.size() << " signals" << std::endl;
+    report(mode_in, BENCH_RATE, slot);
+
+    auto got = decode(mode_in, BENCH_RATE, 0, slot, 1).messages;
+    auto required = mode_in == ft8_mode::ft8 ? BENCH_REQUIRED_DB_FT8 : BENCH_REQUIRED_DB_FT4;
+    bool missed = false;
+
+    for(auto& i : sent) {
+        if (i.second < required) continue;
+
+        auto found = std::find_if(got.begin(), got.end(), [&](const oemros::ft8_message& message_in) { return message_in.text == i.first; });
+        if (found != got.end()) continue;
+
+        std::cout << "    MISSED " << i.first << " at " << i.second << " dB" << std::endl;
+        missed = true;
+    }
+
+    return ! missed;
+}
+
+int main(int argc, char** argv) {
+    auto mode = argc > 1 && std::string(argv[1]) == "ft4" ? ft8_mode::ft4 : ft8_mode::ft8;
+
+    auto logging = logjam::logengine::get_engine();
+    logging->add_destination(std::make_shared<oemros::log_console>(logjam::loglevel::error));
+    logging->start();
+
+    std::cout << oemros::ft8_mode_name(mode) << " with " << oemros::dsp_get_kernels().name << " kernels" << std::endl;
+
+    if (argc <= 2) return made_up(mode) ? 0 : 1;
+
+    size_t failures = 0;
+
+    for(int i = 2; i < argc; i++) {
+        unsigned int rate = 0;
+        std::vector<float> slot;
+
+        std::cout << argv[i] << std::endl;
+        if (! read_slot(argv[i], mode, rate, slot)) {
+            std::cout << "    could not read it" << std::endl;
+            failures++;
+            continue;
+        }
+
+        report(mode, rate, slot);
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+/*
+ * bench_radio.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+// Runs radios through radio::update(), the batch commit and value_source
+// delivery to subscribers as fast as they will go and reports how fast that
+// was, what it cost and how long a sample took to reach a subscriber.
+//
+// usage: bench_radio [radios] [seconds] [latency usec] [error rate]
+
+#include <algorithm>
+#include <atomic>
+#include <boost/thread.hpp>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sys/resource.h>
+#include <vector>
+
+#include "hamlib.h"
+#include "logging.h"
+#include "synthetic.h"
+
+using clock_type = std::chrono::steady_clock;
+using make_radio_type = std::function<std::shared_ptr<oemros::radio> (const size_t& number_in)>;
+
+// keeps memory flat on long runs; later samples are dropped
+#define BENCH_MAX_LATENCIES 1000000
+
+struct bench_result {
+    size_t radios = 0;
+    uint64_t updates = 0;
+    uint64_t deliveries = 0;
+    double seconds = 0;
+    double cpu_seconds = 0;
+    std::vector<double> latencies;
+};
+
+static double cpu_seconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+static double percentile(std::vector<double>& samples_in, const double& fraction_in) {
+    if (samples_in.empty()) return 0;
+    auto nth = samples_in.begin() + static_cast<size_t>(fraction_in * (samples_in.size() - 1));
+    std::nth_element(samples_in.begin(), nth, samples_in.end());
+    return *nth;
+}
+
+// each radio gets a thread that polls it in a loop; the latency is from the
+// start of the poll to the tuner subscriber running
+static bench_result run_bench(const size_t& radios_in, const double& seconds_in, const make_radio_type& make_in) {
+    std::vector<std::shared_ptr<oemros::radio>> radios;
+    std::vector<bench_result> results(radios_in);
+    boost::thread_group threads;
+
+    for(size_t i = 0; i < radios_in; i++) {
+        auto made = make_in(i);
+        if (made == nullptr) return bench_result();
+        radios.push_back(made);
+    }
+
+    auto cpu_before = cpu_seconds();
+    auto started = clock_type::now();
+    auto deadline = started + std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(seconds_in));
+
+    for(size_t i = 0; i < radios_in; i++) {
+        threads.create_thread([&radios, &results, i, deadline] {
+            auto& target = *radios[i];
+            auto& result = results[i];
+            clock_type::time_point poll_started;
+
+            result.latencies.reserve(BENCH_MAX_LATENCIES / radios.size());
+
+            auto tuner_sub = target.vfo.tuner.subscribe([&](const oemros::value_source<oemros::frequency>&) {
+                result.deliveries++;
+                if (result.latencies.size() == result.latencies.capacity()) return;
+                result.latencies.push_back(std::chrono::duration<double>(clock_type::now() - poll_started).count());
+            });
+            auto swr_sub = target.meters.swr.subscribe([&](const oemros::value_source<float>&) {
+                result.deliveries++;
+            });
+            auto changes_sub = target.changes.subscribe([&](const oemros::radio::state_type&) {
+                result.deliveries++;
+            });
+
+            while(clock_type::now() < deadline) {
+                poll_started = clock_type::now();
+                target.update();
+                result.updates++;
+            }
+        });
+    }
+
+    threads.join_all();
+
+    bench_result total;
+    total.radios = radios_in;
+    total.seconds = std::chrono::duration<double>(clock_type::now() - started).count();
+    total.cpu_seconds = cpu_seconds() - cpu_before;
+
+    for(auto&& i : results) {
+        total.updates += i.updates;
+        total.deliveries += i.deliveries;
+        total.latencies.insert(total.latencies.end(), i.latencies.begin(), i.latencies.end());
+    }
+
+    return total;
+}
+
+static void report(const std::string& name_in, bench_result& result_in) {
+    if (result_in.updates == 0) {
+        std::cout << name_in << ": no updates" << std::endl;
+        return;
+    }
+
+    auto p50 = percentile(result_in.latencies, 0.5);
+    auto p99 = percentile(result_in.latencies, 0.99);
+    auto max = result_in.latencies.empty() ? 0 : *std::max_element(result_in.latencies.begin(), result_in.latencies.end());
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << name_in << ": " << result_in.radios << " radios, " << result_in.updates << " updates in " << result_in.seconds << " s" << std::endl;
+    std::cout << "    updates/sec:     " << result_in.updates / result_in.seconds << std::endl;
+    std::cout << "    deliveries/sec:  " << result_in.deliveries / result_in.seconds << std::endl;
+    std::cout << "    cpu per update:  " << result_in.cpu_seconds / result_in.updates * 1e6 << " usec" << std::endl;
+    std::cout << "    latency p50:     " << p50 * 1e6 << " usec" << std::endl;
+    std::cout << "    latency p99:     " << p99 * 1e6 << " usec" << std::endl;
+    std::cout << "    latency max:     " << max * 1e6 << " usec" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t radios = argc > 1 ? std::atoi(argv[1]) : 4;
+    double seconds = argc > 2 ? std::atof(argv[2]) : 5;
+    int latency_usec = argc > 3 ? std::atoi(argv[3]) : 0;
+    double error_rate = argc > 4 ? std::atof(argv[4]) : 0;
+
+    auto logging = logjam::logengine::get_engine();
+    logging->add_destination(std::make_shared<oemros::log_console>(logjam::loglevel::error));
+    logging->start();
+    oemros::hamlib_bootstrap();
+
+    // radios are polled from their bench threads so the loop never runs
+    auto loop = std::make_shared<oemros::runloop>();
+    std::vector<std::shared_ptr<oemros::synthetic_radio>> synthetics;
+
+    auto synthetic_result = run_bench(radios, seconds, [&](const size_t& number_in) {
+        oemros::synthetic_radio::config_type config;
+        config.seed = number_in + 1;
+        config.latency = std::chrono::microseconds(latency_usec);
+        config.error_rate = error_rate;
+
+        auto made = std::make_shared<oemros::synthetic_radio>(loop, config);
+        synthetics.push_back(made);
+        return made;
+    });
+
+    uint64_t errors = 0;
+    for(auto&& i : synthetics) errors += i->get_stats().errors;
+
+    report("synthetic", synthetic_result);
+    std::cout << "    injected errors: " << errors << std::endl;
+
+    // the dummy rig still goes through the actor thread and the caches
+    // which are set to never hit
+    auto hamlib_result = run_bench(radios, seconds, [&](const size_t&) -> std::shared_ptr<oemros::radio> {
+        auto made = std::make_shared<oemros::hamlib_radio>(loop, 1);
+        if (! made->open()) return nullptr;
+
+        made->set_ttl(oemros::radio::update::alc, std::chrono::milliseconds(0));
+        made->set_ttl(oemros::radio::update::swr, std::chrono::milliseconds(0));
+        made->set_ttl(oemros::radio::update::tuner, std::chrono::milliseconds(0));
+        made->set_ttl(oemros::radio::update::ptt, std::chrono::milliseconds(0));
+        return made;
+    });
+
+    report("hamlib dummy", hamlib_result);
+
+    return 0;
+}
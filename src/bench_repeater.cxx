@@ -0,0 +1,292 @@
+/*
+ * bench_repeater.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+// Writes a config with a repeater between two hamlib dummy rigs whose audio
+// is WAV files, then runs it over a made up receiver recording of tone
+// bursts in noise. Reports when the transmitter keyed and unkeyed against
+// when it should have for the hang and the time out, how much of the tone
+// came out and the mouth to ear latency. The exit status is not 0 if any
+// of that is off.
+//
+// usage: bench_repeater
+
+#include <unistd.h>
+
+#include <boost/thread.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audio.h"
+#include "dsp.h"
+#include "hamlib.h"
+#include "logging.h"
+#include "station.h"
+#include "turboini.h"
+
+using clock_type = std::chrono::steady_clock;
+
+#define BENCH_RATE 48000
+#define BENCH_BLOCK_FRAMES 256
+#define BENCH_HANG_SEC 0.5
+#define BENCH_TIME_OUT_SEC 2.0
+#define BENCH_SECONDS 10.0
+// a key up or unkey this close to when it should be is right
+#define BENCH_SLOP_SEC 0.15
+// the dummy rigs have this long to open before the bench gives up
+#define BENCH_OPEN_SEC 30
+
+struct bench_burst {
+    double start;
+    double stop;
+};
+
+// the first burst shows the hang, the second is cut off by the time out
+// and gets no hang when it ends and the third shows the time out was reset
+static const bench_burst bench_bursts[] = { { 1.0, 2.0 }, { 3.5, 7.0 }, { 8.0, 8.5 } };
+
+struct bench_edge {
+    bool keyed;
+    double at;
+};
+
+static const bench_edge bench_expected[] = {
+    { true, 1.0 }, { false, 2.0 + BENCH_HANG_SEC },
+    { true, 3.5 }, { false, 3.5 + BENCH_TIME_OUT_SEC },
+    { true, 8.0 }, { false, 8.5 + BENCH_HANG_SEC },
+};
+
+// seconds of tone that should come out of the transmitter
+static double bench_expected_tone() {
+    return (2.0 - 1.0) + BENCH_TIME_OUT_SEC + (8.5 - 8.0);
+}
+
+static std::string make_path(const char* name_in) {
+    char path[] = "/tmp/bench_repeater.XXXXXX";
+    auto fd = mkstemp(path);
+    if (fd < 0) return std::string();
+    close(fd);
+    unlink(path);
+    return std::string(path) + "." + name_in;
+}
+
+static oemros::audio_format bench_format() {
+    oemros::audio_format format;
+    format.rate = BENCH_RATE;
+    format.channels = 1;
+    format.block_frames = BENCH_BLOCK_FRAMES;
+    return format;
+}
+
+// a 1 kHz tone at -10 dBFS during the bursts and noise at -60 dBFS always
+static bool write_receiver(const std::string& path_in) {
+    oemros::wav_audio file(path_in);
+    auto format = bench_format();
+    file.paced = false;
+
+    if (! file.open(oemros::audio_backend::direction::playback, format)) return false;
+
+    std::mt19937 random(1);
+    std::normal_distribution<float> gaussian(0.0f, 0.001f);
+    std::vector<float> block(format.block_samples());
+    auto amplitude = std::sqrt(2.0f) * std::pow(10.0f, -10.0f / 20);
+    size_t sample = 0;
+
+    while(sample < BENCH_SECONDS * BENCH_RATE) {
+        for(auto& i : block) {
+            auto seconds = (double)sample++ / BENCH_RATE;
+            i = gaussian(random);
+
+            for(auto& burst : bench_bursts) {
+                if (seconds >= burst.start && seconds < burst.stop) i += amplitude * std::sin(2 * M_PI * 1000 * seconds);
+            }
+        }
+
+        if (file.transfer(block.data()) != oemros::audio_backend::status::ok) return false;
+    }
+
+    file.close();
+    return true;
+}
+
+static bool write_config(const std::string& path_in, const std::string& receiver_in, const std::string& transmitter_in) {
+    auto file = std::fopen(path_in.c_str(), "w");
+    if (file == nullptr) return false;
+
+    std::fprintf(file,
+        "# made up by bench_repeater\n\n"
+        "[transceiver]\n"
+        "name = receiver\n"
+        "hamlib.rigid = 1\n"
+        "audio.engine = wav\n"
+        "audio.device = %s\n\n"
+        "[transceiver]\n"
+        "name = transmitter\n"
+        "hamlib.rigid = 1\n"
+        "audio.engine = wav\n"
+        "audio.device = %s\n\n"
+        "[repeater]\n"
+        "name = bench\n"
+        "receiver.name = receiver\n"
+        "receiver.freq = 53.545\n"
+        "receiver.mode = FM\n"
+        "transmitter.name = transmitter\n"
+        "transmitter.freq = 146.560\n"
+        "transmitter.mode = FM\n"
+        "squelch.open = -30db\n"
+        "squelch.close = -36db\n"
+        "hang = %g\n"
+        "timeout = %g\n",
+        receiver_in.c_str(), transmitter_in.c_str(), BENCH_HANG_SEC, BENCH_TIME_OUT_SEC);
+
+    return std::fclose(file) == 0;
+}
+
+// seconds of the transmitter file that have the tone in them
+static double read_tone(const std::string& path_in) {
+    oemros::wav_audio file(path_in);
+    auto format = bench_format();
+    file.paced = false;
+
+    if (! file.open(oemros::audio_backend::direction::capture, format)) return -1;
+
+    std::vector<float> block(format.block_samples());
+    size_t loud = 0;
+
+    while(file.transfer(block.data()) == oemros::audio_backend::status::ok) {
+        if (oemros::dsp_gain_to_db(oemros::dsp_measure(block.data(), block.size()).rms) > -20) loud++;
+    }
+
+    file.close();
+    return (double)loud * format.block_frames / format.rate;
+}
+
+// watches the repeater until the receiver file runs out and returns the key
+// ups and unkeys at where the receiver file was when they happened
+static std::vector<bench_edge> watch(std::shared_ptr<oemros::station> station_in) {
+    std::vector<bench_edge> result;
+    auto repeater = station_in->get_repeaters().front();
+    std::shared_ptr<oemros::audio_stream> capture;
+    auto format = bench_format();
+    auto started = clock_type::now();
+    bool keyed = false;
+
+    for(auto&& i : station_in->get_audio()->get_streams()) {
+        if (i->which == oemros::audio_stream::direction::capture) capture = i;
+    }
+
+    while(clock_type::now() - started < std::chrono::seconds(BENCH_OPEN_SEC) + std::chrono::duration<double>(BENCH_SECONDS)) {
+        auto audio = capture->get_stats();
+        auto stats = repeater->get_stats();
+
+        if (stats.keyed != keyed) {
+            keyed = stats.keyed;
+            result.push_back({ keyed, (double)audio.blocks * format.block_frames / format.rate });
+        }
+
+        if (audio.ended) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return result;
+}
+
+int main() {
+    auto logging = logjam::logengine::get_engine();
+    logging->add_destination(std::make_shared<oemros::log_console>(logjam::loglevel::error));
+    logging->start();
+    oemros::hamlib_bootstrap();
+
+    auto config_path = make_path("ini");
+    auto receiver_path = make_path("receiver.wav");
+    auto transmitter_path = make_path("transmitter.wav");
+    if (config_path.empty() || receiver_path.empty() || transmitter_path.empty() || ! write_receiver(receiver_path)
+        || ! write_config(config_path, receiver_path, transmitter_path)) {
+        std::cout << "could not write the config and audio to /tmp" << std::endl;
+        return 1;
+    }
+
+    size_t failures = 0;
+
+    try {
+        oemros::turboini_document document(config_path);
+        auto loop = std::make_shared<oemros::runloop>();
+        auto station = loop->make_item<oemros::station>(oemros::load_station_config(document), bench_format());
+
+        loop->post([station] { station->start(); });
+        boost::thread thread([loop] { loop->enter(); });
+
+        auto edges = watch(station);
+        auto stats = station->get_repeaters().front()->get_stats();
+
+        loop->post([station] { station->stop(); });
+        thread.join();
+        station->join();
+
+        auto edge_count = sizeof(bench_expected) / sizeof(bench_expected[0]);
+        std::cout << std::fixed << std::setprecision(2);
+
+        for(size_t i = 0; i < std::max(edges.size(), edge_count); i++) {
+            auto got = i < edges.size();
+            auto wanted = i < edge_count;
+            auto right = got && wanted && edges[i].keyed == bench_expected[i].keyed
+                && std::fabs(edges[i].at - bench_expected[i].at) <= BENCH_SLOP_SEC;
+
+            std::cout << "    ";
+            if (got) std::cout << (edges[i].keyed ? "keyed   at " : "unkeyed at ") << edges[i].at << " s";
+            else std::cout << "nothing";
+            if (wanted) std::cout << ", wanted " << (bench_expected[i].keyed ? "keyed at " : "unkeyed at ") << bench_expected[i].at << " s";
+            if (! right) std::cout << "  WRONG";
+            std::cout << std::endl;
+
+            if (! right) failures++;
+        }
+
+        auto tone = read_tone(transmitter_path);
+        std::cout << "    " << tone << " s of tone came out of " << bench_expected_tone() << " s" << std::endl;
+        if (std::fabs(tone - bench_expected_tone()) > 2 * BENCH_SLOP_SEC) failures++;
+
+        std::cout << "    " << stats.keyups << " key ups, " << stats.time_outs << " time outs, " << stats.ptt_failures << " PTT failures, "
+                  << stats.blocks_passed << " blocks passed, " << stats.blocks_dropped << " dropped" << std::endl;
+        if (stats.keyups != 3 || stats.time_outs != 1 || stats.ptt_failures != 0) failures++;
+
+        auto msec = [](const oemros::latency_histogram::duration_type& duration_in) { return duration_in.count() / 1000.0; };
+        std::cout << "    mouth to ear " << msec(stats.latency.percentile(0.5)) << " ms median, " << msec(stats.latency.percentile(0.99))
+                  << " ms 99%, " << stats.latency.max_usec / 1000.0 << " ms worst" << std::endl;
+        if (stats.latency.total == 0) failures++;
+    } catch (oemros::turboini_error& error) {
+        std::cout << error.what() << std::endl;
+        failures++;
+    }
+
+    unlink(config_path.c_str());
+    unlink(receiver_path.c_str());
+    unlink(transmitter_path.c_str());
+
+    return failures == 0 ? 0 : 1;
+}
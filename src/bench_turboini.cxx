@@ -0,0 +1,199 @@
+/*
+ * bench_turboini.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+// Writes a config with thousands of [transceiver] sections and an included
+// file of [repeater] sections, then reports how fast it parses and how
+// fast values can be found in it. The exit status is not 0 if a value
+// came back wrong.
+//
+// usage: bench_turboini [transceiver sections] [parses]
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "logging.h"
+#include "turboini.h"
+
+using clock_type = std::chrono::steady_clock;
+
+// one repeater for this many transceivers
+#define BENCH_REPEATER_RATIO 4
+
+static std::string make_path(const char* name_in) {
+    char path[] = "/tmp/bench_turboini.XXXXXX";
+    auto fd = mkstemp(path);
+    if (fd < 0) return std::string();
+    close(fd);
+    unlink(path);
+    return std::string(path) + "." + name_in;
+}
+
+static bool write_config(const std::string& path_in, const std::string& include_in, const size_t& sections_in) {
+    auto file = std::fopen(path_in.c_str(), "w");
+    if (file == nullptr) return false;
+
+    std::fprintf(file, "# made up by bench_turboini\nlog.level = info\nlog.path = \"/var/log/oemros.log\"\n\n");
+
+    for(size_t i = 0; i < sections_in; i++) {
+        std::fprintf(file,
+            "[transceiver]\n"
+            "name = IC-%zu\n"
+            "hamlib.rigid = %zu\n"
+            "hamlib.serial.port = /dev/ttyUSB%zu\n"
+            "hamlib.serial.speed = 19200\n"
+            "audio.engine = alsa\n"
+            "audio.device = hw:CARD=CODEC%zu,DEV=0\n"
+            "audio.input.gain = 0db\n"
+            "audio.output.gain = -30db\n"
+            "bands = [ 160m, 80m, 40m, 20m, 15m, 10m, 6m ]\n"
+            "tuning = {\n"
+            "    step.ssb: 10,\n"
+            "    step.fm: 12500,\n"
+            "    offset: %zu.5,\n"
+            "}\n"
+            "notes = \"rig %zu\\tof the bench\"\n\n",
+            i, 300 + i, i % 8, i, i, i);
+    }
+
+    std::fprintf(file, "!include %s\n", include_in.c_str());
+    return std::fclose(file) == 0;
+}
+
+static bool write_include(const std::string& path_in, const size_t& sections_in) {
+    auto file = std::fopen(path_in.c_str(), "w");
+    if (file == nullptr) return false;
+
+    for(size_t i = 0; i < sections_in; i++) {
+        std::fprintf(file,
+            "[repeater]\n"
+            "name = Repeater %zu\n"
+            "receiver.name = IC-%zu\n"
+            "receiver.freq = 53.545\n"
+            "receiver.mode = FM\n"
+            "transmitter.name = IC-%zu\n"
+            "transmitter.freq = 146.560\n"
+            "transmitter.mode = FM\n\n",
+            i, i * BENCH_REPEATER_RATIO, i * BENCH_REPEATER_RATIO + 1);
+    }
+
+    return std::fclose(file) == 0;
+}
+
+// every transceiver has the values it was written with
+static size_t check(const oemros::turboini_document& document_in, const size_t& sections_in) {
+    size_t failures = 0;
+    auto range = document_in.get_sections("transceiver");
+
+    if ((size_t)(range.second - range.first) != sections_in) {
+        std::cout << "    found " << range.second - range.first << " transceivers" << std::endl;
+        failures++;
+    }
+
+    for(size_t i = 0; range.first != range.second; range.first++, i++) {
+        int64_t rigid;
+        double offset;
+        auto rigid_value = document_in.find(*range.first, "hamlib.rigid");
+        auto offset_value = document_in.find(*range.first, "tuning.offset");
+        auto bands = document_in.find(*range.first, "bands");
+
+        if (rigid_value == nullptr || ! oemros::turboini_to_integer(rigid_value->text, rigid) || rigid != (int64_t)(300 + i)
+            || offset_value == nullptr || ! oemros::turboini_to_real(offset_value->text, offset) || std::fabs(offset - (i + 0.5)) > 1e-9
+            || bands == nullptr || bands->type != oemros::turboini_value::type_type::list) {
+            if (failures++ < 10) std::cout << "    transceiver " << i << " came back wrong" << std::endl;
+        }
+    }
+
+    auto repeater = document_in.get_sections("repeater");
+    auto notes = document_in.find(*document_in.get_sections("transceiver").first, "notes");
+    if (repeater.first == repeater.second || document_in.find(*repeater.first, "transmitter.freq") == nullptr
+        || notes == nullptr || oemros::turboini_unescape(notes->text) != "rig 0\tof the bench") {
+        std::cout << "    the included file or an escaped string came back wrong" << std::endl;
+        failures++;
+    }
+
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    size_t sections = argc > 1 ? std::atoi(argv[1]) : 5000;
+    size_t runs = argc > 2 ? std::atoi(argv[2]) : 20;
+    if (sections == 0 || runs == 0) {
+        std::cout << "usage: bench_turboini [transceiver sections] [parses]" << std::endl;
+        return 1;
+    }
+
+    auto logging = logjam::logengine::get_engine();
+    logging->add_destination(std::make_shared<oemros::log_console>(logjam::loglevel::error));
+    logging->start();
+
+    auto path = make_path("ini");
+    auto include = make_path("include.ini");
+    if (path.empty() || include.empty() || ! write_config(path, include, sections)
+        || ! write_include(include, sections / BENCH_REPEATER_RATIO)) {
+        std::cout << "could not write the config to /tmp" << std::endl;
+        return 1;
+    }
+
+    size_t failures = 0;
+
+    try {
+        std::chrono::duration<double, std::milli> total(0), best(0);
+        std::unique_ptr<oemros::turboini_document> document;
+
+        for(size_t i = 0; i < runs; i++) {
+            document.reset();
+            auto start = clock_type::now();
+            document = std::make_unique<oemros::turboini_document>(path);
+            std::chrono::duration<double, std::milli> took = clock_type::now() - start;
+            total += took;
+            if (i == 0 || took < best) best = took;
+        }
+
+        auto megabytes = document->get_bytes() / 1e6;
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << sections << " transceivers, " << megabytes << " MB, " << document->get_value_count() << " values, "
+                  << document->get_index_size() << " indexed" << std::endl;
+        std::cout << "    parse: " << total.count() / runs << " ms average, " << best.count() << " ms best, "
+                  << megabytes / (best.count() / 1000) << " MB/s" << std::endl;
+
+        auto start = clock_type::now();
+        failures += check(*document, sections);
+        std::chrono::duration<double> took = clock_type::now() - start;
+        // check() finds three values in every transceiver
+        std::cout << "    find: " << 3 * sections / took.count() / 1e6 << " million a second" << std::endl;
+    } catch (oemros::turboini_error& error) {
+        std::cout << error.what() << std::endl;
+        failures++;
+    }
+
+    unlink(path.c_str());
+    unlink(include.c_str());
+
+    return failures == 0 ? 0 : 1;
+}
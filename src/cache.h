@@ -0,0 +1,152 @@
+/*
+ * cache.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "object.h"
+
+namespace oemros {
+
+// Read-through cache for one value that is expensive to fetch. A value that
+// is younger than the TTL is handed back right away. Otherwise one fetch is
+// started and everyone who asks while it is running waits for that same
+// fetch. put() stores a value we know to be current, such as one we just
+// wrote, and wins over any fetch that was already running.
+template <typename T>
+class read_cache : public baseobj {
+    public:
+        using clock_type = std::chrono::steady_clock;
+        // error_in is 0 on success
+        using done_type = std::function<void (const int& error_in, const T& value_in)>;
+        using fetch_type = std::function<void (const done_type& finished_in)>;
+
+        struct stats_type {
+            uint64_t hits = 0;
+            uint64_t fetches = 0;
+            uint64_t shared = 0;
+        };
+
+    private:
+        std::mutex mutex;
+        const fetch_type fetch;
+        clock_type::duration ttl;
+        bool valid = false;
+        T value{};
+        clock_type::time_point fetched_at;
+        // bumped by put() and invalidate() so a fetch that started before
+        // them does not overwrite what they did
+        uint64_t version = 0;
+        bool in_flight = false;
+        std::vector<done_type> waiters;
+        stats_type stats;
+
+        void finished(const uint64_t& version_in, const int& error_in, const T& value_in) {
+            std::vector<done_type> ready;
+            int error = error_in;
+            T result = value_in;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                if (version_in != version) {
+                    // something newer showed up while the fetch ran
+                    if (valid) {
+                        error = 0;
+                        result = value;
+                    }
+                } else if (error_in == 0) {
+                    value = value_in;
+                    fetched_at = clock_type::now();
+                    valid = true;
+                }
+
+                ready.swap(waiters);
+                in_flight = false;
+            }
+
+            for(auto&& i : ready) i(error, result);
+        }
+
+    public:
+        read_cache(const clock_type::duration& ttl_in, const fetch_type& fetch_in)
+        : fetch(fetch_in), ttl(ttl_in) { }
+
+        // done_in runs right away on a hit or on the thread that finishes the fetch
+        void get(const done_type& done_in) {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            if (valid && clock_type::now() - fetched_at < ttl) {
+                stats.hits++;
+                auto result = value;
+                lock.unlock();
+                done_in(0, result);
+                return;
+            }
+
+            waiters.push_back(done_in);
+
+            if (in_flight) {
+                stats.shared++;
+                return;
+            }
+
+            in_flight = true;
+            stats.fetches++;
+            auto fetch_version = version;
+            lock.unlock();
+
+            auto self = std::dynamic_pointer_cast<read_cache>(shared_from_this());
+            fetch([self, fetch_version](const int& error_in, const T& value_in) {
+                self->finished(fetch_version, error_in, value_in);
+            });
+        }
+
+        void put(const T& value_in) {
+            std::lock_guard<std::mutex> lock(mutex);
+            value = value_in;
+            fetched_at = clock_type::now();
+            valid = true;
+            version++;
+        }
+
+        void invalidate() {
+            std::lock_guard<std::mutex> lock(mutex);
+            valid = false;
+            version++;
+        }
+
+        void set_ttl(const clock_type::duration& ttl_in) {
+            std::lock_guard<std::mutex> lock(mutex);
+            ttl = ttl_in;
+        }
+
+        stats_type get_stats() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return stats;
+        }
+};
+
+}
@@ -0,0 +1,881 @@
+/*
+ * civ.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "civ.h"
+#include "logging.h"
+#include "system.h"
+
+namespace oemros {
+
+#define CIV_CMD_TRANSCEIVE_FREQ 0x00
+#define CIV_CMD_TRANSCEIVE_MODE 0x01
+#define CIV_CMD_READ_FREQ 0x03
+#define CIV_CMD_READ_MODE 0x04
+#define CIV_CMD_SET_FREQ 0x05
+#define CIV_CMD_SET_MODE 0x06
+#define CIV_CMD_LEVEL 0x14
+#define CIV_CMD_METER 0x15
+#define CIV_CMD_PTT 0x1C
+
+#define CIV_LEVEL_AF_GAIN 0x01
+#define CIV_LEVEL_RF_POWER 0x0A
+#define CIV_METER_STRENGTH 0x02
+#define CIV_METER_POWER 0x11
+#define CIV_METER_SWR 0x12
+#define CIV_METER_ALC 0x13
+#define CIV_PTT_STATE 0x00
+
+frequency civ_decode_frequency(const uint8_t* data_in, const size_t& size_in) {
+    frequency result = 0;
+
+    for(size_t i = size_in; i > 0; i--) {
+        auto byte = data_in[i - 1];
+        result = result * 100 + (byte >> 4) * 10 + (byte & 0x0F);
+    }
+
+    return result;
+}
+
+void civ_encode_frequency(const frequency& freq_in, uint8_t* data_out) {
+    auto remaining = freq_in;
+
+    for(size_t i = 0; i < 5; i++) {
+        auto low = remaining % 10;
+        remaining /= 10;
+        auto high = remaining % 10;
+        remaining /= 10;
+        data_out[i] = (high << 4) | low;
+    }
+}
+
+unsigned int civ_decode_level(const uint8_t* data_in) {
+    return (data_in[0] >> 4) * 1000 + (data_in[0] & 0x0F) * 100 + (data_in[1] >> 4) * 10 + (data_in[1] & 0x0F);
+}
+
+void civ_encode_level(const unsigned int& level_in, uint8_t* data_out) {
+    auto level = std::min(level_in, 255u);
+    data_out[0] = level / 100;
+    data_out[1] = ((level / 10 % 10) << 4) | (level % 10);
+}
+
+civ_port::civ_port(std::shared_ptr<runloop> loop_in, const std::string& path_in, const unsigned int& speed_in, const uint8_t& controller_in)
+: runloop_item(loop_in), path(path_in), speed(speed_in), controller(controller_in) { }
+
+bool civ_port::open() {
+    using boost::asio::serial_port_base;
+    boost::system::error_code error;
+
+    if (serial.is_open()) return true;
+
+    serial.open(path, error);
+    if (error) {
+        log_error("could not open CI-V port ", path, ": ", error.message());
+        return false;
+    }
+
+    serial.set_option(serial_port_base::baud_rate(speed), error);
+    if (! error) serial.set_option(serial_port_base::character_size(8), error);
+    if (! error) serial.set_option(serial_port_base::parity(serial_port_base::parity::none), error);
+    if (! error) serial.set_option(serial_port_base::stop_bits(serial_port_base::stop_bits::one), error);
+    if (! error) serial.set_option(serial_port_base::flow_control(serial_port_base::flow_control::none), error);
+
+    if (error) {
+        log_error("could not configure CI-V port ", path, ": ", error.message());
+        serial.close(error);
+        return false;
+    }
+
+    read_begin = read_end = 0;
+    read();
+    return true;
+}
+
+// every request that has not been answered fails
+void civ_port::close() {
+    boost::system::error_code error;
+
+    serial.close(error);
+    timer.cancel();
+    backoff_timer.cancel();
+    writing = false;
+    backing_off = false;
+    unwritten = 0;
+
+    std::deque<request_type> failed;
+    failed.swap(outstanding);
+    for(auto&& i : stations) {
+        for(auto&& j : i.queued) {
+            for(auto&& k : j) failed.push_back(std::move(k));
+            j.clear();
+        }
+    }
+
+    for(auto&& i : failed) finish(i, false);
+}
+
+void civ_port::start__child() {
+    if (! open()) system_fault("could not start CI-V port ", path);
+}
+
+civ_port::station_type* civ_port::find_station(const uint8_t& address_in) {
+    for(auto&& i : stations) {
+        if (i.address == address_in) return &i;
+    }
+
+    return nullptr;
+}
+
+void civ_port::attach(const uint8_t& address_in, const receiver_type& receiver_in) {
+    auto station = find_station(address_in);
+
+    if (station == nullptr) {
+        stations.emplace_back();
+        station = &stations.back();
+        station->address = address_in;
+    }
+
+    station->receiver = receiver_in;
+}
+
+// requests still waiting for the radio fail
+void civ_port::detach(const uint8_t& address_in) {
+    for(size_t i = 0; i < stations.size(); i++) {
+        if (stations[i].address != address_in) continue;
+
+        auto station = std::move(stations[i]);
+        stations.erase(stations.begin() + i);
+        if (next_station >= stations.size()) next_station = 0;
+
+        for(auto&& j : station.queued) {
+            for(auto&& k : j) finish(k, false);
+        }
+
+        return;
+    }
+}
+
+void civ_port::read() {
+    std::weak_ptr<baseobj> weak_us = shared_from_this();
+    auto space = boost::asio::buffer(buffer.data() + read_end, buffer.size() - read_end);
+
+    serial.async_read_some(space, [this, weak_us](const boost::system::error_code& error_in, size_t bytes_in) {
+        auto strong_us = weak_us.lock();
+        if (strong_us) read_done(error_in, bytes_in);
+    });
+}
+
+void civ_port::read_done(const boost::system::error_code& error_in, const size_t& bytes_in) {
+    if (error_in == boost::asio::error::operation_aborted) return;
+
+    if (error_in) {
+        log_error("CI-V port ", path, " failed: ", error_in.message());
+        close();
+        return;
+    }
+
+    read_end += bytes_in;
+    parse();
+
+    if (! parsed.empty()) {
+        route();
+        for(auto&& i : parsed) match(i);
+    }
+
+    if (jammed) {
+        jammed = false;
+        collided();
+    }
+
+    pump();
+
+    // the frames point into the buffer so the leftovers can only be moved
+    // once everyone is done with them
+    if (read_begin == read_end) {
+        read_begin = read_end = 0;
+    } else if (buffer.size() - read_end < civ_max_frame) {
+        std::memmove(buffer.data(), buffer.data() + read_begin, read_end - read_begin);
+        read_end -= read_begin;
+        read_begin = 0;
+    }
+
+    read();
+}
+
+void civ_port::parse() {
+    parsed.clear();
+
+    while(read_begin < read_end) {
+        auto first = buffer.begin() + read_begin;
+        auto start = std::find(first, buffer.begin() + read_end, civ_preamble);
+        if (std::find(first, start, civ_jam) != start) jammed = true;
+        stats.discarded += start - first;
+        read_begin = start - buffer.begin();
+
+        if (read_end - read_begin < 2) break;
+        if (buffer[read_begin + 1] != civ_preamble) {
+            stats.discarded++;
+            read_begin++;
+            continue;
+        }
+
+        auto limit = std::min(read_end, read_begin + civ_max_frame);
+        auto end = std::find(buffer.begin() + read_begin + 2, buffer.begin() + limit, civ_end) - buffer.begin();
+
+        if (end == (ptrdiff_t)limit) {
+            // the rest of the frame has not arrived yet unless the frame is
+            // already too long to be one
+            if (limit - read_begin < civ_max_frame) break;
+            stats.discarded++;
+            read_begin++;
+            continue;
+        }
+
+        // radios may send more than two preamble bytes
+        auto body = read_begin + 2;
+        while(body < (size_t)end && buffer[body] == civ_preamble) body++;
+
+        // the jam code never shows up in a good frame
+        auto garbled = std::find(buffer.begin() + body, buffer.begin() + end, civ_jam) != buffer.begin() + end;
+        if (garbled) jammed = true;
+
+        if (! garbled && end - body >= 3) {
+            civ_frame frame;
+            frame.to = buffer[body];
+            frame.from = buffer[body + 1];
+            frame.command = buffer[body + 2];
+            frame.data = buffer.data() + body + 3;
+            frame.size = end - body - 3;
+            parsed.push_back(frame);
+            stats.received++;
+        } else {
+            stats.discarded += end + 1 - read_begin;
+        }
+
+        read_begin = end + 1;
+    }
+}
+
+// each radio gets the frames it sent in one call; a receiver can make new
+// requests which may add stations so nothing here holds on to one
+void civ_port::route() {
+    for(size_t i = 0; i < stations.size(); i++) {
+        if (! stations[i].receiver) continue;
+
+        routed.clear();
+        for(auto&& j : parsed) {
+            if (j.from == stations[i].address) routed.push_back(j);
+        }
+
+        if (routed.empty()) continue;
+
+        auto receiver = stations[i].receiver;
+        receiver(routed);
+    }
+}
+
+// answers come back in the order the requests went out so the oldest
+// matching request is the one being answered and any older request to the
+// same radio was lost
+void civ_port::match(const civ_frame& frame_in) {
+    if (frame_in.from == controller) {
+        if (expect_echo && ! check_echo(frame_in)) collided();
+        return;
+    }
+
+    if (frame_in.to != controller) return;
+
+    auto written = outstanding.size() - unwritten;
+    auto acked = frame_in.command == civ_ok || frame_in.command == civ_ng;
+
+    for(size_t i = 0; i < written; i++) {
+        auto& request = outstanding[i];
+        if (request.to != frame_in.from) continue;
+        if (! acked && request.command != frame_in.command) continue;
+
+        // the matched request and every lost one before it are removed
+        // from the front so the unwritten requests never move
+        std::deque<request_type> finished;
+        for(size_t j = 0; j <= i; j++) {
+            finished.push_back(std::move(outstanding.front()));
+            outstanding.pop_front();
+        }
+
+        // requests for other radios go back in their place first so the
+        // callbacks below see a consistent pipeline
+        for(size_t j = i; j-- > 0;) {
+            if (finished[j].to != frame_in.from) outstanding.push_front(std::move(finished[j]));
+        }
+
+        for(size_t j = 0; j < i; j++) {
+            if (finished[j].to != frame_in.from) continue;
+            stats.timeouts++;
+            finish(finished[j], false);
+        }
+
+        auto ok = frame_in.command != civ_ng;
+        if (! ok) stats.rejected++;
+        finish(finished[i], ok);
+
+        arm();
+        return;
+    }
+}
+
+// false if the bus gave back something other than what was sent
+bool civ_port::check_echo(const civ_frame& frame_in) {
+    auto written = outstanding.size() - unwritten;
+
+    for(size_t i = 0; i < written; i++) {
+        auto& request = outstanding[i];
+        if (request.echoed) continue;
+
+        // the data is everything between the command and the end byte
+        auto data_size = request.size - 6;
+        if (frame_in.to != request.to || frame_in.command != request.command) return false;
+        if (frame_in.size != data_size) return false;
+        if (std::memcmp(frame_in.data, request.bytes.data() + 5, data_size) != 0) return false;
+
+        request.echoed = true;
+        return true;
+    }
+
+    // nothing of ours is on the wire so some other controller sent it
+    return true;
+}
+
+// whatever was on the wire is lost; it goes back to the front of its queue
+// unless it already used up its retries
+void civ_port::collided() {
+    auto written = outstanding.size() - unwritten;
+    std::vector<request_type> lost;
+    unsigned int worst = 0;
+
+    stats.collisions++;
+
+    for(size_t i = 0; i < written; i++) {
+        lost.push_back(std::move(outstanding.front()));
+        outstanding.pop_front();
+    }
+
+    std::vector<request_type> failed;
+    for(auto i = lost.rbegin(); i != lost.rend(); i++) {
+        auto station = find_station(i->to);
+
+        if (station == nullptr || i->retries >= max_retries) {
+            failed.push_back(std::move(*i));
+            continue;
+        }
+
+        i->retries++;
+        i->echoed = false;
+        worst = std::max(worst, i->retries);
+        stats.retries++;
+        station->queued[(size_t)i->level].push_front(std::move(*i));
+    }
+
+    for(auto&& i : failed) finish(i, false);
+
+    // everyone who collided backs off for a different random time so the
+    // next attempt is unlikely to collide again
+    random_state = random_state * 6364136223846793005ULL + 1442695040888963407ULL;
+    auto jitter = 0.5 + (random_state >> 11) * (1.0 / (1ULL << 53));
+    auto wait = std::chrono::duration_cast<clock_type::duration>(collision_backoff * (1 << std::min(worst, 6u)) * jitter);
+
+    log_debug("CI-V collision on ", path, "; backing off for ", std::chrono::duration<double>(wait).count(), " s");
+
+    backing_off = true;
+    std::weak_ptr<baseobj> weak_us = shared_from_this();
+    backoff_timer.expires_after(wait);
+    backoff_timer.async_wait([this, weak_us](const boost::system::error_code& error_in) {
+        auto strong_us = weak_us.lock();
+        if (! strong_us) return;
+        if (error_in == boost::asio::error::operation_aborted) return;
+        backing_off = false;
+        pump();
+    });
+
+    arm();
+}
+
+void civ_port::finish(request_type& request_in, const bool& ok_in) {
+    auto done = std::move(request_in.done);
+    auto took = clock_type::duration::zero();
+    if (request_in.sent != clock_type::time_point()) took = clock_type::now() - request_in.sent;
+    if (done) done(ok_in, took);
+}
+
+void civ_port::request(const uint8_t& to_in, const uint8_t& command_in, const int& subcommand_in,
+                       const uint8_t* data_in, const size_t& size_in, const done_type& done_in,
+                       const priority& level_in) {
+    request_type request;
+    auto& bytes = request.bytes;
+    size_t size = 0;
+
+    if (size_in + 7 > civ_max_frame) system_fault("CI-V frame is too long: ", size_in);
+
+    bytes[size++] = civ_preamble;
+    bytes[size++] = civ_preamble;
+    bytes[size++] = to_in;
+    bytes[size++] = controller;
+    bytes[size++] = command_in;
+    if (subcommand_in != civ_no_subcommand) bytes[size++] = subcommand_in;
+    if (size_in > 0) std::memcpy(bytes.data() + size, data_in, size_in);
+    size += size_in;
+    bytes[size++] = civ_end;
+
+    request.size = size;
+    request.to = to_in;
+    request.command = command_in;
+    request.level = level_in;
+    request.done = done_in;
+
+    if (! serial.is_open()) {
+        finish(request, false);
+        return;
+    }
+
+    auto station = find_station(to_in);
+    if (station == nullptr) {
+        attach(to_in, nullptr);
+        station = find_station(to_in);
+    }
+
+    station->queued[(size_t)level_in].push_back(std::move(request));
+    pump();
+}
+
+// the highest priority request that is waiting; stations at the same
+// priority take turns
+bool civ_port::next_request(request_type& request_out) {
+    auto count = stations.size();
+
+    for(auto level = priority_levels; level-- > 0;) {
+        for(size_t i = 0; i < count; i++) {
+            auto index = (next_station + i) % count;
+            auto& queue = stations[index].queued[level];
+            if (queue.empty()) continue;
+
+            request_out = std::move(queue.front());
+            queue.pop_front();
+            next_station = (index + 1) % count;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void civ_port::pump() {
+    if (! serial.is_open() || backing_off) return;
+
+    auto limit = stations.size() > 1 ? 1 : max_outstanding;
+    request_type next;
+
+    while(outstanding.size() < limit && next_request(next)) {
+        outstanding.push_back(std::move(next));
+        unwritten++;
+    }
+
+    write();
+}
+
+// everything waiting to go out is written with one call; the requests
+// being written are at the back of outstanding and nothing removes them
+// until the write is done
+void civ_port::write() {
+    if (writing || unwritten == 0) return;
+
+    std::vector<boost::asio::const_buffer> buffers;
+    auto first = outstanding.size() - unwritten;
+    auto count = unwritten;
+
+    auto now = clock_type::now();
+    buffers.reserve(count);
+    for(auto i = first; i < outstanding.size(); i++) {
+        buffers.push_back(boost::asio::buffer(outstanding[i].bytes.data(), outstanding[i].size));
+        outstanding[i].sent = now;
+    }
+
+    writing = true;
+    std::weak_ptr<baseobj> weak_us = shared_from_this();
+    boost::asio::async_write(serial, buffers, [this, weak_us, count](const boost::system::error_code& error_in, size_t) {
+        auto strong_us = weak_us.lock();
+        if (! strong_us) return;
+        if (error_in == boost::asio::error::operation_aborted) return;
+
+        if (error_in) {
+            log_error("could not write to CI-V port ", path, ": ", error_in.message());
+            close();
+            return;
+        }
+
+        auto deadline = clock_type::now() + timeout;
+        auto first_written = outstanding.size() - unwritten;
+        for(auto i = first_written; i < first_written + count; i++) outstanding[i].deadline = deadline;
+
+        stats.sent += count;
+        unwritten -= count;
+        writing = false;
+
+        arm();
+        write();
+    });
+}
+
+void civ_port::arm() {
+    if (outstanding.size() == unwritten) {
+        timer.cancel();
+        return;
+    }
+
+    std::weak_ptr<baseobj> weak_us = shared_from_this();
+    timer.expires_at(outstanding.front().deadline);
+    timer.async_wait([this, weak_us](const boost::system::error_code& error_in) {
+        auto strong_us = weak_us.lock();
+        if (strong_us) expire(error_in);
+    });
+}
+
+void civ_port::expire(const boost::system::error_code& error_in) {
+    if (error_in == boost::asio::error::operation_aborted) return;
+    if (error_in) system_fault("CI-V timer failed: ", error_in.message());
+
+    auto now = clock_type::now();
+
+    while(outstanding.size() > unwritten && outstanding.front().deadline <= now) {
+        auto request = std::move(outstanding.front());
+        outstanding.pop_front();
+        stats.timeouts++;
+        finish(request, false);
+    }
+
+    arm();
+    pump();
+}
+
+struct civ_point {
+    unsigned int raw;
+    float value;
+};
+
+// calibration of the IC-7300 meters
+static const civ_point civ_power_table[] = { { 0, 0 }, { 143, 0.5 }, { 213, 1 } };
+static const civ_point civ_swr_table[] = { { 0, 1 }, { 48, 1.5 }, { 80, 2 }, { 120, 3 }, { 240, 6 } };
+static const civ_point civ_alc_table[] = { { 0, 0 }, { 120, 1 } };
+// S0 to S9 then S9 to S9+60 dB
+static const civ_point civ_strength_table[] = { { 0, -54 }, { 120, 0 }, { 241, 60 } };
+
+template <size_t N>
+static float civ_interpolate(const civ_point (&table_in)[N], const unsigned int& raw_in) {
+    if (raw_in <= table_in[0].raw) return table_in[0].value;
+
+    for(size_t i = 1; i < N; i++) {
+        if (raw_in > table_in[i].raw) continue;
+        auto& low = table_in[i - 1];
+        auto& high = table_in[i];
+        return low.value + (high.value - low.value) * (raw_in - low.raw) / (high.raw - low.raw);
+    }
+
+    return table_in[N - 1].value;
+}
+
+static radio::mode civ_to_mode(const uint8_t& mode_in) {
+    switch(mode_in) {
+        case 0x00: return radio::mode::lsb;
+        case 0x01: return radio::mode::usb;
+        case 0x02: return radio::mode::am;
+        case 0x03: return radio::mode::cw;
+        case 0x05: return radio::mode::fm;
+        case 0x07: return radio::mode::cw;
+    }
+
+    return radio::mode::unknown;
+}
+
+static int civ_from_mode(const radio::mode& mode_in) {
+    switch(mode_in) {
+        case radio::mode::lsb: return 0x00;
+        case radio::mode::usb: return 0x01;
+        case radio::mode::am: return 0x02;
+        case radio::mode::cw: return 0x03;
+        case radio::mode::fm: return 0x05;
+        case radio::mode::unknown: break;
+    }
+
+    return -1;
+}
+
+static int civ_from_level(const radio::level& level_in) {
+    switch(level_in) {
+        case radio::level::rf_power: return CIV_LEVEL_RF_POWER;
+        case radio::level::af_gain: return CIV_LEVEL_AF_GAIN;
+    }
+
+    return -1;
+}
+
+// done_in and apply_in run on the loop because the port does
+template <typename T>
+static std::function<void (bool, const T&)> civ_finish(std::weak_ptr<baseobj> weak_radio_in, const radio::set_done<T>& done_in,
+                                                        const std::function<void (radio&, const T&)>& apply_in = nullptr) {
+    return [weak_radio_in, done_in, apply_in](bool ok_in, const T& applied_in) {
+        auto strong_radio = std::dynamic_pointer_cast<radio>(weak_radio_in.lock());
+        if (strong_radio == nullptr) return;
+
+        if (ok_in && apply_in) {
+            radio::batch scope(*strong_radio);
+            apply_in(*strong_radio, applied_in);
+        }
+
+        if (done_in) done_in(ok_in, applied_in);
+    };
+}
+
+civ_radio::civ_radio(std::shared_ptr<runloop> loop_in, const config_type& config_in)
+: radio(loop_in), config(config_in) {
+    port = loop_in->make_item<civ_port>(config.port, config.speed, config.controller);
+    make_writers();
+}
+
+static civ_radio::config_type civ_bus_config(std::shared_ptr<civ_port> bus_in, const uint8_t& address_in) {
+    civ_radio::config_type config;
+    config.address = address_in;
+    config.controller = bus_in->controller;
+    return config;
+}
+
+civ_radio::civ_radio(std::shared_ptr<runloop> loop_in, std::shared_ptr<civ_port> bus_in, const uint8_t& address_in)
+: radio(loop_in), config(civ_bus_config(bus_in, address_in)), port(bus_in) {
+    make_writers();
+}
+
+// writes go ahead of polls on a busy bus
+void civ_radio::make_writers() {
+    auto our_port = port;
+    auto our_loop = loop;
+    auto address = config.address;
+
+    // writers are called from any thread and the port belongs to the loop
+    freq_writes = std::make_shared<write_coalescer<int, frequency>>(
+        [our_port, our_loop, address](const int&, const frequency& freq_in, const write_coalescer<int, frequency>::finished_type& finished_in) {
+            our_loop->post([our_port, address, freq_in, finished_in] {
+                uint8_t data[5];
+                civ_encode_frequency(freq_in, data);
+                our_port->request(address, CIV_CMD_SET_FREQ, civ_no_subcommand, data, sizeof(data),
+                    [freq_in, finished_in](const bool& ok_in, const civ_port::clock_type::duration&) { finished_in(ok_in, freq_in); },
+                    civ_port::priority::control);
+            });
+        });
+
+    ptt_writes = std::make_shared<write_coalescer<int, bool>>(
+        [our_port, our_loop, address](const int&, const bool& ptt_in, const write_coalescer<int, bool>::finished_type& finished_in) {
+            our_loop->post([our_port, address, ptt_in, finished_in] {
+                uint8_t data = ptt_in ? 1 : 0;
+                our_port->request(address, CIV_CMD_PTT, CIV_PTT_STATE, &data, 1,
+                    [ptt_in, finished_in](const bool& ok_in, const civ_port::clock_type::duration&) { finished_in(ok_in, ptt_in); },
+                    civ_port::priority::control);
+            });
+        });
+
+    mode_writes = std::make_shared<write_coalescer<int, mode>>(
+        [our_port, our_loop, address](const int&, const mode& mode_in, const write_coalescer<int, mode>::finished_type& finished_in) {
+            our_loop->post([our_port, address, mode_in, finished_in] {
+                auto civ_mode = civ_from_mode(mode_in);
+                if (civ_mode < 0) {
+                    finished_in(false, mode_in);
+                    return;
+                }
+
+                uint8_t data = civ_mode;
+                our_port->request(address, CIV_CMD_SET_MODE, civ_no_subcommand, &data, 1,
+                    [mode_in, finished_in](const bool& ok_in, const civ_port::clock_type::duration&) { finished_in(ok_in, mode_in); },
+                    civ_port::priority::control);
+            });
+        });
+
+    level_writes = std::make_shared<write_coalescer<level, float>>(
+        [our_port, our_loop, address](const level& level_in, const float& value_in, const write_coalescer<level, float>::finished_type& finished_in) {
+            our_loop->post([our_port, address, level_in, value_in, finished_in] {
+                auto subcommand = civ_from_level(level_in);
+                if (subcommand < 0) {
+                    finished_in(false, value_in);
+                    return;
+                }
+
+                uint8_t data[2];
+                civ_encode_level(std::max(0.0f, std::min(value_in, 1.0f)) * 255 + 0.5f, data);
+                our_port->request(address, CIV_CMD_LEVEL, subcommand, data, sizeof(data),
+                    [value_in, finished_in](const bool& ok_in, const civ_port::clock_type::duration&) { finished_in(ok_in, value_in); },
+                    civ_port::priority::control);
+            });
+        });
+}
+
+bool civ_radio::open() {
+    std::weak_ptr<baseobj> weak_us = weak_from_this();
+
+    port->attach(config.address, [weak_us](const std::vector<civ_frame>& frames_in) {
+        auto strong_us = std::dynamic_pointer_cast<civ_radio>(weak_us.lock());
+        if (strong_us) strong_us->receive(frames_in);
+    });
+
+    if (! port->open()) return false;
+
+    set_poll_plan(~ (mask_type)0);
+    update();
+
+    return true;
+}
+
+void civ_radio::read(const enum update& field_in, const uint8_t& command_in, const int& subcommand_in) {
+    auto field = (mask_type)field_in;
+
+    // one read of a field at a time is enough
+    if (reading & field) return;
+    reading |= field;
+
+    std::weak_ptr<baseobj> weak_us = weak_from_this();
+    port->request(config.address, command_in, subcommand_in, nullptr, 0, [weak_us, field_in](const bool& ok_in, const civ_port::clock_type::duration& took_in) {
+        auto strong_us = std::dynamic_pointer_cast<civ_radio>(weak_us.lock());
+        if (strong_us == nullptr) return;
+        strong_us->reading &= ~ (mask_type)field_in;
+
+        if (ok_in) {
+            strong_us->report_round_trip(field_in, took_in);
+        } else {
+            log_debug("CI-V read of field ", (mask_type)field_in, " failed");
+        }
+    });
+}
+
+// every frame from one read lands in the same batch
+void civ_radio::receive(const std::vector<civ_frame>& frames_in) {
+    batch scope(*this);
+
+    for(auto&& i : frames_in) {
+        if (i.from != config.address) continue;
+        if (i.to != config.controller && i.to != civ_broadcast) continue;
+        decode(i);
+    }
+}
+
+// pushed frames and answers to reads carry the same data so they are
+// handled the same way
+void civ_radio::decode(const civ_frame& frame_in) {
+    switch(frame_in.command) {
+        case CIV_CMD_TRANSCEIVE_FREQ:
+        case CIV_CMD_READ_FREQ:
+            if (frame_in.size >= 4) vfo.tuner = civ_decode_frequency(frame_in.data, frame_in.size);
+            return;
+
+        case CIV_CMD_TRANSCEIVE_MODE:
+        case CIV_CMD_READ_MODE:
+            if (frame_in.size >= 1) last_mode = civ_to_mode(frame_in.data[0]);
+            return;
+
+        case CIV_CMD_METER:
+            if (frame_in.size < 3) return;
+
+            switch(frame_in.data[0]) {
+                case CIV_METER_STRENGTH:
+                    last_strength = std::lround(civ_interpolate(civ_strength_table, civ_decode_level(frame_in.data + 1)));
+                    return;
+                case CIV_METER_POWER:
+                    meters.power = civ_interpolate(civ_power_table, civ_decode_level(frame_in.data + 1));
+                    return;
+                case CIV_METER_SWR:
+                    meters.swr = civ_interpolate(civ_swr_table, civ_decode_level(frame_in.data + 1));
+                    return;
+                case CIV_METER_ALC:
+                    meters.alc = civ_interpolate(civ_alc_table, civ_decode_level(frame_in.data + 1));
+                    return;
+            }
+
+            return;
+
+        case CIV_CMD_PTT:
+            if (frame_in.size >= 2 && frame_in.data[0] == CIV_PTT_STATE) ptt = frame_in.data[1] != 0;
+            return;
+    }
+}
+
+void civ_radio::update__alc() {
+    read(update::alc, CIV_CMD_METER, CIV_METER_ALC);
+}
+
+void civ_radio::update__power() {
+    read(update::power, CIV_CMD_METER, CIV_METER_POWER);
+}
+
+void civ_radio::update__swr() {
+    read(update::swr, CIV_CMD_METER, CIV_METER_SWR);
+}
+
+void civ_radio::update__tuner() {
+    read(update::tuner, CIV_CMD_READ_FREQ, civ_no_subcommand);
+}
+
+void civ_radio::update__ptt() {
+    read(update::ptt, CIV_CMD_PTT, CIV_PTT_STATE);
+}
+
+void civ_radio::set_frequency(const frequency& freq_in, const set_done<frequency>& done_in) {
+    freq_writes->write(0, freq_in, civ_finish<frequency>(weak_from_this(), done_in, [](radio& radio_in, const frequency& applied_in) {
+        radio_in.vfo.tuner = applied_in;
+    }));
+}
+
+void civ_radio::set_ptt(const bool& ptt_in, const set_done<bool>& done_in) {
+    ptt_writes->write(0, ptt_in, civ_finish<bool>(weak_from_this(), done_in, [](radio& radio_in, const bool& applied_in) {
+        radio_in.ptt = applied_in;
+    }));
+}
+
+void civ_radio::set_mode(const mode& mode_in, const set_done<mode>& done_in) {
+    mode_writes->write(0, mode_in, civ_finish<mode>(weak_from_this(), done_in));
+}
+
+void civ_radio::set_level(const level& level_in, const float& value_in, const set_done<float>& done_in) {
+    level_writes->write(level_in, value_in, civ_finish<float>(weak_from_this(), done_in));
+}
+
+// the answer is decoded by receive() before the request is finished so
+// last_strength already holds it; control priority keeps it behind retunes
+void civ_radio::read_strength(const read_done<int>& done_in) {
+    std::weak_ptr<baseobj> weak_us = weak_from_this();
+    auto our_port = port;
+    auto address = config.address;
+
+    loop->post([weak_us, our_port, address, done_in] {
+        our_port->request(address, CIV_CMD_METER, CIV_METER_STRENGTH, nullptr, 0, [weak_us, done_in](const bool& ok_in, const civ_port::clock_type::duration&) {
+            auto strong_us = std::dynamic_pointer_cast<civ_radio>(weak_us.lock());
+            if (strong_us == nullptr) return;
+            if (done_in) done_in(ok_in, strong_us->last_strength);
+        }, civ_port::priority::control);
+    });
+}
+
+}
@@ -0,0 +1,253 @@
+/*
+ * civ.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "coalesce.h"
+#include "radio.h"
+#include "runloop.h"
+
+namespace oemros {
+
+// a CI-V frame is FE FE <to> <from> <command> [data ...] FD
+constexpr uint8_t civ_preamble = 0xFE;
+constexpr uint8_t civ_end = 0xFD;
+constexpr uint8_t civ_ok = 0xFB;
+constexpr uint8_t civ_ng = 0xFA;
+// sent over and over by a radio that saw a collision
+constexpr uint8_t civ_jam = 0xFC;
+// frames sent to this address are transceive pushes meant for everyone
+constexpr uint8_t civ_broadcast = 0x00;
+constexpr uint8_t civ_controller = 0xE0;
+// longest frame that is sent or accepted
+constexpr size_t civ_max_frame = 64;
+constexpr int civ_no_subcommand = -1;
+
+// points into the receive buffer of a civ_port and is only good until the
+// receiver returns
+struct civ_frame {
+    uint8_t to = 0;
+    uint8_t from = 0;
+    uint8_t command = 0;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+// frequencies are 5 bytes of packed BCD with the least significant digits first
+frequency civ_decode_frequency(const uint8_t* data_in, const size_t& size_in);
+void civ_encode_frequency(const frequency& freq_in, uint8_t* data_out);
+// levels and meters are 2 bytes of packed BCD from 0000 to 0255 with the
+// most significant digits first
+unsigned int civ_decode_level(const uint8_t* data_in);
+void civ_encode_level(const unsigned int& level_in, uint8_t* data_out);
+
+// Owns the serial port of a CI-V bus which may have several radios on it,
+// each with its own address. Bytes are read straight into the receive
+// buffer and frames are handed out as pointers into it so nothing is
+// copied. Each radio attaches with its address and gets the frames it sent.
+//
+// Requests wait in a queue per radio. Control requests always go before
+// polls and radios at the same priority take turns so a busy radio can not
+// starve the others. With one radio up to max_outstanding requests are
+// pipelined and answers are matched to requests in the order they were
+// sent. With more than one radio only one request is on the wire at a time
+// because two radios answering at once would collide.
+//
+// A collision shows up as a radio jamming the bus with 0xFC or, when the
+// bus echoes what we send, as an echo that is not what was sent. The
+// requests on the wire then go back to the front of their queues and are
+// sent again after a random backoff.
+class civ_port : public runloop_item {
+    public:
+        using clock_type = std::chrono::steady_clock;
+        // ok_in is false if the radio said NG or never answered; took_in is
+        // from the request going out to the answer
+        using done_type = std::function<void (const bool& ok_in, const clock_type::duration& took_in)>;
+        // called once per read with every frame from the radio that read completed
+        using receiver_type = std::function<void (const std::vector<civ_frame>& frames_in)>;
+
+        enum class priority {
+            poll = 0,
+            control = 1,
+        };
+
+        struct stats_type {
+            uint64_t sent = 0;
+            uint64_t received = 0;
+            uint64_t rejected = 0;
+            uint64_t timeouts = 0;
+            uint64_t collisions = 0;
+            uint64_t retries = 0;
+            // bytes that were not part of any frame
+            uint64_t discarded = 0;
+        };
+
+    private:
+        static constexpr size_t priority_levels = 2;
+
+        struct request_type {
+            std::array<uint8_t, civ_max_frame> bytes;
+            size_t size = 0;
+            uint8_t to = 0;
+            uint8_t command = 0;
+            priority level = priority::poll;
+            unsigned int retries = 0;
+            // the bus handed it back to us
+            bool echoed = false;
+            done_type done;
+            clock_type::time_point sent;
+            clock_type::time_point deadline;
+        };
+
+        struct station_type {
+            uint8_t address;
+            receiver_type receiver;
+            std::array<std::deque<request_type>, priority_levels> queued;
+        };
+
+        const std::string path;
+        const unsigned int speed;
+        boost::asio::serial_port serial{*get_loop_ioptr()};
+        boost::asio::steady_timer timer{*get_loop_ioptr()};
+        boost::asio::steady_timer backoff_timer{*get_loop_ioptr()};
+        // unparsed bytes are [read_begin, read_end)
+        std::array<uint8_t, 4096> buffer;
+        size_t read_begin = 0;
+        size_t read_end = 0;
+        std::vector<civ_frame> parsed;
+        std::vector<civ_frame> routed;
+        bool jammed = false;
+        std::vector<station_type> stations;
+        // the station that gets the first look next time
+        size_t next_station = 0;
+        // written or being written and waiting for an answer
+        std::deque<request_type> outstanding;
+        size_t unwritten = 0;
+        bool writing = false;
+        bool backing_off = false;
+        uint64_t random_state = 1;
+        stats_type stats;
+
+        station_type* find_station(const uint8_t& address_in);
+        bool next_request(request_type& request_out);
+        void read();
+        void read_done(const boost::system::error_code& error_in, const size_t& bytes_in);
+        void parse();
+        void route();
+        void match(const civ_frame& frame_in);
+        bool check_echo(const civ_frame& frame_in);
+        void collided();
+        void pump();
+        void write();
+        void arm();
+        void expire(const boost::system::error_code& error_in);
+        void finish(request_type& request_in, const bool& ok_in);
+
+    public:
+        const uint8_t controller;
+        // only used when a single radio is attached
+        size_t max_outstanding = 4;
+        std::chrono::milliseconds timeout{500};
+        // true when the bus hands every frame we send back to us like a
+        // CT-17 or any single wire interface does
+        bool expect_echo = false;
+        unsigned int max_retries = 3;
+        // first backoff after a collision; it doubles on each retry
+        std::chrono::milliseconds collision_backoff{5};
+
+        civ_port(std::shared_ptr<runloop> loop_in, const std::string& path_in, const unsigned int& speed_in, const uint8_t& controller_in = civ_controller);
+        // opening an open port does nothing
+        bool open();
+        void close();
+        void attach(const uint8_t& address_in, const receiver_type& receiver_in);
+        void detach(const uint8_t& address_in);
+        void request(const uint8_t& to_in, const uint8_t& command_in, const int& subcommand_in,
+                     const uint8_t* data_in, const size_t& size_in, const done_type& done_in = nullptr,
+                     const priority& level_in = priority::poll);
+        stats_type get_stats() const { return stats; }
+        virtual void start__child() override;
+};
+
+// Talks to an Icom radio over CI-V without hamlib. With CI-V transceive
+// turned on in the radio menus frequency and mode changes are pushed by the
+// radio and land in vfo.tuner without being polled. Meters still have to be
+// asked for. Radios can have a port to themselves or share one bus.
+class civ_radio : public radio {
+    public:
+        struct config_type {
+            // not used when the radio shares a bus
+            std::string port;
+            unsigned int speed = 19200;
+            // the CI-V address of the radio; 0x94 is the IC-7300 default
+            uint8_t address = 0x94;
+            uint8_t controller = civ_controller;
+        };
+
+    private:
+        const config_type config;
+        std::shared_ptr<civ_port> port;
+        // fields with a read already waiting on the radio
+        mask_type reading = 0;
+        mode last_mode = mode::unknown;
+        int last_strength = 0;
+        std::shared_ptr<write_coalescer<int, frequency>> freq_writes;
+        std::shared_ptr<write_coalescer<int, bool>> ptt_writes;
+        std::shared_ptr<write_coalescer<int, mode>> mode_writes;
+        std::shared_ptr<write_coalescer<level, float>> level_writes;
+
+        void make_writers();
+        void read(const enum update& field_in, const uint8_t& command_in, const int& subcommand_in);
+        void receive(const std::vector<civ_frame>& frames_in);
+        void decode(const civ_frame& frame_in);
+
+    protected:
+        virtual void update__alc() override;
+        virtual void update__power() override;
+        virtual void update__swr() override;
+        virtual void update__tuner() override;
+        virtual void update__ptt() override;
+
+    public:
+        civ_radio(std::shared_ptr<runloop> loop_in, const config_type& config_in);
+        // for a radio on a bus shared with others
+        civ_radio(std::shared_ptr<runloop> loop_in, std::shared_ptr<civ_port> bus_in, const uint8_t& address_in);
+        bool open();
+        std::shared_ptr<civ_port> get_port() { return port; }
+        mode get_mode() const { return last_mode; }
+        // done_in runs on the radio's runloop
+        virtual void set_frequency(const frequency& freq_in, const set_done<frequency>& done_in = nullptr) override;
+        virtual void set_ptt(const bool& ptt_in, const set_done<bool>& done_in = nullptr) override;
+        virtual void set_mode(const mode& mode_in, const set_done<mode>& done_in = nullptr) override;
+        virtual void set_level(const level& level_in, const float& value_in, const set_done<float>& done_in = nullptr) override;
+        virtual void read_strength(const read_done<int>& done_in) override;
+};
+
+}
@@ -0,0 +1,133 @@
+/*
+ * coalesce.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "object.h"
+
+namespace oemros {
+
+// Only one write per target is ever in flight. Writes that arrive while one
+// is in flight replace each other so when it finishes only the latest value
+// is written next. Every caller is told the value that was actually applied
+// which for a replaced write is the value that replaced it.
+template <typename Key, typename Value>
+class write_coalescer : public baseobj {
+    public:
+        using done_type = std::function<void (bool ok_in, const Value& applied_in)>;
+        using finished_type = std::function<void (bool ok_in, const Value& applied_in)>;
+        // starts the write and calls finished_in once it is done
+        using writer_type = std::function<void (const Key& key_in, const Value& value_in, const finished_type& finished_in)>;
+
+        struct stats_type {
+            uint64_t submitted = 0;
+            uint64_t coalesced = 0;
+            uint64_t written = 0;
+        };
+
+    private:
+        struct target_type {
+            bool in_flight = false;
+            bool has_pending = false;
+            Value pending{};
+            std::vector<done_type> in_flight_waiters;
+            std::vector<done_type> pending_waiters;
+        };
+
+        std::mutex mutex;
+        std::map<Key, target_type> targets;
+        const writer_type writer;
+        stats_type stats;
+
+        void start(const Key& key_in, const Value& value_in) {
+            auto self = std::dynamic_pointer_cast<write_coalescer>(shared_from_this());
+
+            writer(key_in, value_in, [self, key_in](bool ok_in, const Value& applied_in) {
+                self->finished(key_in, ok_in, applied_in);
+            });
+        }
+
+        void finished(const Key& key_in, bool ok_in, const Value& applied_in) {
+            std::vector<done_type> waiters;
+            bool next = false;
+            Value next_value{};
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto& target = targets[key_in];
+
+                waiters.swap(target.in_flight_waiters);
+                stats.written++;
+
+                if (target.has_pending) {
+                    next = true;
+                    next_value = target.pending;
+                    target.has_pending = false;
+                    target.in_flight_waiters.swap(target.pending_waiters);
+                } else {
+                    target.in_flight = false;
+                }
+            }
+
+            for(auto&& i : waiters) {
+                if (i) i(ok_in, applied_in);
+            }
+
+            if (next) start(key_in, next_value);
+        }
+
+    public:
+        write_coalescer(const writer_type& writer_in) : writer(writer_in) { }
+
+        // done_in runs on whatever thread the writer finishes on
+        void write(const Key& key_in, const Value& value_in, const done_type& done_in = nullptr) {
+            std::unique_lock<std::mutex> lock(mutex);
+            auto& target = targets[key_in];
+
+            stats.submitted++;
+
+            if (target.in_flight) {
+                if (target.has_pending) stats.coalesced++;
+                target.pending = value_in;
+                target.has_pending = true;
+                target.pending_waiters.push_back(done_in);
+                return;
+            }
+
+            target.in_flight = true;
+            target.in_flight_waiters.push_back(done_in);
+            lock.unlock();
+
+            start(key_in, value_in);
+        }
+
+        stats_type get_stats() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return stats;
+        }
+};
+
+}
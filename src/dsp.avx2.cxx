@@ -0,0 +1,240 @@
+/*
+ * dsp.avx2.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+// Built with -mavx2 and only called when the CPU says it has AVX2. Nothing
+// from the standard library is used here because a template instantiated
+// in this file could be the copy the linker keeps for everyone else.
+
+#include <immintrin.h>
+
+#include "dsp.h"
+#include "dsp.kernels.h"
+
+namespace oemros {
+
+// see sse2_clamp() for why the arguments go in this order
+static inline __m256 avx2_clamp(const __m256& samples_in, const __m256& low_in, const __m256& high_in) {
+    return _mm256_max_ps(_mm256_min_ps(high_in, samples_in), low_in);
+}
+
+static void avx2_s16_to_f32(const int16_t* in_in, float* out_in, size_t count_in) {
+    const auto scale = _mm256_set1_ps(DSP_S16_TO_F32);
+    size_t i = 0;
+
+    for(; i + 8 <= count_in; i += 8) {
+        auto samples = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(in_in + i)));
+        _mm256_storeu_ps(out_in + i, _mm256_mul_ps(_mm256_cvtepi32_ps(samples), scale));
+    }
+
+    dsp_scalar_kernels.s16_to_f32(in_in + i, out_in + i, count_in - i);
+}
+
+static void avx2_f32_to_s16(const float* in_in, int16_t* out_in, size_t count_in) {
+    const auto scale = _mm256_set1_ps(DSP_F32_TO_S16);
+    const auto low = _mm256_set1_ps(DSP_F32_S16_LOW);
+    const auto high = _mm256_set1_ps(DSP_F32_S16_HIGH);
+    size_t i = 0;
+
+    for(; i + 16 <= count_in; i += 16) {
+        auto first = _mm256_cvtps_epi32(avx2_clamp(_mm256_mul_ps(_mm256_loadu_ps(in_in + i), scale), low, high));
+        auto second = _mm256_cvtps_epi32(avx2_clamp(_mm256_mul_ps(_mm256_loadu_ps(in_in + i + 8), scale), low, high));
+        // packing works inside each 128 bit lane so the middle quarters
+        // come out swapped and have to be put back
+        auto packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(first, second), 0xd8);
+        _mm256_storeu_si256((__m256i*)(out_in + i), packed);
+    }
+
+    dsp_scalar_kernels.f32_to_s16(in_in + i, out_in + i, count_in - i);
+}
+
+static void avx2_s32_to_f32(const int32_t* in_in, float* out_in, size_t count_in) {
+    const auto scale = _mm256_set1_ps(DSP_S32_TO_F32);
+    size_t i = 0;
+
+    for(; i + 8 <= count_in; i += 8) {
+        auto samples = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(in_in + i)));
+        _mm256_storeu_ps(out_in + i, _mm256_mul_ps(samples, scale));
+    }
+
+    dsp_scalar_kernels.s32_to_f32(in_in + i, out_in + i, count_in - i);
+}
+
+static void avx2_f32_to_s32(const float* in_in, int32_t* out_in, size_t count_in) {
+    const auto scale = _mm256_set1_ps(DSP_F32_TO_S32);
+    const auto low = _mm256_set1_ps(DSP_F32_S32_LOW);
+    const auto high = _mm256_set1_ps(DSP_F32_S32_HIGH);
+    size_t i = 0;
+
+    for(; i + 8 <= count_in; i += 8) {
+        auto scaled = avx2_clamp(_mm256_mul_ps(_mm256_loadu_ps(in_in + i), scale), low, high);
+        _mm256_storeu_si256((__m256i*)(out_in + i), _mm256_cvtps_epi32(scaled));
+    }
+
+    dsp_scalar_kernels.f32_to_s32(in_in + i, out_in + i, count_in - i);
+}
+
+static void avx2_ramp_gain(float* samples_in, size_t count_in, float start_in, float step_in) {
+    const auto start = _mm256_set1_ps(start_in);
+    const auto step = _mm256_set1_ps(step_in);
+    const auto eight = _mm256_set1_ps(8);
+    auto index = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    size_t i = 0;
+
+    for(; i + 8 <= count_in; i += 8) {
+        auto gain = _mm256_add_ps(start, _mm256_mul_ps(index, step));
+        _mm256_storeu_ps(samples_in + i, _mm256_mul_ps(_mm256_loadu_ps(samples_in + i), gain));
+        index = _mm256_add_ps(index, eight);
+    }
+
+    for(; i < count_in; i++) samples_in[i] *= start_in + (float)i * step_in;
+}
+
+static void avx2_offset(float* samples_in, size_t count_in, float add_in) {
+    const auto add = _mm256_set1_ps(add_in);
+    size_t i = 0;
+
+    for(; i + 8 <= count_in; i += 8) {
+        _mm256_storeu_ps(samples_in + i, _mm256_add_ps(_mm256_loadu_ps(samples_in + i), add));
+    }
+
+    dsp_scalar_kernels.offset(samples_in + i, count_in - i, add_in);
+}
+
+static void avx2_measure(const float* samples_in, size_t count_in, float* peak_out, double* sum_out, double* squares_out) {
+    const auto sign = _mm256_set1_ps(-0.0f);
+    auto peak = _mm256_setzero_ps();
+    auto sum = _mm256_setzero_pd();
+    auto squares = _mm256_setzero_pd();
+    size_t i = 0;
+
+    for(; i + 8 <= count_in; i += 8) {
+        auto samples = _mm256_loadu_ps(samples_in + i);
+        peak = _mm256_max_ps(peak, _mm256_andnot_ps(sign, samples));
+
+        auto low = _mm256_cvtps_pd(_mm256_castps256_ps128(samples));
+        auto high = _mm256_cvtps_pd(_mm256_extractf128_ps(samples, 1));
+        sum = _mm256_add_pd(sum, _mm256_add_pd(low, high));
+        squares = _mm256_add_pd(squares, _mm256_add_pd(_mm256_mul_pd(low, low), _mm256_mul_pd(high, high)));
+    }
+
+    float peaks[8];
+    double sums[4], all_squares[4];
+    _mm256_storeu_ps(peaks, peak);
+    _mm256_storeu_pd(sums, sum);
+    _mm256_storeu_pd(all_squares, squares);
+
+    float tail_peak;
+    double tail_sum, tail_squares;
+    dsp_scalar_kernels.measure(samples_in + i, count_in - i, &tail_peak, &tail_sum, &tail_squares);
+
+    *peak_out = tail_peak;
+    for(auto lane : peaks) if (lane > *peak_out) *peak_out = lane;
+    *sum_out = sums[0] + sums[1] + sums[2] + sums[3] + tail_sum;
+    *squares_out = all_squares[0] + all_squares[1] + all_squares[2] + all_squares[3] + tail_squares;
+}
+
+// four groups of bins at a time like sse2_goertzel()
+static void avx2_goertzel(const float* samples_in, size_t count_in, const float* coefficients_in,
+                          float* s1_inout, float* s2_inout, size_t bins_in) {
+    size_t bin = 0;
+
+    for(; bin + 32 <= bins_in; bin += 32) {
+        __m256 coefficient[4], s1[4], s2[4];
+
+        for(size_t j = 0; j < 4; j++) {
+            coefficient[j] = _mm256_loadu_ps(coefficients_in + bin + j * 8);
+            s1[j] = _mm256_loadu_ps(s1_inout + bin + j * 8);
+            s2[j] = _mm256_loadu_ps(s2_inout + bin + j * 8);
+        }
+
+        for(size_t i = 0; i < count_in; i++) {
+            auto sample = _mm256_set1_ps(samples_in[i]);
+
+            for(size_t j = 0; j < 4; j++) {
+                auto s0 = _mm256_sub_ps(_mm256_add_ps(sample, _mm256_mul_ps(coefficient[j], s1[j])), s2[j]);
+                s2[j] = s1[j];
+                s1[j] = s0;
+            }
+        }
+
+        for(size_t j = 0; j < 4; j++) {
+            _mm256_storeu_ps(s1_inout + bin + j * 8, s1[j]);
+            _mm256_storeu_ps(s2_inout + bin + j * 8, s2[j]);
+        }
+    }
+
+    for(; bin < bins_in; bin += 8) {
+        auto coefficient = _mm256_loadu_ps(coefficients_in + bin);
+        auto s1 = _mm256_loadu_ps(s1_inout + bin);
+        auto s2 = _mm256_loadu_ps(s2_inout + bin);
+
+        for(size_t i = 0; i < count_in; i++) {
+            auto s0 = _mm256_sub_ps(_mm256_add_ps(_mm256_set1_ps(samples_in[i]), _mm256_mul_ps(coefficient, s1)), s2);
+            s2 = s1;
+            s1 = s0;
+        }
+
+        _mm256_storeu_ps(s1_inout + bin, s1);
+        _mm256_storeu_ps(s2_inout + bin, s2);
+    }
+}
+
+// short passes go to the scalar version like in sse2_fft_stage()
+static void avx2_fft_stage(float* re_inout, float* im_inout, size_t count_in, size_t half_in,
+                           const float* twiddle_re_in, const float* twiddle_im_in) {
+    if (half_in < 8) {
+        dsp_scalar_kernels.fft_stage(re_inout, im_inout, count_in, half_in, twiddle_re_in, twiddle_im_in);
+        return;
+    }
+
+    for(size_t group = 0; group < count_in; group += 2 * half_in) {
+        auto re = re_inout + group, im = im_inout + group;
+
+        for(size_t k = 0; k < half_in; k += 8) {
+            auto w_re = _mm256_loadu_ps(twiddle_re_in + k), w_im = _mm256_loadu_ps(twiddle_im_in + k);
+            auto b_re = _mm256_loadu_ps(re + k + half_in), b_im = _mm256_loadu_ps(im + k + half_in);
+            auto a_re = _mm256_loadu_ps(re + k), a_im = _mm256_loadu_ps(im + k);
+
+            auto t_re = _mm256_sub_ps(_mm256_mul_ps(w_re, b_re), _mm256_mul_ps(w_im, b_im));
+            auto t_im = _mm256_add_ps(_mm256_mul_ps(w_re, b_im), _mm256_mul_ps(w_im, b_re));
+
+            _mm256_storeu_ps(re + k + half_in, _mm256_sub_ps(a_re, t_re));
+            _mm256_storeu_ps(im + k + half_in, _mm256_sub_ps(a_im, t_im));
+            _mm256_storeu_ps(re + k, _mm256_add_ps(a_re, t_re));
+            _mm256_storeu_ps(im + k, _mm256_add_ps(a_im, t_im));
+        }
+    }
+}
+
+const dsp_kernels dsp_avx2_kernels = {
+    "avx2",
+    avx2_s16_to_f32,
+    avx2_f32_to_s16,
+    avx2_s32_to_f32,
+    avx2_f32_to_s32,
+    avx2_ramp_gain,
+    avx2_offset,
+    avx2_measure,
+    avx2_goertzel,
+    avx2_fft_stage,
+};
+
+}
@@ -0,0 +1,339 @@
+/*
+ * dsp.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "dsp.h"
+#include "dsp.kernels.h"
+#include "logging.h"
+#include "system.h"
+
+namespace oemros {
+
+// quieter than this is reported as this many dB
+#define DSP_FLOOR_DB -150.0f
+
+static void scalar_s16_to_f32(const int16_t* in_in, float* out_in, size_t count_in) {
+    for(size_t i = 0; i < count_in; i++) out_in[i] = in_in[i] * DSP_S16_TO_F32;
+}
+
+static void scalar_f32_to_s16(const float* in_in, int16_t* out_in, size_t count_in) {
+    for(size_t i = 0; i < count_in; i++) {
+        auto scaled = std::max(DSP_F32_S16_LOW, std::min(in_in[i] * DSP_F32_TO_S16, DSP_F32_S16_HIGH));
+        out_in[i] = std::lrint(scaled);
+    }
+}
+
+static void scalar_s32_to_f32(const int32_t* in_in, float* out_in, size_t count_in) {
+    for(size_t i = 0; i < count_in; i++) out_in[i] = (float)in_in[i] * DSP_S32_TO_F32;
+}
+
+static void scalar_f32_to_s32(const float* in_in, int32_t* out_in, size_t count_in) {
+    for(size_t i = 0; i < count_in; i++) {
+        auto scaled = std::max(DSP_F32_S32_LOW, std::min(in_in[i] * DSP_F32_TO_S32, DSP_F32_S32_HIGH));
+        out_in[i] = std::lrint(scaled);
+    }
+}
+
+static void scalar_ramp_gain(float* samples_in, size_t count_in, float start_in, float step_in) {
+    for(size_t i = 0; i < count_in; i++) samples_in[i] *= start_in + (float)i * step_in;
+}
+
+static void scalar_offset(float* samples_in, size_t count_in, float add_in) {
+    for(size_t i = 0; i < count_in; i++) samples_in[i] += add_in;
+}
+
+static void scalar_measure(const float* samples_in, size_t count_in, float* peak_out, double* sum_out, double* squares_out) {
+    float peak = 0;
+    double sum = 0, squares = 0;
+
+    for(size_t i = 0; i < count_in; i++) {
+        double sample = samples_in[i];
+        peak = std::max(peak, std::fabs(samples_in[i]));
+        sum += sample;
+        squares += sample * sample;
+    }
+
+    *peak_out = peak;
+    *sum_out = sum;
+    *squares_out = squares;
+}
+
+static void scalar_goertzel(const float* samples_in, size_t count_in, const float* coefficients_in,
+                            float* s1_inout, float* s2_inout, size_t bins_in) {
+    for(size_t bin = 0; bin < bins_in; bin++) {
+        auto coefficient = coefficients_in[bin];
+        auto s1 = s1_inout[bin], s2 = s2_inout[bin];
+
+        for(size_t i = 0; i < count_in; i++) {
+            auto s0 = samples_in[i] + coefficient * s1 - s2;
+            s2 = s1;
+            s1 = s0;
+        }
+
+        s1_inout[bin] = s1;
+        s2_inout[bin] = s2;
+    }
+}
+
+static void scalar_fft_stage(float* re_inout, float* im_inout, size_t count_in, size_t half_in,
+                             const float* twiddle_re_in, const float* twiddle_im_in) {
+    for(size_t group = 0; group < count_in; group += 2 * half_in) {
+        auto re = re_inout + group, im = im_inout + group;
+
+        for(size_t k = 0; k < half_in; k++) {
+            auto t_re = twiddle_re_in[k] * re[k + half_in] - twiddle_im_in[k] * im[k + half_in];
+            auto t_im = twiddle_re_in[k] * im[k + half_in] + twiddle_im_in[k] * re[k + half_in];
+            re[k + half_in] = re[k] - t_re;
+            im[k + half_in] = im[k] - t_im;
+            re[k] = re[k] + t_re;
+            im[k] = im[k] + t_im;
+        }
+    }
+}
+
+const dsp_kernels dsp_scalar_kernels = {
+    "scalar",
+    scalar_s16_to_f32,
+    scalar_f32_to_s16,
+    scalar_s32_to_f32,
+    scalar_f32_to_s32,
+    scalar_ramp_gain,
+    scalar_offset,
+    scalar_measure,
+    scalar_goertzel,
+    scalar_fft_stage,
+};
+
+std::vector<const dsp_kernels*> dsp_all_kernels() {
+    std::vector<const dsp_kernels*> result{ &dsp_scalar_kernels };
+
+#ifdef OEMROS_DSP_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) result.push_back(&dsp_sse2_kernels);
+    if (__builtin_cpu_supports("avx2")) result.push_back(&dsp_avx2_kernels);
+#endif
+
+    return result;
+}
+
+const dsp_kernels* dsp_find_kernels(const std::string& name_in) {
+    for(auto i : dsp_all_kernels()) {
+        if (name_in == i->name) return i;
+    }
+
+    return nullptr;
+}
+
+static const dsp_kernels& dsp_choose_kernels() {
+    auto wanted = std::getenv("OEMROS_DSP");
+
+    if (wanted != nullptr) {
+        auto found = dsp_find_kernels(wanted);
+        if (found != nullptr) return *found;
+        log_error("OEMROS_DSP names DSP kernels that can not be used here: ", wanted);
+    }
+
+    return *dsp_all_kernels().back();
+}
+
+const dsp_kernels& dsp_get_kernels() {
+    static const dsp_kernels& chosen = dsp_choose_kernels();
+    return chosen;
+}
+
+float dsp_db_to_gain(const float& db_in) {
+    return std::pow(10.0f, db_in / 20.0f);
+}
+
+float dsp_gain_to_db(const float& gain_in) {
+    if (gain_in <= 0) return DSP_FLOOR_DB;
+    return std::max(DSP_FLOOR_DB, 20.0f * std::log10(gain_in));
+}
+
+dsp_level dsp_measure(const float* samples_in, const size_t& count_in) {
+    dsp_level result;
+    if (count_in == 0) return result;
+
+    double sum, squares;
+    dsp_get_kernels().measure(samples_in, count_in, &result.peak, &sum, &squares);
+    result.rms = std::sqrt(squares / count_in);
+    result.mean = sum / count_in;
+
+    return result;
+}
+
+dsp_gain::dsp_gain(const float& db_in, const float& smoothing_in)
+: kernels(dsp_get_kernels()), current(dsp_db_to_gain(db_in)), target(current), smoothing(smoothing_in) {
+    if (smoothing <= 0 || smoothing > 1) system_fault("DSP gain smoothing must be more than 0 and no more than 1");
+}
+
+void dsp_gain::set_db(const float& db_in) {
+    target = dsp_db_to_gain(db_in);
+}
+
+void dsp_gain::process(float* samples_in, const size_t& count_in) {
+    if (count_in == 0) return;
+
+    auto next = current + (target - current) * smoothing;
+    // close enough that the rest of the way can not be heard
+    if (std::fabs(target - next) <= target * 1e-5f) next = target;
+
+    kernels.ramp_gain(samples_in, count_in, current, (next - current) / count_in);
+    current = next;
+}
+
+// the lowpass from the RBJ audio EQ cookbook
+dsp_biquad dsp_biquad::lowpass(const float& rate_in, const float& hertz_in, const float& q_in) {
+    if (hertz_in <= 0 || hertz_in >= rate_in / 2) system_fault("DSP lowpass corner must be between 0 and half the sample rate");
+
+    auto w0 = 2 * M_PI * hertz_in / rate_in;
+    auto alpha = std::sin(w0) / (2 * q_in);
+    auto a0 = 1 + alpha;
+    dsp_biquad result;
+
+    result.b1 = (1 - std::cos(w0)) / a0;
+    result.b0 = result.b2 = result.b1 / 2;
+    result.a1 = -2 * std::cos(w0) / a0;
+    result.a2 = (1 - alpha) / a0;
+
+    return result;
+}
+
+dsp_fft::dsp_fft(const size_t& size_in, const dsp_kernels& kernels_in)
+: kernels(kernels_in), size(size_in), reversed(size_in), twiddle_re(size_in), twiddle_im(size_in) {
+    if (size < 2 || (size & (size - 1)) != 0) system_fault("FFT size must be a power of 2: ", size);
+
+    size_t bits = 0;
+    while(((size_t)1 << bits) < size) bits++;
+
+    for(size_t i = 0; i < size; i++) {
+        uint32_t flipped = 0;
+        for(size_t bit = 0; bit < bits; bit++) if (i & ((size_t)1 << bit)) flipped |= 1u << (bits - 1 - bit);
+        reversed[i] = flipped;
+    }
+
+    // worked out in double so the big transforms stay accurate
+    for(size_t half = 1; half < size; half *= 2) {
+        for(size_t k = 0; k < half; k++) {
+            auto angle = -M_PI * k / half;
+            twiddle_re[half - 1 + k] = std::cos(angle);
+            twiddle_im[half - 1 + k] = std::sin(angle);
+        }
+    }
+}
+
+void dsp_fft::forward_reversed(float* re_inout, float* im_inout) const {
+    for(size_t half = 1; half < size; half *= 2) {
+        kernels.fft_stage(re_inout, im_inout, size, half, twiddle_re.data() + half - 1, twiddle_im.data() + half - 1);
+    }
+}
+
+void dsp_fft::forward(float* re_inout, float* im_inout) const {
+    for(size_t i = 0; i < size; i++) {
+        auto j = reversed[i];
+        if (j <= i) continue;
+        std::swap(re_inout[i], re_inout[j]);
+        std::swap(im_inout[i], im_inout[j]);
+    }
+
+    forward_reversed(re_inout, im_inout);
+}
+
+// a windowed sinc at the prototype rate of the input times up_in; a
+// Blackman window needs about 5.5 taps over the width of the transition
+dsp_resampler::dsp_resampler(const unsigned int& up_in, const unsigned int& down_in, const float& pass_in)
+: up(up_in), down(down_in) {
+    if (up == 0 || down == 0) system_fault("DSP resampler needs a ratio of more than 0");
+    if (pass_in <= 0 || pass_in >= 0.5f) system_fault("DSP resampler pass band must be more than 0 and under one half");
+
+    double prototype = std::max(up, down);
+    double width = (1 - 2 * pass_in) / prototype;
+    taps = std::max<size_t>(1, std::ceil(5.5 / width / up));
+
+    auto length = taps * up;
+    auto cutoff = 0.5 / prototype;
+    double span = std::max<size_t>(1, length - 1);
+    std::vector<double> filter(length);
+
+    for(size_t i = 0; i < length; i++) {
+        auto x = i - span / 2;
+        auto sinc = std::fabs(x) < 1e-9 ? 2 * cutoff : std::sin(2 * M_PI * cutoff * x) / (M_PI * x);
+        auto window = 0.42 - 0.5 * std::cos(2 * M_PI * i / span) + 0.08 * std::cos(4 * M_PI * i / span);
+        filter[i] = sinc * window * up;
+    }
+
+    // output at phase p after input n is the sum of filter[p + k * up] times
+    // input n - k so each phase is turned around to run oldest first
+    coefficients.resize(length);
+    for(size_t p = 0; p < up; p++) {
+        for(size_t k = 0; k < taps; k++) coefficients[p * taps + taps - 1 - k] = filter[p + k * up];
+    }
+
+    history.assign(taps * 2, 0);
+}
+
+size_t dsp_resampler::process(const float* samples_in, const size_t& count_in, float* out_out) {
+    size_t made = 0;
+
+    for(size_t i = 0; i < count_in; i++) {
+        history[position] = history[position + taps] = samples_in[i];
+        if (++position == taps) position = 0;
+
+        for(; phase < up; phase += down) {
+            auto oldest = history.data() + position;
+            auto taps_for = coefficients.data() + phase * taps;
+            float sum = 0;
+            for(size_t k = 0; k < taps; k++) sum += taps_for[k] * oldest[k];
+            out_out[made++] = sum;
+        }
+
+        phase -= up;
+    }
+
+    return made;
+}
+
+void dsp_resampler::reset() {
+    std::fill(history.begin(), history.end(), 0.0f);
+    position = 0;
+    phase = 0;
+}
+
+dsp_dc_blocker::dsp_dc_blocker(const float& coefficient_in)
+: kernels(dsp_get_kernels()), coefficient(coefficient_in) {
+    if (coefficient <= 0 || coefficient > 1) system_fault("DSP DC blocker coefficient must be more than 0 and no more than 1");
+}
+
+void dsp_dc_blocker::process(float* samples_in, const size_t& count_in) {
+    if (count_in == 0) return;
+
+    float peak;
+    double sum, squares;
+    kernels.measure(samples_in, count_in, &peak, &sum, &squares);
+
+    dc += ((float)(sum / count_in) - dc) * coefficient;
+    kernels.offset(samples_in, count_in, -dc);
+}
+
+}
@@ -0,0 +1,190 @@
+/*
+ * dsp.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace oemros {
+
+// Inner loops for audio blocks. There is a plain C++ version of each and on
+// x86 SSE2 and AVX2 versions; the best one the CPU can run is picked the
+// first time dsp_get_kernels() is called. Every version gives the same
+// answer as the plain one except for the order sums are added up in.
+//
+// Floats run from -1 to 1 and integers are scaled so the full scale of the
+// integer is 1; converting to an integer rounds to nearest and saturates.
+struct dsp_kernels {
+    const char* name;
+    void (*s16_to_f32)(const int16_t* in_in, float* out_in, size_t count_in);
+    void (*f32_to_s16)(const float* in_in, int16_t* out_in, size_t count_in);
+    void (*s32_to_f32)(const int32_t* in_in, float* out_in, size_t count_in);
+    void (*f32_to_s32)(const float* in_in, int32_t* out_in, size_t count_in);
+    // sample i is multiplied by start_in + i * step_in
+    void (*ramp_gain)(float* samples_in, size_t count_in, float start_in, float step_in);
+    void (*offset)(float* samples_in, size_t count_in, float add_in);
+    // largest magnitude, sum and sum of squares in one pass
+    void (*measure)(const float* samples_in, size_t count_in, float* peak_out, double* sum_out, double* squares_out);
+    // runs a bank of Goertzel filters over the samples; bin b has the
+    // coefficient 2 cos(w) and keeps its state in s1 and s2. bins_in has to
+    // be a multiple of dsp_bank_width.
+    void (*goertzel)(const float* samples_in, size_t count_in, const float* coefficients_in,
+                     float* s1_inout, float* s2_inout, size_t bins_in);
+    // one radix 2 decimation in time pass over count_in complex points in
+    // split real and imaginary arrays with butterflies half_in apart
+    void (*fft_stage)(float* re_inout, float* im_inout, size_t count_in, size_t half_in,
+                      const float* twiddle_re_in, const float* twiddle_im_in);
+};
+
+// Goertzel banks are padded out to a multiple of this many bins
+static constexpr size_t dsp_bank_width = 8;
+
+extern const dsp_kernels dsp_scalar_kernels;
+#ifdef OEMROS_DSP_X86
+extern const dsp_kernels dsp_sse2_kernels;
+extern const dsp_kernels dsp_avx2_kernels;
+#endif
+
+// the fastest set this CPU can run; OEMROS_DSP in the environment can name
+// a slower one
+const dsp_kernels& dsp_get_kernels();
+// nullptr if there is no such set or the CPU can not run it
+const dsp_kernels* dsp_find_kernels(const std::string& name_in);
+// every set this CPU can run, slowest first
+std::vector<const dsp_kernels*> dsp_all_kernels();
+
+float dsp_db_to_gain(const float& db_in);
+float dsp_gain_to_db(const float& gain_in);
+
+// Gain set in dB that moves to a new setting smoothly instead of stepping
+// and clicking. Each block ramps from where the last block ended toward the
+// target, covering the fraction of the way that smoothing_in says.
+class dsp_gain {
+    private:
+        const dsp_kernels& kernels;
+        float current;
+        float target;
+        float smoothing;
+
+    public:
+        // smoothing_in is how much of the way to the target each block goes
+        dsp_gain(const float& db_in = 0, const float& smoothing_in = 0.25f);
+        void set_db(const float& db_in);
+        float get_db() const { return dsp_gain_to_db(target); }
+        void process(float* samples_in, const size_t& count_in);
+};
+
+struct dsp_level {
+    float peak = 0;
+    float rms = 0;
+    // the mean of the block which is the DC offset
+    float mean = 0;
+};
+
+dsp_level dsp_measure(const float* samples_in, const size_t& count_in);
+
+// One second order section run a sample at a time for the places that
+// need a steep filter on a slow signal.
+class dsp_biquad {
+    private:
+        float b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+        float z1 = 0, z2 = 0;
+
+    public:
+        // q_in of 0.7071 is Butterworth; 0.5412 and 1.3066 make a fourth
+        // order Butterworth out of two
+        static dsp_biquad lowpass(const float& rate_in, const float& hertz_in, const float& q_in);
+        float process(const float& sample_in) {
+            auto result = b0 * sample_in + z1;
+            z1 = b1 * sample_in - a1 * result + z2;
+            z2 = b2 * sample_in - a2 * result;
+            return result;
+        }
+        void reset() { z1 = z2 = 0; }
+};
+
+// In place complex FFT on split real and imaginary arrays. The twiddles for
+// each pass sit next to each other so a pass walks memory in order and the
+// butterflies of a pass run through the fft_stage kernel.
+class dsp_fft {
+    private:
+        const dsp_kernels& kernels;
+        const size_t size;
+        std::vector<uint32_t> reversed;
+        // the twiddles for the pass with butterflies h apart start at h - 1
+        std::vector<float> twiddle_re, twiddle_im;
+
+    public:
+        // size_in has to be a power of 2
+        dsp_fft(const size_t& size_in, const dsp_kernels& kernels_in = dsp_get_kernels());
+        size_t get_size() const { return size; }
+        // where input sample i has to go so the transform comes out in order;
+        // filling the arrays this way saves a separate reordering pass
+        const std::vector<uint32_t>& get_reversed() const { return reversed; }
+        // the input has to already be in bit reversed order
+        void forward_reversed(float* re_inout, float* im_inout) const;
+        void forward(float* re_inout, float* im_inout) const;
+};
+
+// Changes the sample rate by up_in / down_in with a polyphase FIR so only
+// the output samples are ever worked out. Everything up to pass_in of the
+// lower of the two rates is kept and everything that would fold back onto
+// it is filtered out; the filter gets longer as pass_in nears one half.
+class dsp_resampler {
+    private:
+        const unsigned int up;
+        const unsigned int down;
+        size_t taps = 0;
+        // taps for each phase one after the other, oldest sample first
+        std::vector<float> coefficients;
+        // the last taps samples twice over so they can be read in one run
+        std::vector<float> history;
+        size_t position = 0;
+        unsigned int phase = 0;
+
+    public:
+        dsp_resampler(const unsigned int& up_in, const unsigned int& down_in, const float& pass_in = 0.4f);
+        // the most samples process() can make out of count_in
+        size_t get_max_out(const size_t& count_in) const { return count_in * up / down + 1; }
+        // returns how many samples went into out_out
+        size_t process(const float* samples_in, const size_t& count_in, float* out_out);
+        void reset();
+};
+
+// Takes the DC offset out of a signal. The offset is tracked as a slow
+// average of the block means and subtracted from every sample so the work
+// per sample stays a single add.
+class dsp_dc_blocker {
+    private:
+        const dsp_kernels& kernels;
+        float dc = 0;
+        float coefficient;
+
+    public:
+        dsp_dc_blocker(const float& coefficient_in = 0.05f);
+        float get_offset() const { return dc; }
+        void process(float* samples_in, const size_t& count_in);
+};
+
+}
@@ -1,7 +1,7 @@
 /*
- * object.cxx
+ * dsp.kernels.h
  *
- *  Created on: Jul 31, 2018
+ *  Created on: Oct 19, 2026
  *      Author: tyler
  *
  * This program is free software: you can redistribute it and/or modify
@@ -19,15 +19,18 @@
  *
  */
 
-#include <atomic>
+#pragma once
 
-#include "object.h"
+// Scale factors shared by every set of DSP kernels so they all round and
+// saturate the same way. Only the kernel sources include this.
 
-namespace oemros {
+#define DSP_S16_TO_F32 (1.0f / 32768.0f)
+#define DSP_F32_TO_S16 32768.0f
+#define DSP_F32_S16_LOW -32768.0f
+#define DSP_F32_S16_HIGH 32767.0f
 
-uint32_t get_next_subscription_num() {
-    static std::atomic<uint32_t> last_subscription_num = ATOMIC_VAR_INIT(0);
-    return ++last_subscription_num;
-}
-
-}
+#define DSP_S32_TO_F32 (1.0f / 2147483648.0f)
+#define DSP_F32_TO_S32 2147483648.0f
+#define DSP_F32_S32_LOW -2147483648.0f
+// the largest float below 2^31; anything past it will not fit in an int32
+#define DSP_F32_S32_HIGH 2147483520.0f
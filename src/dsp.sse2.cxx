@@ -0,0 +1,245 @@
+/*
+ * dsp.sse2.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+// Built with -msse2 and only called when the CPU says it has SSE2. Like
+// dsp.avx2.cxx it stays away from standard library templates.
+
+#include <emmintrin.h>
+
+#include "dsp.h"
+#include "dsp.kernels.h"
+
+namespace oemros {
+
+// minps and maxps hand back their second argument when either is NaN so
+// this order sends NaN to low just like std::max(low, std::min(x, high))
+static inline __m128 sse2_clamp(const __m128& samples_in, const __m128& low_in, const __m128& high_in) {
+    return _mm_max_ps(_mm_min_ps(high_in, samples_in), low_in);
+}
+
+static void sse2_s16_to_f32(const int16_t* in_in, float* out_in, size_t count_in) {
+    const auto scale = _mm_set1_ps(DSP_S16_TO_F32);
+    size_t i = 0;
+
+    for(; i + 8 <= count_in; i += 8) {
+        auto packed = _mm_loadu_si128((const __m128i*)(in_in + i));
+        // sign extend by putting each sample in the top half and shifting down
+        auto low = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+        auto high = _mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16);
+        _mm_storeu_ps(out_in + i, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+        _mm_storeu_ps(out_in + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+    }
+
+    dsp_scalar_kernels.s16_to_f32(in_in + i, out_in + i, count_in - i);
+}
+
+static void sse2_f32_to_s16(const float* in_in, int16_t* out_in, size_t count_in) {
+    const auto scale = _mm_set1_ps(DSP_F32_TO_S16);
+    const auto low = _mm_set1_ps(DSP_F32_S16_LOW);
+    const auto high = _mm_set1_ps(DSP_F32_S16_HIGH);
+    size_t i = 0;
+
+    for(; i + 8 <= count_in; i += 8) {
+        auto first = sse2_clamp(_mm_mul_ps(_mm_loadu_ps(in_in + i), scale), low, high);
+        auto second = sse2_clamp(_mm_mul_ps(_mm_loadu_ps(in_in + i + 4), scale), low, high);
+        _mm_storeu_si128((__m128i*)(out_in + i), _mm_packs_epi32(_mm_cvtps_epi32(first), _mm_cvtps_epi32(second)));
+    }
+
+    dsp_scalar_kernels.f32_to_s16(in_in + i, out_in + i, count_in - i);
+}
+
+static void sse2_s32_to_f32(const int32_t* in_in, float* out_in, size_t count_in) {
+    const auto scale = _mm_set1_ps(DSP_S32_TO_F32);
+    size_t i = 0;
+
+    for(; i + 4 <= count_in; i += 4) {
+        auto samples = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(in_in + i)));
+        _mm_storeu_ps(out_in + i, _mm_mul_ps(samples, scale));
+    }
+
+    dsp_scalar_kernels.s32_to_f32(in_in + i, out_in + i, count_in - i);
+}
+
+static void sse2_f32_to_s32(const float* in_in, int32_t* out_in, size_t count_in) {
+    const auto scale = _mm_set1_ps(DSP_F32_TO_S32);
+    const auto low = _mm_set1_ps(DSP_F32_S32_LOW);
+    const auto high = _mm_set1_ps(DSP_F32_S32_HIGH);
+    size_t i = 0;
+
+    for(; i + 4 <= count_in; i += 4) {
+        auto scaled = _mm_mul_ps(_mm_loadu_ps(in_in + i), scale);
+        _mm_storeu_si128((__m128i*)(out_in + i), _mm_cvtps_epi32(sse2_clamp(scaled, low, high)));
+    }
+
+    dsp_scalar_kernels.f32_to_s32(in_in + i, out_in + i, count_in - i);
+}
+
+static void sse2_ramp_gain(float* samples_in, size_t count_in, float start_in, float step_in) {
+    const auto start = _mm_set1_ps(start_in);
+    const auto step = _mm_set1_ps(step_in);
+    auto index = _mm_setr_ps(0, 1, 2, 3);
+    const auto four = _mm_set1_ps(4);
+    size_t i = 0;
+
+    for(; i + 4 <= count_in; i += 4) {
+        auto gain = _mm_add_ps(start, _mm_mul_ps(index, step));
+        _mm_storeu_ps(samples_in + i, _mm_mul_ps(_mm_loadu_ps(samples_in + i), gain));
+        index = _mm_add_ps(index, four);
+    }
+
+    for(; i < count_in; i++) samples_in[i] *= start_in + (float)i * step_in;
+}
+
+static void sse2_offset(float* samples_in, size_t count_in, float add_in) {
+    const auto add = _mm_set1_ps(add_in);
+    size_t i = 0;
+
+    for(; i + 4 <= count_in; i += 4) {
+        _mm_storeu_ps(samples_in + i, _mm_add_ps(_mm_loadu_ps(samples_in + i), add));
+    }
+
+    dsp_scalar_kernels.offset(samples_in + i, count_in - i, add_in);
+}
+
+static void sse2_measure(const float* samples_in, size_t count_in, float* peak_out, double* sum_out, double* squares_out) {
+    const auto sign = _mm_set1_ps(-0.0f);
+    auto peak = _mm_setzero_ps();
+    auto sum = _mm_setzero_pd();
+    auto squares = _mm_setzero_pd();
+    size_t i = 0;
+
+    // the sums are kept in double like the scalar version so long blocks
+    // do not lose the small samples
+    for(; i + 4 <= count_in; i += 4) {
+        auto samples = _mm_loadu_ps(samples_in + i);
+        peak = _mm_max_ps(peak, _mm_andnot_ps(sign, samples));
+
+        auto low = _mm_cvtps_pd(samples);
+        auto high = _mm_cvtps_pd(_mm_movehl_ps(samples, samples));
+        sum = _mm_add_pd(sum, _mm_add_pd(low, high));
+        squares = _mm_add_pd(squares, _mm_add_pd(_mm_mul_pd(low, low), _mm_mul_pd(high, high)));
+    }
+
+    float peaks[4];
+    double sums[2], all_squares[2];
+    _mm_storeu_ps(peaks, peak);
+    _mm_storeu_pd(sums, sum);
+    _mm_storeu_pd(all_squares, squares);
+
+    float tail_peak;
+    double tail_sum, tail_squares;
+    dsp_scalar_kernels.measure(samples_in + i, count_in - i, &tail_peak, &tail_sum, &tail_squares);
+
+    *peak_out = tail_peak;
+    for(auto lane : peaks) if (lane > *peak_out) *peak_out = lane;
+    *sum_out = sums[0] + sums[1] + tail_sum;
+    *squares_out = all_squares[0] + all_squares[1] + tail_squares;
+}
+
+// Each bin only depends on itself so several groups of bins run side by
+// side to keep the multiplier busy while each one waits on its last sample.
+static void sse2_goertzel(const float* samples_in, size_t count_in, const float* coefficients_in,
+                          float* s1_inout, float* s2_inout, size_t bins_in) {
+    size_t bin = 0;
+
+    for(; bin + 16 <= bins_in; bin += 16) {
+        __m128 coefficient[4], s1[4], s2[4];
+
+        for(size_t j = 0; j < 4; j++) {
+            coefficient[j] = _mm_loadu_ps(coefficients_in + bin + j * 4);
+            s1[j] = _mm_loadu_ps(s1_inout + bin + j * 4);
+            s2[j] = _mm_loadu_ps(s2_inout + bin + j * 4);
+        }
+
+        for(size_t i = 0; i < count_in; i++) {
+            auto sample = _mm_set1_ps(samples_in[i]);
+
+            for(size_t j = 0; j < 4; j++) {
+                auto s0 = _mm_sub_ps(_mm_add_ps(sample, _mm_mul_ps(coefficient[j], s1[j])), s2[j]);
+                s2[j] = s1[j];
+                s1[j] = s0;
+            }
+        }
+
+        for(size_t j = 0; j < 4; j++) {
+            _mm_storeu_ps(s1_inout + bin + j * 4, s1[j]);
+            _mm_storeu_ps(s2_inout + bin + j * 4, s2[j]);
+        }
+    }
+
+    for(; bin < bins_in; bin += 4) {
+        auto coefficient = _mm_loadu_ps(coefficients_in + bin);
+        auto s1 = _mm_loadu_ps(s1_inout + bin);
+        auto s2 = _mm_loadu_ps(s2_inout + bin);
+
+        for(size_t i = 0; i < count_in; i++) {
+            auto s0 = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(samples_in[i]), _mm_mul_ps(coefficient, s1)), s2);
+            s2 = s1;
+            s1 = s0;
+        }
+
+        _mm_storeu_ps(s1_inout + bin, s1);
+        _mm_storeu_ps(s2_inout + bin, s2);
+    }
+}
+
+// the first passes have fewer butterflies in a group than fit in a
+// register and go to the scalar version
+static void sse2_fft_stage(float* re_inout, float* im_inout, size_t count_in, size_t half_in,
+                           const float* twiddle_re_in, const float* twiddle_im_in) {
+    if (half_in < 4) {
+        dsp_scalar_kernels.fft_stage(re_inout, im_inout, count_in, half_in, twiddle_re_in, twiddle_im_in);
+        return;
+    }
+
+    for(size_t group = 0; group < count_in; group += 2 * half_in) {
+        auto re = re_inout + group, im = im_inout + group;
+
+        for(size_t k = 0; k < half_in; k += 4) {
+            auto w_re = _mm_loadu_ps(twiddle_re_in + k), w_im = _mm_loadu_ps(twiddle_im_in + k);
+            auto b_re = _mm_loadu_ps(re + k + half_in), b_im = _mm_loadu_ps(im + k + half_in);
+            auto a_re = _mm_loadu_ps(re + k), a_im = _mm_loadu_ps(im + k);
+
+            auto t_re = _mm_sub_ps(_mm_mul_ps(w_re, b_re), _mm_mul_ps(w_im, b_im));
+            auto t_im = _mm_add_ps(_mm_mul_ps(w_re, b_im), _mm_mul_ps(w_im, b_re));
+
+            _mm_storeu_ps(re + k + half_in, _mm_sub_ps(a_re, t_re));
+            _mm_storeu_ps(im + k + half_in, _mm_sub_ps(a_im, t_im));
+            _mm_storeu_ps(re + k, _mm_add_ps(a_re, t_re));
+            _mm_storeu_ps(im + k, _mm_add_ps(a_im, t_im));
+        }
+    }
+}
+
+const dsp_kernels dsp_sse2_kernels = {
+    "sse2",
+    sse2_s16_to_f32,
+    sse2_f32_to_s16,
+    sse2_s32_to_f32,
+    sse2_f32_to_s32,
+    sse2_ramp_gain,
+    sse2_offset,
+    sse2_measure,
+    sse2_goertzel,
+    sse2_fft_stage,
+};
+
+}
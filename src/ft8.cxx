@@ -0,0 +1,1374 @@
+/*
+ * ft8.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <numeric>
+#include <sstream>
+
+#include "ft8.h"
+#include "logging.h"
+#include "system.h"
+
+namespace oemros {
+
+// the LDPC code both modes use
+#define FT8_CODE_BITS 174
+#define FT8_DATA_BITS 91
+#define FT8_CHECKS 83
+#define FT8_PAYLOAD_BITS 77
+#define FT8_CRC_POLY 0x2757
+#define FT8_CRC_BITS 14
+// audio is kept up to here when it is resampled for decoding
+#define FT8_PASS_HZ 3200.0f
+// slots that can be filling or decoding at once
+#define FT8_BUFFERS 3
+// the spectrogram has this many steps a symbol and bins a tone spacing
+#define FT8_TIME_STEPS 4
+#define FT8_FREQUENCY_BINS 2
+// symbols the sync search looks before the slot and past a signal that
+// would end at the end of the slot
+#define FT8_SEARCH_EXTRA_SYMBOLS 5
+// the variance the bit likelihoods are scaled to before belief propagation
+#define FT8_LLR_VARIANCE 24.0f
+// the clock and the sound card can disagree by this much before the
+// decoder takes the clock's word for where the audio is
+#define FT8_MAX_DRIFT_MSEC 250
+// base 38 for the 11 characters a hash is worked out over
+#define FT8_HASH_MULTIPLIER 47055833459ULL
+// calls remembered to show hashed ones with
+#define FT8_MAX_HASHES 1000
+
+// Each parity bit of a codeword is the parity of the message bits set in
+// its row; the rows are 91 bits of hex with a 0 on the end.
+static const char* const ft8_generator_hex[FT8_CHECKS] = {
+    "8329ce11bf31eaf509f27fc", "761c264e25c259335493132", "dc265902fb277c6410a1bdc", "1b3f417858cd2dd33ec7f62",
+    "09fda4fee04195fd034783a", "077cccc11b8873ed5c3d48a", "29b62afe3ca036f4fe1a9da", "6054faf5f35d96d3b0c8c3e",
+    "e20798e4310eed27884ae90", "775c9c08e80e26ddae56318", "b0b811028c2bf997213487c", "18a0c9231fc60adf5c5ea32",
+    "76471e8302a0721e01b12b8", "ffbccb80ca8341fafb47b2e", "66a72a158f9325a2bf67170", "c4243689fe85b1c51363a18",
+    "0dff739414d1a1b34b1c270", "15b48830636c8b99894972e", "29a89c0d3de81d665489b0e", "4f126f37fa51cbe61bd6b94",
+    "99c47239d0d97d3c84e0940", "1919b75119765621bb4f1e8", "09db12d731faee0b86df6b8", "488fc33df43fbdeea4eafb4",
+    "827423ee40b675f756eb5fe", "abe197c484cb74757144a9a", "2b500e4bc0ec5a6d2bdbdd0", "c474aa53d70218761669360",
+    "8eba1a13db3390bd6718cec", "753844673a27782cc42012e", "06ff83a145c37035a5c1268", "3b37417858cc2dd33ec3f62",
+    "9a4a5a28ee17ca9c324842c", "bc29f465309c977e89610a4", "2663ae6ddf8b5ce2bb29488", "46f231efe457034c1814418",
+    "3fb2ce85abe9b0c72e06fbe", "de87481f282c153971a0a2e", "fcd7ccf23c69fa99bba1412", "f0261447e9490ca8e474cec",
+    "4410115818196f95cdd7012", "088fc31df4bfbde2a4eafb4", "b8fef1b6307729fb0a078c0", "5afea7acccb77bbc9d99a90",
+    "49a7016ac653f65ecdc9076", "1944d085be4e7da8d6cc7d0", "251f62adc4032f0ee714002", "56471f8702a0721e00b12b8",
+    "2b8e4923f2dd51e2d537fa0", "6b550a40a66f4755de95c26", "a18ad28d4e27fe92a4f6c84", "10c2e586388cb82a3d80758",
+    "ef34a41817ee02133db2eb0", "7e9c0c54325a9c15836e000", "3693e572d1fde4cdf079e86", "bfb2cec5abe1b0c72e07fbe",
+    "7ee18230c583cccc57d4b08", "a066cb2fedafc9f52664126", "bb23725abc47cc5f4cc4cd2", "ded9dba3bee40c59b5609b4",
+    "d9a7016ac653e6decdc9036", "9ad46aed5f707f280ab5fc4", "e5921c77822587316d7d3c2", "4f14da8242a8b86dca73352",
+    "8b8b507ad467d4441df770e", "22831c9cf1169467ad04b68", "213b838fe2ae54c38ee7180", "5d926b6dd71f085181a4e12",
+    "66ab79d4b29ee6e69509e56", "958148682d748a38dd68baa", "b8ce020cf069c32a723ab14", "f4331d6d461607e95752746",
+    "6da23ba424b9596133cf9c8", "a636bcbc7b30c5fbeae67fe", "5cb0d86a07df654a9089a20", "f11f106848780fc9ecdd80a",
+    "1fbb5364fb8d2c9d730d5ba", "fcb86bc70a50c9d02a5d034", "a534433029eac15f322e34c", "c989d9c7c3d3b8c55d75130",
+    "7bb38b2f0186d46643ae962", "2644ebadeb44b9467d1f42c", "608cc857594bfbb55d69600",
+};
+
+// the codeword bits in each parity check; -1 fills out the ones with 6
+static const int16_t ft8_checks[FT8_CHECKS][7] = {
+    {   0,   3,  51,  56,  85, 135, 151 },
+    {   0,  25,  44,  79, 127, 146,  -1 },
+    {   0,  32,  71, 105, 106, 156,  -1 },
+    {   1,  26,  40,  60,  61, 114, 132 },
+    {   1,  47,  73, 112, 127, 159,  -1 },
+    {   1,  53,  85, 100, 134, 163,  -1 },
+    {   2,  12,  47,  77,  94, 122,  -1 },
+    {   2,  23,  29,  71, 103, 138,  -1 },
+    {   2,  43,  79, 123, 126, 168,  -1 },
+    {   3,  28,  67, 119, 133, 172,  -1 },
+    {   3,  30,  58,  90,  91,  95, 152 },
+    {   4,  31,  59,  92, 114, 145,  -1 },
+    {   4,  33,  64,  77,  97, 106, 153 },
+    {   4,  38,  74, 101, 135, 166,  -1 },
+    {   5,  23,  60,  93, 121, 150,  -1 },
+    {   5,  31,  63,  96, 125, 137,  -1 },
+    {   5,  32,  84, 107, 115, 155,  -1 },
+    {   6,  32,  61,  94,  95, 142,  -1 },
+    {   6,  48,  57,  89,  99, 104, 167 },
+    {   6,  49,  80,  98, 131, 172,  -1 },
+    {   7,  24,  62,  82,  92,  95, 147 },
+    {   7,  39,  69,  81, 103, 113, 144 },
+    {   7,  45,  70, 111, 118, 165,  -1 },
+    {   8,  34,  65,  98, 138, 145,  -1 },
+    {   8,  39,  89, 105, 133, 150,  -1 },
+    {   8,  53,  62, 130, 146, 154,  -1 },
+    {   9,  35,  66,  99, 106, 125,  -1 },
+    {   9,  43,  81,  90, 110, 143, 148 },
+    {   9,  52,  65,  83, 111, 127, 164 },
+    {  10,  36,  66,  86, 100, 138, 157 },
+    {  10,  43,  74, 109, 120, 165,  -1 },
+    {  10,  48,  87,  91, 141, 156,  -1 },
+    {  11,  37,  67, 101, 104, 154,  -1 },
+    {  11,  42,  65,  88,  96, 134, 158 },
+    {  11,  49,  60, 117, 118, 143,  -1 },
+    {  12,  38,  68, 102, 148, 161,  -1 },
+    {  12,  50,  63, 113, 117, 156,  -1 },
+    {  13,  29,  82, 112, 124, 169,  -1 },
+    {  13,  30,  78,  97, 131, 163,  -1 },
+    {  13,  40,  70,  87, 101, 122, 155 },
+    {  14,  41,  58, 105, 122, 158,  -1 },
+    {  14,  55,  86, 107, 118, 170,  -1 },
+    {  14,  57,  59,  73, 110, 149, 162 },
+    {  15,  38,  61, 111, 133, 157,  -1 },
+    {  15,  42,  72, 107, 140, 159,  -1 },
+    {  15,  46,  75, 129, 136, 153,  -1 },
+    {  16,  26,  88, 102, 115, 152,  -1 },
+    {  16,  36,  73,  80, 108, 130, 153 },
+    {  16,  41,  74, 128, 169, 171,  -1 },
+    {  17,  35,  75,  88, 112, 113, 142 },
+    {  17,  41,  78, 143, 145, 151,  -1 },
+    {  17,  48,  54, 123, 140, 166,  -1 },
+    {  18,  34,  58,  72, 109, 124, 160 },
+    {  18,  37,  76, 103, 115, 162,  -1 },
+    {  18,  45,  80, 116, 134, 166,  -1 },
+    {  19,  35,  62,  93, 135, 160,  -1 },
+    {  19,  45,  64,  79, 119, 139, 169 },
+    {  19,  46,  69,  91, 137, 164,  -1 },
+    {  20,  36,  72, 137, 151, 168,  -1 },
+    {  20,  44,  77,  82, 116, 120, 150 },
+    {  20,  53,  76,  99, 139, 170,  -1 },
+    {  21,  46,  57, 117, 126, 163,  -1 },
+    {  21,  52,  67, 108, 120, 173,  -1 },
+    {  21,  56,  84,  92, 139, 158,  -1 },
+    {  22,  33,  70,  93, 126, 152,  -1 },
+    {  22,  42,  78, 119, 130, 144,  -1 },
+    {  22,  54,  66,  94, 171, 173,  -1 },
+    {  23,  51,  75, 128, 147, 148,  -1 },
+    {  24,  37,  64,  98, 121, 159,  -1 },
+    {  24,  52,  68,  89, 100, 129, 155 },
+    {  25,  40,  76, 108, 140, 147,  -1 },
+    {  25,  50,  55,  90, 121, 136, 167 },
+    {  26,  39,  55, 123, 124, 125,  -1 },
+    {  27,  28,  83,  87, 116, 142, 149 },
+    {  27,  31,  71, 102, 131, 165,  -1 },
+    {  27,  47,  69,  84, 104, 128, 157 },
+    {  28,  33,  86,  96, 146, 161,  -1 },
+    {  29,  49,  59,  85, 136, 141, 161 },
+    {  30,  68, 132, 149, 154, 168,  -1 },
+    {  34,  81, 132, 141, 170, 173,  -1 },
+    {  44,  54,  63, 110, 129, 160, 172 },
+    {  50,  56,  97, 162, 164, 171,  -1 },
+    {  51,  83, 109, 114, 144, 167,  -1 },
+};
+
+// FT4 sends the payload XORed with this so a run of zeros is not a run of
+// one tone
+static const uint8_t ft4_scramble[10] = { 0x4a, 0x5e, 0x89, 0xb4, 0xb0, 0x8a, 0x79, 0x55, 0xbe, 0x28 };
+
+struct ft8_mode_info {
+    size_t symbols;
+    size_t tones;
+    size_t bits;
+    double symbol_seconds;
+    double slot_seconds;
+    // the decode rate is rate_up / rate_down which makes a symbol a power
+    // of 2 samples long
+    unsigned int rate_up;
+    unsigned int rate_down;
+    size_t sync_length;
+    size_t sync_blocks;
+    size_t sync_at[4];
+    uint8_t costas[4][7];
+    uint8_t gray[8];
+    float bt;
+};
+
+static const ft8_mode_info ft8_info = {
+    79, 8, 3, 0.16, 15, 12800, 1,
+    7, 3, { 0, 36, 72, 0 },
+    { { 3, 1, 4, 0, 6, 5, 2 }, { 3, 1, 4, 0, 6, 5, 2 }, { 3, 1, 4, 0, 6, 5, 2 }, { } },
+    { 0, 1, 3, 2, 5, 6, 4, 7 }, 2.0f,
+};
+
+static const ft8_mode_info ft4_info = {
+    103, 4, 2, 0.048, 7.5, 32000, 3,
+    4, 4, { 0, 33, 66, 99 },
+    { { 0, 1, 3, 2 }, { 1, 0, 2, 3 }, { 2, 3, 1, 0 }, { 3, 2, 0, 1 } },
+    { 0, 1, 3, 2 }, 1.0f,
+};
+
+static const ft8_mode_info& mode_info(const ft8_mode& mode_in) {
+    return mode_in == ft8_mode::ft4 ? ft4_info : ft8_info;
+}
+
+static bool is_sync(const ft8_mode_info& info_in, const size_t& symbol_in) {
+    for(size_t i = 0; i < info_in.sync_blocks; i++) {
+        if (symbol_in >= info_in.sync_at[i] && symbol_in < info_in.sync_at[i] + info_in.sync_length) return true;
+    }
+
+    return false;
+}
+
+const char* ft8_mode_name(const ft8_mode& mode_in) {
+    return mode_in == ft8_mode::ft4 ? "FT4" : "FT8";
+}
+
+double ft8_slot_seconds(const ft8_mode& mode_in) {
+    return mode_info(mode_in).slot_seconds;
+}
+
+// bits are counted from the top of byte 0
+static uint64_t get_bits(const uint8_t* bytes_in, const size_t& at_in, const size_t& count_in) {
+    uint64_t result = 0;
+
+    for(size_t i = at_in; i < at_in + count_in; i++) {
+        result = (result << 1) | ((bytes_in[i / 8] >> (7 - i % 8)) & 1);
+    }
+
+    return result;
+}
+
+static void put_bits(uint8_t* bytes_inout, const size_t& at_in, const size_t& count_in, const uint64_t& value_in) {
+    for(size_t i = 0; i < count_in; i++) {
+        auto bit = at_in + i;
+        auto mask = 0x80 >> (bit % 8);
+
+        if ((value_in >> (count_in - 1 - i)) & 1) {
+            bytes_inout[bit / 8] |= mask;
+        } else {
+            bytes_inout[bit / 8] &= ~mask;
+        }
+    }
+}
+
+// over the 77 payload bits and 5 zero bits like WSJT-X
+static uint16_t ft8_crc(const uint8_t* bits_in) {
+    uint16_t remainder = 0;
+
+    for(size_t i = 0; i < FT8_PAYLOAD_BITS + 5; i++) {
+        auto bit = i < FT8_PAYLOAD_BITS ? bits_in[i] : 0;
+        auto feedback = ((remainder >> (FT8_CRC_BITS - 1)) & 1) ^ bit;
+        remainder = (remainder << 1) & ((1 << FT8_CRC_BITS) - 1);
+        if (feedback) remainder ^= FT8_CRC_POLY;
+    }
+
+    return remainder;
+}
+
+using generator_type = std::array<std::array<uint8_t, 12>, FT8_CHECKS>;
+
+static const generator_type& ft8_generator() {
+    static const generator_type generator = [] {
+        generator_type result{};
+
+        for(size_t row = 0; row < FT8_CHECKS; row++) {
+            for(size_t i = 0; i < 23; i++) {
+                auto digit = ft8_generator_hex[row][i];
+                uint8_t nibble = std::isdigit(digit) ? digit - '0' : digit - 'a' + 10;
+                result[row][i / 2] |= i % 2 ? nibble : nibble << 4;
+            }
+        }
+
+        return result;
+    }();
+
+    return generator;
+}
+
+// for each codeword bit the 3 checks it is in and where it is in each and
+// for each place in a check which of its bit's checks it is
+struct ft8_bit_checks {
+    uint8_t check[FT8_CODE_BITS][3];
+    uint8_t slot[FT8_CODE_BITS][3];
+    uint8_t which[FT8_CHECKS][7];
+    uint8_t size[FT8_CHECKS];
+};
+
+static const ft8_bit_checks& bit_checks() {
+    static const ft8_bit_checks table = [] {
+        ft8_bit_checks result{};
+        uint8_t used[FT8_CODE_BITS] = { };
+
+        for(size_t check = 0; check < FT8_CHECKS; check++) {
+            for(size_t slot = 0; slot < 7 && ft8_checks[check][slot] >= 0; slot++) {
+                auto bit = ft8_checks[check][slot];
+                result.check[bit][used[bit]] = check;
+                result.slot[bit][used[bit]] = slot;
+                result.which[check][slot] = used[bit];
+                used[bit]++;
+                result.size[check] = slot + 1;
+            }
+        }
+
+        return result;
+    }();
+
+    return table;
+}
+
+// the payload after any scrambling with its CRC and parity as one bit a byte
+static void encode_codeword(const ft8_payload& payload_in, uint8_t* bits_out) {
+    uint8_t message[12] = { };
+    std::memcpy(message, payload_in.data(), payload_in.size());
+    message[9] &= 0xf8;
+
+    for(size_t i = 0; i < FT8_PAYLOAD_BITS; i++) bits_out[i] = get_bits(message, i, 1);
+    put_bits(message, FT8_PAYLOAD_BITS, FT8_CRC_BITS, ft8_crc(bits_out));
+    for(size_t i = FT8_PAYLOAD_BITS; i < FT8_DATA_BITS; i++) bits_out[i] = get_bits(message, i, 1);
+
+    auto& generator = ft8_generator();
+    for(size_t row = 0; row < FT8_CHECKS; row++) {
+        uint8_t parity = 0;
+        for(size_t i = 0; i < 12; i++) parity ^= message[i] & generator[row][i];
+        bits_out[FT8_DATA_BITS + row] = __builtin_parity(parity);
+    }
+}
+
+std::vector<uint8_t> ft8_tones(const ft8_mode& mode_in, const ft8_payload& payload_in) {
+    auto& info = mode_info(mode_in);
+    auto payload = payload_in;
+    uint8_t bits[FT8_CODE_BITS];
+
+    if (mode_in == ft8_mode::ft4) {
+        for(size_t i = 0; i < payload.size(); i++) payload[i] ^= ft4_scramble[i];
+    }
+
+    encode_codeword(payload, bits);
+
+    std::vector<uint8_t> result;
+    size_t next = 0;
+
+    for(size_t symbol = 0; symbol < info.symbols; symbol++) {
+        if (is_sync(info, symbol)) {
+            size_t block = 0;
+            while(symbol >= info.sync_at[block] + info.sync_length) block++;
+            result.push_back(info.costas[block][symbol - info.sync_at[block]]);
+            continue;
+        }
+
+        size_t value = 0;
+        for(size_t i = 0; i < info.bits; i++) value = (value << 1) | bits[next++];
+        result.push_back(info.gray[value]);
+    }
+
+    return result;
+}
+
+size_t ft8_transmit_samples(const ft8_mode& mode_in, const unsigned int& rate_in) {
+    auto& info = mode_info(mode_in);
+    auto per_symbol = rate_in * info.symbol_seconds;
+
+    if (std::fabs(per_symbol - std::round(per_symbol)) > 1e-6) {
+        system_fault(ft8_mode_name(mode_in), " symbols are not a whole number of samples at ", rate_in, " Hz");
+    }
+
+    return info.symbols * (size_t)std::round(per_symbol);
+}
+
+// The frequency moves from tone to tone through a Gaussian shaped pulse so
+// the signal stays narrow. There is a made up symbol before and after that
+// holds the first and last tones and the ends are ramped over an eighth of
+// a symbol.
+void ft8_synthesize(const ft8_mode& mode_in, const std::vector<uint8_t>& tones_in, const float& hertz_in,
+                    const unsigned int& rate_in, const float& amplitude_in, float* out_inout) {
+    auto& info = mode_info(mode_in);
+    auto samples = ft8_transmit_samples(mode_in, rate_in);
+    size_t per_symbol = samples / info.symbols;
+    auto count = tones_in.size();
+
+    if (count != info.symbols) system_fault(ft8_mode_name(mode_in), " needs ", info.symbols, " tones and not ", count);
+
+    std::vector<double> pulse(3 * per_symbol);
+    auto k = M_PI * std::sqrt(2 / std::log(2.0));
+    for(size_t i = 0; i < pulse.size(); i++) {
+        double t = (double)i / per_symbol - 1.5;
+        pulse[i] = (std::erf(k * info.bt * (t + 0.5)) - std::erf(k * info.bt * (t - 0.5))) / 2;
+    }
+
+    auto shift = 2 * M_PI / per_symbol;
+    std::vector<double> step((count + 2) * per_symbol, 2 * M_PI * hertz_in / rate_in);
+
+    for(size_t symbol = 0; symbol < count; symbol++) {
+        for(size_t i = 0; i < pulse.size(); i++) step[symbol * per_symbol + i] += shift * pulse[i] * tones_in[symbol];
+    }
+
+    for(size_t i = 0; i < 2 * per_symbol; i++) {
+        step[i] += shift * pulse[i + per_symbol] * tones_in.front();
+        step[count * per_symbol + i] += shift * pulse[i] * tones_in.back();
+    }
+
+    auto ramp = per_symbol / 8;
+    double phase = 0;
+
+    for(size_t i = 0; i < samples; i++) {
+        double envelope = 1;
+        auto from_end = samples - 1 - i;
+        if (i < ramp) envelope = (1 - std::cos(M_PI * i / ramp)) / 2;
+        if (from_end < ramp) envelope = (1 - std::cos(M_PI * from_end / ramp)) / 2;
+
+        out_inout[i] += amplitude_in * envelope * std::sin(phase);
+        phase = std::fmod(phase + step[i + per_symbol], 2 * M_PI);
+    }
+}
+
+// the alphabets of the message fields
+static const char ft8_alnum_space[] = " 0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+static const char ft8_alnum[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+static const char ft8_letters_space[] = " ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+static const char ft8_text[] = " 0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ+-./?";
+static const char ft8_hash_chars[] = " 0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ/";
+
+// special values of a 28 bit callsign field
+#define FT8_TOKENS 2063592UL
+#define FT8_MAX22 4194304UL
+#define FT8_CQ_NUMBERS 3UL
+#define FT8_CQ_LETTERS 1003UL
+#define FT8_MAX_GRID4 32400UL
+
+static int char_index(const char* alphabet_in, const char& char_in) {
+    auto found = std::strchr(alphabet_in, char_in);
+    if (char_in == 0 || found == nullptr) return -1;
+    return found - alphabet_in;
+}
+
+static std::vector<std::string> split_words(const std::string& text_in) {
+    std::vector<std::string> result;
+    std::istringstream stream(text_in);
+    std::string word;
+
+    while(stream >> word) result.push_back(word);
+    return result;
+}
+
+static std::string trim(const std::string& text_in) {
+    auto first = text_in.find_first_not_of(' ');
+    if (first == std::string::npos) return std::string();
+    return text_in.substr(first, text_in.find_last_not_of(' ') - first + 1);
+}
+
+static uint32_t hash_call(const std::string& call_in, const unsigned int& bits_in) {
+    uint64_t value = 0;
+
+    for(size_t i = 0; i < 11; i++) {
+        auto index = i < call_in.size() ? char_index(ft8_hash_chars, call_in[i]) : 0;
+        value = value * 38 + std::max(index, 0);
+    }
+
+    return (value * FT8_HASH_MULTIPLIER) >> (64 - bits_in);
+}
+
+// -1 if the call is not a standard one; a standard call has a digit as
+// its second or third character with at most 3 letters after it
+static int64_t pack_call(const std::string& call_in) {
+    std::string padded = call_in;
+    if (padded.size() >= 2 && std::isdigit(padded[1]) && (padded.size() < 3 || ! std::isdigit(padded[2]))) padded = " " + padded;
+    if (padded.size() < 3 || padded.size() > 6 || ! std::isdigit(padded[2])) return -1;
+    padded.resize(6, ' ');
+
+    auto i1 = char_index(ft8_alnum_space, padded[0]);
+    auto i2 = char_index(ft8_alnum, padded[1]);
+    auto i3 = char_index(ft8_alnum, padded[2]);
+    auto i4 = char_index(ft8_letters_space, padded[3]);
+    auto i5 = char_index(ft8_letters_space, padded[4]);
+    auto i6 = char_index(ft8_letters_space, padded[5]);
+    if (std::min({ i1, i2, i3, i4, i5, i6 }) < 0) return -1;
+
+    // the letters after the digit can not have a space in the middle
+    auto suffix = trim(padded.substr(3));
+    if (suffix.find(' ') != std::string::npos || padded.substr(3, suffix.size()) != suffix) return -1;
+
+    int64_t result = ((((int64_t)i1 * 36 + i2) * 10 + i3) * 27 + i4) * 27 * 27 + i5 * 27 + i6;
+    return FT8_TOKENS + FT8_MAX22 + result;
+}
+
+// the first word of a message: DE, QRZ, CQ, CQ with a number or letters or
+// a standard call
+static int64_t pack_token(const std::string& word_in) {
+    if (word_in == "DE") return 0;
+    if (word_in == "QRZ") return 1;
+    if (word_in == "CQ") return 2;
+
+    if (word_in.compare(0, 3, "CQ ") == 0) {
+        auto what = word_in.substr(3);
+
+        if (what.size() == 3 && std::all_of(what.begin(), what.end(), ::isdigit)) return FT8_CQ_NUMBERS + std::stoi(what);
+
+        if (what.size() >= 1 && what.size() <= 4 && std::all_of(what.begin(), what.end(), ::isupper)) {
+            int64_t value = 0;
+            what.insert(0, 4 - what.size(), ' ');
+            for(auto i : what) value = value * 27 + char_index(ft8_letters_space, i);
+            return FT8_CQ_LETTERS + value;
+        }
+
+        return -1;
+    }
+
+    return pack_call(word_in);
+}
+
+static bool is_grid(const std::string& word_in) {
+    return word_in.size() == 4 && word_in[0] >= 'A' && word_in[0] <= 'R' && word_in[1] >= 'A' && word_in[1] <= 'R'
+           && std::isdigit(word_in[2]) && std::isdigit(word_in[3]) && word_in != "RR73";
+}
+
+// 15 bits of grid, report, RRR, RR73, 73 or nothing; -1 if it is not one
+static int64_t pack_extra(const std::string& word_in) {
+    if (word_in.empty()) return FT8_MAX_GRID4 + 1;
+    if (word_in == "RRR") return FT8_MAX_GRID4 + 2;
+    if (word_in == "RR73") return FT8_MAX_GRID4 + 3;
+    if (word_in == "73") return FT8_MAX_GRID4 + 4;
+
+    if (is_grid(word_in)) {
+        return ((word_in[0] - 'A') * 18 + (word_in[1] - 'A')) * 100 + (word_in[2] - '0') * 10 + (word_in[3] - '0');
+    }
+
+    if (word_in.size() == 3 && (word_in[0] == '+' || word_in[0] == '-') && std::isdigit(word_in[1]) && std::isdigit(word_in[2])) {
+        auto db = std::stoi(word_in);
+        if (db >= -30 && db <= 32) return FT8_MAX_GRID4 + 35 + db;
+    }
+
+    return -1;
+}
+
+static bool pack_standard(const std::vector<std::string>& words_in, ft8_payload& payload_out) {
+    auto words = words_in;
+
+    // CQ DX K1ABC FN42 and CQ 123 K1ABC FN42 travel in the first field
+    if (words.size() >= 3 && words[0] == "CQ" && pack_token("CQ " + words[1]) >= 0 && pack_extra(words[2]) < 0) {
+        words[1] = "CQ " + words[1];
+        words.erase(words.begin());
+    }
+
+    if (words.size() < 2 || words.size() > 4) return false;
+
+    bool acknowledge = false;
+    std::string extra;
+
+    if (words.size() == 4) {
+        if (words[2] != "R" || ! is_grid(words[3])) return false;
+        acknowledge = true;
+        extra = words[3];
+    } else if (words.size() == 3) {
+        extra = words[2];
+        if (extra.size() == 4 && extra[0] == 'R' && (extra[1] == '+' || extra[1] == '-')) {
+            acknowledge = true;
+            extra.erase(0, 1);
+        }
+    }
+
+    uint64_t i3 = 1;
+    bool suffix[2] = { false, false };
+    int64_t calls[2];
+
+    for(size_t i = 0; i < 2; i++) {
+        auto word = words[i];
+        auto slash = word.size() > 2 ? word.substr(word.size() - 2) : std::string();
+
+        if (slash == "/R" || slash == "/P") {
+            auto wanted = slash == "/R" ? 1 : 2;
+            if (suffix[0] && (int)i3 != wanted) return false;
+            i3 = wanted;
+            suffix[i] = true;
+            word.erase(word.size() - 2);
+        }
+
+        calls[i] = i == 0 ? pack_token(word) : pack_call(word);
+        if (calls[i] < 0) return false;
+    }
+
+    auto packed_extra = pack_extra(extra);
+    if (packed_extra < 0) return false;
+
+    payload_out.fill(0);
+    put_bits(payload_out.data(), 0, 28, calls[0]);
+    put_bits(payload_out.data(), 28, 1, suffix[0]);
+    put_bits(payload_out.data(), 29, 28, calls[1]);
+    put_bits(payload_out.data(), 57, 1, suffix[1]);
+    put_bits(payload_out.data(), 58, 1, acknowledge);
+    put_bits(payload_out.data(), 59, 15, packed_extra);
+    put_bits(payload_out.data(), 74, 3, i3);
+
+    return true;
+}
+
+// 13 characters as a 71 bit number in base 42
+static bool pack_text(const std::string& text_in, ft8_payload& payload_out) {
+    if (text_in.size() > 13) return false;
+
+    unsigned __int128 value = 0;
+    for(size_t i = 0; i < 13; i++) {
+        auto index = char_index(ft8_text, i < text_in.size() ? text_in[i] : ' ');
+        if (index < 0) return false;
+        value = value * 42 + index;
+    }
+
+    payload_out.fill(0);
+    put_bits(payload_out.data(), 0, 7, (uint64_t)(value >> 64));
+    put_bits(payload_out.data(), 7, 64, (uint64_t)value);
+    return true;
+}
+
+bool ft8_pack(const std::string& text_in, ft8_payload& payload_out) {
+    std::string upper;
+    for(auto i : text_in) upper += std::toupper(i);
+
+    auto words = split_words(upper);
+    if (words.empty()) return false;
+    if (pack_standard(words, payload_out)) return true;
+
+    std::string joined;
+    for(auto& i : words) joined += (joined.empty() ? "" : " ") + i;
+    return pack_text(joined, payload_out);
+}
+
+using lookup_type = std::function<std::string (const uint32_t& hash_in, const unsigned int& bits_in)>;
+
+static std::string unknown_hash(const uint32_t&, const unsigned int&) {
+    return "<...>";
+}
+
+// empty if the field holds something that is never sent
+static std::string unpack_call(const uint64_t& value_in, const lookup_type& lookup_in) {
+    if (value_in == 0) return "DE";
+    if (value_in == 1) return "QRZ";
+    if (value_in == 2) return "CQ";
+
+    if (value_in < FT8_CQ_LETTERS) {
+        char number[8];
+        std::snprintf(number, sizeof(number), "%03u", (unsigned int)(value_in - FT8_CQ_NUMBERS));
+        return std::string("CQ ") + number;
+    }
+
+    if (value_in < FT8_TOKENS) {
+        auto value = value_in - FT8_CQ_LETTERS;
+        if (value >= 27 * 27 * 27 * 27) return std::string();
+
+        std::string letters(4, ' ');
+        for(size_t i = 4; i-- > 0; value /= 27) letters[i] = ft8_letters_space[value % 27];
+        return "CQ " + trim(letters);
+    }
+
+    if (value_in < FT8_TOKENS + FT8_MAX22) return lookup_in(value_in - FT8_TOKENS, 22);
+
+    auto value = value_in - FT8_TOKENS - FT8_MAX22;
+    std::string call(6, ' ');
+    call[5] = ft8_letters_space[value % 27]; value /= 27;
+    call[4] = ft8_letters_space[value % 27]; value /= 27;
+    call[3] = ft8_letters_space[value % 27]; value /= 27;
+    call[2] = ft8_alnum[value % 10]; value /= 10;
+    call[1] = ft8_alnum[value % 36]; value /= 36;
+    if (value >= 37) return std::string();
+    call[0] = ft8_alnum_space[value];
+
+    call = trim(call);
+    if (call.find(' ') != std::string::npos) return std::string();
+    return call;
+}
+
+static std::string unpack_standard(const ft8_payload& payload_in, const uint64_t& i3_in, const lookup_type& lookup_in) {
+    auto bytes = payload_in.data();
+    auto suffix = i3_in == 1 ? "/R" : "/P";
+    auto first = unpack_call(get_bits(bytes, 0, 28), lookup_in);
+    auto second = unpack_call(get_bits(bytes, 29, 28), lookup_in);
+
+    // only the first field can hold a CQ and only calls get a suffix
+    if (first.empty() || second.empty() || get_bits(bytes, 29, 28) < FT8_TOKENS) return std::string();
+    if (get_bits(bytes, 28, 1)) {
+        if (get_bits(bytes, 0, 28) < FT8_TOKENS) return std::string();
+        first += suffix;
+    }
+    if (get_bits(bytes, 57, 1)) second += suffix;
+
+    auto acknowledge = get_bits(bytes, 58, 1) != 0;
+    auto extra = get_bits(bytes, 59, 15);
+    auto result = first + " " + second;
+
+    if (extra < FT8_MAX_GRID4) {
+        std::string grid(4, ' ');
+        grid[0] = 'A' + extra / 1800;
+        grid[1] = 'A' + extra / 100 % 18;
+        grid[2] = '0' + extra / 10 % 10;
+        grid[3] = '0' + extra % 10;
+        return result + (acknowledge ? " R " : " ") + grid;
+    }
+
+    switch(extra - FT8_MAX_GRID4) {
+        case 1: return acknowledge ? std::string() : result;
+        case 2: return result + " RRR";
+        case 3: return result + " RR73";
+        case 4: return result + " 73";
+    }
+
+    char report[8];
+    std::snprintf(report, sizeof(report), "%s%+03d", acknowledge ? "R" : "", (int)(extra - FT8_MAX_GRID4) - 35);
+    return result + " " + report;
+}
+
+// a call that is not standard in full with the other one hashed
+static std::string unpack_nonstandard(const ft8_payload& payload_in, const lookup_type& lookup_in) {
+    auto bytes = payload_in.data();
+    auto value = get_bits(bytes, 12, 58);
+    std::string call(11, ' ');
+
+    for(size_t i = 11; i-- > 0; value /= 38) call[i] = ft8_hash_chars[value % 38];
+    call = trim(call);
+    if (call.empty()) return std::string();
+
+    if (get_bits(bytes, 73, 1)) return "CQ " + call;
+
+    auto hashed = lookup_in(get_bits(bytes, 0, 12), 12);
+    auto result = get_bits(bytes, 70, 1) ? call + " " + hashed : hashed + " " + call;
+
+    switch(get_bits(bytes, 71, 2)) {
+        case 1: return result + " RRR";
+        case 2: return result + " RR73";
+        case 3: return result + " 73";
+    }
+
+    return result;
+}
+
+// message types that are not unpacked show as the type and the payload in hex
+static std::string unpack_raw(const ft8_payload& payload_in, const uint64_t& i3_in, const uint64_t& n3_in) {
+    std::ostringstream result;
+    result << "[" << i3_in << "." << n3_in << "] " << std::hex;
+    for(size_t i = 0; i < 10; i++) result << (payload_in[i] >> 4) << (payload_in[i] & 15);
+    return result.str();
+}
+
+static std::string unpack_payload(const ft8_payload& payload_in, const lookup_type& lookup_in) {
+    auto bytes = payload_in.data();
+    auto i3 = get_bits(bytes, 74, 3);
+    auto n3 = get_bits(bytes, 71, 3);
+
+    if (i3 == 1 || i3 == 2) return unpack_standard(payload_in, i3, lookup_in);
+    if (i3 == 4) return unpack_nonstandard(payload_in, lookup_in);
+    if (i3 != 0) return unpack_raw(payload_in, i3, 0);
+
+    if (n3 == 0) {
+        unsigned __int128 value = ((unsigned __int128)get_bits(bytes, 0, 7) << 64) | get_bits(bytes, 7, 64);
+        std::string text(13, ' ');
+        for(size_t i = 13; i-- > 0; value /= 42) text[i] = ft8_text[(size_t)(value % 42)];
+        return trim(text);
+    }
+
+    // telemetry is up to 18 hex digits
+    if (n3 == 5) {
+        std::ostringstream result;
+        result << std::hex << get_bits(bytes, 0, 7) << std::setfill('0');
+        for(size_t at = 7; at < 71; at += 16) result << std::setw(4) << get_bits(bytes, at, 16);
+        auto text = result.str();
+        auto first = text.find_first_not_of('0');
+        return first == std::string::npos ? "0" : text.substr(first);
+    }
+
+    return unpack_raw(payload_in, i3, n3);
+}
+
+std::string ft8_unpack(const ft8_payload& payload_in) {
+    return unpack_payload(payload_in, unknown_hash);
+}
+
+// Sum product belief propagation over the parity checks. The likelihoods
+// are log P(1) / P(0) for each codeword bit; true if every check passed
+// within the iterations.
+static bool ldpc_decode(const float* llr_in, const unsigned int& iterations_in, uint8_t* bits_out) {
+    auto& table = bit_checks();
+    float to_check[FT8_CHECKS][7];
+    float to_bit[FT8_CODE_BITS][3] = { };
+
+    for(unsigned int iteration = 0; ; iteration++) {
+        for(size_t bit = 0; bit < FT8_CODE_BITS; bit++) {
+            bits_out[bit] = llr_in[bit] + to_bit[bit][0] + to_bit[bit][1] + to_bit[bit][2] > 0;
+        }
+
+        size_t failed = 0;
+        for(size_t check = 0; check < FT8_CHECKS; check++) {
+            uint8_t parity = 0;
+            for(size_t slot = 0; slot < table.size[check]; slot++) parity ^= bits_out[ft8_checks[check][slot]];
+            failed += parity;
+        }
+
+        if (failed == 0) return true;
+        if (iteration == iterations_in) return false;
+
+        for(size_t bit = 0; bit < FT8_CODE_BITS; bit++) {
+            auto total = llr_in[bit] + to_bit[bit][0] + to_bit[bit][1] + to_bit[bit][2];
+            for(size_t i = 0; i < 3; i++) to_check[table.check[bit][i]][table.slot[bit][i]] = std::tanh(-(total - to_bit[bit][i]) / 2);
+        }
+
+        for(size_t check = 0; check < FT8_CHECKS; check++) {
+            for(size_t slot = 0; slot < table.size[check]; slot++) {
+                float product = 1;
+                for(size_t other = 0; other < table.size[check]; other++) if (other != slot) product *= to_check[check][other];
+
+                product = std::max(-0.9999999f, std::min(product, 0.9999999f));
+                to_bit[ft8_checks[check][slot]][table.which[check][slot]] = -2 * std::atanh(product);
+            }
+        }
+    }
+}
+
+// how far the Costas tones at a place in the spectrogram stand above the
+// bins next to them in frequency and in time on average
+static float sync_score(const ft8_mode_info& info_in, const float* spectrum_in, const int& steps_in, const size_t& bins_in,
+                        const int& step_in, const size_t& bin_in) {
+    float score = 0;
+    size_t count = 0, seen = 0;
+
+    for(size_t block = 0; block < info_in.sync_blocks; block++) {
+        for(size_t k = 0; k < info_in.sync_length; k++) {
+            int step = step_in + FT8_TIME_STEPS * (info_in.sync_at[block] + k);
+            if (step < 0 || step >= steps_in) continue;
+
+            auto row = spectrum_in + step * bins_in + bin_in;
+            size_t tone = info_in.costas[block][k];
+            auto level = row[FT8_FREQUENCY_BINS * tone];
+            seen++;
+
+            if (tone > 0) {
+                score += level - row[FT8_FREQUENCY_BINS * (tone - 1)];
+                count++;
+            }
+            if (tone + 1 < info_in.tones) {
+                score += level - row[FT8_FREQUENCY_BINS * (tone + 1)];
+                count++;
+            }
+            if (k > 0 && step >= FT8_TIME_STEPS) {
+                score += level - row[FT8_FREQUENCY_BINS * tone - FT8_TIME_STEPS * bins_in];
+                count++;
+            }
+            if (k + 1 < info_in.sync_length && step + FT8_TIME_STEPS < steps_in) {
+                score += level - row[FT8_FREQUENCY_BINS * tone + FT8_TIME_STEPS * bins_in];
+                count++;
+            }
+        }
+    }
+
+    // most of the signal is off the ends of the slot
+    if (seen * 2 < info_in.sync_length * info_in.sync_blocks) return std::numeric_limits<float>::lowest();
+    return score / count;
+}
+
+struct ft8_candidate {
+    float score = 0;
+    // spectrogram steps from the start of the slot to the first symbol
+    int step = 0;
+    // spectrogram bin of the lowest tone
+    size_t bin = 0;
+};
+
+struct ft8_slot {
+    std::vector<float> audio;
+    size_t filled = 0;
+    ft8_decoder::clock_type::time_point start;
+    std::chrono::steady_clock::time_point closed;
+    // a row of bins in dB for each step
+    std::vector<float> spectrum;
+    // what each search job found and then the best of them
+    std::vector<std::vector<ft8_candidate>> found;
+    std::vector<ft8_candidate> candidates;
+    std::mutex mutex;
+    std::vector<ft8_message> messages;
+    // jobs of the running stage that have not finished
+    std::atomic<size_t> pending{0};
+    // set while the slot is filling or decoding and cleared by finish
+    std::atomic<bool> busy{false};
+};
+
+static unsigned int ratio_gcd(const ft8_mode_info& info_in, const unsigned int& rate_in) {
+    return std::gcd(info_in.rate_up, info_in.rate_down * rate_in);
+}
+
+static ft8_decoder::clock_type::duration slot_period(const ft8_mode& mode_in) {
+    return std::chrono::duration_cast<ft8_decoder::clock_type::duration>(std::chrono::duration<double>(ft8_slot_seconds(mode_in)));
+}
+
+ft8_decoder::ft8_decoder(const ft8_config& config_in, std::shared_ptr<thread_queue> queue_in)
+: config(config_in), queue(queue_in),
+  symbol_samples(std::lround(mode_info(config_in.mode).symbol_seconds * mode_info(config_in.mode).rate_up / mode_info(config_in.mode).rate_down)),
+  decode_rate((double)mode_info(config_in.mode).rate_up / mode_info(config_in.mode).rate_down),
+  slot_samples(std::lround(ft8_slot_seconds(config_in.mode) * decode_rate)),
+  up(mode_info(config_in.mode).rate_up / ratio_gcd(mode_info(config_in.mode), config_in.rate)),
+  down(mode_info(config_in.mode).rate_down * config_in.rate / ratio_gcd(mode_info(config_in.mode), config_in.rate)),
+  fft(symbol_samples * FT8_FREQUENCY_BINS),
+  resampler(up, down, FT8_PASS_HZ / std::min<double>(config_in.rate, decode_rate)) {
+    auto& info = mode_info(config.mode);
+    auto spacing = 1 / info.symbol_seconds;
+
+    if (config.min_hertz <= 0 || config.max_hertz < config.min_hertz) system_fault(ft8_mode_name(config.mode), " decoder needs 0 < min_hertz <= max_hertz");
+    if (config.max_hertz + (info.tones - 1) * spacing > FT8_PASS_HZ) system_fault(ft8_mode_name(config.mode), " signals can not go past ", FT8_PASS_HZ, " Hz");
+    if (config.jobs == 0 || config.max_candidates == 0) system_fault(ft8_mode_name(config.mode), " decoder needs at least one job and candidate");
+
+    auto bin_hertz = spacing / FT8_FREQUENCY_BINS;
+    first_bin = std::floor(config.min_hertz / bin_hertz);
+    bins = std::ceil(config.max_hertz / bin_hertz) - first_bin + 1 + FT8_FREQUENCY_BINS * (info.tones - 1);
+    steps = (slot_samples - symbol_samples) / (symbol_samples / FT8_TIME_STEPS) + 1;
+
+    for(size_t i = 0; i < FT8_BUFFERS; i++) {
+        auto buffer = std::make_shared<ft8_slot>();
+        buffer->audio.resize(slot_samples);
+        buffer->spectrum.resize(steps * bins);
+        buffers.push_back(buffer);
+    }
+}
+
+ft8_decoder::stats_type ft8_decoder::get_stats() const {
+    stats_type result;
+    result.slots = slots.load();
+    result.dropped = dropped.load();
+    result.decoded = decoded_count.load();
+    return result;
+}
+
+// a buffer that is not busy; acquiring it pairs with the release in finish so
+// the last decode of it is done with before the buffer is written again
+std::shared_ptr<ft8_slot> ft8_decoder::take_buffer() {
+    for(auto& i : buffers) {
+        bool idle = false;
+        if (i->busy.compare_exchange_strong(idle, true, std::memory_order_acquire)) return i;
+    }
+
+    return nullptr;
+}
+
+void ft8_decoder::begin_slot(const clock_type::time_point& start_in) {
+    slot_start = start_in;
+    filling = take_buffer();
+
+    if (! filling) {
+        dropped++;
+        return;
+    }
+
+    std::fill(filling->audio.begin(), filling->audio.end(), 0.0f);
+    filling->filled = 0;
+    filling->start = start_in;
+}
+
+// a slot that was joined less than half way through is not worth decoding
+void ft8_decoder::close_slot() {
+    auto slot = std::move(filling);
+    filling.reset();
+
+    if (! slot) return;
+
+    if (slot->filled < slot_samples / 2) {
+        slot->busy.store(false, std::memory_order_release);
+        return;
+    }
+
+    dispatch(slot);
+}
+
+void ft8_decoder::process(const float* block_in, const size_t& samples_in) {
+    auto now = clock_type::now();
+    auto block_start = now - std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>((double)samples_in / config.rate));
+    auto expected = anchor + std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(since_anchor / decode_rate));
+    auto period = slot_period(config.mode);
+
+    if (! anchored || std::chrono::abs(block_start - expected) > std::chrono::milliseconds(FT8_MAX_DRIFT_MSEC)) {
+        if (anchored) log_info(ft8_mode_name(config.mode), " decoder audio and clock disagreed so the clock was taken");
+
+        anchored = true;
+        anchor = block_start;
+        since_anchor = 0;
+
+        auto start = clock_type::time_point(block_start.time_since_epoch() / period * period);
+        if (! filling || filling->start != start) {
+            close_slot();
+            begin_slot(start);
+        }
+
+        position = std::lround(std::chrono::duration<double>(block_start - start).count() * decode_rate);
+    }
+
+    if (resampled.size() < resampler.get_max_out(samples_in)) resampled.resize(resampler.get_max_out(samples_in));
+    auto count = resampler.process(block_in, samples_in, resampled.data());
+    since_anchor += count;
+
+    for(size_t i = 0; i < count; i++) {
+        if (position >= slot_samples) {
+            close_slot();
+            begin_slot(slot_start + period);
+            position -= slot_samples;
+        }
+
+        if (filling) {
+            filling->audio[position] = resampled[i];
+            filling->filled++;
+        }
+
+        position++;
+    }
+}
+
+bool ft8_decoder::decode_slot(const float* samples_in, const size_t& count_in, const clock_type::time_point& slot_in) {
+    auto slot = take_buffer();
+
+    if (! slot) {
+        dropped++;
+        return false;
+    }
+
+    dsp_resampler whole(up, down, FT8_PASS_HZ / std::min<double>(config.rate, decode_rate));
+    std::vector<float> audio(whole.get_max_out(count_in));
+    auto made = std::min(whole.process(samples_in, count_in, audio.data()), slot_samples);
+
+    std::fill(slot->audio.begin(), slot->audio.end(), 0.0f);
+    std::copy(audio.begin(), audio.begin() + made, slot->audio.begin());
+    slot->filled = made;
+    slot->start = slot_in;
+    dispatch(slot);
+
+    return true;
+}
+
+void ft8_decoder::run_stage(std::shared_ptr<ft8_slot> slot_in, const size_t& jobs_in, stage_type stage_in, next_type next_in) {
+    auto self = std::dynamic_pointer_cast<ft8_decoder>(shared_from_this());
+    slot_in->pending.store(jobs_in);
+
+    for(size_t job = 0; job < jobs_in; job++) {
+        queue->post([self, slot_in, job, stage_in, next_in] {
+            (self.get()->*stage_in)(*slot_in, job);
+            if (slot_in->pending.fetch_sub(1) == 1) (self.get()->*next_in)(slot_in);
+        });
+    }
+}
+
+void ft8_decoder::dispatch(std::shared_ptr<ft8_slot> slot_in) {
+    slots++;
+    slot_in->closed = std::chrono::steady_clock::now();
+    run_stage(slot_in, std::min(config.jobs, steps), &ft8_decoder::spectrogram, &ft8_decoder::start_search);
+}
+
+// the window is one symbol with nothing on it so tones a spacing apart
+// land in each other's nulls; the padding puts bins in between the tones
+void ft8_decoder::spectrogram(ft8_slot& slot_in, const size_t& job_in) {
+    auto jobs = std::min(config.jobs, steps);
+    auto size = fft.get_size();
+    auto& reversed = fft.get_reversed();
+    std::vector<float> re(size), im(size);
+
+    for(size_t step = job_in * steps / jobs; step < (job_in + 1) * steps / jobs; step++) {
+        auto samples = slot_in.audio.data() + step * (symbol_samples / FT8_TIME_STEPS);
+        auto row = slot_in.spectrum.data() + step * bins;
+
+        std::fill(re.begin(), re.end(), 0.0f);
+        std::fill(im.begin(), im.end(), 0.0f);
+        for(size_t i = 0; i < symbol_samples; i++) re[reversed[i]] = samples[i];
+        fft.forward_reversed(re.data(), im.data());
+
+        for(size_t bin = 0; bin < bins; bin++) {
+            auto k = first_bin + bin;
+            row[bin] = 10 * std::log10(re[k] * re[k] + im[k] * im[k] + 1e-12f);
+        }
+    }
+}
+
+void ft8_decoder::start_search(std::shared_ptr<ft8_slot> slot_in) {
+    auto starts = bins - FT8_FREQUENCY_BINS * (mode_info(config.mode).tones - 1);
+    slot_in->found.assign(config.jobs, std::vector<ft8_candidate>());
+    run_stage(slot_in, std::min(config.jobs, starts), &ft8_decoder::search, &ft8_decoder::start_decode);
+}
+
+// Each job scores every place a signal could start in its part of the band
+// and keeps the ones that score better than all of their neighbors so one
+// signal does not use up several candidates.
+void ft8_decoder::search(ft8_slot& slot_in, const size_t& job_in) {
+    auto& info = mode_info(config.mode);
+    auto starts = bins - FT8_FREQUENCY_BINS * (info.tones - 1);
+    auto jobs = std::min(config.jobs, starts);
+    size_t first = job_in * starts / jobs, last = (job_in + 1) * starts / jobs;
+    int extra = FT8_SEARCH_EXTRA_SYMBOLS * FT8_TIME_STEPS;
+    int first_step = -extra, last_step = (int)steps - FT8_TIME_STEPS * (int)info.symbols + extra;
+
+    // one bin more each side so the edges can be compared
+    auto low = first > 0 ? first - 1 : 0, high = std::min(last + 1, starts);
+    auto width = high - low;
+    auto rows = last_step - first_step + 1;
+    std::vector<float> scores(rows * width);
+
+    for(int row = 0; row < rows; row++) {
+        for(size_t bin = low; bin < high; bin++) {
+            scores[row * width + bin - low] = sync_score(info, slot_in.spectrum.data(), steps, bins, row + first_step, bin);
+        }
+    }
+
+    auto& found = slot_in.found[job_in];
+
+    for(int row = 0; row < rows; row++) {
+        for(size_t bin = first; bin < last; bin++) {
+            auto score = scores[row * width + bin - low];
+            if (score < config.min_sync) continue;
+
+            bool best = true;
+            for(int near_row = std::max(0, row - 1); near_row <= std::min(rows - 1, row + 1) && best; near_row++) {
+                for(auto near_bin = bin > low ? bin - 1 : bin; near_bin < std::min(high, bin + 2); near_bin++) {
+                    if (near_row == row && near_bin == bin) continue;
+                    auto near = scores[near_row * width + near_bin - low];
+                    // on a tie the first one in the scan wins
+                    bool earlier = near_row < row || (near_row == row && near_bin < bin);
+                    if (near > score || (earlier && ! (near < score))) best = false;
+                }
+            }
+
+            if (best) found.push_back(ft8_candidate{ score, row + first_step, bin });
+        }
+    }
+
+    auto by_score = [](const ft8_candidate& left_in, const ft8_candidate& right_in) { return left_in.score > right_in.score; };
+    if (found.size() > config.max_candidates) {
+        std::nth_element(found.begin(), found.begin() + config.max_candidates, found.end(), by_score);
+        found.resize(config.max_candidates);
+    }
+}
+
+void ft8_decoder::start_decode(std::shared_ptr<ft8_slot> slot_in) {
+    auto& candidates = slot_in->candidates;
+    candidates.clear();
+    for(auto& i : slot_in->found) candidates.insert(candidates.end(), i.begin(), i.end());
+
+    std::sort(candidates.begin(), candidates.end(), [](const ft8_candidate& left_in, const ft8_candidate& right_in) {
+        return left_in.score > right_in.score;
+    });
+    if (candidates.size() > config.max_candidates) candidates.resize(config.max_candidates);
+
+    slot_in->messages.clear();
+
+    if (candidates.empty()) {
+        finish(slot_in);
+        return;
+    }
+
+    run_stage(slot_in, std::min(config.jobs, candidates.size()), &ft8_decoder::decode, &ft8_decoder::finish);
+}
+
+// candidates are dealt out in turn so the strong ones are spread over the jobs
+void ft8_decoder::decode(ft8_slot& slot_in, const size_t& job_in) {
+    auto jobs = std::min(config.jobs, slot_in.candidates.size());
+    std::vector<ft8_message> found;
+
+    for(size_t i = job_in; i < slot_in.candidates.size(); i += jobs) {
+        ft8_message message;
+        if (decode_candidate(slot_in, slot_in.candidates[i], message)) found.push_back(message);
+    }
+
+    std::lock_guard<std::mutex> lock(slot_in.mutex);
+    slot_in.messages.insert(slot_in.messages.end(), found.begin(), found.end());
+}
+
+bool ft8_decoder::decode_candidate(const ft8_slot& slot_in, const ft8_candidate& candidate_in, ft8_message& message_out) const {
+    auto& info = mode_info(config.mode);
+    float llr[FT8_CODE_BITS];
+    float levels[8];
+    size_t next = 0;
+
+    // each bit is as likely as the loudest tone that sends it as a 1 is
+    // louder than the loudest that sends it as a 0
+    for(size_t symbol = 0; symbol < info.symbols; symbol++) {
+        if (is_sync(info, symbol)) continue;
+
+        int step = candidate_in.step + FT8_TIME_STEPS * symbol;
+        if (step < 0 || step >= (int)steps) {
+            for(size_t i = 0; i < info.bits; i++) llr[next++] = 0;
+            continue;
+        }
+
+        auto row = slot_in.spectrum.data() + step * bins + candidate_in.bin;
+        for(size_t value = 0; value < info.tones; value++) levels[value] = row[FT8_FREQUENCY_BINS * info.gray[value]];
+
+        for(size_t i = 0; i < info.bits; i++) {
+            size_t mask = 1 << (info.bits - 1 - i);
+            auto one = std::numeric_limits<float>::lowest(), zero = one;
+
+            for(size_t value = 0; value < info.tones; value++) {
+                auto& side = value & mask ? one : zero;
+                side = std::max(side, levels[value]);
+            }
+
+            llr[next++] = one - zero;
+        }
+    }
+
+    // scaled to one variance so belief propagation sees the same
+    // confidence from a strong signal and a weak one
+    double sum = 0, squares = 0;
+    for(auto i : llr) {
+        sum += i;
+        squares += i * i;
+    }
+
+    auto variance = squares / FT8_CODE_BITS - (sum / FT8_CODE_BITS) * (sum / FT8_CODE_BITS);
+    if (variance <= 0) return false;
+
+    auto scale = std::sqrt(FT8_LLR_VARIANCE / variance);
+    for(auto& i : llr) i *= scale;
+
+    uint8_t bits[FT8_CODE_BITS];
+    if (! ldpc_decode(llr, config.ldpc_iterations, bits)) return false;
+
+    uint16_t sent = 0;
+    for(size_t i = FT8_PAYLOAD_BITS; i < FT8_DATA_BITS; i++) sent = (sent << 1) | bits[i];
+    if (ft8_crc(bits) != sent) return false;
+
+    ft8_payload payload{};
+    for(size_t i = 0; i < FT8_PAYLOAD_BITS; i++) put_bits(payload.data(), i, 1, bits[i]);
+    // all zeros passes the CRC and is what noise tends toward
+    if (std::all_of(payload.begin(), payload.end(), [](const uint8_t& byte_in) { return byte_in == 0; })) return false;
+
+    if (config.mode == ft8_mode::ft4) {
+        for(size_t i = 0; i < payload.size(); i++) payload[i] ^= ft4_scramble[i];
+    }
+
+    auto spacing = 1 / info.symbol_seconds;
+    message_out.mode = config.mode;
+    message_out.slot = slot_in.start;
+    message_out.dt = candidate_in.step * info.symbol_seconds / FT8_TIME_STEPS - 0.5;
+    message_out.hertz = (first_bin + candidate_in.bin) * spacing / FT8_FREQUENCY_BINS;
+    message_out.payload = payload;
+
+    // the power in a bin is the tone plus the noise in one tone spacing; the
+    // noise is read off the same bins before and after the transmission since
+    // a level from the whole band rises with every signal in it and the other
+    // tones pick up the signal whenever the steps straddle two symbols
+    auto tones = ft8_tones(config.mode, payload);
+    double signal = 0;
+    double others = 0;
+    size_t count = 0;
+
+    for(size_t symbol = 0; symbol < info.symbols; symbol++) {
+        int step = candidate_in.step + FT8_TIME_STEPS * symbol;
+        if (step < 0 || step >= (int)steps) continue;
+
+        auto row = &slot_in.spectrum[step * bins + candidate_in.bin];
+        for(size_t tone = 0; tone < info.tones; tone++) {
+            auto power = std::pow(10.0, row[FT8_FREQUENCY_BINS * tone] / 10);
+            if (tone == tones[symbol]) signal += power;
+            else others += power;
+        }
+        count++;
+    }
+
+    double noise = 0;
+    size_t heard = 0;
+    int first = candidate_in.step - FT8_TIME_STEPS;
+    int last = candidate_in.step + FT8_TIME_STEPS * info.symbols;
+    auto filled_steps = slot_in.filled < symbol_samples ? 0 : (slot_in.filled - symbol_samples) / (symbol_samples / FT8_TIME_STEPS) + 1;
+
+    for(size_t step = 0; step < std::min(steps, filled_steps); step++) {
+        if ((int)step > first && (int)step < last) continue;
+
+        auto row = &slot_in.spectrum[step * bins + candidate_in.bin];
+        for(size_t tone = 0; tone < info.tones; tone++) noise += std::pow(10.0, row[FT8_FREQUENCY_BINS * tone] / 10);
+        heard += info.tones;
+    }
+
+    // a slot cut short can leave nothing outside so the other tones have to do
+    if (heard == 0) {
+        noise = others;
+        heard = count * (info.tones - 1);
+    }
+
+    message_out.snr = 10 * std::log10(std::max(signal / count / (noise / heard) - 1, 1e-3)) + 10 * std::log10(spacing / 2500);
+
+    return true;
+}
+
+void ft8_decoder::learn(const ft8_payload& payload_in) {
+    auto bytes = payload_in.data();
+    auto i3 = get_bits(bytes, 74, 3);
+    std::vector<std::string> calls;
+
+    if (i3 == 1 || i3 == 2) {
+        for(size_t at : { 0, 29 }) {
+            auto value = get_bits(bytes, at, 28);
+            if (value >= FT8_TOKENS + FT8_MAX22) calls.push_back(unpack_call(value, unknown_hash));
+        }
+    } else if (i3 == 4) {
+        auto text = unpack_nonstandard(payload_in, unknown_hash);
+        for(auto& i : split_words(text)) if (i != "CQ" && i.front() != '<' && i != "RRR" && i != "RR73" && i != "73") calls.push_back(i);
+    }
+
+    std::lock_guard<std::mutex> lock(hashes_mutex);
+
+    for(auto& call : calls) {
+        if (call.empty()) continue;
+
+        auto hash = hash_call(call, 22);
+        auto known = std::find_if(hashes.begin(), hashes.end(), [&](const std::pair<uint32_t, std::string>& entry_in) { return entry_in.first == hash; });
+        if (known != hashes.end()) continue;
+
+        if (hashes.size() >= FT8_MAX_HASHES) hashes.erase(hashes.begin());
+        hashes.emplace_back(hash, call);
+    }
+}
+
+// the 12 and 10 bit hashes are the top of the 22 bit one
+std::string ft8_decoder::unpack(const ft8_payload& payload_in) {
+    return unpack_payload(payload_in, [this](const uint32_t& hash_in, const unsigned int& bits_in) {
+        std::lock_guard<std::mutex> lock(hashes_mutex);
+
+        for(auto& i : hashes) {
+            if (i.first >> (22 - bits_in) == hash_in) return "<" + i.second + ">";
+        }
+
+        return std::string("<...>");
+    });
+}
+
+// Several candidates can land on one signal so only the loudest copy of a
+// payload is kept. Calls heard in this slot are learned before anything is
+// unpacked so a hash can be shown in the slot its call was first heard in.
+void ft8_decoder::finish(std::shared_ptr<ft8_slot> slot_in) {
+    auto& messages = slot_in->messages;
+
+    std::sort(messages.begin(), messages.end(), [](const ft8_message& left_in, const ft8_message& right_in) {
+        if (left_in.payload != right_in.payload) return left_in.payload < right_in.payload;
+        return left_in.snr > right_in.snr;
+    });
+    messages.erase(std::unique(messages.begin(), messages.end(), [](const ft8_message& left_in, const ft8_message& right_in) {
+        return left_in.payload == right_in.payload;
+    }), messages.end());
+    std::sort(messages.begin(), messages.end(), [](const ft8_message& left_in, const ft8_message& right_in) {
+        return left_in.hertz < right_in.hertz;
+    });
+
+    for(auto& i : messages) learn(i.payload);
+
+    ft8_slot_stats stats;
+    stats.mode = config.mode;
+    stats.slot = slot_in->start;
+    stats.candidates = slot_in->candidates.size();
+
+    for(auto& i : messages) {
+        i.text = unpack(i.payload);
+        // a message that can never be sent got past the CRC by chance
+        if (i.text.empty()) continue;
+
+        stats.decoded++;
+        decoded.deliver(i);
+    }
+
+    decoded_count += stats.decoded;
+    stats.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - slot_in->closed);
+    // nothing in the slot is touched after this so it can be filled again
+    slot_in->busy.store(false, std::memory_order_release);
+    finished.deliver(stats);
+}
+
+}
@@ -0,0 +1,200 @@
+/*
+ * ft8.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "dsp.h"
+#include "object.h"
+#include "thread.h"
+
+namespace oemros {
+
+enum class ft8_mode : uint8_t {
+    ft8,
+    ft4,
+};
+
+// the 77 bits of a message with the first bit in the top of byte 0
+using ft8_payload = std::array<uint8_t, 10>;
+
+struct ft8_message {
+    ft8_mode mode = ft8_mode::ft8;
+    // when the slot it was sent in started
+    std::chrono::system_clock::time_point slot;
+    // seconds from half a second into the slot where a signal should start
+    float dt = 0;
+    // audio frequency of the lowest tone
+    float hertz = 0;
+    // in dB over the noise in 2500 Hz like WSJT-X
+    float snr = 0;
+    ft8_payload payload{};
+    std::string text;
+};
+
+struct ft8_slot_stats {
+    ft8_mode mode = ft8_mode::ft8;
+    std::chrono::system_clock::time_point slot;
+    size_t candidates = 0;
+    size_t decoded = 0;
+    // from the slot closing to the last message being published
+    std::chrono::microseconds elapsed{0};
+};
+
+const char* ft8_mode_name(const ft8_mode& mode_in);
+// 15 for FT8 and 7.5 for FT4
+double ft8_slot_seconds(const ft8_mode& mode_in);
+
+// Standard messages like CQ K1ABC FN42 or K1ABC W9XYZ R-07 and free text of
+// up to 13 characters can be packed; false if the text is neither.
+bool ft8_pack(const std::string& text_in, ft8_payload& payload_out);
+// hashed callsigns that are not known come out as <...>
+std::string ft8_unpack(const ft8_payload& payload_in);
+
+// the tone for each symbol with the sync symbols in place; 79 for FT8 and
+// 103 for FT4
+std::vector<uint8_t> ft8_tones(const ft8_mode& mode_in, const ft8_payload& payload_in);
+// samples the tones take at rate_in which has to hold a whole number of
+// samples a symbol
+size_t ft8_transmit_samples(const ft8_mode& mode_in, const unsigned int& rate_in);
+// adds the GFSK signal for the tones with the lowest tone at hertz_in into
+// out_inout which has to hold ft8_transmit_samples()
+void ft8_synthesize(const ft8_mode& mode_in, const std::vector<uint8_t>& tones_in, const float& hertz_in,
+                    const unsigned int& rate_in, const float& amplitude_in, float* out_inout);
+
+struct ft8_config {
+    ft8_mode mode = ft8_mode::ft8;
+    // of the audio given to the decoder
+    unsigned int rate = 48000;
+    // where the lowest tone of a signal can be
+    float min_hertz = 200;
+    float max_hertz = 3000;
+    // the best scoring sync positions that get an LDPC decode
+    size_t max_candidates = 200;
+    // average dB the sync tones have to stand over their neighbors
+    float min_sync = 2.0f;
+    unsigned int ldpc_iterations = 30;
+    // how many pieces each stage of a slot is split into for the workers
+    size_t jobs = 8;
+};
+
+struct ft8_slot;
+struct ft8_candidate;
+
+// Decodes every FT8 or FT4 signal in a slot once the slot closes.
+//
+// Audio comes in a block at a time and is resampled to a rate that makes a
+// symbol a power of 2 samples long so the FFTs can be radix 2. The slot is
+// then worked on by the thread queue in stages with each stage split into
+// jobs: a spectrogram at a quarter symbol and half a tone spacing, a search
+// of the Costas sync tones over time and frequency and belief propagation
+// on the LDPC code for each candidate the search found. The last job of a
+// stage starts the next so no worker waits on another. Messages that pass
+// the CRC go to the subscribers of decoded on a worker thread and
+// finished follows once the slot is done.
+//
+// process() takes audio as it is captured and uses the system clock to
+// find the slot boundaries so the clock has to be kept in time. It only
+// takes a lock and allocates once per slot when it hands a slot to the
+// workers. The decoder has to be made with std::make_shared.
+class ft8_decoder : public baseobj {
+    public:
+        using clock_type = std::chrono::system_clock;
+
+        struct stats_type {
+            uint64_t slots = 0;
+            // closed while every buffer was still being decoded
+            uint64_t dropped = 0;
+            uint64_t decoded = 0;
+        };
+
+    private:
+        const ft8_config config;
+        std::shared_ptr<thread_queue> queue;
+        const size_t symbol_samples;
+        const double decode_rate;
+        const size_t slot_samples;
+        // the resampler to the decode rate goes up by one and down by the other
+        unsigned int up = 1, down = 1;
+        // spectrogram bins kept and the FFT bin the first one is
+        size_t first_bin = 0;
+        size_t bins = 0;
+        size_t steps = 0;
+        dsp_fft fft;
+        dsp_resampler resampler;
+        std::vector<float> resampled;
+        // slots are reused once the workers let go of them
+        std::vector<std::shared_ptr<ft8_slot>> buffers;
+        std::shared_ptr<ft8_slot> filling;
+        size_t position = 0;
+        clock_type::time_point slot_start;
+        clock_type::time_point anchor;
+        uint64_t since_anchor = 0;
+        bool anchored = false;
+        // callsigns heard in full so hashed ones can be shown
+        std::mutex hashes_mutex;
+        std::vector<std::pair<uint32_t, std::string>> hashes;
+        std::atomic<uint64_t> slots{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> decoded_count{0};
+
+        using stage_type = void (ft8_decoder::*)(ft8_slot& slot_in, const size_t& job_in);
+        using next_type = void (ft8_decoder::*)(std::shared_ptr<ft8_slot> slot_in);
+
+        std::shared_ptr<ft8_slot> take_buffer();
+        void begin_slot(const clock_type::time_point& start_in);
+        void close_slot();
+        void run_stage(std::shared_ptr<ft8_slot> slot_in, const size_t& jobs_in, stage_type stage_in, next_type next_in);
+        void dispatch(std::shared_ptr<ft8_slot> slot_in);
+        void spectrogram(ft8_slot& slot_in, const size_t& job_in);
+        void start_search(std::shared_ptr<ft8_slot> slot_in);
+        void search(ft8_slot& slot_in, const size_t& job_in);
+        void start_decode(std::shared_ptr<ft8_slot> slot_in);
+        void decode(ft8_slot& slot_in, const size_t& job_in);
+        bool decode_candidate(const ft8_slot& slot_in, const ft8_candidate& candidate_in, ft8_message& message_out) const;
+        void finish(std::shared_ptr<ft8_slot> slot_in);
+        void learn(const ft8_payload& payload_in);
+        std::string unpack(const ft8_payload& payload_in);
+
+    public:
+        event_source<const ft8_message&> decoded;
+        event_source<const ft8_slot_stats&> finished;
+
+        ft8_decoder(const ft8_config& config_in, std::shared_ptr<thread_queue> queue_in = thread_queue::get_global());
+        const ft8_config& get_config() const { return config; }
+        // block_in holds one channel at the configured rate
+        void process(const float* block_in, const size_t& samples_in);
+        // A whole slot of recorded audio at the configured rate that starts
+        // at slot_in; false if every buffer is busy. Use this or process()
+        // on one decoder but not both.
+        bool decode_slot(const float* samples_in, const size_t& count_in, const clock_type::time_point& slot_in);
+        stats_type get_stats() const;
+};
+
+}
@@ -19,45 +19,294 @@
  *
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <thread>
 
 #include "hamlib.h"
 #include "logging.h"
 
 namespace oemros {
 
+// a poll that has waited this long is stale and is dropped
+#define HAMLIB_POLL_DEADLINE_MSEC 1000
+// opening can mean waiting on a slow serial port
+#define HAMLIB_OPEN_DEADLINE_MSEC 30000
+// a write nobody got to in this long is no longer what the user wants
+#define HAMLIB_CONTROL_DEADLINE_MSEC 2000
+// how long a value read from the rig is good for
+#define HAMLIB_FREQ_TTL_MSEC 200
+#define HAMLIB_PTT_TTL_MSEC 100
+#define HAMLIB_METER_TTL_MSEC 40
+// the port timeout is set from the latency of this many calls
+#define HAMLIB_ADAPT_CALLS 128
+#define HAMLIB_ADAPT_PERCENTILE 0.99
+// how much slower than the percentile an answer may be before giving up
+#define HAMLIB_ADAPT_FACTOR 3
+#define HAMLIB_MIN_TIMEOUT_MSEC 20
+// how long polls are skipped after the first timeout; it doubles for each
+// timeout in a row
+#define HAMLIB_BACKOFF_MIN_MSEC 100
+#define HAMLIB_BACKOFF_MAX_MSEC 5000
+// lines of hamlib debug output kept for each rig
+#define HAMLIB_TRACE_LINES 256
+
+static thread_local hamlib_trace* current_trace = nullptr;
+static thread_local hamlib_actor* current_actor = nullptr;
+
+static logjam::loglevel hamlib_log_level(const hamlib::rig_debug_level_e& level_in) {
+    switch(level_in) {
+        case hamlib::RIG_DEBUG_NONE: return logjam::loglevel::none;
+        case hamlib::RIG_DEBUG_BUG: return logjam::loglevel::error;
+        case hamlib::RIG_DEBUG_ERR: return logjam::loglevel::error;
+        case hamlib::RIG_DEBUG_WARN: return logjam::loglevel::info;
+        case hamlib::RIG_DEBUG_VERBOSE: return logjam::loglevel::debug;
+        case hamlib::RIG_DEBUG_TRACE: return logjam::loglevel::trace;
+        default: break;
+    }
+
+    return logjam::loglevel::trace;
+}
+
+// hamlib is told to send everything here so nothing is formatted unless a
+// trace or the log is going to keep it
+static int hamlib_debug(enum hamlib::rig_debug_level_e level_in, hamlib::rig_ptr_t, const char* format_in, va_list args_in) {
+    auto trace = current_trace;
+    auto level = hamlib_log_level(level_in);
+    auto to_log = logjam::should_log(level);
+
+    if (trace == nullptr && ! to_log) return 0;
+
+    const char* text;
+    char buf[hamlib_trace::line_size];
+
+    if (trace != nullptr) {
+        text = trace->add(level_in, format_in, args_in);
+    } else {
+        vsnprintf(buf, sizeof(buf), format_in, args_in);
+        auto length = strlen(buf);
+        if (length > 0 && buf[length - 1] == '\n') buf[length - 1] = '\0';
+        text = buf;
+    }
+
+    if (to_log) logjam::send_logevent(log_sources.hamlib, level, __PRETTY_FUNCTION__, __FILE__, __LINE__, text);
+
+    return 0;
+}
+
 void hamlib_bootstrap() {
-    hamlib::rig_set_debug_level(hamlib::RIG_DEBUG_NONE);
+    hamlib::rig_set_debug_callback(hamlib_debug, nullptr);
+    hamlib::rig_set_debug_level(hamlib::RIG_DEBUG_TRACE);
+}
+
+hamlib_trace::hamlib_trace(const size_t& capacity_in)
+: lines(capacity_in) {
+    assert(capacity_in > 0);
+}
+
+hamlib_trace* hamlib_trace::get_current() {
+    return current_trace;
+}
+
+void hamlib_trace::set_current(hamlib_trace* trace_in) {
+    current_trace = trace_in;
+}
+
+const char* hamlib_trace::add(const hamlib::rig_debug_level_e& level_in, const char* format_in, va_list args_in) {
+    auto& line = lines[next];
+    next = (next + 1) % lines.size();
+    count = std::min(count + 1, lines.size());
+
+    line.when = clock_type::now();
+    line.level = level_in;
+    vsnprintf(line.text, sizeof(line.text), format_in, args_in);
+
+    auto length = strlen(line.text);
+    if (length > 0 && line.text[length - 1] == '\n') line.text[length - 1] = '\0';
+
+    return line.text;
+}
+
+void hamlib_trace::dump(const std::string& why_in) {
+    if (count == 0) return;
+
+    auto first = (next + lines.size() - count) % lines.size();
+    auto now = clock_type::now();
+
+    logjam::send_logevent(log_sources.hamlib, logjam::loglevel::info, __PRETTY_FUNCTION__, __FILE__, __LINE__,
+                          why_in, "; last ", count, " lines of hamlib debug output follow");
+
+    for(size_t i = 0; i < count; i++) {
+        auto& line = lines[(first + i) % lines.size()];
+        auto age = std::chrono::duration_cast<std::chrono::milliseconds>(now - line.when).count();
+        logjam::send_logevent(log_sources.hamlib, logjam::loglevel::info, __PRETTY_FUNCTION__, __FILE__, __LINE__,
+                              "  [", age, " msec ago] ", line.text);
+    }
+
+    count = 0;
 }
 
 hamlib_error::hamlib_error(int error_num_in)
 : exception(hamlib::rigerror(error_num_in)), error_num(error_num_in) { }
 
+const char* hamlib_rig::operation_name(const operation& type_in) {
+    switch(type_in) {
+        case operation::open: return "open";
+        case operation::get_freq: return "get_freq";
+        case operation::get_ptt: return "get_ptt";
+        case operation::get_level: return "get_level";
+        case operation::set_freq: return "set_freq";
+        case operation::set_ptt: return "set_ptt";
+        case operation::set_mode: return "set_mode";
+        case operation::set_level: return "set_level";
+    }
+
+    system_fault("could not find name for hamlib operation");
+}
+
 hamlib_rig::~hamlib_rig() {
+    close();
+}
+
+void hamlib_rig::close() {
     if (hl_rig != nullptr) {
-        rig_close(hl_rig);
+        if (opened) rig_close(hl_rig);
         rig_cleanup(hl_rig);
 
         hl_rig = nullptr;
+        opened = false;
+    }
+}
+
+template <typename F>
+int hamlib_rig::timed(const operation& type_in, const F& call_in) {
+    auto& counters = stats[(size_t)type_in];
+    auto started = std::chrono::steady_clock::now();
+    auto retval = call_in();
+    auto elapsed = std::chrono::duration_cast<latency_histogram::duration_type>(std::chrono::steady_clock::now() - started);
+
+    counters.calls++;
+    counters.latency.record(elapsed);
+
+    if (retval != hamlib::RIG_OK) {
+        counters.errors++;
+        if (retval == - hamlib::RIG_ETIMEOUT) counters.timeouts++;
+    }
+
+    // a timeout counts too and pulls the percentile back up so a link that
+    // got slower gets its time back
+    if (type_in != operation::open) {
+        recent.record(elapsed);
+        if (++recent_calls >= HAMLIB_ADAPT_CALLS) adapt_timeout();
     }
+
+    return retval;
 }
 
+// safe to call again after a failure; whatever was left over is closed first
 bool hamlib_rig::open() {
+    close();
+
     hl_rig = hamlib::rig_init(model);
 
     if (hl_rig == nullptr) {
         return false;
     }
 
-    auto retcode = hamlib::rig_open(hl_rig);
-    return retcode;
+    if (port != "" && ! set_conf("rig_pathname", port)) return false;
+    if (speed != 0 && ! set_conf("serial_speed", std::to_string(speed))) return false;
+
+    auto retcode = timed(operation::open, [this] { return hamlib::rig_open(hl_rig); });
+    opened = retcode == hamlib::RIG_OK;
+
+    // whatever the backend settled on once open is the most it will wait
+    default_timeout = hl_rig->state.rigport.timeout;
+    current_timeout = default_timeout;
+    recent.reset();
+    recent_calls = 0;
+
+    return opened;
+}
+
+void hamlib_rig::adapt_timeout() {
+    assert(hl_rig != nullptr);
+
+    auto slow = recent.snapshot().percentile(HAMLIB_ADAPT_PERCENTILE);
+    recent.reset();
+    recent_calls = 0;
+
+    if (default_timeout <= 0) return;
+
+    auto wanted = std::chrono::duration_cast<std::chrono::milliseconds>(slow).count() * HAMLIB_ADAPT_FACTOR;
+    int timeout = std::min<int64_t>(std::max<int64_t>(wanted, HAMLIB_MIN_TIMEOUT_MSEC), default_timeout);
+
+    if (timeout == current_timeout) return;
+
+    log_debug("hamlib port timeout for model ", model, " is now ", timeout, " msec");
+    hl_rig->state.rigport.timeout = timeout;
+    current_timeout = timeout;
+}
+
+std::vector<hamlib_rig::operation_report> hamlib_rig::get_operation_stats() const {
+    std::vector<operation_report> result;
+
+    for(size_t i = 0; i < operation_count; i++) {
+        auto& counters = stats[i];
+        operation_report report;
+
+        report.type = (operation)i;
+        report.name = operation_name(report.type);
+        report.calls = counters.calls.load();
+        report.errors = counters.errors.load();
+        report.timeouts = counters.timeouts.load();
+        report.latency = counters.latency.snapshot();
+
+        result.push_back(report);
+    }
+
+    return result;
+}
+
+bool hamlib_rig::set_conf(const char* name_in, const std::string& value_in) {
+    assert(hl_rig != nullptr);
+
+    auto token = hamlib::rig_token_lookup(hl_rig, name_in);
+    auto retval = hamlib::rig_set_conf(hl_rig, token, value_in.c_str());
+
+    if (retval != hamlib::RIG_OK) {
+        log_error("could not set hamlib ", name_in, " to ", value_in, ": ", hamlib::rigerror(retval));
+        return false;
+    }
+
+    return true;
+}
+
+// only asks the backend what it implements so it never touches the port;
+// hamlib reads a PTT on a DTR, RTS, parallel, CM108 or GPIO line itself so
+// those can be read even when the backend has no get_ptt
+hamlib_rig::caps_type hamlib_rig::probe() {
+    assert(hl_rig != nullptr);
+    assert(hl_rig->caps != nullptr);
+
+    static const setting_type wanted_levels = hamlib::RIG_LEVEL_ALC | hamlib::RIG_LEVEL_SWR;
+    caps_type caps;
+
+    caps.get_freq = hl_rig->caps->get_freq != nullptr;
+    auto ptt_port = hl_rig->state.pttport.type.ptt;
+    auto ptt_line = ptt_port != hamlib::RIG_PTT_NONE && ptt_port != hamlib::RIG_PTT_RIG && ptt_port != hamlib::RIG_PTT_RIG_MICDATA;
+    caps.get_ptt = hl_rig->caps->get_ptt != nullptr || ptt_line;
+    caps.get_levels = hamlib::rig_has_get_level(hl_rig, wanted_levels);
+
+    return caps;
 }
 
 hamlib_result<float> hamlib_rig::get_alc(hamlib_rig::vfo_type vfo_in) {
     assert(hl_rig != nullptr);
 
     hamlib::value_t buf;
-    auto retval = hamlib::rig_get_level(hl_rig, vfo_in, hamlib::RIG_LEVEL_ALC, &buf);
+    auto retval = timed(operation::get_level, [&] { return hamlib::rig_get_level(hl_rig, vfo_in, hamlib::RIG_LEVEL_ALC, &buf); });
     return make_hamlib_result(retval, buf.f);
 }
 
@@ -66,7 +315,15 @@ hamlib_rig::get_freq(hamlib_rig::vfo_type vfo_in) {
     assert(hl_rig != nullptr);
 
     hamlib_rig::freq_type buf;
-    auto retval = hamlib::rig_get_freq(hl_rig, vfo_in, &buf);
+    auto retval = timed(operation::get_freq, [&] { return hamlib::rig_get_freq(hl_rig, vfo_in, &buf); });
+    return make_hamlib_result(retval, buf);
+}
+
+hamlib_result<hamlib_rig::ptt_type> hamlib_rig::get_ptt(hamlib_rig::vfo_type vfo_in) {
+    assert(hl_rig != nullptr);
+
+    hamlib_rig::ptt_type buf = hamlib::RIG_PTT_OFF;
+    auto retval = timed(operation::get_ptt, [&] { return hamlib::rig_get_ptt(hl_rig, vfo_in, &buf); });
     return make_hamlib_result(retval, buf);
 }
 
@@ -74,7 +331,7 @@ hamlib_result<int> hamlib_rig::get_strength(hamlib_rig::vfo_type vfo_in) {
     assert(hl_rig != nullptr);
 
     hamlib::value_t buf;
-    auto retval = hamlib::rig_get_level(hl_rig, vfo_in, hamlib::RIG_LEVEL_STRENGTH, &buf);
+    auto retval = timed(operation::get_level, [&] { return hamlib::rig_get_level(hl_rig, vfo_in, hamlib::RIG_LEVEL_STRENGTH, &buf); });
     return make_hamlib_result(retval, buf.i);
 }
 
@@ -82,29 +339,405 @@ hamlib_result<float> hamlib_rig::get_swr(hamlib_rig::vfo_type vfo_in) {
     assert(hl_rig != nullptr);
 
     hamlib::value_t buf;
-    auto retval = hamlib::rig_get_level(hl_rig, vfo_in, hamlib::RIG_LEVEL_SWR, &buf);
+    auto retval = timed(operation::get_level, [&] { return hamlib::rig_get_level(hl_rig, vfo_in, hamlib::RIG_LEVEL_SWR, &buf); });
     return make_hamlib_result(retval, buf.f);
 }
 
-hamlib_radio::hamlib_radio(std::shared_ptr<runloop> loop_in, const hamlib::rig_model_t& model_in)
-: radio(loop_in), rig(new hamlib_rig(model_in)) { }
+hamlib_result<hamlib_rig::freq_type>
+hamlib_rig::set_freq(const hamlib_rig::freq_type& freq_in, hamlib_rig::vfo_type vfo_in) {
+    assert(hl_rig != nullptr);
+
+    auto retval = timed(operation::set_freq, [&] { return hamlib::rig_set_freq(hl_rig, vfo_in, freq_in); });
+    return make_hamlib_result(retval, freq_in);
+}
+
+hamlib_result<hamlib_rig::ptt_type>
+hamlib_rig::set_ptt(const hamlib_rig::ptt_type& ptt_in, hamlib_rig::vfo_type vfo_in) {
+    assert(hl_rig != nullptr);
+
+    auto retval = timed(operation::set_ptt, [&] { return hamlib::rig_set_ptt(hl_rig, vfo_in, ptt_in); });
+    return make_hamlib_result(retval, ptt_in);
+}
+
+hamlib_result<hamlib_rig::mode_type>
+hamlib_rig::set_mode(const hamlib_rig::mode_type& mode_in, hamlib_rig::vfo_type vfo_in) {
+    assert(hl_rig != nullptr);
+
+    auto retval = timed(operation::set_mode, [&] { return hamlib::rig_set_mode(hl_rig, vfo_in, mode_in, RIG_PASSBAND_NORMAL); });
+    return make_hamlib_result(retval, mode_in);
+}
 
-hamlib_radio::~hamlib_radio() {
-    if (rig != nullptr) {
-        delete rig;
-        rig = nullptr;
+hamlib_result<float>
+hamlib_rig::set_level(const hamlib_rig::setting_type& level_in, const float& value_in, hamlib_rig::vfo_type vfo_in) {
+    assert(hl_rig != nullptr);
+
+    hamlib::value_t buf;
+    buf.f = value_in;
+    auto retval = timed(operation::set_level, [&] { return hamlib::rig_set_level(hl_rig, vfo_in, level_in, buf); });
+    return make_hamlib_result(retval, value_in);
+}
+
+hamlib_actor::hamlib_actor(const hamlib::rig_model_t& model_in, const std::string& port_in, const int& speed_in)
+: rig(model_in, port_in, speed_in), trace(HAMLIB_TRACE_LINES), worker([this] { be_worker(); }) { }
+
+hamlib_actor::~hamlib_actor() {
+    // the last owner must never be a completion running on the worker
+    assert(boost::this_thread::get_id() != worker.get_id());
+
+    auto lock = get_lock();
+    stopping = true;
+    condition.notify_all();
+    lock.unlock();
+
+    worker.join();
+
+    // the worker is gone so nothing else can touch the queue
+    while(! queue.empty()) {
+        queue.top()->fail(- hamlib::RIG_EINTERNAL);
+        queue.pop();
+    }
+}
+
+boost::unique_lock<boost::mutex> hamlib_actor::get_lock() {
+    return boost::unique_lock<boost::mutex>(mutex);
+}
+
+hamlib_actor::stats_type hamlib_actor::get_stats() {
+    auto lock = get_lock();
+    auto result = stats;
+    result.queued = queue.size();
+    return result;
+}
+
+hamlib_actor* hamlib_actor::get_current() {
+    return current_actor;
+}
+
+void hamlib_actor::be_worker() {
+    hamlib_trace::set_current(&trace);
+    current_actor = this;
+
+    while(1) {
+        auto lock = get_lock();
+        while(queue.empty() && ! stopping) {
+            condition.wait(lock);
+        }
+        if (stopping) return;
+
+        auto next = queue.top();
+        queue.pop();
+
+        // once started nothing else can be merged into it
+        if (next->key != no_merge) {
+            auto found = mergeable.find(next->key);
+            if (found != mergeable.end() && found->second == next) mergeable.erase(found);
+        }
+
+        auto now = clock_type::now();
+        auto expired = now > next->deadline;
+        auto skipped = ! expired && next->level == priority::poll && now < backoff_until;
+        if (expired) stats.expired++;
+        if (skipped) stats.skipped++;
+
+        // after this the queue no longer needs to be locked
+        lock.unlock();
+
+        if (expired || skipped) {
+            next->fail(- hamlib::RIG_ETIMEOUT);
+            continue;
+        }
+
+        auto error = next->run(rig);
+
+        if (error != hamlib::RIG_OK) {
+            trace.dump(std::string("hamlib command failed for model ") + std::to_string(rig.model) + ": " + hamlib::rigerror(error));
+        }
+
+        lock.lock();
+        stats.completed++;
+        if (error == hamlib::RIG_OK) {
+            stats.last_ok = clock_type::now();
+        } else {
+            stats.failed++;
+        }
+
+        // any answer at all means the rig is there
+        if (error != - hamlib::RIG_ETIMEOUT) {
+            stats.consecutive_timeouts = 0;
+            continue;
+        }
+
+        auto doublings = std::min<uint64_t>(stats.consecutive_timeouts++, 16);
+        auto backoff = std::min<int64_t>((int64_t)HAMLIB_BACKOFF_MIN_MSEC << doublings, HAMLIB_BACKOFF_MAX_MSEC);
+        backoff_until = clock_type::now() + std::chrono::milliseconds(backoff);
+    }
+}
+
+static hamlib_rig::mode_type hamlib_mode(const radio::mode& mode_in) {
+    switch(mode_in) {
+        case radio::mode::unknown: return hamlib::RIG_MODE_NONE;
+        case radio::mode::am: return hamlib::RIG_MODE_AM;
+        case radio::mode::cw: return hamlib::RIG_MODE_CW;
+        case radio::mode::usb: return hamlib::RIG_MODE_USB;
+        case radio::mode::lsb: return hamlib::RIG_MODE_LSB;
+        case radio::mode::fm: return hamlib::RIG_MODE_FM;
+    }
+
+    system_fault("could not find hamlib mode for enum");
+}
+
+static hamlib_rig::setting_type hamlib_level(const radio::level& level_in) {
+    switch(level_in) {
+        case radio::level::rf_power: return hamlib::RIG_LEVEL_RFPOWER;
+        case radio::level::af_gain: return hamlib::RIG_LEVEL_AF;
+    }
+
+    system_fault("could not find hamlib level for enum");
+}
+
+// The actor as seen from closures that completions can keep alive on the
+// worker thread. A strong reference taken on the worker could turn out to be
+// the last one and then the actor would join itself. The worker does not
+// need one because the actor waits for the running command before it goes.
+class hamlib_actor_ref {
+    private:
+        std::weak_ptr<hamlib_actor> weak;
+        hamlib_actor* raw;
+
+    public:
+        hamlib_actor_ref(const std::shared_ptr<hamlib_actor>& actor_in) : weak(actor_in), raw(actor_in.get()) { }
+
+        // false if the actor is already gone
+        template <typename Func>
+        bool with(const Func& func_in) const {
+            if (hamlib_actor::get_current() == raw) {
+                func_in(*raw);
+                return true;
+            }
+
+            auto strong = weak.lock();
+            if (strong == nullptr) return false;
+            func_in(*strong);
+            return true;
+        }
+};
+
+// cache misses are queued as polls and share the merge key of the field;
+// a fetch in flight keeps the cache alive on the actor thread so the cache
+// must not keep the actor alive
+template <typename T>
+static std::shared_ptr<read_cache<T>>
+make_hamlib_cache(std::shared_ptr<hamlib_actor> actor_in, const enum radio::update& field_in, const int& ttl_msec_in,
+                  const std::function<hamlib_result<T> (hamlib_rig&)>& work_in) {
+    auto key = (hamlib_actor::key_type)field_in;
+    hamlib_actor_ref our_actor(actor_in);
+
+    return std::make_shared<read_cache<T>>(std::chrono::milliseconds(ttl_msec_in),
+        [our_actor, key, work_in](const typename read_cache<T>::done_type& finished_in) {
+            auto started = our_actor.with([&](hamlib_actor& running_in) {
+                running_in.submit<T>(hamlib_actor::priority::poll, key, std::chrono::milliseconds(HAMLIB_POLL_DEADLINE_MSEC), work_in,
+                    [finished_in](hamlib_result<T> result_in) { finished_in(result_in.error, result_in.value); });
+            });
+
+            if (! started) finished_in(- hamlib::RIG_EINTERNAL, T());
+        });
+}
+
+// blocks the caller until the cache has a value; a hit is answered on the
+// calling thread and a fetch on the actor thread so only an answer from the
+// actor is a round trip to the rig
+template <typename T>
+hamlib_result<T> hamlib_radio::poll_through(const enum update& field_in, read_cache<T>& cache_in) {
+    auto promise = std::make_shared<std::promise<hamlib_result<T>>>();
+    auto future = promise->get_future();
+    auto asked = std::this_thread::get_id();
+    // the promise orders the write before the read
+    auto fetched = std::make_shared<bool>(false);
+    auto started = std::chrono::steady_clock::now();
+
+    cache_in.get([promise, asked, fetched](const int& error_in, const T& value_in) {
+        *fetched = std::this_thread::get_id() != asked;
+        promise->set_value(make_hamlib_result(error_in, value_in));
+    });
+
+    auto result = future.get();
+    if (result && *fetched) report_round_trip(field_in, std::chrono::steady_clock::now() - started);
+    return result;
+}
+
+hamlib_radio::hamlib_radio(std::shared_ptr<runloop> loop_in, const hamlib::rig_model_t& model_in, const std::string& port_in, const int& speed_in)
+: radio(loop_in), actor(std::make_shared<hamlib_actor>(model_in, port_in, speed_in)) {
+    auto control_deadline = std::chrono::milliseconds(HAMLIB_CONTROL_DEADLINE_MSEC);
+    // completions can keep the caches and writers alive on the actor thread
+    // after the radio is gone so only the radio owns the actor
+    hamlib_actor_ref our_actor(actor);
+
+    freq_cache = make_hamlib_cache<hamlib_rig::freq_type>(actor, radio::update::tuner, HAMLIB_FREQ_TTL_MSEC,
+        [](hamlib_rig& rig_in) { return rig_in.get_freq(); });
+    ptt_cache = make_hamlib_cache<hamlib_rig::ptt_type>(actor, radio::update::ptt, HAMLIB_PTT_TTL_MSEC,
+        [](hamlib_rig& rig_in) { return rig_in.get_ptt(); });
+    alc_cache = make_hamlib_cache<float>(actor, radio::update::alc, HAMLIB_METER_TTL_MSEC,
+        [](hamlib_rig& rig_in) { return rig_in.get_alc(); });
+    swr_cache = make_hamlib_cache<float>(actor, radio::update::swr, HAMLIB_METER_TTL_MSEC,
+        [](hamlib_rig& rig_in) { return rig_in.get_swr(); });
+
+    auto our_freq_cache = freq_cache;
+    auto our_ptt_cache = ptt_cache;
+
+    freq_writes = std::make_shared<write_coalescer<int, frequency>>(
+        [our_actor, our_freq_cache, control_deadline](const int&, const frequency& freq_in, const write_coalescer<int, frequency>::finished_type& finished_in) {
+            auto started = our_actor.with([&](hamlib_actor& actor_in) {
+                actor_in.submit<hamlib_rig::freq_type>(hamlib_actor::priority::control, hamlib_actor::no_merge, control_deadline,
+                    [freq_in](hamlib_rig& rig_in) { return rig_in.set_freq(freq_in); },
+                    [freq_in, finished_in, our_freq_cache](hamlib_result<hamlib_rig::freq_type> result_in) {
+                        if (result_in) our_freq_cache->put(result_in.value);
+                        finished_in(result_in, freq_in);
+                    });
+            });
+
+            if (! started) finished_in(false, freq_in);
+        });
+
+    ptt_writes = std::make_shared<write_coalescer<int, bool>>(
+        [our_actor, our_ptt_cache, control_deadline](const int&, const bool& ptt_in, const write_coalescer<int, bool>::finished_type& finished_in) {
+            auto hl_ptt = ptt_in ? hamlib::RIG_PTT_ON : hamlib::RIG_PTT_OFF;
+            auto started = our_actor.with([&](hamlib_actor& actor_in) {
+                actor_in.submit<hamlib_rig::ptt_type>(hamlib_actor::priority::control, hamlib_actor::no_merge, control_deadline,
+                    [hl_ptt](hamlib_rig& rig_in) { return rig_in.set_ptt(hl_ptt); },
+                    [ptt_in, finished_in, our_ptt_cache](hamlib_result<hamlib_rig::ptt_type> result_in) {
+                        if (result_in) our_ptt_cache->put(result_in.value);
+                        finished_in(result_in, ptt_in);
+                    });
+            });
+
+            if (! started) finished_in(false, ptt_in);
+        });
+
+    mode_writes = std::make_shared<write_coalescer<int, mode>>(
+        [our_actor, control_deadline](const int&, const mode& mode_in, const write_coalescer<int, mode>::finished_type& finished_in) {
+            auto hl_mode = hamlib_mode(mode_in);
+            auto started = our_actor.with([&](hamlib_actor& actor_in) {
+                actor_in.submit<hamlib_rig::mode_type>(hamlib_actor::priority::control, hamlib_actor::no_merge, control_deadline,
+                    [hl_mode](hamlib_rig& rig_in) { return rig_in.set_mode(hl_mode); },
+                    [mode_in, finished_in](hamlib_result<hamlib_rig::mode_type> result_in) { finished_in(result_in, mode_in); });
+            });
+
+            if (! started) finished_in(false, mode_in);
+        });
+
+    level_writes = std::make_shared<write_coalescer<level, float>>(
+        [our_actor, control_deadline](const level& level_in, const float& value_in, const write_coalescer<level, float>::finished_type& finished_in) {
+            auto hl_level = hamlib_level(level_in);
+            auto started = our_actor.with([&](hamlib_actor& actor_in) {
+                actor_in.submit<float>(hamlib_actor::priority::control, hamlib_actor::no_merge, control_deadline,
+                    [hl_level, value_in](hamlib_rig& rig_in) { return rig_in.set_level(hl_level, value_in); },
+                    [value_in, finished_in](hamlib_result<float> result_in) { finished_in(result_in, value_in); });
+            });
+
+            if (! started) finished_in(false, value_in);
+        });
+}
+
+// write completions show up on the actor thread; the radio state and the
+// caller's callback are only touched back on the runloop
+template <typename T>
+std::function<void (bool, const T&)>
+hamlib_radio::finish_on_loop(const set_done<T>& done_in, const std::function<void (hamlib_radio&, const T&)>& apply_in) {
+    assert(loop != nullptr);
+
+    std::weak_ptr<baseobj> weak_us = weak_from_this();
+    auto our_loop = loop;
+
+    return [weak_us, our_loop, done_in, apply_in](bool ok_in, const T& applied_in) {
+        our_loop->post([weak_us, done_in, apply_in, ok_in, applied_in] {
+            auto strong_us = std::dynamic_pointer_cast<hamlib_radio>(weak_us.lock());
+            if (strong_us == nullptr) return;
+
+            if (ok_in && apply_in) {
+                batch scope(*strong_us);
+                apply_in(*strong_us, applied_in);
+            }
+
+            if (done_in) done_in(ok_in, applied_in);
+        });
+    };
+}
+
+void hamlib_radio::set_ttl(const enum update& field_in, const std::chrono::milliseconds& ttl_in) {
+    switch(field_in) {
+        case update::alc: alc_cache->set_ttl(ttl_in); return;
+        case update::swr: swr_cache->set_ttl(ttl_in); return;
+        case update::tuner: freq_cache->set_ttl(ttl_in); return;
+        case update::ptt: ptt_cache->set_ttl(ttl_in); return;
+        case update::power: return;
     }
+
+    system_fault("could not find cache for update field");
+}
+
+void hamlib_radio::set_frequency(const frequency& freq_in, const set_done<frequency>& done_in) {
+    freq_writes->write(0, freq_in, finish_on_loop<frequency>(done_in, [](hamlib_radio& radio_in, const frequency& applied_in) {
+        radio_in.vfo.tuner = applied_in;
+    }));
+}
+
+void hamlib_radio::set_ptt(const bool& ptt_in, const set_done<bool>& done_in) {
+    ptt_writes->write(0, ptt_in, finish_on_loop<bool>(done_in, [](hamlib_radio& radio_in, const bool& applied_in) {
+        radio_in.ptt = applied_in;
+    }));
+}
+
+void hamlib_radio::set_mode(const mode& mode_in, const set_done<mode>& done_in) {
+    mode_writes->write(0, mode_in, finish_on_loop<mode>(done_in));
+}
+
+void hamlib_radio::set_level(const level& level_in, const float& value_in, const set_done<float>& done_in) {
+    level_writes->write(level_in, value_in, finish_on_loop<float>(done_in));
+}
+
+// queued with the writes instead of the polls so it can not run before a
+// retune that was asked for first
+void hamlib_radio::read_strength(const read_done<int>& done_in) {
+    auto finished = finish_on_loop<int>(done_in);
+
+    actor->submit<int>(hamlib_actor::priority::control, hamlib_actor::no_merge, std::chrono::milliseconds(HAMLIB_CONTROL_DEADLINE_MSEC),
+        [](hamlib_rig& rig_in) { return rig_in.get_strength(); },
+        [finished](hamlib_result<int> result_in) { finished(result_in, result_in.value); });
 }
 
 bool hamlib_radio::open() {
-    assert(rig != nullptr);
-    return rig->open();
+    assert(actor != nullptr);
+
+    auto result = actor->call<hamlib_rig::caps_type>(hamlib_actor::priority::control, hamlib_actor::no_merge,
+        std::chrono::milliseconds(HAMLIB_OPEN_DEADLINE_MSEC), [](hamlib_rig& rig_in) {
+            if (! rig_in.open()) return make_hamlib_result(- hamlib::RIG_EIO, hamlib_rig::caps_type());
+            return make_hamlib_result(hamlib::RIG_OK, rig_in.probe());
+        });
+
+    if (! result) {
+        log_error("could not open hamlib rig: ", result.error_str());
+        return false;
+    }
+
+    auto caps = result.value;
+    mask_type can_update = 0;
+
+    if (caps.get_levels & hamlib::RIG_LEVEL_ALC) can_update |= (mask_type)radio::update::alc;
+    if (caps.get_levels & hamlib::RIG_LEVEL_SWR) can_update |= (mask_type)radio::update::swr;
+    if (caps.get_freq) can_update |= (mask_type)radio::update::tuner;
+    if (caps.get_ptt) can_update |= (mask_type)radio::update::ptt;
+    // hamlib has no way to read the power meter yet so it stays out of the plan
+
+    set_poll_plan(can_update);
+    log_debug("hamlib supports update mask ", can_update);
+
+    return true;
 }
 
 void hamlib_radio::update__alc() {
-    assert(rig != nullptr);
+    assert(actor != nullptr);
 
-    auto result = rig->get_alc();
+    auto result = poll_through(update::alc, *alc_cache);
     if (result) {
         meters.alc = result.value;
     } else {
@@ -113,15 +746,15 @@ void hamlib_radio::update__alc() {
 }
 
 void hamlib_radio::update__power() {
-    assert(rig != nullptr);
+    assert(actor != nullptr);
 
     log_error("can not update power meter from hamlib yet");
 }
 
 void hamlib_radio::update__swr() {
-    assert(rig != nullptr);
+    assert(actor != nullptr);
 
-    auto result = rig->get_swr();
+    auto result = poll_through(update::swr, *swr_cache);
     if (result) {
         meters.swr = result.value;
     } else {
@@ -130,9 +763,9 @@ void hamlib_radio::update__swr() {
 }
 
 void hamlib_radio::update__tuner() {
-    assert(rig != nullptr);
+    assert(actor != nullptr);
 
-    auto result = rig->get_freq();
+    auto result = poll_through(update::tuner, *freq_cache);
     if (result) {
         vfo.tuner = result.value;
     } else {
@@ -140,4 +773,15 @@ void hamlib_radio::update__tuner() {
     }
 }
 
+void hamlib_radio::update__ptt() {
+    assert(actor != nullptr);
+
+    auto result = poll_through(update::ptt, *ptt_cache);
+    if (result) {
+        ptt = result.value != hamlib::RIG_PTT_OFF;
+    } else {
+        log_error("could not get PTT from hamlib: ", result.error_str());
+    }
+}
+
 }
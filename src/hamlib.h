@@ -21,8 +21,22 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <boost/thread.hpp>
+#include <chrono>
+#include <cstdarg>
+#include <functional>
+#include <future>
+#include <queue>
+#include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "cache.h"
+#include "coalesce.h"
+#include "histogram.h"
 #include "object.h"
 #include "radio.h"
 #include "system.h"
@@ -35,6 +49,8 @@ namespace hamlib {
 
 namespace oemros {
 
+// hamlib debug output goes to log_sources.hamlib and to the trace of the
+// rig whose actor thread it came from
 void hamlib_bootstrap();
 
 struct hamlib_error : public exception {
@@ -65,39 +81,330 @@ make_hamlib_result(const int& error_in, const T& value_in) {
     return hamlib_result<T>(error_in, value_in);
 }
 
+// Every call into hamlib is timed and counted by what kind of call it was.
+// The latency of recent calls sets how long hamlib waits on the port before
+// it gives up so a link that normally answers in 20 msec does not sit out
+// the multi-second backend default every time an answer goes missing.
 class hamlib_rig : public baseobj {
     public:
         using freq_type = hamlib::freq_t;
         using vfo_type = hamlib::vfo_t;
+        using ptt_type = hamlib::ptt_t;
+        using setting_type = hamlib::setting_t;
+        using mode_type = hamlib::rmode_t;
+
+        // what the backend for this model and its PTT port say can be read
+        struct caps_type {
+            bool get_freq = false;
+            bool get_ptt = false;
+            setting_type get_levels = 0;
+        };
+
+        enum class operation : size_t {
+            open = 0,
+            get_freq,
+            get_ptt,
+            get_level,
+            set_freq,
+            set_ptt,
+            set_mode,
+            set_level,
+        };
+
+        static constexpr size_t operation_count = (size_t)operation::set_level + 1;
+
+        struct operation_report {
+            operation type;
+            const char* name;
+            uint64_t calls = 0;
+            uint64_t errors = 0;
+            uint64_t timeouts = 0;
+            latency_histogram::snapshot_type latency;
+        };
 
     private:
+        struct operation_stats {
+            std::atomic<uint64_t> calls{0};
+            std::atomic<uint64_t> errors{0};
+            std::atomic<uint64_t> timeouts{0};
+            latency_histogram latency;
+        };
+
         hamlib::RIG* hl_rig = nullptr;
+        bool opened = false;
+        std::array<operation_stats, operation_count> stats;
+        // calls since the timeout was last adjusted
+        latency_histogram recent;
+        uint64_t recent_calls = 0;
+        // what the backend asked for; the timeout never goes above this
+        int default_timeout = 0;
+        std::atomic<int> current_timeout{0};
+
+        bool set_conf(const char* name_in, const std::string& value_in);
+        // call_in returns the hamlib status and only ever runs on the caller's thread
+        template <typename F> int timed(const operation& type_in, const F& call_in);
+        void adapt_timeout();
 
     public:
         const hamlib::rig_model_t model;
-        hamlib_rig(const hamlib::rig_model_t& model_in) : model(model_in) { }
+        // an empty port or a speed of 0 leaves the backend default alone
+        const std::string port;
+        const int speed;
+        hamlib_rig(const hamlib::rig_model_t& model_in, const std::string& port_in = "", const int& speed_in = 0)
+        : model(model_in), port(port_in), speed(speed_in) { }
         ~hamlib_rig();
         bool open();
+        void close();
+        caps_type probe();
         hamlib_result<float> get_alc(vfo_type vfo_in = RIG_VFO_CURR);
         hamlib_result<freq_type> get_freq(vfo_type vfo_in = RIG_VFO_CURR);
+        hamlib_result<ptt_type> get_ptt(vfo_type vfo_in = RIG_VFO_CURR);
         hamlib_result<int> get_strength(vfo_type vfo_in = RIG_VFO_CURR);
         hamlib_result<float> get_swr(vfo_type vfo_in = RIG_VFO_CURR);
+        hamlib_result<freq_type> set_freq(const freq_type& freq_in, vfo_type vfo_in = RIG_VFO_CURR);
+        hamlib_result<ptt_type> set_ptt(const ptt_type& ptt_in, vfo_type vfo_in = RIG_VFO_CURR);
+        hamlib_result<mode_type> set_mode(const mode_type& mode_in, vfo_type vfo_in = RIG_VFO_CURR);
+        hamlib_result<float> set_level(const setting_type& level_in, const float& value_in, vfo_type vfo_in = RIG_VFO_CURR);
+        // safe to call from any thread
+        std::vector<operation_report> get_operation_stats() const;
+        // msec hamlib currently waits on the port for an answer
+        int get_timeout() const { return current_timeout.load(); }
+        static const char* operation_name(const operation& type_in);
+};
+
+// The last lines of hamlib debug output from one thread. Each actor puts one
+// on its thread so a trace only has lines about that one rig and it is
+// written to the log when a command fails. Lines are formatted straight into
+// slots that were allocated up front.
+class hamlib_trace {
+    public:
+        using clock_type = std::chrono::steady_clock;
+        static constexpr size_t line_size = 160;
+
+        struct line_type {
+            clock_type::time_point when;
+            hamlib::rig_debug_level_e level = hamlib::RIG_DEBUG_NONE;
+            char text[line_size];
+        };
+
+    private:
+        std::vector<line_type> lines;
+        size_t next = 0;
+        size_t count = 0;
+
+    public:
+        hamlib_trace(const size_t& capacity_in);
+        // returns the line that was written
+        const char* add(const hamlib::rig_debug_level_e& level_in, const char* format_in, va_list args_in);
+        // oldest first and then the trace is empty
+        void dump(const std::string& why_in);
+        size_t size() const { return count; }
+        // the trace of the calling thread or nullptr
+        static hamlib_trace* get_current();
+        static void set_current(hamlib_trace* trace_in);
+};
+
+// A RIG* handle can only be used by one thread at a time so each rig gets an
+// actor that owns it and runs commands on its own thread. The highest
+// priority command that is queued runs next so keying and tuning go ahead
+// of any meter polls that are waiting. A command that is still queued when
+// its deadline passes is dropped and completes with RIG_ETIMEOUT. Commands
+// with the same non-zero key and priority are merged while queued so every
+// submitter gets the result of one trip to the rig.
+//
+// When the rig stops answering polls are failed right away without going to
+// the rig for a while that doubles with each timeout in a row. Control
+// commands always go to the rig.
+class hamlib_actor : public baseobj {
+    public:
+        using clock_type = std::chrono::steady_clock;
+        using key_type = uint64_t;
+
+        enum class priority : int {
+            poll = 0,
+            normal = 50,
+            control = 100,
+        };
+
+        static constexpr key_type no_merge = 0;
+
+        struct stats_type {
+            uint64_t completed = 0;
+            uint64_t failed = 0;
+            uint64_t merged = 0;
+            uint64_t expired = 0;
+            // polls failed without trying while backing off
+            uint64_t skipped = 0;
+            uint64_t consecutive_timeouts = 0;
+            size_t queued = 0;
+            clock_type::time_point last_ok;
+        };
+
+    private:
+        struct command : public baseobj {
+            const priority level;
+            const uint64_t seq;
+            const key_type key;
+            const clock_type::time_point deadline;
+            command(const priority& level_in, const uint64_t& seq_in, const key_type& key_in, const clock_type::time_point& deadline_in)
+            : level(level_in), seq(seq_in), key(key_in), deadline(deadline_in) { }
+            // returns the hamlib status of the command
+            virtual int run(hamlib_rig& rig_in) = 0;
+            virtual void fail(const int& error_in) = 0;
+        };
+
+        template <typename T>
+        struct typed_command : public command {
+            using work_type = std::function<hamlib_result<T> (hamlib_rig&)>;
+            using done_type = std::function<void (hamlib_result<T>)>;
+
+            const work_type work;
+            std::vector<done_type> waiters;
+
+            typed_command(const priority& level_in, const uint64_t& seq_in, const key_type& key_in, const clock_type::time_point& deadline_in, const work_type& work_in)
+            : command(level_in, seq_in, key_in, deadline_in), work(work_in) { }
+            virtual int run(hamlib_rig& rig_in) override {
+                auto result = work(rig_in);
+                for(auto&& i : waiters) i(result);
+                return result.error;
+            }
+            virtual void fail(const int& error_in) override {
+                hamlib_result<T> result(error_in, T());
+                for(auto&& i : waiters) i(result);
+            }
+        };
+
+        // highest priority first then oldest first
+        struct command_order {
+            bool operator()(const std::shared_ptr<command>& lhs_in, const std::shared_ptr<command>& rhs_in) const {
+                if (lhs_in->level != rhs_in->level) return lhs_in->level < rhs_in->level;
+                return lhs_in->seq > rhs_in->seq;
+            }
+        };
+
+        hamlib_rig rig;
+        // only touched by the worker
+        hamlib_trace trace;
+        boost::mutex mutex;
+        boost::condition_variable condition;
+        std::priority_queue<std::shared_ptr<command>, std::vector<std::shared_ptr<command>>, command_order> queue;
+        // queued commands that a new submission can still be merged into
+        std::unordered_map<key_type, std::shared_ptr<command>> mergeable;
+        uint64_t next_seq = 0;
+        bool stopping = false;
+        clock_type::time_point backoff_until;
+        stats_type stats;
+        boost::thread worker;
+
+        boost::unique_lock<boost::mutex> get_lock();
+        void be_worker();
+
+    public:
+        hamlib_actor(const hamlib::rig_model_t& model_in, const std::string& port_in = "", const int& speed_in = 0);
+        ~hamlib_actor();
+
+        // done_in runs on the actor thread
+        template <typename T>
+        void submit(const priority& level_in, const key_type& key_in, const clock_type::duration& timeout_in,
+                    const typename typed_command<T>::work_type& work_in, const typename typed_command<T>::done_type& done_in) {
+            auto lock = get_lock();
+
+            if (stopping) {
+                lock.unlock();
+                done_in(hamlib_result<T>(- hamlib::RIG_EINTERNAL, T()));
+                return;
+            }
+
+            if (key_in != no_merge) {
+                auto found = mergeable.find(key_in);
+                if (found != mergeable.end() && found->second->level == level_in) {
+                    auto existing = std::dynamic_pointer_cast<typed_command<T>>(found->second);
+                    if (existing != nullptr) {
+                        existing->waiters.push_back(done_in);
+                        stats.merged++;
+                        return;
+                    }
+                }
+            }
+
+            auto deadline = clock_type::now() + timeout_in;
+            auto new_command = std::make_shared<typed_command<T>>(level_in, next_seq++, key_in, deadline, work_in);
+            new_command->waiters.push_back(done_in);
+            queue.push(new_command);
+            if (key_in != no_merge) mergeable[key_in] = new_command;
+
+            condition.notify_one();
+        }
+
+        // blocks until the command has run or was dropped; must not be
+        // called from the actor thread
+        template <typename T>
+        hamlib_result<T> call(const priority& level_in, const key_type& key_in, const clock_type::duration& timeout_in,
+                              const typename typed_command<T>::work_type& work_in) {
+            assert(boost::this_thread::get_id() != worker.get_id());
+
+            auto promise = std::make_shared<std::promise<hamlib_result<T>>>();
+            auto future = promise->get_future();
+
+            submit<T>(level_in, key_in, timeout_in, work_in, [promise](hamlib_result<T> result_in) {
+                promise->set_value(result_in);
+            });
+
+            return future.get();
+        }
+
+        stats_type get_stats();
+        // the actor whose worker is the calling thread or nullptr
+        static hamlib_actor* get_current();
+        std::vector<hamlib_rig::operation_report> get_operation_stats() const { return rig.get_operation_stats(); }
+        int get_timeout() const { return rig.get_timeout(); }
 };
 
 class hamlib_radio : public radio {
     private:
-        hamlib_rig* rig;
+        std::shared_ptr<hamlib_actor> actor;
+        // every read goes through these so many readers cost one trip to the rig
+        std::shared_ptr<read_cache<hamlib_rig::freq_type>> freq_cache;
+        std::shared_ptr<read_cache<hamlib_rig::ptt_type>> ptt_cache;
+        std::shared_ptr<read_cache<float>> alc_cache;
+        std::shared_ptr<read_cache<float>> swr_cache;
+        // a spinning tuning knob turns into one write per round trip
+        std::shared_ptr<write_coalescer<int, frequency>> freq_writes;
+        std::shared_ptr<write_coalescer<int, bool>> ptt_writes;
+        std::shared_ptr<write_coalescer<int, mode>> mode_writes;
+        std::shared_ptr<write_coalescer<level, float>> level_writes;
+
+        template <typename T>
+        std::function<void (bool, const T&)> finish_on_loop(const set_done<T>& done_in, const std::function<void (hamlib_radio&, const T&)>& apply_in = nullptr);
+        // reads a field for poll() and reports the round trip when the rig was asked
+        template <typename T>
+        hamlib_result<T> poll_through(const enum update& field_in, read_cache<T>& cache_in);
 
     protected:
         virtual void update__alc() override;
         virtual void update__power() override;
         virtual void update__swr() override;
         virtual void update__tuner() override;
+        virtual void update__ptt() override;
 
     public:
-        hamlib_radio(std::shared_ptr<runloop> loop_in, const hamlib::rig_model_t& model_in);
-        ~hamlib_radio();
+        hamlib_radio(std::shared_ptr<runloop> loop_in, const hamlib::rig_model_t& model_in, const std::string& port_in = "", const int& speed_in = 0);
         bool open();
+        std::shared_ptr<hamlib_actor> get_actor() { return actor; }
+        // done_in runs right away on a cache hit and on the actor thread otherwise
+        void read_freq(const read_cache<hamlib_rig::freq_type>::done_type& done_in) { freq_cache->get(done_in); }
+        void read_ptt(const read_cache<hamlib_rig::ptt_type>::done_type& done_in) { ptt_cache->get(done_in); }
+        void read_alc(const read_cache<float>::done_type& done_in) { alc_cache->get(done_in); }
+        void read_swr(const read_cache<float>::done_type& done_in) { swr_cache->get(done_in); }
+        // how old a cached value may be for one of the update fields
+        void set_ttl(const enum update& field_in, const std::chrono::milliseconds& ttl_in);
+        // done_in runs on the radio's runloop
+        virtual void set_frequency(const frequency& freq_in, const set_done<frequency>& done_in = nullptr) override;
+        virtual void set_ptt(const bool& ptt_in, const set_done<bool>& done_in = nullptr) override;
+        virtual void set_mode(const mode& mode_in, const set_done<mode>& done_in = nullptr) override;
+        virtual void set_level(const level& level_in, const float& value_in, const set_done<float>& done_in = nullptr) override;
+        // done_in runs on the radio's runloop
+        virtual void read_strength(const read_done<int>& done_in) override;
 };
 
 }
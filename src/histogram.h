@@ -0,0 +1,139 @@
+/*
+ * histogram.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace oemros {
+
+// Counts latencies in buckets that are 1/8 of a power of two wide so any
+// percentile is within 12.5% of the real value over the whole range from a
+// microsecond to over an hour. Recording never blocks and is safe from any
+// thread; a snapshot can be taken at any time to do the math on.
+class latency_histogram {
+    public:
+        using duration_type = std::chrono::microseconds;
+        static constexpr size_t sub_buckets = 8;
+        static constexpr size_t octaves = 33;
+        static constexpr size_t bucket_count = sub_buckets * octaves;
+
+        struct snapshot_type {
+            std::array<uint64_t, bucket_count> counts{};
+            uint64_t total = 0;
+            uint64_t sum_usec = 0;
+            uint64_t max_usec = 0;
+
+            // the upper edge of the bucket the percentile falls in
+            duration_type percentile(const double& fraction_in) const {
+                if (total == 0) return duration_type(0);
+
+                auto clamped = std::min(std::max(fraction_in, 0.0), 1.0);
+                auto wanted = std::max<uint64_t>(1, static_cast<uint64_t>(clamped * total + 0.5));
+                uint64_t seen = 0;
+
+                for(size_t i = 0; i < bucket_count; i++) {
+                    seen += counts[i];
+                    if (seen >= wanted) return duration_type(std::min(bucket_upper(i), max_usec));
+                }
+
+                return duration_type(max_usec);
+            }
+
+            duration_type mean() const {
+                return duration_type(total == 0 ? 0 : sum_usec / total);
+            }
+
+            void merge(const snapshot_type& other_in) {
+                for(size_t i = 0; i < bucket_count; i++) counts[i] += other_in.counts[i];
+                total += other_in.total;
+                sum_usec += other_in.sum_usec;
+                max_usec = std::max(max_usec, other_in.max_usec);
+            }
+        };
+
+        // values below sub_buckets get a bucket each and after that every
+        // power of two is split into sub_buckets
+        static size_t bucket_for(const uint64_t& usec_in) {
+            if (usec_in < sub_buckets) return usec_in;
+
+            size_t top_bit = 63 - __builtin_clzll(usec_in);
+            size_t octave = top_bit - 2;
+            size_t sub = (usec_in >> (top_bit - 3)) & (sub_buckets - 1);
+
+            return std::min(octave * sub_buckets + sub, bucket_count - 1);
+        }
+
+        static uint64_t bucket_upper(const size_t& bucket_in) {
+            if (bucket_in < sub_buckets) return bucket_in;
+
+            size_t octave = bucket_in / sub_buckets;
+            size_t sub = bucket_in % sub_buckets;
+            size_t shift = octave - 1;
+
+            return ((sub_buckets + sub + 1) << shift) - 1;
+        }
+
+    private:
+        std::array<std::atomic<uint64_t>, bucket_count> counts{};
+        std::atomic<uint64_t> total{0};
+        std::atomic<uint64_t> sum_usec{0};
+        std::atomic<uint64_t> max_usec{0};
+
+    public:
+        void record(const duration_type& latency_in) {
+            auto usec = static_cast<uint64_t>(std::max<int64_t>(latency_in.count(), 0));
+
+            counts[bucket_for(usec)].fetch_add(1, std::memory_order_relaxed);
+            total.fetch_add(1, std::memory_order_relaxed);
+            sum_usec.fetch_add(usec, std::memory_order_relaxed);
+
+            auto old_max = max_usec.load(std::memory_order_relaxed);
+            while(usec > old_max && ! max_usec.compare_exchange_weak(old_max, usec, std::memory_order_relaxed));
+        }
+
+        // counts that are recorded while this runs may or may not show up
+        snapshot_type snapshot() const {
+            snapshot_type result;
+
+            for(size_t i = 0; i < bucket_count; i++) {
+                result.counts[i] = counts[i].load(std::memory_order_relaxed);
+                result.total += result.counts[i];
+            }
+            result.sum_usec = sum_usec.load(std::memory_order_relaxed);
+            result.max_usec = max_usec.load(std::memory_order_relaxed);
+
+            return result;
+        }
+
+        void reset() {
+            for(auto&& i : counts) i.store(0, std::memory_order_relaxed);
+            total.store(0, std::memory_order_relaxed);
+            sum_usec.store(0, std::memory_order_relaxed);
+            max_usec.store(0, std::memory_order_relaxed);
+        }
+};
+
+}
@@ -0,0 +1,219 @@
+/*
+ * history.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <type_traits>
+#include <vector>
+
+namespace oemros {
+
+// A fixed capacity ring of (timestamp, value) samples. The timestamps and
+// values live in separate arrays so scans over the values stay dense. The
+// min, max and mean over the trailing window are maintained as samples
+// arrive so asking for them does not walk the ring.
+template <typename T>
+class value_history {
+    public:
+        using value_type = T;
+        using clock_type = std::chrono::steady_clock;
+        using timestamp_type = clock_type::time_point;
+        using duration_type = clock_type::duration;
+        using seq_type = uint64_t;
+
+        struct stats_type {
+            size_t count = 0;
+            T min{};
+            T max{};
+            double mean = 0;
+        };
+
+    private:
+        const size_t capacity;
+        const duration_type window;
+        std::vector<timestamp_type> timestamps;
+        std::vector<T> values;
+        // running total of the samples pushed before this one so the sum of
+        // any span of the ring is a single subtraction; the totals are moved
+        // back toward 0 each time the ring wraps so they only ever hold
+        // about two rings worth and keep their precision
+        std::vector<double> totals_before;
+        double total = 0;
+        // sequence number of the next sample and of the oldest sample that
+        // is still inside the trailing window
+        seq_type next_seq = 0;
+        seq_type window_seq = 0;
+        // monotonic queues of sequence numbers: the front is always the
+        // min or max of the trailing window
+        std::deque<seq_type> min_queue;
+        std::deque<seq_type> max_queue;
+
+        size_t slot(const seq_type& seq_in) const { return seq_in % capacity; }
+        seq_type oldest_seq() const { return next_seq - size(); }
+
+        void expire(const timestamp_type& now_in) {
+            auto cutoff = now_in - window;
+
+            if (window_seq < oldest_seq()) window_seq = oldest_seq();
+            while(window_seq < next_seq && timestamps[slot(window_seq)] < cutoff) {
+                window_seq++;
+            }
+
+            while(! min_queue.empty() && min_queue.front() < window_seq) min_queue.pop_front();
+            while(! max_queue.empty() && max_queue.front() < window_seq) max_queue.pop_front();
+        }
+
+        seq_type find_seq(const timestamp_type& since_in) const {
+            seq_type low = oldest_seq(), high = next_seq;
+
+            while(low < high) {
+                auto middle = low + (high - low) / 2;
+                if (timestamps[slot(middle)] < since_in) {
+                    low = middle + 1;
+                } else {
+                    high = middle;
+                }
+            }
+
+            return low;
+        }
+
+        // every span is a difference of two totals so taking the same
+        // amount off all of them changes nothing
+        void rebase(const double& base_in) {
+            for(auto& i : totals_before) i -= base_in;
+            total -= base_in;
+        }
+
+        double sum_from(const seq_type& seq_in) const {
+            if (seq_in == next_seq) return 0;
+            return total - totals_before[slot(seq_in)];
+        }
+
+        stats_type scan(const seq_type& first_in) const {
+            stats_type result;
+
+            if (first_in == next_seq) return result;
+
+            result.count = next_seq - first_in;
+            result.min = result.max = values[slot(first_in)];
+            for(auto i = first_in + 1; i < next_seq; i++) {
+                const auto& value = values[slot(i)];
+                if (value < result.min) result.min = value;
+                if (result.max < value) result.max = value;
+            }
+            result.mean = sum_from(first_in) / result.count;
+
+            return result;
+        }
+
+    public:
+        value_history(const size_t& capacity_in, const duration_type& window_in)
+        : capacity(capacity_in), window(window_in),
+          timestamps(capacity_in), values(capacity_in), totals_before(capacity_in) {
+            assert(capacity > 0);
+        }
+
+        size_t size() const { return std::min<seq_type>(next_seq, capacity); }
+        size_t get_capacity() const { return capacity; }
+        duration_type get_window() const { return window; }
+
+        // samples must be pushed in timestamp order
+        void push(const timestamp_type& when_in, const T& value_in) {
+            assert(next_seq == 0 || ! (when_in < timestamps[slot(next_seq - 1)]));
+
+            auto seq = next_seq++;
+            auto i = slot(seq);
+
+            // the sample about to be overwritten becomes the new zero
+            if (i == 0 && seq >= capacity) rebase(totals_before[i]);
+
+            timestamps[i] = when_in;
+            values[i] = value_in;
+            totals_before[i] = total;
+            if constexpr (std::is_arithmetic<T>::value) total += static_cast<double>(value_in);
+
+            while(! min_queue.empty() && value_in < values[slot(min_queue.back())]) min_queue.pop_back();
+            min_queue.push_back(seq);
+            while(! max_queue.empty() && values[slot(max_queue.back())] < value_in) max_queue.pop_back();
+            max_queue.push_back(seq);
+
+            expire(when_in);
+        }
+
+        // statistics over the trailing window ending at now_in; amortized O(1)
+        stats_type stats(const timestamp_type& now_in = clock_type::now()) {
+            stats_type result;
+
+            expire(now_in);
+            if (window_seq == next_seq) return result;
+
+            result.count = next_seq - window_seq;
+            result.min = values[slot(min_queue.front())];
+            result.max = values[slot(max_queue.front())];
+            result.mean = sum_from(window_seq) / result.count;
+
+            return result;
+        }
+
+        // statistics over every retained sample at or after since_in such as
+        // the start of a transmission; the mean is O(log n) and the min and
+        // max are a scan of the value array
+        stats_type stats_since(const timestamp_type& since_in) const {
+            return scan(find_seq(since_in));
+        }
+
+        double mean_since(const timestamp_type& since_in) const {
+            auto first = find_seq(since_in);
+            if (first == next_seq) return 0;
+            return sum_from(first) / (next_seq - first);
+        }
+
+        // fraction_in is from 0 to 1; selecting an order statistic has no
+        // incremental form so this is linear in the number of samples
+        T percentile(const double& fraction_in, const timestamp_type& since_in) const {
+            auto first = find_seq(since_in);
+            if (first == next_seq) return T{};
+
+            std::vector<T> scratch;
+            scratch.reserve(next_seq - first);
+            for(auto i = first; i < next_seq; i++) {
+                scratch.push_back(values[slot(i)]);
+            }
+
+            auto clamped = std::min(std::max(fraction_in, 0.0), 1.0);
+            auto nth = scratch.begin() + static_cast<size_t>(clamped * (scratch.size() - 1));
+            std::nth_element(scratch.begin(), nth, scratch.end());
+            return *nth;
+        }
+
+        T percentile(const double& fraction_in) {
+            auto now = clock_type::now();
+            return percentile(fraction_in, now - window);
+        }
+};
+
+}
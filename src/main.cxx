@@ -23,24 +23,39 @@
 
 #include "hamlib.h"
 #include "logging.h"
+#include "manager.h"
 #include "object.h"
 #include "radio.h"
-#include "runloop.h"
+#include "station.h"
 #include "system.h"
 #include "thread.h"
+#include "turboini.h"
 
 using std::make_shared;
 
 void run() {
-    auto loop = std::make_shared<oemros::runloop>();
-    oemros::hamlib_radio radio(loop, 1);
+    auto rigs = std::make_shared<oemros::rig_manager>();
+    auto radio = rigs->add({ "dummy", 1, "", 0 });
 
-    radio.open();
-    radio.update();
+    auto frequency_log = radio->vfo.tuner.subscribe([](const oemros::value_source<oemros::frequency>& tuner_in) {
+        log_info("Frequency: ", tuner_in.get());
+    });
 
-    loop->enter();
+    rigs->start();
+    rigs->join();
+}
+
+void run_config(const std::string& path_in) {
+    oemros::turboini_document document(path_in);
+    auto config = oemros::load_station_config(document);
+    auto loop = make_shared<oemros::runloop>();
+    auto station = loop->make_item<oemros::station>(config);
 
-    log_info("Frequency: ", radio.vfo.tuner);
+    log_info("Read ", config.transceivers.size(), " transceivers and ", config.repeaters.size(), " repeaters from ", path_in);
+
+    loop->post([station] { station->start(); });
+    loop->enter();
+    station->join();
 }
 
 void bootstrap() {
@@ -53,13 +68,18 @@ void bootstrap() {
     oemros::hamlib_bootstrap();
 }
 
-int main() {
+// the config file is the only argument; without one a dummy rig is run
+int main(int argc, char** argv) {
     bootstrap();
 
     log_debug("Starting OEMROS");
 
     try {
-        run();
+        if (argc > 1) {
+            run_config(argv[1]);
+        } else {
+            run();
+        }
     } catch (oemros::exception& e) {
         log_error("OEMROS faulted: ", e.what());
     }
@@ -0,0 +1,204 @@
+/*
+ * manager.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+
+#include "logging.h"
+#include "manager.h"
+#include "system.h"
+
+namespace oemros {
+
+#define RIG_CHECK_MSEC 1000
+// a rig that has not finished a command in this long is not responsive
+#define RIG_STALE_MSEC 5000
+#define RIG_BACKOFF_MIN_MSEC 1000
+#define RIG_BACKOFF_MAX_MSEC 60000
+
+rig_supervisor::rig_supervisor(std::shared_ptr<runloop> loop_in, const rig_config& config_in)
+: runloop_item(loop_in), config(config_in), backoff(RIG_BACKOFF_MIN_MSEC) {
+    radio = std::make_shared<hamlib_radio>(loop_in, config.model, config.port, config.speed);
+    health.name = config.name;
+}
+
+void rig_supervisor::arm(const clock_type::duration& wait_in, void (rig_supervisor::*next_in)()) {
+    std::weak_ptr<baseobj> weak_us = shared_from_this();
+    timer.expires_after(wait_in);
+    timer.async_wait([this, weak_us, next_in](const boost::system::error_code& error_in) {
+        auto strong_us = weak_us.lock();
+        if (! strong_us) return;
+        if (error_in == boost::asio::error::operation_aborted) return;
+        if (error_in) system_fault("rig supervisor timer failed: ", error_in.message());
+        if (running) (this->*next_in)();
+    });
+}
+
+// blocks this rig's runloop until the open finishes which is fine because
+// nothing else runs on it until the rig is open
+void rig_supervisor::try_open() {
+    {
+        std::lock_guard<std::mutex> lock(health_mutex);
+        health.open_attempts++;
+    }
+
+    log_info("opening rig ", config.name);
+
+    if (! radio->open()) {
+        {
+            std::lock_guard<std::mutex> lock(health_mutex);
+            health.open_failures++;
+        }
+
+        log_error("could not open rig ", config.name, "; trying again in ", backoff.count(), " ms");
+        arm(backoff, &rig_supervisor::try_open);
+        backoff = std::min(backoff * 2, std::chrono::milliseconds(RIG_BACKOFF_MAX_MSEC));
+        return;
+    }
+
+    backoff = std::chrono::milliseconds(RIG_BACKOFF_MIN_MSEC);
+    poller = get_loop()->make_started<radio_poller>(radio);
+    last_check = clock_type::now();
+
+    {
+        std::lock_guard<std::mutex> lock(health_mutex);
+        health.open = true;
+    }
+
+    log_info("rig ", config.name, " is open");
+    arm(std::chrono::milliseconds(RIG_CHECK_MSEC), &rig_supervisor::check);
+}
+
+void rig_supervisor::check() {
+    auto now = clock_type::now();
+    auto actor = radio->get_actor();
+    auto stats = actor->get_stats();
+    auto operations = actor->get_operation_stats();
+    auto elapsed = std::chrono::duration<double>(now - last_check).count();
+    auto responsive = stats.completed > 0 && now - stats.last_ok < std::chrono::milliseconds(RIG_STALE_MSEC);
+    bool was_responsive;
+
+    {
+        std::lock_guard<std::mutex> lock(health_mutex);
+        was_responsive = health.responsive;
+        health.responsive = responsive;
+        health.commands = stats;
+        health.timeout = actor->get_timeout();
+        health.operations = std::move(operations);
+        health.command_rate = elapsed > 0 ? (stats.completed - last_completed) / elapsed : 0;
+        health.poll_scale = poller->get_scale();
+    }
+
+    if (was_responsive && ! responsive) {
+        log_error("rig ", config.name, " stopped responding");
+    } else if (! was_responsive && responsive) {
+        log_verbose("rig ", config.name, " is responding");
+    }
+
+    last_completed = stats.completed;
+    last_check = now;
+    arm(std::chrono::milliseconds(RIG_CHECK_MSEC), &rig_supervisor::check);
+}
+
+rig_health rig_supervisor::get_health() {
+    std::lock_guard<std::mutex> lock(health_mutex);
+    return health;
+}
+
+void rig_supervisor::stop() {
+    running = false;
+    timer.cancel();
+    if (poller != nullptr) poller->stop();
+}
+
+void rig_supervisor::start__child() {
+    running = true;
+    try_open();
+}
+
+rig_manager::~rig_manager() {
+    stop();
+    join();
+}
+
+std::shared_ptr<hamlib_radio> rig_manager::add(const rig_config& config_in) {
+    if (started) system_fault("can not add rig ", config_in.name, " after the rig manager started");
+    if (get_radio(config_in.name) != nullptr) system_fault("duplicate rig name: ", config_in.name);
+
+    rig_type rig;
+    rig.name = config_in.name;
+    rig.loop = std::make_shared<runloop>();
+    rig.supervisor = rig.loop->make_item<rig_supervisor>(config_in);
+    rigs.push_back(std::move(rig));
+
+    return rigs.back().supervisor->get_radio();
+}
+
+std::shared_ptr<hamlib_radio> rig_manager::get_radio(const std::string& name_in) {
+    for(auto&& i : rigs) {
+        if (i.name == name_in) return i.supervisor->get_radio();
+    }
+
+    return nullptr;
+}
+
+std::vector<rig_health> rig_manager::get_health() {
+    std::vector<rig_health> result;
+
+    result.reserve(rigs.size());
+    for(auto&& i : rigs) result.push_back(i.supervisor->get_health());
+
+    return result;
+}
+
+void rig_manager::start() {
+    if (started) system_fault("rig manager was already started");
+    started = true;
+
+    for(auto&& i : rigs) {
+        auto loop = i.loop;
+        auto supervisor = i.supervisor;
+
+        loop->post([supervisor] { supervisor->start(); });
+        i.thread = boost::thread([loop] { loop->enter(); });
+    }
+}
+
+void rig_manager::stop() {
+    for(auto&& i : rigs) {
+        auto loop = i.loop;
+        auto supervisor = i.supervisor;
+
+        // a rig that is in the middle of opening gets to finish first
+        loop->post([loop, supervisor] {
+            supervisor->stop();
+            loop->stop();
+        });
+    }
+}
+
+void rig_manager::join() {
+    for(auto&& i : rigs) {
+        if (i.thread.joinable()) i.thread.join();
+    }
+}
+
+}
@@ -0,0 +1,120 @@
+/*
+ * manager.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <boost/thread.hpp>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "hamlib.h"
+#include "poller.h"
+#include "runloop.h"
+
+namespace oemros {
+
+struct rig_config {
+    std::string name;
+    hamlib::rig_model_t model = 1;
+    // an empty port or a speed of 0 uses the hamlib defaults
+    std::string port;
+    int speed = 0;
+};
+
+struct rig_health {
+    std::string name;
+    bool open = false;
+    // a command has worked recently
+    bool responsive = false;
+    uint64_t open_attempts = 0;
+    uint64_t open_failures = 0;
+    // rig commands finished per second over the last check
+    double command_rate = 0;
+    double poll_scale = 1;
+    hamlib_actor::stats_type commands;
+    // msec hamlib waits for the rig to answer right now
+    int timeout = 0;
+    std::vector<hamlib_rig::operation_report> operations;
+};
+
+// Lives on the runloop of one rig. Opens the rig, retries with backoff when
+// that fails, starts the poller once it is open and keeps the health of the
+// rig up to date.
+class rig_supervisor : public runloop_item {
+    public:
+        using clock_type = std::chrono::steady_clock;
+
+    private:
+        const rig_config config;
+        std::shared_ptr<hamlib_radio> radio;
+        std::shared_ptr<radio_poller> poller;
+        boost::asio::steady_timer timer{*get_loop_ioptr()};
+        std::chrono::milliseconds backoff;
+        bool running = false;
+        std::mutex health_mutex;
+        rig_health health;
+        uint64_t last_completed = 0;
+        clock_type::time_point last_check;
+
+        void try_open();
+        void check();
+        void arm(const clock_type::duration& wait_in, void (rig_supervisor::*next_in)());
+
+    public:
+        rig_supervisor(std::shared_ptr<runloop> loop_in, const rig_config& config_in);
+        std::shared_ptr<hamlib_radio> get_radio() { return radio; }
+        // safe to call from any thread
+        rig_health get_health();
+        void stop();
+        virtual void start__child() override;
+};
+
+// Every rig gets its own runloop on its own thread so a slow or dead rig can
+// only ever hold up itself. All of them are opened at the same time.
+class rig_manager : public baseobj {
+    private:
+        struct rig_type {
+            std::string name;
+            std::shared_ptr<runloop> loop;
+            std::shared_ptr<rig_supervisor> supervisor;
+            boost::thread thread;
+        };
+
+        std::vector<rig_type> rigs;
+        bool started = false;
+
+    public:
+        ~rig_manager();
+        // rigs can only be added before start()
+        std::shared_ptr<hamlib_radio> add(const rig_config& config_in);
+        std::shared_ptr<hamlib_radio> get_radio(const std::string& name_in);
+        std::vector<rig_health> get_health();
+        size_t size() const { return rigs.size(); }
+        void start();
+        void stop();
+        // returns once every rig thread has exited
+        void join();
+};
+
+}
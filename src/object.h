@@ -22,15 +22,22 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <cassert>
 #include <chrono>
+#include <cstring>
+#include <deque>
 #include <functional>
-#include <list>
 #include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
-namespace oemros {
+#include "history.h"
 
-uint32_t get_next_subscription_num();
+namespace oemros {
 
 struct baseobj : public std::enable_shared_from_this<baseobj> {
     baseobj& operator=(const baseobj&) = delete;
@@ -40,44 +47,400 @@ struct baseobj : public std::enable_shared_from_this<baseobj> {
     virtual ~baseobj() = default;
 };
 
+// Holds deliveries for a subscriber that runs on some other executor. At most
+// capacity deliveries wait at once; when full the oldest is thrown away so
+// the subscriber always catches up to the latest value. Only one drain is
+// ever posted to the executor at a time.
 template <typename... Args>
-class event_source : public baseobj {
+class event_mailbox : public baseobj {
     public:
         using sink_type = std::function<void (Args...)>;
-        struct subscription {
-            const uint32_t number = get_next_subscription_num();
-            const bool repeat;
-            const sink_type cb;
-            subscription(const sink_type& cb_in, const bool& repeat_in = true)
-            : repeat(repeat_in), cb(cb_in) { }
-        };
+        // a copy of every argument so nothing the publisher owns is read
+        // after deliver() returns
+        using tuple_type = std::tuple<typename std::decay<Args>::type...>;
 
     private:
-        std::vector<std::shared_ptr<subscription>> subscribers;
+        std::mutex mutex;
+        std::deque<tuple_type> pending;
+        bool scheduled = false;
+        uint64_t dropped = 0;
+
+    public:
+        const size_t capacity;
+        const sink_type cb;
+        event_mailbox(const size_t& capacity_in, const sink_type& cb_in)
+        : capacity(capacity_in), cb(cb_in) { assert(capacity > 0); }
+
+        // true if the caller needs to post a drain to the executor
+        bool push(Args&... args) {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (pending.size() == capacity) {
+                pending.pop_front();
+                dropped++;
+            }
+            pending.emplace_back(args...);
+
+            if (scheduled) return false;
+            scheduled = true;
+            return true;
+        }
+
+        void drain() {
+            std::deque<tuple_type> ready;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ready.swap(pending);
+                scheduled = false;
+            }
+
+            for(auto&& i : ready) {
+                std::apply(cb, i);
+            }
+        }
+
+        uint64_t get_dropped() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return dropped;
+        }
+
+        // a sink that queues into mailbox_in and posts a drain to target_in
+        template <class Executor>
+        static sink_type forward_to(const std::shared_ptr<event_mailbox>& mailbox_in, const std::shared_ptr<Executor>& target_in) {
+            std::weak_ptr<Executor> weak_target = target_in;
+
+            return [mailbox_in, weak_target](Args... args) {
+                if (! mailbox_in->push(args...)) return;
+
+                auto target = weak_target.lock();
+                if (target) target->post([mailbox_in] { mailbox_in->drain(); });
+            };
+        }
+};
+
+// Subscribers of one event_source live in slots that are reused after an
+// unsubscribe. A slot's generation changes every time it is freed so a stale
+// subscription can never remove whoever got the slot next. The table is
+// shared with the subscriptions so they can safely outlive the source.
+template <typename... Args>
+class subscriber_slots : public baseobj {
+    public:
+        using sink_type = std::function<void (Args...)>;
+        using index_type = uint32_t;
+        using generation_type = uint32_t;
+
+    private:
+        struct slot {
+            sink_type cb;
+            generation_type generation = 0;
+            // where this slot is in the live list
+            index_type live_pos = 0;
+            bool repeat = true;
+            bool active = false;
+        };
+
+        // never held while a callback runs so a callback can take its own
+        // locks and subscribe or unsubscribe without deadlocking
+        std::mutex mutex;
+        // a deque so a callback that is running does not move when a new
+        // subscriber is added
+        std::deque<slot> slots;
+        std::vector<index_type> free_list;
+        // dense list of active slots walked by deliver(); removing one moves
+        // the last one into its place so this is not subscription order
+        std::vector<index_type> live;
+        // slots removed while any delivery is running are freed once the
+        // last one finishes so live does not change under a delivery and a
+        // callback being run is never cleared
+        std::vector<index_type> doomed;
+        unsigned int delivering = 0;
+
+        // counts a delivery for as long as it runs, even one a callback
+        // throws out of, and frees the doomed slots when the last one ends
+        class delivery_guard {
+            private:
+                subscriber_slots& owner;
+                std::unique_lock<std::mutex>& lock;
+
+            public:
+                delivery_guard(subscriber_slots& owner_in, std::unique_lock<std::mutex>& lock_in)
+                : owner(owner_in), lock(lock_in) {
+                    owner.delivering++;
+                }
+                delivery_guard(const delivery_guard&) = delete;
+                delivery_guard& operator=(const delivery_guard&) = delete;
+                ~delivery_guard() {
+                    if (! lock.owns_lock()) lock.lock();
+                    owner.delivering--;
+
+                    if (owner.delivering) return;
+                    for(auto&& i : owner.doomed) owner.free_slot(i);
+                    owner.doomed.clear();
+                }
+        };
+
+        void free_slot(const index_type& index_in) {
+            auto& target = slots[index_in];
+            auto last = live.back();
+
+            live[target.live_pos] = last;
+            slots[last].live_pos = target.live_pos;
+            live.pop_back();
+
+            target.cb = nullptr;
+            target.generation++;
+            free_list.push_back(index_in);
+        }
 
     public:
-        std::shared_ptr<subscription> subscribe(const sink_type& handler_in, const bool& repeat_in = true) {
-            auto ticket = std::make_shared<subscription>(handler_in, repeat_in);
-            subscribers.push_back(ticket);
-            return ticket;
+        std::pair<index_type, generation_type> add(const sink_type& cb_in, const bool& repeat_in) {
+            std::lock_guard<std::mutex> lock(mutex);
+            index_type index;
+
+            if (free_list.empty()) {
+                index = slots.size();
+                slots.emplace_back();
+            } else {
+                index = free_list.back();
+                free_list.pop_back();
+            }
+
+            auto& target = slots[index];
+            target.cb = cb_in;
+            target.repeat = repeat_in;
+            target.active = true;
+            target.live_pos = live.size();
+            live.push_back(index);
+
+            return std::make_pair(index, target.generation);
+        }
+
+        void remove(const index_type& index_in, const generation_type& generation_in) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto& target = slots[index_in];
+
+            if (target.generation != generation_in || ! target.active) return;
+            target.active = false;
+
+            if (delivering) {
+                doomed.push_back(index_in);
+            } else {
+                free_slot(index_in);
+            }
+        }
+
+        bool is_active(const index_type& index_in, const generation_type& generation_in) {
+            std::lock_guard<std::mutex> lock(mutex);
+            const auto& target = slots[index_in];
+            return target.generation == generation_in && target.active;
+        }
+
+        size_t size() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return live.size() - doomed.size();
         }
 
         void deliver(Args&... args) {
-            std::list<std::shared_ptr<subscription>> to_remove;
+            std::unique_lock<std::mutex> lock(mutex);
+
+            // anyone who subscribes during this delivery waits for the next
+            auto count = live.size();
+            delivery_guard guard(*this, lock);
 
-            for(auto&& i : subscribers) {
-                i->cb(args...);
-                if (! i->repeat) {
-                    to_remove.push_back(i);
+            for(size_t i = 0; i < count; i++) {
+                auto index = live[i];
+                auto& target = slots[index];
+
+                if (! target.active) continue;
+                if (! target.repeat) {
+                    target.active = false;
+                    doomed.push_back(index);
                 }
+
+                lock.unlock();
+                target.cb(args...);
+                lock.lock();
             }
+        }
+};
+
+// Returned by subscribe(); the subscriber is removed when this goes away.
+// Call release() to keep the subscriber for the life of the source.
+template <typename... Args>
+class event_subscription {
+    using slots_type = subscriber_slots<Args...>;
 
-            for(auto&& i : to_remove) {
-                auto found = std::find(subscribers.begin(), subscribers.end(), i);
-                assert(found != subscribers.end());
-                subscribers.erase(found);
+    private:
+        std::weak_ptr<slots_type> slots;
+        typename slots_type::index_type index = 0;
+        typename slots_type::generation_type generation = 0;
+
+    public:
+        event_subscription() = default;
+        event_subscription(const std::shared_ptr<slots_type>& slots_in, const std::pair<typename slots_type::index_type, typename slots_type::generation_type>& slot_in)
+        : slots(slots_in), index(slot_in.first), generation(slot_in.second) { }
+        event_subscription(const event_subscription&) = delete;
+        event_subscription& operator=(const event_subscription&) = delete;
+        event_subscription(event_subscription&& other_in) noexcept
+        : slots(std::move(other_in.slots)), index(other_in.index), generation(other_in.generation) {
+            other_in.slots.reset();
+        }
+        event_subscription& operator=(event_subscription&& other_in) noexcept {
+            if (this != &other_in) {
+                unsubscribe();
+                slots = std::move(other_in.slots);
+                index = other_in.index;
+                generation = other_in.generation;
+                other_in.slots.reset();
             }
+            return *this;
         }
+        ~event_subscription() { unsubscribe(); }
+
+        void unsubscribe() {
+            auto locked = slots.lock();
+            if (locked) locked->remove(index, generation);
+            slots.reset();
+        }
+        void release() { slots.reset(); }
+        bool is_active() const {
+            auto locked = slots.lock();
+            return locked && locked->is_active(index, generation);
+        }
+};
+
+template <typename... Args>
+class event_source : public baseobj {
+    using slots_type = subscriber_slots<Args...>;
+
+    public:
+        using sink_type = std::function<void (Args...)>;
+        using subscription = event_subscription<Args...>;
+
+    private:
+        std::shared_ptr<slots_type> subscribers = std::make_shared<slots_type>();
+
+    public:
+        subscription subscribe(const sink_type& handler_in, const bool& repeat_in = true) {
+            return subscription(subscribers, subscribers->add(handler_in, repeat_in));
+        }
+
+        // handler_in runs on target_in instead of on the thread that delivers;
+        // the executor only needs a post() that takes a std::function. The
+        // arguments wait in the mailbox as copies so they have to be copyable.
+        template <class Executor>
+        subscription subscribe(const std::shared_ptr<Executor>& target_in, const sink_type& handler_in, const size_t& mailbox_size_in = 1) {
+            static_assert(std::conjunction<std::is_copy_constructible<typename std::decay<Args>::type>...>::value,
+                          "only events with copyable arguments can be delivered on an executor");
+
+            using mailbox_type = event_mailbox<Args...>;
+            auto mailbox = std::make_shared<mailbox_type>(mailbox_size_in, handler_in);
+            return subscribe(mailbox_type::forward_to(mailbox, target_in));
+        }
+
+        size_t size() { return subscribers->size(); }
+        void deliver(Args&... args) { subscribers->deliver(args...); }
+};
+
+// Storage for a value that one thread writes while any number of threads
+// read it. Types the hardware can load and store in one instruction use a
+// plain atomic, other trivially copyable types use a seqlock so readers
+// never block or write to the shared cache line, and everything else falls
+// back to a mutex.
+template <typename T, typename Enable = void>
+class value_cell {
+    private:
+        mutable std::mutex mutex;
+        T value;
+
+    public:
+        value_cell(const T& value_in) : value(value_in) { }
+        T load() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return value;
+        }
+        T exchange(const T& value_in) {
+            std::lock_guard<std::mutex> lock(mutex);
+            T old = value;
+            value = value_in;
+            return old;
+        }
+};
+
+template <typename T>
+struct value_cell_lock_free : std::integral_constant<bool, std::atomic<T>::is_always_lock_free> { };
+
+// std::atomic<T> can only be named once T is known to be trivially copyable
+template <typename T>
+struct value_cell_is_atomic : std::conjunction<std::is_trivially_copyable<T>, value_cell_lock_free<T>> { };
+
+template <typename T>
+class value_cell<T, typename std::enable_if<value_cell_is_atomic<T>::value>::type> {
+    private:
+        std::atomic<T> value;
+
+    public:
+        value_cell(const T& value_in) : value(value_in) { }
+        T load() const { return value.load(std::memory_order_acquire); }
+        T exchange(const T& value_in) { return value.exchange(value_in, std::memory_order_acq_rel); }
+};
+
+template <typename T>
+class value_cell<T, typename std::enable_if<std::is_trivially_copyable<T>::value && ! value_cell_is_atomic<T>::value>::type> {
+    using word_type = uint64_t;
+    static constexpr size_t num_words = (sizeof(T) + sizeof(word_type) - 1) / sizeof(word_type);
+
+    private:
+        // odd while a write is in progress
+        std::atomic<uint32_t> version{0};
+        // the payload is kept in atomic words so a reader racing a writer
+        // is not undefined behavior; the version check throws away the torn copy
+        std::atomic<word_type> words[num_words];
+
+        void store_words(const T& value_in) {
+            word_type buf[num_words] = { };
+            std::memcpy(buf, &value_in, sizeof(T));
+            for(size_t i = 0; i < num_words; i++) words[i].store(buf[i], std::memory_order_relaxed);
+        }
+
+        T load_words() const {
+            word_type buf[num_words];
+            for(size_t i = 0; i < num_words; i++) buf[i] = words[i].load(std::memory_order_relaxed);
+            T result;
+            std::memcpy(&result, buf, sizeof(T));
+            return result;
+        }
+
+    public:
+        value_cell(const T& value_in) { store_words(value_in); }
+        T load() const {
+            uint32_t before, after;
+            T result;
+
+            do {
+                before = version.load(std::memory_order_acquire);
+                result = load_words();
+                std::atomic_thread_fence(std::memory_order_acquire);
+                after = version.load(std::memory_order_relaxed);
+            } while(before != after || before & 1);
+
+            return result;
+        }
+        T exchange(const T& value_in) {
+            // claiming the odd version keeps concurrent writers apart
+            auto current = version.load(std::memory_order_relaxed);
+            do {
+                while(current & 1) current = version.load(std::memory_order_relaxed);
+            } while(! version.compare_exchange_weak(current, current + 1, std::memory_order_acquire, std::memory_order_relaxed));
+
+            T old = load_words();
+            std::atomic_thread_fence(std::memory_order_release);
+            store_words(value_in);
+            version.store(current + 2, std::memory_order_release);
+            return old;
+        }
+
 };
 
 template <typename T>
@@ -88,29 +451,83 @@ class value_source : public baseobj {
     using sink_type = typename source_type::sink_type;
     using subscription_type = typename source_type::subscription;
     using timestamp_type = std::chrono::time_point<std::chrono::system_clock>;
+    using history_type = value_history<T>;
 
     private:
-        value_type value;
+        value_cell<T> value;
         source_type source;
-        timestamp_type last_update;
+        value_cell<timestamp_type> last_update{timestamp_type()};
+        // the ring is only touched with history_mutex held; has_history
+        // lets set() skip the lock for sources nobody charts
+        mutable std::mutex history_mutex;
+        std::unique_ptr<history_type> history;
+        std::atomic<bool> has_history{false};
+        unsigned int held = 0;
+        bool pending = false;
         void deliver() { source.deliver(*this); }
 
     public:
         value_source(const T& value_in) : value(value_in) { }
         value_source& operator=(const T& value_in) { set(value_in); return *this; }
-        operator T() { return get(); }
-        T get() { return value; }
+        // reads are safe from any thread while set() runs on another
+        operator T() const { return get(); }
+        T get() const { return value.load(); }
+        timestamp_type get_last_update() const { return last_update.load(); }
         T set(const T& value_in) {
             auto now = std::chrono::system_clock::now();
-            auto old = value;
-            value = value_in;
-            last_update = now;
-            deliver();
+            auto old = value.exchange(value_in);
+            last_update.exchange(now);
+            if (has_history.load(std::memory_order_acquire)) {
+                std::lock_guard<std::mutex> lock(history_mutex);
+                history->push(history_type::clock_type::now(), value_in);
+            }
+            if (held) {
+                pending = true;
+            } else {
+                deliver();
+            }
             return old;
         }
-        template <typename... Args>
-        std::shared_ptr<subscription_type> subscribe(const Args&&... args) {
-            return source.subscribe(args...);
+        // while held set() stores the value but delivery waits for the
+        // last release() which delivers once if anything was set
+        void hold() { held++; }
+        bool has_pending() const { return pending; }
+        bool release() {
+            assert(held > 0);
+            if (--held > 0 || ! pending) return false;
+            pending = false;
+            deliver();
+            return true;
+        }
+        subscription_type subscribe(const sink_type& handler_in, const bool& repeat_in = true) {
+            return source.subscribe(handler_in, repeat_in);
+        }
+        // handler_in runs on target_in with the value as it was when it was
+        // delivered; the source itself is never handed to another thread
+        template <class Executor>
+        subscription_type subscribe(const std::shared_ptr<Executor>& target_in, const std::function<void (const T&)>& handler_in,
+                                    const size_t& mailbox_size_in = 1) {
+            using mailbox_type = event_mailbox<const T&>;
+            auto mailbox = std::make_shared<mailbox_type>(mailbox_size_in, handler_in);
+            auto forward = mailbox_type::forward_to(mailbox, target_in);
+
+            return source.subscribe([forward](const value_source<T>& source_in) { forward(source_in.get()); });
+        }
+        // history is off unless asked for so sources nobody charts do not
+        // pay for the ring
+        void enable_history(const size_t& capacity_in, const typename history_type::duration_type& window_in) {
+            std::lock_guard<std::mutex> lock(history_mutex);
+            history = std::make_unique<history_type>(capacity_in, window_in);
+            has_history.store(true, std::memory_order_release);
+        }
+        // read_in gets the history with set() locked out so it can run on
+        // any thread; false if history was never enabled
+        template <typename Func>
+        bool read_history(Func&& read_in) {
+            std::lock_guard<std::mutex> lock(history_mutex);
+            if (! history) return false;
+            read_in(*history);
+            return true;
         }
 };
 
@@ -0,0 +1,225 @@
+/*
+ * poller.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+
+#include "logging.h"
+#include "poller.h"
+#include "system.h"
+
+namespace oemros {
+
+// how much of each new round trip sample goes into the smoothed value
+#define POLLER_RTT_WEIGHT 0.2
+// how long to sleep when every field is turned off
+#define POLLER_IDLE_MSEC 1000
+
+radio_poller::radio_poller(std::shared_ptr<runloop> loop_in, std::shared_ptr<radio> radio_in)
+: runloop_item(loop_in), target(radio_in) {
+    assert(target != nullptr);
+
+    // meters only mean something while transmitting
+    fields.emplace_back(update_type::alc, rate_type{0, 20});
+    fields.emplace_back(update_type::power, rate_type{0, 20});
+    fields.emplace_back(update_type::swr, rate_type{0, 20});
+    fields.emplace_back(update_type::tuner, rate_type{2, 2});
+    fields.emplace_back(update_type::ptt, rate_type{5, 5});
+}
+
+radio_poller::field_type& radio_poller::get_field(const update_type& field_in) {
+    for(auto&& i : fields) {
+        if (i.field == field_in) return i;
+    }
+
+    system_fault("radio_poller has no such field: ", (radio::mask_type)field_in);
+}
+
+double radio_poller::wanted_hz(const field_type& field_in, const clock_type::time_point& now_in) const {
+    if (! (target->get_supported() & (radio::mask_type)field_in.field)) return 0;
+
+    auto hz = target->ptt.get() ? field_in.rate.tx_hz : field_in.rate.rx_hz;
+    if (now_in < field_in.boost_until) hz = std::max(hz, field_in.boost_hz);
+    return hz;
+}
+
+double radio_poller::effective_hz(const field_type& field_in, const clock_type::time_point& now_in) const {
+    return wanted_hz(field_in, now_in) * scale;
+}
+
+// if polling every field at the wanted rate would keep the link busier
+// than the budget then every rate is scaled down by the same amount
+void radio_poller::rebalance(const clock_type::time_point& now_in) {
+    double demand = 0;
+
+    for(auto&& i : fields) {
+        demand += wanted_hz(i, now_in) * i.rtt_seconds;
+    }
+
+    auto old_scale = scale;
+    scale = demand > link_budget ? link_budget / demand : 1;
+
+    if (old_scale >= 1 && scale < 1) {
+        log_verbose("radio poller is saturating the link; scaling rates by ", scale);
+    } else if (old_scale < 1 && scale >= 1) {
+        log_verbose("radio poller is no longer saturating the link");
+    }
+}
+
+void radio_poller::reschedule(field_type& field_in, const clock_type::time_point& now_in) {
+    auto hz = effective_hz(field_in, now_in);
+
+    if (hz <= 0) {
+        field_in.next_due = clock_type::time_point::max();
+        return;
+    }
+
+    auto period = std::chrono::duration<double>(1 / hz);
+    field_in.next_due = now_in + std::chrono::duration_cast<clock_type::duration>(period);
+}
+
+void radio_poller::arm() {
+    if (! running) return;
+
+    auto now = clock_type::now();
+    auto due = now + std::chrono::milliseconds(POLLER_IDLE_MSEC);
+
+    for(auto&& i : fields) {
+        // a field that was off and has been turned on is due right away
+        if (i.next_due == clock_type::time_point::max() && effective_hz(i, now) > 0) {
+            i.next_due = now;
+        }
+
+        due = std::min(due, i.next_due);
+    }
+
+    std::weak_ptr<baseobj> weak_us = shared_from_this();
+    timer.expires_at(due);
+    timer.async_wait([this, weak_us](const boost::system::error_code& error_in) {
+        auto strong_us = weak_us.lock();
+        if (strong_us) handler(error_in);
+    });
+}
+
+void radio_poller::handler(const boost::system::error_code& error_in) {
+    if (error_in == boost::asio::error::operation_aborted) return;
+    if (error_in) system_fault("radio poller timer failed: ", error_in.message());
+    if (! running) return;
+
+    auto now = clock_type::now();
+    field_type* next = nullptr;
+
+    for(auto&& i : fields) {
+        if (effective_hz(i, now) <= 0) continue;
+        if (next == nullptr || i.next_due < next->next_due) next = &i;
+    }
+
+    // only one field is polled per wakeup so a slow link can not make the
+    // poller fall further and further behind
+    if (next != nullptr && next->next_due <= now) {
+        target->poll((radio::mask_type)next->field);
+
+        auto done = clock_type::now();
+        rebalance(done);
+        reschedule(*next, done);
+    }
+
+    arm();
+}
+
+// the answer to a read may come long after poll() returned so the time
+// poll() took says nothing about the link
+void radio_poller::answered(const radio::round_trip_type& round_trip_in) {
+    field_type* found = nullptr;
+
+    for(auto&& i : fields) {
+        if ((radio::mask_type)i.field == round_trip_in.field) found = &i;
+    }
+
+    if (found == nullptr) return;
+
+    auto sample = std::chrono::duration<double>(round_trip_in.took).count();
+
+    if (found->answers++ == 0) {
+        found->rtt_seconds = sample;
+    } else {
+        found->rtt_seconds += (sample - found->rtt_seconds) * POLLER_RTT_WEIGHT;
+    }
+}
+
+void radio_poller::set_rate(const update_type& field_in, const rate_type& rate_in) {
+    auto& field = get_field(field_in);
+    field.rate = rate_in;
+    field.next_due = clock_type::now();
+    arm();
+}
+
+void radio_poller::boost(const update_type& field_in, const double& hz_in, const clock_type::duration& for_in) {
+    auto& field = get_field(field_in);
+    auto now = clock_type::now();
+
+    field.boost_hz = hz_in;
+    field.boost_until = now + for_in;
+    field.next_due = std::min(field.next_due, now);
+    arm();
+}
+
+double radio_poller::get_rtt(const update_type& field_in) {
+    return get_field(field_in).rtt_seconds;
+}
+
+void radio_poller::stop() {
+    running = false;
+    timer.cancel();
+}
+
+void radio_poller::start__child() {
+    running = true;
+    last_tuner = target->vfo.tuner;
+    last_ptt = target->ptt;
+
+    tuner_watch = target->vfo.tuner.subscribe([this](const value_source<frequency>& tuner_in) {
+        auto tuner = tuner_in.get();
+        if (tuner == last_tuner) return;
+        last_tuner = tuner;
+        boost(update_type::tuner, retune_boost_hz, retune_boost_for);
+    });
+
+    // the next rebalance picks up the new round trip
+    round_trip_watch = target->round_trips.subscribe([this](const radio::round_trip_type& round_trip_in) {
+        answered(round_trip_in);
+    });
+
+    // going in or out of transmit changes which rates apply
+    ptt_watch = target->ptt.subscribe([this](const value_source<bool>& ptt_in) {
+        auto ptt = ptt_in.get();
+        if (ptt == last_ptt) return;
+        last_ptt = ptt;
+
+        auto now = clock_type::now();
+        for(auto&& i : fields) reschedule(i, now);
+        arm();
+    });
+
+    arm();
+}
+
+}
@@ -0,0 +1,99 @@
+/*
+ * poller.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "radio.h"
+#include "runloop.h"
+
+namespace oemros {
+
+// Polls each field of a radio at its own rate. Rates depend on whether the
+// radio is transmitting, can be boosted for a while after a retune, and are
+// scaled down together when the round trip times the radio reports say the
+// link would be busier than link_budget allows. The radio has to report
+// round trips on the runloop of the poller.
+class radio_poller : public runloop_item {
+    public:
+        using clock_type = std::chrono::steady_clock;
+        // radio::update also names a member function
+        using update_type = enum radio::update;
+
+        struct rate_type {
+            double rx_hz = 0;
+            double tx_hz = 0;
+        };
+
+    private:
+        struct field_type {
+            update_type field;
+            rate_type rate;
+            double boost_hz = 0;
+            clock_type::time_point boost_until;
+            clock_type::time_point next_due;
+            // smoothed time from a read of this field going out to its answer
+            double rtt_seconds = 0;
+            uint64_t answers = 0;
+            field_type(const update_type& field_in, const rate_type& rate_in)
+            : field(field_in), rate(rate_in) { }
+        };
+
+        std::shared_ptr<radio> target;
+        boost::asio::steady_timer timer{*get_loop_ioptr()};
+        std::vector<field_type> fields;
+        event_source<const value_source<frequency>&>::subscription tuner_watch;
+        event_source<const value_source<bool>&>::subscription ptt_watch;
+        event_source<const radio::round_trip_type&>::subscription round_trip_watch;
+        frequency last_tuner = 0;
+        bool last_ptt = false;
+        double scale = 1;
+        bool running = false;
+
+        field_type& get_field(const update_type& field_in);
+        double wanted_hz(const field_type& field_in, const clock_type::time_point& now_in) const;
+        double effective_hz(const field_type& field_in, const clock_type::time_point& now_in) const;
+        void rebalance(const clock_type::time_point& now_in);
+        void reschedule(field_type& field_in, const clock_type::time_point& now_in);
+        void arm();
+        void answered(const radio::round_trip_type& round_trip_in);
+        void handler(const boost::system::error_code& error_in);
+
+    public:
+        // fraction of wall time the link may spend on polls
+        double link_budget = 0.8;
+        // used when a retune is seen
+        double retune_boost_hz = 10;
+        std::chrono::milliseconds retune_boost_for{2000};
+
+        radio_poller(std::shared_ptr<runloop> loop_in, std::shared_ptr<radio> radio_in);
+        void set_rate(const update_type& field_in, const rate_type& rate_in);
+        void boost(const update_type& field_in, const double& hz_in, const clock_type::duration& for_in);
+        double get_rtt(const update_type& field_in);
+        double get_scale() const { return scale; }
+        void stop();
+        virtual void start__child() override;
+};
+
+}
@@ -19,15 +19,145 @@
  *
  */
 
+#include <cassert>
+
+#include "logging.h"
 #include "radio.h"
+#include "system.h"
 
 namespace oemros {
 
+radio::radio(std::shared_ptr<runloop> loop_in) : loop(loop_in) {
+    set_poll_plan(~ (mask_type)0);
+}
+
+radio::batch::batch(radio& target_in) : target(target_in) {
+    target.begin_batch();
+}
+
+radio::batch::~batch() {
+    target.commit_batch();
+}
+
+// the batch commits from a destructor that may be running because of
+// another exception so a subscriber that throws can not be let out
+template <typename Func>
+static void radio_deliver(const char* what_in, Func&& deliver_in) {
+    try {
+        deliver_in();
+    } catch (std::exception& e) {
+        log_error("subscriber to ", what_in, " threw: ", e.what());
+    } catch (...) {
+        log_error("subscriber to ", what_in, " threw something that is not an exception");
+    }
+}
+
+void radio::begin_batch() {
+    if (batch_depth++ > 0) return;
+
+    ptt.hold();
+    vfo.tuner.hold();
+    meters.power.hold();
+    meters.swr.hold();
+    meters.alc.hold();
+}
+
+void radio::commit_batch() {
+    assert(batch_depth > 0);
+    if (--batch_depth > 0) return;
+
+    auto previous = get_state();
+    auto next = std::make_shared<state_type>();
+
+    next->sequence = previous->sequence + 1;
+    next->when = std::chrono::steady_clock::now();
+    next->tuner = vfo.tuner;
+    next->ptt = ptt;
+    next->power = meters.power;
+    next->swr = meters.swr;
+    next->alc = meters.alc;
+
+    if (ptt.has_pending()) next->changed |= (mask_type)radio::update::ptt;
+    if (vfo.tuner.has_pending()) next->changed |= (mask_type)radio::update::tuner;
+    if (meters.power.has_pending()) next->changed |= (mask_type)radio::update::power;
+    if (meters.swr.has_pending()) next->changed |= (mask_type)radio::update::swr;
+    if (meters.alc.has_pending()) next->changed |= (mask_type)radio::update::alc;
+
+    // the snapshot is visible before any subscriber runs so each of them
+    // sees every field from this batch
+    std::shared_ptr<const state_type> published = next;
+    if (published->changed) std::atomic_store(&state, published);
+
+    radio_deliver("ptt", [this] { ptt.release(); });
+    radio_deliver("tuner", [this] { vfo.tuner.release(); });
+    radio_deliver("power", [this] { meters.power.release(); });
+    radio_deliver("swr", [this] { meters.swr.release(); });
+    radio_deliver("alc", [this] { meters.alc.release(); });
+
+    if (published->changed) radio_deliver("changes", [this, &published] { changes.deliver(*published); });
+}
+
+void radio::set_frequency(const frequency& freq_in, const set_done<frequency>& done_in) {
+    if (done_in) done_in(false, freq_in);
+}
+
+void radio::set_ptt(const bool& ptt_in, const set_done<bool>& done_in) {
+    if (done_in) done_in(false, ptt_in);
+}
+
+void radio::set_mode(const mode& mode_in, const set_done<mode>& done_in) {
+    if (done_in) done_in(false, mode_in);
+}
+
+void radio::set_level(UNUSED const level& level_in, const float& value_in, const set_done<float>& done_in) {
+    if (done_in) done_in(false, value_in);
+}
+
+void radio::read_strength(const read_done<int>& done_in) {
+    if (done_in) done_in(false, 0);
+}
+
+std::shared_ptr<const radio::state_type> radio::get_state() const {
+    return std::atomic_load(&state);
+}
+
 void radio::update() {
-    if (~ update_mask & (mask_type)radio::update::alc) update__alc();
-    if (~ update_mask & (mask_type)radio::update::power) update__power();
-    if (~ update_mask & (mask_type)radio::update::swr) update__swr();
-    if (~ update_mask & (mask_type)radio::update::tuner) update__tuner();
+    poll(~ (mask_type)0);
+}
+
+void radio::set_poll_plan(const mask_type& supported_in) {
+    static const poll_entry all[] = {
+        { (mask_type)radio::update::alc, &radio::update__alc },
+        { (mask_type)radio::update::power, &radio::update__power },
+        { (mask_type)radio::update::swr, &radio::update__swr },
+        { (mask_type)radio::update::tuner, &radio::update__tuner },
+        { (mask_type)radio::update::ptt, &radio::update__ptt },
+    };
+
+    poll_plan.clear();
+    supported = 0;
+
+    for(auto&& i : all) {
+        if (! (supported_in & i.field)) continue;
+        poll_plan.push_back(i);
+        supported |= i.field;
+    }
+}
+
+void radio::report_round_trip(const enum update& field_in, const std::chrono::steady_clock::duration& took_in) {
+    round_trip_type round_trip;
+    round_trip.field = (mask_type)field_in;
+    round_trip.took = took_in;
+    radio_deliver("round_trips", [&] { round_trips.deliver(round_trip); });
+}
+
+void radio::poll(const mask_type& fields_in) {
+    batch scope(*this);
+    auto wanted = fields_in & ~ update_mask;
+
+    for(auto&& i : poll_plan) {
+        if (wanted & i.field) (this->*i.getter)();
+    }
 }
 
 }
@@ -21,7 +21,11 @@
 
 #pragma once
 
+#include <chrono>
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
 
 #include "object.h"
 #include "runloop.h"
@@ -39,14 +43,94 @@ class radio : public baseobj {
             power = 1 << 1,
             swr = 1 << 2,
             tuner = 1 << 3,
+            ptt = 1 << 4,
         };
 
+        enum class mode {
+            unknown,
+            am,
+            cw,
+            usb,
+            lsb,
+            fm,
+        };
+
+        enum class level {
+            rf_power,
+            af_gain,
+        };
+
+        // called once the write finished with the value the radio ended up
+        // with; that may be a newer value than the one asked for
+        template <typename T>
+        using set_done = std::function<void (bool ok_in, const T& applied_in)>;
+        template <typename T>
+        using read_done = std::function<void (bool ok_in, const T& value_in)>;
+
+        // an immutable copy of every field taken when a batch commits;
+        // changed has the update bit set for each field written in the batch
+        struct state_type {
+            uint64_t sequence = 0;
+            std::chrono::steady_clock::time_point when;
+            mask_type changed = 0;
+            frequency tuner = 0;
+            bool ptt = false;
+            float power = 0;
+            float swr = 0;
+            float alc = 0;
+        };
+
+        // how long one read of a field took from the request going out to
+        // the answer coming back
+        struct round_trip_type {
+            mask_type field = 0;
+            std::chrono::steady_clock::duration took{};
+        };
+
+        // Writes made while a batch is alive are published when the
+        // outermost batch goes away. The snapshot is stored first, then
+        // each field that changed delivers to its own subscribers and
+        // last comes a single changes event. Anyone who wants to wake once
+        // per batch with a consistent view subscribes to changes and not
+        // to the fields.
+        class batch {
+            private:
+                radio& target;
+
+            public:
+                batch(radio& target_in);
+                // a subscriber that throws is logged and the rest still run
+                ~batch();
+                batch(const batch&) = delete;
+                batch& operator=(const batch&) = delete;
+        };
+
+    private:
+        // one entry per field that is worth asking the radio for
+        struct poll_entry {
+            mask_type field;
+            void (radio::*getter)();
+        };
+
+        std::vector<poll_entry> poll_plan;
+        mask_type supported = 0;
+        unsigned int batch_depth = 0;
+        std::shared_ptr<const state_type> state = std::make_shared<const state_type>();
+        void begin_batch();
+        void commit_batch();
+
     protected:
         std::shared_ptr<runloop> loop;
         virtual void update__alc() = 0;
         virtual void update__power() = 0;
         virtual void update__swr() = 0;
         virtual void update__tuner() = 0;
+        virtual void update__ptt() = 0;
+        // subclasses call this once they know what the radio can report;
+        // poll() never calls the getter for a field that is not in supported_in
+        void set_poll_plan(const mask_type& supported_in);
+        // subclasses call this on the runloop for every read that was answered
+        void report_round_trip(const enum update& field_in, const std::chrono::steady_clock::duration& took_in);
 
     public:
         struct vfo_type : public baseobj {
@@ -61,11 +145,32 @@ class radio : public baseobj {
         };
 
         mask_type update_mask = 0;
+        // true while the radio is transmitting
+        value_source<bool> ptt{false};
         vfo_type vfo;
         meters_type meters;
+        event_source<const state_type&> changes;
+        // one delivery per answered read; a read the radio never answered
+        // has no round trip
+        event_source<const round_trip_type&> round_trips;
 
-        radio(std::shared_ptr<runloop> loop_in) : loop(loop_in) { }
+        radio(std::shared_ptr<runloop> loop_in);
         void update();
+        // update only the fields in fields_in
+        void poll(const mask_type& fields_in);
+        mask_type get_supported() const { return supported; }
+        // these return right away; a radio that can not do the write calls
+        // done_in with ok_in set to false
+        virtual void set_frequency(const frequency& freq_in, const set_done<frequency>& done_in = nullptr);
+        virtual void set_ptt(const bool& ptt_in, const set_done<bool>& done_in = nullptr);
+        virtual void set_mode(const mode& mode_in, const set_done<mode>& done_in = nullptr);
+        virtual void set_level(const level& level_in, const float& value_in, const set_done<float>& done_in = nullptr);
+        // signal strength in dB over S9 the way hamlib reports it; the read
+        // goes out after any write that was already asked for so it is taken
+        // on the frequency the radio was last told to tune to
+        virtual void read_strength(const read_done<int>& done_in);
+        // safe to call from any thread
+        std::shared_ptr<const state_type> get_state() const;
 };
 
 }
@@ -0,0 +1,306 @@
+/*
+ * repeater.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+
+#include "logging.h"
+#include "repeater.h"
+#include "system.h"
+
+namespace oemros {
+
+// the PTT is looked at no more often than this even with tiny blocks
+#define REPEATER_MIN_CHECK_USEC 2000
+// capture timestamps that can be waiting for playback; far more than any
+// sane playback ring holds
+#define REPEATER_MAX_IN_FLIGHT 256
+
+repeater::repeater(std::shared_ptr<runloop> loop_in, const repeater_config& config_in, std::shared_ptr<radio> receiver_in,
+                   std::shared_ptr<radio> transmitter_in, std::shared_ptr<audio_stream> capture_in, std::shared_ptr<audio_stream> playback_in)
+: runloop_item(loop_in), config(config_in), receiver(receiver_in), transmitter(transmitter_in), capture(capture_in), playback(playback_in),
+  block_period(std::max<std::chrono::microseconds>(capture_in->get_format().block_period(), std::chrono::microseconds(REPEATER_MIN_CHECK_USEC))),
+  gain(config_in.output_gain_db),
+  hold_blocks(std::max<size_t>(1, config_in.key_hold / std::max<std::chrono::microseconds>(capture_in->get_format().block_period(), std::chrono::microseconds(1)))),
+  held(hold_blocks * capture_in->get_format().block_samples()), held_at(hold_blocks), captured_at(REPEATER_MAX_IN_FLIGHT) {
+    if (capture->which != audio_stream::direction::capture) system_fault("repeater ", config.name, " capture stream is not for capture");
+    if (playback->which != audio_stream::direction::playback) system_fault("repeater ", config.name, " playback stream is not for playback");
+
+    if (capture->get_format().block_samples() != playback->get_format().block_samples()) {
+        system_fault("repeater ", config.name, " capture and playback blocks are not the same size");
+    }
+
+    if (config.close_db > config.open_db) system_fault("repeater ", config.name, " closes above the level it opens at");
+}
+
+// the handlers point at us so the audio threads have to be gone first
+repeater::~repeater() {
+    capture->stop();
+    playback->stop();
+}
+
+void repeater::start__child() {
+    running = true;
+
+    tune(receiver, config.receiver_freq, config.receiver_mode);
+    tune(transmitter, config.transmitter_freq, config.transmitter_mode);
+
+    capture->set_handler([this](float* block_inout, const size_t& samples_in) { capture_block(block_inout, samples_in); });
+    capture->set_queueing(false);
+    playback->set_handler([this](float* block_inout, const size_t& samples_in) { playback_block(block_inout, samples_in); });
+
+    if (! playback->start()) system_fault("repeater ", config.name, " could not start playback on ", playback->name);
+    if (! capture->start()) system_fault("repeater ", config.name, " could not start capture on ", capture->name);
+
+    log_info("repeater ", config.name, " running from ", config.receiver_name, " to ", config.transmitter_name);
+    arm();
+}
+
+void repeater::stop() {
+    running = false;
+    timer.cancel();
+
+    capture->stop();
+    playback->stop();
+
+    if (keyed) key(false);
+}
+
+repeater::stats_type repeater::get_stats() const {
+    stats_type result;
+
+    result.signal = signal_seen;
+    result.keyed = keyed;
+    result.timed_out = timed_out;
+    result.level_db = level_db;
+    result.blocks_passed = blocks_passed;
+    result.blocks_dropped = blocks_dropped;
+    result.keyups = keyups;
+    result.time_outs = time_outs;
+    result.ptt_failures = ptt_failures;
+    result.latency = latency.snapshot();
+
+    return result;
+}
+
+void repeater::tune(std::shared_ptr<radio> radio_in, const frequency& freq_in, const radio::mode& mode_in) {
+    auto name = config.name;
+
+    if (freq_in != 0) {
+        radio_in->set_frequency(freq_in, [name, freq_in](bool ok_in, const frequency&) {
+            if (! ok_in) log_error("repeater ", name, " could not tune to ", freq_in);
+        });
+    }
+
+    if (mode_in != radio::mode::unknown) {
+        radio_in->set_mode(mode_in, [name](bool ok_in, const radio::mode&) {
+            if (! ok_in) log_error("repeater ", name, " could not set the mode");
+        });
+    }
+}
+
+// runs on the capture audio thread
+void repeater::capture_block(float* block_inout, const size_t& samples_in) {
+    // the first sample of the block reached the device one block period
+    // before the newest one, which has been sitting in the device since
+    auto now = clock_type::now();
+    auto started = now - capture->get_format().block_period() - capture->get_device_delay();
+
+    dc_blocker.process(block_inout, samples_in);
+
+    auto level = dsp_gain_to_db(dsp_measure(block_inout, samples_in).rms);
+    level_db.store(level, std::memory_order_relaxed);
+
+    if (level >= config.open_db) {
+        blocks_above++;
+    } else {
+        blocks_above = 0;
+    }
+
+    if (! signal && blocks_above >= config.open_blocks) {
+        signal = true;
+    } else if (signal && level < config.close_db) {
+        signal = false;
+    }
+
+    auto stopped = timed_out.load(std::memory_order_relaxed);
+    if (signal) last_signal = now;
+    // the signal that timed out gets no hang after it finally goes away
+    if (stopped) last_signal = clock_type::time_point();
+    signal_seen.store(signal, std::memory_order_relaxed);
+
+    auto pass = (signal || now - last_signal < config.hang) && ! stopped;
+    passing.store(pass, std::memory_order_relaxed);
+
+    if (! pass) {
+        // the transmitter never came up for what is held
+        blocks_dropped.fetch_add(held_count, std::memory_order_relaxed);
+        held_count = 0;
+        return;
+    }
+
+    gain.process(block_inout, samples_in);
+
+    if (! key_confirmed()) {
+        hold(block_inout, started);
+        return;
+    }
+
+    release_held();
+    send(block_inout, started);
+}
+
+// audio thread only; a full hold loses its oldest block
+void repeater::hold(const float* block_in, const clock_type::time_point& started_in) {
+    auto samples = capture->get_format().block_samples();
+
+    if (held_count == hold_blocks) {
+        held_first = (held_first + 1) % hold_blocks;
+        held_count--;
+        blocks_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    auto slot = (held_first + held_count++) % hold_blocks;
+    std::copy(block_in, block_in + samples, held.data() + slot * samples);
+    held_at[slot] = started_in;
+}
+
+// audio thread only; leaves room in the ring for the block being captured
+// and drops the oldest held blocks that do not fit
+void repeater::release_held() {
+    if (held_count == 0) return;
+
+    auto samples = capture->get_format().block_samples();
+    auto room = playback->writable();
+    room = room > 0 ? room - 1 : 0;
+
+    while(held_count > room) {
+        held_first = (held_first + 1) % hold_blocks;
+        held_count--;
+        blocks_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    while(held_count > 0) {
+        send(held.data() + held_first * samples, held_at[held_first]);
+        held_first = (held_first + 1) % hold_blocks;
+        held_count--;
+    }
+}
+
+// audio thread only; only this thread adds to the ring so the room can not
+// go away between the check and the write and the timestamp always goes in
+// first
+void repeater::send(const float* block_in, const clock_type::time_point& started_in) {
+    if (playback->writable() == 0 || ! captured_at.push(started_in)) {
+        blocks_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    playback->write(block_in);
+    blocks_passed.fetch_add(1, std::memory_order_relaxed);
+}
+
+// runs on the playback audio thread for every block that came from capture
+// just before it goes to the device which plays it once what it already
+// holds is gone
+void repeater::playback_block(float*, const size_t&) {
+    clock_type::time_point started;
+    if (! captured_at.pop(started)) return;
+
+    auto played = clock_type::now() + playback->get_device_delay();
+    latency.record(std::chrono::duration_cast<latency_histogram::duration_type>(played - started));
+}
+
+void repeater::key(const bool& keyed_in) {
+    std::weak_ptr<baseobj> weak_us = shared_from_this();
+    auto name = config.name;
+
+    keyed = keyed_in;
+    // audio is held from now until the transmitter confirms this key up
+    auto generation = ++key_generation;
+
+    if (keyed_in) {
+        keyed_at = clock_type::now();
+        keyups++;
+    }
+
+    log_debug("repeater ", name, keyed_in ? " keying up" : " unkeying");
+
+    // runs on the transmitter's loop
+    transmitter->set_ptt(keyed_in, [this, weak_us, name, keyed_in, generation](bool ok_in, const bool& applied_in) {
+        auto strong_us = weak_us.lock();
+
+        if (ok_in) {
+            if (! strong_us || ! keyed_in || ! applied_in) return;
+
+            // answers can come back out of order so an older one never
+            // takes back a newer confirmation
+            auto confirmed = confirmed_generation.load(std::memory_order_relaxed);
+            while(confirmed < generation && ! confirmed_generation.compare_exchange_weak(confirmed, generation, std::memory_order_release)) { }
+            return;
+        }
+
+        log_error("repeater ", name, " could not ", keyed_in ? "key" : "unkey", " the transmitter");
+        if (strong_us) ptt_failures++;
+    });
+}
+
+// safe from any thread; a key() since the confirmed key up means it no longer
+// counts, even when that was another key up
+bool repeater::key_confirmed() const {
+    return confirmed_generation.load(std::memory_order_acquire) == key_generation.load(std::memory_order_acquire);
+}
+
+void repeater::check() {
+    if (! running) return;
+
+    auto pass = passing.load(std::memory_order_relaxed);
+
+    if (timed_out && ! signal_seen) {
+        log_info("repeater ", config.name, " time out reset");
+        timed_out = false;
+    }
+
+    if (keyed && clock_type::now() - keyed_at >= config.time_out) {
+        log_info("repeater ", config.name, " timed out after ", config.time_out.count(), " msec");
+        timed_out = true;
+        time_outs++;
+        key(false);
+    }
+
+    // the audio thread may not have seen the time out yet
+    if (timed_out) pass = false;
+    if (pass != keyed) key(pass);
+    arm();
+}
+
+void repeater::arm() {
+    std::weak_ptr<baseobj> weak_us = shared_from_this();
+
+    timer.expires_after(block_period);
+    timer.async_wait([this, weak_us](const boost::system::error_code& error_in) {
+        auto strong_us = weak_us.lock();
+        if (strong_us == nullptr || error_in == boost::asio::error::operation_aborted) return;
+        if (error_in) system_fault("repeater timer failed: ", error_in.message());
+        check();
+    });
+}
+
+}
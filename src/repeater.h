@@ -0,0 +1,183 @@
+/*
+ * repeater.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "audio.h"
+#include "dsp.h"
+#include "histogram.h"
+#include "radio.h"
+#include "runloop.h"
+
+namespace oemros {
+
+// What a [repeater] section says; load_station_config() reads it. The
+// receiver and transmitter are found by name among the [transceiver]
+// sections and their audio.* settings give the audio devices. Levels are
+// dBFS of the RMS of a block.
+struct repeater_config {
+    std::string name;
+    std::string receiver_name;
+    // 0 leaves the rig where it is
+    frequency receiver_freq = 0;
+    radio::mode receiver_mode = radio::mode::fm;
+    std::string transmitter_name;
+    frequency transmitter_freq = 0;
+    radio::mode transmitter_mode = radio::mode::fm;
+    // the receiver audio is a signal above open_db until it falls below
+    // close_db; the gap keeps a weak signal from chattering the transmitter
+    float open_db = -40;
+    float close_db = -46;
+    // blocks in a row over open_db before a signal counts
+    unsigned int open_blocks = 2;
+    // how long the transmitter stays up after the signal goes away
+    std::chrono::milliseconds hang{750};
+    // audio waits for the transmitter to say it is keyed; past this much
+    // the oldest audio is dropped
+    std::chrono::milliseconds key_hold{250};
+    // longest transmission; after that the signal has to drop to reset it
+    std::chrono::milliseconds time_out{180000};
+    float output_gain_db = 0;
+};
+
+// Carries audio from a receiver to a transmitter and keys the transmitter
+// while there is something to carry.
+//
+// All of the audio work happens in the capture handler on the capture audio
+// thread: DC removal, the signal detector, gain and the hand off to the
+// playback ring. Nothing there allocates or locks and every block is the
+// size of the capture format. The playback ring is the only queue so its
+// size is the bound on the latency; a block that does not fit is dropped.
+//
+// The PTT is worked from the runloop by watching what the audio thread
+// published once per block period. Audio is held on the audio thread until
+// the transmitter confirms it is keyed so the start of an over is not sent
+// into a dead transmitter. When it is let go only what fits in the playback
+// ring goes, newest last, so the hold does not add latency to the rest of
+// the over.
+//
+// Latency is mouth to ear: from the first sample of a block reaching the
+// capture device to it leaving the playback device, counting the audio
+// the devices say they are holding. Backends that can not tell count as
+// holding nothing.
+class repeater : public runloop_item {
+    public:
+        using clock_type = std::chrono::steady_clock;
+
+        struct stats_type {
+            bool signal = false;
+            bool keyed = false;
+            bool timed_out = false;
+            // level of the last captured block
+            float level_db = 0;
+            uint64_t blocks_passed = 0;
+            // blocks the playback ring had no room for or that waited too
+            // long for the transmitter to key up
+            uint64_t blocks_dropped = 0;
+            uint64_t keyups = 0;
+            uint64_t time_outs = 0;
+            uint64_t ptt_failures = 0;
+            // mouth to ear
+            latency_histogram::snapshot_type latency;
+        };
+
+    private:
+        const repeater_config config;
+        std::shared_ptr<radio> receiver;
+        std::shared_ptr<radio> transmitter;
+        std::shared_ptr<audio_stream> capture;
+        std::shared_ptr<audio_stream> playback;
+        const clock_type::duration block_period;
+        boost::asio::steady_timer timer{*get_loop_ioptr()};
+        bool running = false;
+
+        // audio thread only
+        dsp_dc_blocker dc_blocker;
+        dsp_gain gain;
+        unsigned int blocks_above = 0;
+        bool signal = false;
+        clock_type::time_point last_signal;
+        // blocks waiting for the transmitter to key up, oldest at held_first
+        const size_t hold_blocks;
+        std::vector<float> held;
+        std::vector<clock_type::time_point> held_at;
+        size_t held_first = 0;
+        size_t held_count = 0;
+        // capture thread pushes and playback thread pops one per block
+        boost::lockfree::spsc_queue<clock_type::time_point> captured_at;
+        latency_histogram latency;
+
+        // written by the audio thread for the loop
+        std::atomic<bool> signal_seen{false};
+        std::atomic<bool> passing{false};
+        std::atomic<float> level_db{0};
+        std::atomic<uint64_t> blocks_passed{0};
+        std::atomic<uint64_t> blocks_dropped{0};
+
+        // written by the loop
+        std::atomic<bool> timed_out{false};
+        std::atomic<bool> keyed{false};
+        std::atomic<uint64_t> keyups{0};
+        std::atomic<uint64_t> time_outs{0};
+        clock_type::time_point keyed_at;
+        // bumped by every key() so a late answer to an older PTT change can
+        // not confirm a newer one; the transmitter is confirmed keyed while
+        // the two are the same, which they are not before the first key up
+        std::atomic<uint64_t> key_generation{1};
+        std::atomic<uint64_t> confirmed_generation{0};
+
+        // written by the transmitter when a PTT change fails
+        std::atomic<uint64_t> ptt_failures{0};
+
+        void capture_block(float* block_inout, const size_t& samples_in);
+        void playback_block(float* block_inout, const size_t& samples_in);
+        void hold(const float* block_in, const clock_type::time_point& started_in);
+        void release_held();
+        void send(const float* block_in, const clock_type::time_point& started_in);
+        void tune(std::shared_ptr<radio> radio_in, const frequency& freq_in, const radio::mode& mode_in);
+        void key(const bool& keyed_in);
+        bool key_confirmed() const;
+        void check();
+        void arm();
+
+    public:
+        // the playback stream ring should be a few blocks long since it sets
+        // the latency; neither stream may be started yet
+        repeater(std::shared_ptr<runloop> loop_in, const repeater_config& config_in, std::shared_ptr<radio> receiver_in,
+                 std::shared_ptr<radio> transmitter_in, std::shared_ptr<audio_stream> capture_in, std::shared_ptr<audio_stream> playback_in);
+        ~repeater();
+        const repeater_config& get_config() const { return config; }
+        // safe to call from any thread
+        stats_type get_stats() const;
+        // unkeys the transmitter and stops both streams
+        void stop();
+        virtual void start__child() override;
+};
+
+}
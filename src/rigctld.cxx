@@ -0,0 +1,539 @@
+/*
+ * rigctld.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#include "logging.h"
+#include "rigctld.h"
+#include "system.h"
+
+namespace oemros {
+
+// hamlib status codes as rigctld reports them
+#define RIGCTLD_OK 0
+#define RIGCTLD_EINVAL -1
+#define RIGCTLD_ENIMPL -4
+#define RIGCTLD_EIO -6
+#define RIGCTLD_EPROTO -8
+#define RIGCTLD_ENAVAIL -11
+
+rigctld_connection::rigctld_connection(std::shared_ptr<runloop> loop_in)
+: runloop_item(loop_in) { }
+
+bool rigctld_connection::connect(const boost::asio::generic::stream_protocol::endpoint& endpoint_in) {
+    boost::system::error_code error;
+
+    socket.connect(endpoint_in, error);
+    if (error) {
+        log_debug("could not connect to rigctld: ", error.message());
+        socket.close(error);
+        return false;
+    }
+
+    read_begin = read_end = 0;
+    read();
+    return true;
+}
+
+bool rigctld_connection::connect_tcp(const std::string& host_in, const std::string& port_in) {
+    using boost::asio::ip::tcp;
+    boost::system::error_code error;
+    tcp::resolver resolver(*get_loop_ioptr());
+
+    auto results = resolver.resolve(host_in, port_in, error);
+    if (error) {
+        log_error("could not resolve rigctld host ", host_in, ": ", error.message());
+        return false;
+    }
+
+    for(auto&& i : results) {
+        if (! connect(i.endpoint())) continue;
+        // replies are tiny and latency is the whole point
+        socket.set_option(tcp::no_delay(true), error);
+        return true;
+    }
+
+    log_error("could not connect to rigctld at ", host_in, ":", port_in);
+    return false;
+}
+
+bool rigctld_connection::connect_local(const std::string& path_in) {
+    if (connect(boost::asio::local::stream_protocol::endpoint(path_in))) return true;
+    log_error("could not connect to rigctld at ", path_in);
+    return false;
+}
+
+bool rigctld_connection::open_tcp(const std::string& host_in, const std::string& port_in) {
+    reopen = [this, host_in, port_in] { return connect_tcp(host_in, port_in); };
+    reconnect_backoff = reconnect_min;
+    return reopen();
+}
+
+bool rigctld_connection::open_local(const std::string& path_in) {
+    reopen = [this, path_in] { return connect_local(path_in); };
+    reconnect_backoff = reconnect_min;
+    return reopen();
+}
+
+void rigctld_connection::close() {
+    reopen = nullptr;
+    reconnect_timer.cancel();
+    reconnecting = false;
+    shut();
+}
+
+// the stream can not be trusted any more; everything waiting fails and a
+// new connection is tried after a backoff that doubles with each failure
+void rigctld_connection::lost() {
+    shut();
+    if (! reopen || reconnecting) return;
+
+    reconnecting = true;
+    log_info("reconnecting to rigctld in ", reconnect_backoff.count(), " ms");
+
+    std::weak_ptr<baseobj> weak_us = shared_from_this();
+    reconnect_timer.expires_after(reconnect_backoff);
+    reconnect_timer.async_wait([this, weak_us](const boost::system::error_code& error_in) {
+        auto strong_us = weak_us.lock();
+        if (! strong_us) return;
+        if (error_in == boost::asio::error::operation_aborted) return;
+        if (error_in) system_fault("rigctld reconnect timer failed: ", error_in.message());
+
+        reconnecting = false;
+        if (! reopen) return;
+
+        if (! reopen()) {
+            reconnect_backoff = std::min(reconnect_backoff * 2, reconnect_max);
+            lost();
+            return;
+        }
+
+        stats.reconnects++;
+        reconnect_backoff = reconnect_min;
+        log_info("reconnected to rigctld");
+        pump();
+    });
+}
+
+// every request that has not been answered fails
+void rigctld_connection::shut() {
+    boost::system::error_code error;
+
+    socket.close(error);
+    timer.cancel();
+    outbox.clear();
+
+    std::deque<request_type> failed;
+    failed.swap(outstanding);
+    for(auto&& i : queued) failed.push_back(std::move(i));
+    queued.clear();
+
+    for(auto&& i : failed) {
+        stats.failed++;
+        if (i.done) i.done(RIGCTLD_EIO, std::string_view(), clock_type::duration::zero());
+    }
+}
+
+void rigctld_connection::read() {
+    std::weak_ptr<baseobj> weak_us = shared_from_this();
+    auto space = boost::asio::buffer(buffer.data() + read_end, buffer.size() - read_end);
+
+    socket.async_read_some(space, [this, weak_us](const boost::system::error_code& error_in, size_t bytes_in) {
+        auto strong_us = weak_us.lock();
+        if (strong_us) read_done(error_in, bytes_in);
+    });
+}
+
+void rigctld_connection::read_done(const boost::system::error_code& error_in, const size_t& bytes_in) {
+    if (error_in == boost::asio::error::operation_aborted) return;
+
+    if (error_in) {
+        log_error("rigctld connection failed: ", error_in.message());
+        lost();
+        return;
+    }
+
+    read_end += bytes_in;
+
+    while(read_begin < read_end) {
+        auto first = buffer.data() + read_begin;
+        auto newline = static_cast<char*>(std::memchr(first, '\n', read_end - read_begin));
+        if (newline == nullptr) break;
+
+        read_begin = newline - buffer.data() + 1;
+        answer(std::string_view(first, newline - first));
+        // answer() may have closed the connection
+        if (! socket.is_open()) return;
+    }
+
+    if (read_begin == read_end) {
+        read_begin = read_end = 0;
+    } else if (read_begin > 0) {
+        std::memmove(buffer.data(), buffer.data() + read_begin, read_end - read_begin);
+        read_end -= read_begin;
+        read_begin = 0;
+    }
+
+    if (read_end == buffer.size()) {
+        log_error("rigctld sent a line longer than ", buffer.size(), " bytes");
+        lost();
+        return;
+    }
+
+    arm();
+    pump();
+    read();
+}
+
+void rigctld_connection::answer(const std::string_view& line_in) {
+    if (outstanding.empty()) {
+        log_error("rigctld answered a request that was never made: ", std::string(line_in));
+        lost();
+        return;
+    }
+
+    auto request = std::move(outstanding.front());
+    outstanding.pop_front();
+    stats.answered++;
+
+    int error = RIGCTLD_OK;
+    std::string_view value;
+
+    if (line_in.compare(0, 5, "RPRT ") == 0) {
+        error = std::atoi(std::string(line_in.substr(5)).c_str());
+        // a get should never be answered by a plain RPRT 0
+        if (error == RIGCTLD_OK && request.has_value) error = RIGCTLD_EPROTO;
+    } else if (request.has_value) {
+        value = line_in;
+    } else {
+        error = RIGCTLD_EPROTO;
+    }
+
+    if (error != RIGCTLD_OK) stats.failed++;
+    if (request.done) request.done(error, value, clock_type::now() - request.sent);
+}
+
+void rigctld_connection::request(const std::string& command_in, const bool& has_value_in, const done_type& done_in) {
+    request_type request;
+
+    request.command = command_in;
+    request.has_value = has_value_in;
+    request.done = done_in;
+
+    queued.push_back(std::move(request));
+    pump();
+}
+
+// moves requests into the pipeline and leaves them in the outbox which is
+// written once whatever the runloop is doing right now is done
+void rigctld_connection::pump() {
+    if (! socket.is_open()) {
+        if (! queued.empty()) shut();
+        return;
+    }
+
+    auto deadline = clock_type::now() + timeout;
+
+    while(! queued.empty() && outstanding.size() < max_outstanding) {
+        auto& request = queued.front();
+        outbox += request.command;
+        outbox += '\n';
+        request.deadline = deadline;
+        outstanding.push_back(std::move(request));
+        queued.pop_front();
+        stats.sent++;
+    }
+
+    if (outbox.empty() || flush_posted) return;
+
+    flush_posted = true;
+    std::weak_ptr<baseobj> weak_us = shared_from_this();
+    get_loop()->post([this, weak_us] {
+        auto strong_us = weak_us.lock();
+        if (! strong_us) return;
+        flush_posted = false;
+        flush();
+    });
+}
+
+void rigctld_connection::flush() {
+    if (! writing.empty() || outbox.empty() || ! socket.is_open()) return;
+
+    writing.swap(outbox);
+    stats.writes++;
+
+    // everything in flight that has not been sent yet is in this write
+    auto now = clock_type::now();
+    for(auto&& i : outstanding) {
+        if (i.sent == clock_type::time_point()) i.sent = now;
+    }
+
+    arm();
+
+    std::weak_ptr<baseobj> weak_us = shared_from_this();
+    boost::asio::async_write(socket, boost::asio::buffer(writing), [this, weak_us](const boost::system::error_code& error_in, size_t) {
+        auto strong_us = weak_us.lock();
+        if (! strong_us) return;
+
+        writing.clear();
+        if (error_in == boost::asio::error::operation_aborted) return;
+
+        if (error_in) {
+            log_error("could not write to rigctld: ", error_in.message());
+            lost();
+            return;
+        }
+
+        flush();
+    });
+}
+
+void rigctld_connection::arm() {
+    if (outstanding.empty()) {
+        timer.cancel();
+        return;
+    }
+
+    std::weak_ptr<baseobj> weak_us = shared_from_this();
+    timer.expires_at(outstanding.front().deadline);
+    timer.async_wait([this, weak_us](const boost::system::error_code& error_in) {
+        auto strong_us = weak_us.lock();
+        if (strong_us) expire(error_in);
+    });
+}
+
+// answers are matched by order so once one is missing the rest can not be
+// trusted and the connection has to go
+void rigctld_connection::expire(const boost::system::error_code& error_in) {
+    if (error_in == boost::asio::error::operation_aborted) return;
+    if (error_in) system_fault("rigctld timer failed: ", error_in.message());
+    if (outstanding.empty() || outstanding.front().deadline > clock_type::now()) return;
+
+    log_error("rigctld did not answer in time; dropping the connection");
+    lost();
+}
+
+static const char* rigctld_mode(const radio::mode& mode_in) {
+    switch(mode_in) {
+        case radio::mode::am: return "AM";
+        case radio::mode::cw: return "CW";
+        case radio::mode::usb: return "USB";
+        case radio::mode::lsb: return "LSB";
+        case radio::mode::fm: return "FM";
+        case radio::mode::unknown: break;
+    }
+
+    return nullptr;
+}
+
+static const char* rigctld_level(const radio::level& level_in) {
+    switch(level_in) {
+        case radio::level::rf_power: return "RFPOWER";
+        case radio::level::af_gain: return "AF";
+    }
+
+    return nullptr;
+}
+
+static double rigctld_number(const std::string_view& value_in) {
+    return std::strtod(std::string(value_in).c_str(), nullptr);
+}
+
+// done_in and apply_in run on the loop because the connection does
+template <typename T>
+static std::function<void (bool, const T&)> rigctld_finish(std::weak_ptr<baseobj> weak_radio_in, const radio::set_done<T>& done_in,
+                                                            const std::function<void (radio&, const T&)>& apply_in = nullptr) {
+    return [weak_radio_in, done_in, apply_in](bool ok_in, const T& applied_in) {
+        auto strong_radio = std::dynamic_pointer_cast<radio>(weak_radio_in.lock());
+        if (strong_radio == nullptr) return;
+
+        if (ok_in && apply_in) {
+            radio::batch scope(*strong_radio);
+            apply_in(*strong_radio, applied_in);
+        }
+
+        if (done_in) done_in(ok_in, applied_in);
+    };
+}
+
+// writers are called from any thread and the connection belongs to the loop
+template <typename Key, typename Value>
+static std::shared_ptr<write_coalescer<Key, Value>>
+make_rigctld_writer(std::shared_ptr<runloop> loop_in, std::shared_ptr<rigctld_connection> connection_in,
+                    const std::function<std::string (const Key&, const Value&)>& command_in) {
+    return std::make_shared<write_coalescer<Key, Value>>(
+        [loop_in, connection_in, command_in](const Key& key_in, const Value& value_in, const typename write_coalescer<Key, Value>::finished_type& finished_in) {
+            auto command = command_in(key_in, value_in);
+            if (command.empty()) {
+                loop_in->post([value_in, finished_in] { finished_in(false, value_in); });
+                return;
+            }
+
+            loop_in->post([connection_in, command, value_in, finished_in] {
+                connection_in->request(command, false, [value_in, finished_in](const int& error_in, const std::string_view&, const rigctld_connection::clock_type::duration&) {
+                    if (error_in != RIGCTLD_OK) log_debug("rigctld write failed with status ", error_in);
+                    finished_in(error_in == RIGCTLD_OK, value_in);
+                });
+            });
+        });
+}
+
+rigctld_radio::rigctld_radio(std::shared_ptr<runloop> loop_in, const config_type& config_in)
+: radio(loop_in), config(config_in) {
+    connection = loop_in->make_item<rigctld_connection>();
+
+    freq_writes = make_rigctld_writer<int, frequency>(loop_in, connection, [](const int&, const frequency& freq_in) {
+        return "F " + std::to_string(freq_in);
+    });
+
+    ptt_writes = make_rigctld_writer<int, bool>(loop_in, connection, [](const int&, const bool& ptt_in) {
+        return std::string(ptt_in ? "T 1" : "T 0");
+    });
+
+    // a passband of 0 keeps the normal one for the mode
+    mode_writes = make_rigctld_writer<int, mode>(loop_in, connection, [](const int&, const mode& mode_in) {
+        auto name = rigctld_mode(mode_in);
+        return name == nullptr ? std::string() : std::string("M ") + name + " 0";
+    });
+
+    level_writes = make_rigctld_writer<level, float>(loop_in, connection, [](const level& level_in, const float& value_in) {
+        auto name = rigctld_level(level_in);
+        return name == nullptr ? std::string() : std::string("L ") + name + " " + std::to_string(value_in);
+    });
+}
+
+bool rigctld_radio::open() {
+    auto opened = config.host.compare(0, 1, "/") == 0
+                ? connection->open_local(config.host)
+                : connection->open_tcp(config.host, config.port);
+
+    if (! opened) return false;
+
+    set_poll_plan(~ (mask_type)0);
+    update();
+
+    return true;
+}
+
+void rigctld_radio::read(const enum update& field_in, const std::string& command_in, void (*apply_in)(radio&, const std::string_view&)) {
+    auto field = (mask_type)field_in;
+
+    // one read of a field at a time is enough
+    if (reading & field) return;
+    reading |= field;
+
+    std::weak_ptr<baseobj> weak_us = weak_from_this();
+    connection->request(command_in, true, [weak_us, field_in, field, apply_in](const int& error_in, const std::string_view& value_in, const rigctld_connection::clock_type::duration& took_in) {
+        auto strong_us = std::dynamic_pointer_cast<rigctld_radio>(weak_us.lock());
+        if (strong_us == nullptr) return;
+
+        strong_us->reading &= ~ field;
+
+        if (error_in == RIGCTLD_OK) {
+            {
+                batch scope(*strong_us);
+                apply_in(*strong_us, value_in);
+            }
+
+            strong_us->report_round_trip(field_in, took_in);
+            return;
+        }
+
+        // the rig behind rigctld can not do this so stop asking
+        if (error_in == RIGCTLD_EINVAL || error_in == RIGCTLD_ENIMPL || error_in == RIGCTLD_ENAVAIL) {
+            log_verbose("rigctld can not read field ", field, "; removing it from the poll plan");
+            strong_us->set_poll_plan(strong_us->get_supported() & ~ field);
+            return;
+        }
+
+        log_debug("rigctld read of field ", field, " failed with status ", error_in);
+    });
+}
+
+void rigctld_radio::update__alc() {
+    read(update::alc, "l ALC", [](radio& radio_in, const std::string_view& value_in) {
+        radio_in.meters.alc = rigctld_number(value_in);
+    });
+}
+
+void rigctld_radio::update__power() {
+    read(update::power, "l RFPOWER_METER", [](radio& radio_in, const std::string_view& value_in) {
+        radio_in.meters.power = rigctld_number(value_in);
+    });
+}
+
+void rigctld_radio::update__swr() {
+    read(update::swr, "l SWR", [](radio& radio_in, const std::string_view& value_in) {
+        radio_in.meters.swr = rigctld_number(value_in);
+    });
+}
+
+void rigctld_radio::update__tuner() {
+    read(update::tuner, "f", [](radio& radio_in, const std::string_view& value_in) {
+        radio_in.vfo.tuner = static_cast<frequency>(rigctld_number(value_in));
+    });
+}
+
+void rigctld_radio::update__ptt() {
+    read(update::ptt, "t", [](radio& radio_in, const std::string_view& value_in) {
+        radio_in.ptt = std::atoi(std::string(value_in).c_str()) != 0;
+    });
+}
+
+void rigctld_radio::set_frequency(const frequency& freq_in, const set_done<frequency>& done_in) {
+    freq_writes->write(0, freq_in, rigctld_finish<frequency>(weak_from_this(), done_in, [](radio& radio_in, const frequency& applied_in) {
+        radio_in.vfo.tuner = applied_in;
+    }));
+}
+
+void rigctld_radio::set_ptt(const bool& ptt_in, const set_done<bool>& done_in) {
+    ptt_writes->write(0, ptt_in, rigctld_finish<bool>(weak_from_this(), done_in, [](radio& radio_in, const bool& applied_in) {
+        radio_in.ptt = applied_in;
+    }));
+}
+
+void rigctld_radio::set_mode(const mode& mode_in, const set_done<mode>& done_in) {
+    mode_writes->write(0, mode_in, rigctld_finish<mode>(weak_from_this(), done_in));
+}
+
+void rigctld_radio::set_level(const level& level_in, const float& value_in, const set_done<float>& done_in) {
+    level_writes->write(level_in, value_in, rigctld_finish<float>(weak_from_this(), done_in));
+}
+
+// writes are posted before they are sent so this is too or it could pass
+// a retune that was asked for first
+void rigctld_radio::read_strength(const read_done<int>& done_in) {
+    std::weak_ptr<baseobj> weak_us = weak_from_this();
+    auto our_connection = connection;
+
+    loop->post([weak_us, our_connection, done_in] {
+        our_connection->request("l STRENGTH", true, [weak_us, done_in](const int& error_in, const std::string_view& value_in, const rigctld_connection::clock_type::duration&) {
+            if (weak_us.expired()) return;
+            auto ok = error_in == RIGCTLD_OK;
+            if (done_in) done_in(ok, ok ? std::atoi(std::string(value_in).c_str()) : 0);
+        });
+    });
+}
+
+}
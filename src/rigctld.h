@@ -0,0 +1,165 @@
+/*
+ * rigctld.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "coalesce.h"
+#include "radio.h"
+#include "runloop.h"
+
+namespace oemros {
+
+// A connection to a rigctld daemon speaking the default protocol. Requests
+// are pipelined: up to max_outstanding of them are sent without waiting and
+// rigctld answers them in order. Every command asked for while the runloop
+// is busy goes out in the same write. When the connection breaks or rigctld
+// stops answering, everything waiting fails and the connection is opened
+// again after a backoff.
+class rigctld_connection : public runloop_item {
+    public:
+        using clock_type = std::chrono::steady_clock;
+        // error_in is the hamlib status which is 0 on success; value_in is
+        // the reply line of a get and points into the receive buffer; took_in
+        // is from the request being written to its answer
+        using done_type = std::function<void (const int& error_in, const std::string_view& value_in, const clock_type::duration& took_in)>;
+
+        struct stats_type {
+            uint64_t sent = 0;
+            uint64_t answered = 0;
+            uint64_t failed = 0;
+            uint64_t writes = 0;
+            uint64_t reconnects = 0;
+        };
+
+    private:
+        struct request_type {
+            std::string command;
+            // a get answers with a value line and a set with an RPRT line
+            bool has_value = false;
+            done_type done;
+            // zero until the write that carries it starts
+            clock_type::time_point sent;
+            clock_type::time_point deadline;
+        };
+
+        boost::asio::generic::stream_protocol::socket socket{*get_loop_ioptr()};
+        boost::asio::steady_timer timer{*get_loop_ioptr()};
+        boost::asio::steady_timer reconnect_timer{*get_loop_ioptr()};
+        // unparsed bytes are [read_begin, read_end)
+        std::array<char, 4096> buffer;
+        size_t read_begin = 0;
+        size_t read_end = 0;
+        std::deque<request_type> queued;
+        std::deque<request_type> outstanding;
+        // commands not written yet and the ones being written
+        std::string outbox;
+        std::string writing;
+        bool flush_posted = false;
+        // connects the same way open did; empty once close() was called
+        std::function<bool ()> reopen;
+        bool reconnecting = false;
+        std::chrono::milliseconds reconnect_backoff{500};
+        stats_type stats;
+
+        bool connect(const boost::asio::generic::stream_protocol::endpoint& endpoint_in);
+        bool connect_tcp(const std::string& host_in, const std::string& port_in);
+        bool connect_local(const std::string& path_in);
+        void shut();
+        void lost();
+        void read();
+        void read_done(const boost::system::error_code& error_in, const size_t& bytes_in);
+        void answer(const std::string_view& line_in);
+        void pump();
+        void flush();
+        void arm();
+        void expire(const boost::system::error_code& error_in);
+
+    public:
+        size_t max_outstanding = 16;
+        std::chrono::milliseconds timeout{2000};
+        // first wait before connecting again; it doubles up to reconnect_max
+        std::chrono::milliseconds reconnect_min{500};
+        std::chrono::milliseconds reconnect_max{30000};
+
+        rigctld_connection(std::shared_ptr<runloop> loop_in);
+        bool open_tcp(const std::string& host_in, const std::string& port_in);
+        bool open_local(const std::string& path_in);
+        // closes for good without connecting again
+        void close();
+        bool is_open() const { return socket.is_open(); }
+        // command_in is one rigctld command without the newline
+        void request(const std::string& command_in, const bool& has_value_in, const done_type& done_in = nullptr);
+        stats_type get_stats() const { return stats; }
+        virtual void start__child() override { }
+};
+
+// A radio behind rigctld so other station software can share it. Fields
+// rigctld says it can not read are dropped from the poll plan.
+class rigctld_radio : public radio {
+    public:
+        struct config_type {
+            // a path starting with / is a unix socket and anything else is
+            // a host name with the port in port
+            std::string host = "localhost";
+            std::string port = "4532";
+        };
+
+    private:
+        const config_type config;
+        std::shared_ptr<rigctld_connection> connection;
+        // fields with a read already waiting on rigctld
+        mask_type reading = 0;
+        std::shared_ptr<write_coalescer<int, frequency>> freq_writes;
+        std::shared_ptr<write_coalescer<int, bool>> ptt_writes;
+        std::shared_ptr<write_coalescer<int, mode>> mode_writes;
+        std::shared_ptr<write_coalescer<level, float>> level_writes;
+
+        void read(const enum update& field_in, const std::string& command_in, void (*apply_in)(radio&, const std::string_view&));
+
+    protected:
+        virtual void update__alc() override;
+        virtual void update__power() override;
+        virtual void update__swr() override;
+        virtual void update__tuner() override;
+        virtual void update__ptt() override;
+
+    public:
+        rigctld_radio(std::shared_ptr<runloop> loop_in, const config_type& config_in);
+        bool open();
+        std::shared_ptr<rigctld_connection> get_connection() { return connection; }
+        // done_in runs on the radio's runloop
+        virtual void set_frequency(const frequency& freq_in, const set_done<frequency>& done_in = nullptr) override;
+        virtual void set_ptt(const bool& ptt_in, const set_done<bool>& done_in = nullptr) override;
+        virtual void set_mode(const mode& mode_in, const set_done<mode>& done_in = nullptr) override;
+        virtual void set_level(const level& level_in, const float& value_in, const set_done<float>& done_in = nullptr) override;
+        virtual void read_strength(const read_done<int>& done_in) override;
+};
+
+}
@@ -31,6 +31,10 @@ void runloop::enter() {
     io.run();
 }
 
+void runloop::stop() {
+    io.stop();
+}
+
 void runloop::post(const std::function<void ()>& post_in) {
     io.post(post_in);
 }
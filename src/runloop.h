@@ -42,6 +42,7 @@ class runloop_item : public baseobj {
     protected:
         virtual void start__child() = 0;
         boost::asio::io_service* get_loop_ioptr();
+        std::shared_ptr<runloop> get_loop() { return loop; }
 
     public:
         runloop_item(std::shared_ptr<runloop> loop_in) : loop(loop_in) { }
@@ -67,6 +68,8 @@ class runloop : public baseobj {
             return new_item;
         }
         void enter();
+        // makes enter() return as soon as it can
+        void stop();
         void post(const std::function<void ()>& post_in);
         template <class Class, class Instance>
         void post(Class&& class_in, Instance&& instance_in) {
@@ -0,0 +1,420 @@
+/*
+ * scanner.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+
+#include "logging.h"
+#include "scanner.h"
+#include "system.h"
+
+namespace oemros {
+
+// how long to wait before looking again when every channel is locked out
+#define SCANNER_IDLE_MSEC 1000
+// how much the settle time changes after a check
+#define SCANNER_SETTLE_GROW 1.5
+#define SCANNER_SETTLE_SHRINK 0.875
+
+radio_scanner::radio_scanner(std::shared_ptr<runloop> loop_in, std::shared_ptr<radio> radio_in, const std::chrono::microseconds& settle_in)
+: runloop_item(loop_in), target(radio_in), settle(settle_in) {
+    assert(target != nullptr);
+}
+
+size_t radio_scanner::add_channel(const frequency& freq_in, const bool& priority_in) {
+    frequencies.push_back(freq_in);
+    strengths.push_back(0);
+    heard.emplace_back();
+    flags.push_back(priority_in ? flag_priority : 0);
+
+    return frequencies.size() - 1;
+}
+
+void radio_scanner::add_range(const frequency& start_in, const frequency& stop_in, const frequency& step_in) {
+    if (step_in == 0) system_fault("scanner range step can not be 0");
+
+    auto count = stop_in >= start_in ? (stop_in - start_in) / step_in + 1 : 0;
+
+    frequencies.reserve(frequencies.size() + count);
+    strengths.reserve(strengths.size() + count);
+    heard.reserve(heard.size() + count);
+    flags.reserve(flags.size() + count);
+
+    for(frequency i = 0; i < count; i++) {
+        add_channel(start_in + i * step_in);
+    }
+}
+
+// the channel numbers in flight mean nothing after this so it stops too
+void radio_scanner::clear() {
+    stop();
+
+    frequencies.clear();
+    strengths.clear();
+    heard.clear();
+    flags.clear();
+    cursor = cursor_type();
+}
+
+radio_scanner::channel_type radio_scanner::get_channel(const size_t& channel_in) const {
+    assert(channel_in < frequencies.size());
+
+    channel_type result;
+    result.freq = frequencies[channel_in];
+    result.strength = strengths[channel_in];
+    result.when = heard[channel_in];
+    result.priority = flags[channel_in] & flag_priority;
+    result.locked = flags[channel_in] & flag_locked;
+
+    return result;
+}
+
+void radio_scanner::set_priority(const size_t& channel_in, const bool& priority_in) {
+    assert(channel_in < flags.size());
+
+    if (priority_in) {
+        flags[channel_in] |= flag_priority;
+    } else {
+        flags[channel_in] &= ~ flag_priority;
+    }
+}
+
+// locking out the channel being held on lets the scan go on
+void radio_scanner::set_lockout(const size_t& channel_in, const bool& locked_in) {
+    assert(channel_in < flags.size());
+
+    if (! locked_in) {
+        flags[channel_in] &= ~ flag_locked;
+        return;
+    }
+
+    flags[channel_in] |= flag_locked;
+    if (hold_channel == channel_in) hold_channel = no_channel;
+    if (running && phase == phase_type::holding && tuned == channel_in) {
+        // the hold read in flight is for a channel nobody wants now
+        generation++;
+        timer.cancel();
+        advance();
+    }
+}
+
+size_t radio_scanner::get_holding() const {
+    if (phase == phase_type::holding) return tuned;
+    return hold_channel;
+}
+
+radio_scanner::stats_type radio_scanner::get_stats() const {
+    auto result = stats;
+    auto elapsed = std::chrono::duration<double>(clock_type::now() - started).count();
+
+    result.sweeps = cursor.sweeps;
+    result.settle = settle;
+    result.channels_per_second = running && elapsed > 0 ? result.steps / elapsed : 0;
+
+    return result;
+}
+
+void radio_scanner::stop() {
+    running = false;
+    generation++;
+    phase = phase_type::idle;
+    hold_channel = no_channel;
+    timer.cancel();
+}
+
+void radio_scanner::start__child() {
+    running = true;
+    generation++;
+    started = clock_type::now();
+    cursor.priority_due = started + priority_period;
+    stats = stats_type();
+    cursor.sweeps = 0;
+
+    advance();
+}
+
+// priority channels go first when they are due and otherwise the scan goes
+// on from where it was
+size_t radio_scanner::next_channel(const clock_type::time_point& now_in) {
+    auto count = frequencies.size();
+    if (count == 0) return no_channel;
+
+    if (now_in >= cursor.priority_due) {
+        cursor.priority_due = now_in + priority_period;
+
+        for(size_t i = 0; i < count; i++) {
+            auto channel = (cursor.priority_position + i) % count;
+            if ((flags[channel] & (flag_priority | flag_locked)) != flag_priority) continue;
+            cursor.priority_position = channel + 1;
+            return channel;
+        }
+    }
+
+    for(size_t i = 0; i < count; i++) {
+        auto channel = cursor.position++;
+        if (cursor.position >= count) {
+            cursor.position = 0;
+            cursor.sweeps++;
+        }
+
+        if (! (flags[channel] & flag_locked)) return channel;
+    }
+
+    return no_channel;
+}
+
+void radio_scanner::advance() {
+    if (! running) return;
+
+    auto channel = next_channel(clock_type::now());
+
+    if (channel == no_channel) {
+        phase = phase_type::idle;
+        wait(std::chrono::milliseconds(SCANNER_IDLE_MSEC), &radio_scanner::advance);
+        return;
+    }
+
+    tune(channel);
+}
+
+void radio_scanner::tune(const size_t& channel_in) {
+    std::weak_ptr<baseobj> weak_us = shared_from_this();
+    auto our_generation = generation;
+
+    phase = phase_type::tuning;
+    tuned = channel_in;
+
+    target->set_frequency(frequencies[channel_in], [this, weak_us, our_generation, channel_in](bool ok_in, const frequency&) {
+        auto strong_us = weak_us.lock();
+        if (strong_us) tuned_done(our_generation, channel_in, ok_in);
+    });
+}
+
+void radio_scanner::tuned_done(const uint64_t& generation_in, const size_t& channel_in, const bool& ok_in) {
+    if (generation_in != generation) return;
+
+    if (! ok_in) {
+        stats.failures++;
+        log_debug("scanner could not tune to ", frequencies[channel_in]);
+        // a rig that can not tune should not be asked again right away
+        wait(settle, &radio_scanner::advance);
+        return;
+    }
+
+    // a signal turned up behind us so go back to it
+    if (hold_channel != no_channel && hold_channel != channel_in) {
+        tune(hold_channel);
+        return;
+    }
+
+    if (hold_channel == channel_in) {
+        hold_channel = no_channel;
+        start_hold();
+        return;
+    }
+
+    phase = phase_type::settling;
+    wait(settle, &radio_scanner::settled);
+}
+
+void radio_scanner::read(const size_t& channel_in, void (radio_scanner::*next_in)(const size_t&, const bool&, const int&)) {
+    std::weak_ptr<baseobj> weak_us = shared_from_this();
+    auto our_generation = generation;
+
+    target->read_strength([this, weak_us, our_generation, channel_in, next_in](bool ok_in, const int& strength_in) {
+        auto strong_us = weak_us.lock();
+        if (strong_us == nullptr || our_generation != generation) return;
+        (this->*next_in)(channel_in, ok_in, strength_in);
+    });
+}
+
+// the retune to the next channel goes out right behind the strength read
+// unless this channel is being read twice
+void radio_scanner::settled() {
+    if (hold_channel != no_channel && hold_channel != tuned) {
+        tune(hold_channel);
+        return;
+    }
+
+    if (phase == phase_type::holding) {
+        read(tuned, &radio_scanner::hold_read);
+        return;
+    }
+
+    if (phase == phase_type::checking) {
+        read(tuned, &radio_scanner::check_read);
+        return;
+    }
+
+    auto channel = tuned;
+    auto our_generation = generation;
+    auto saved = cursor;
+
+    check_pending = last_had_signal || ++steps_since_check >= settle_check_every;
+    auto next = check_pending ? no_channel : next_channel(clock_type::now());
+
+    pipelined = next != no_channel;
+    phase = phase_type::reading;
+    read(channel, &radio_scanner::first_read);
+
+    if (! pipelined || our_generation != generation) return;
+
+    // the reading came back before the retune went out and it found a signal
+    if (hold_channel == channel) {
+        cursor = saved;
+        hold_channel = no_channel;
+        start_hold();
+        return;
+    }
+
+    tune(next);
+}
+
+void radio_scanner::first_read(const size_t& channel_in, const bool& ok_in, const int& strength_in) {
+    if (! ok_in) {
+        stats.failures++;
+        if (! pipelined) advance();
+        return;
+    }
+
+    if (check_pending) {
+        check_pending = false;
+        first_reading = strength_in;
+        phase = phase_type::checking;
+        wait(settle, &radio_scanner::settled);
+        return;
+    }
+
+    stats.steps++;
+    auto our_generation = generation;
+    record(channel_in, strength_in);
+    if (our_generation != generation) return;
+
+    if (strength_in >= threshold) {
+        if (pipelined) {
+            hold_channel = channel_in;
+        } else {
+            start_hold();
+        }
+
+        return;
+    }
+
+    if (! pipelined) advance();
+}
+
+// a second reading that moved means the first one was taken too soon
+void radio_scanner::check_read(const size_t& channel_in, const bool& ok_in, const int& strength_in) {
+    stats.settle_checks++;
+    steps_since_check = 0;
+
+    auto reading = first_reading;
+
+    if (ok_in) {
+        reading = strength_in;
+
+        if (std::abs(strength_in - first_reading) > settle_tolerance) {
+            settle = std::min(max_settle, std::chrono::duration_cast<std::chrono::microseconds>(settle * SCANNER_SETTLE_GROW) + std::chrono::microseconds(1000));
+            log_debug("scanner settle time raised to ", settle.count(), " usec");
+        } else {
+            settle = std::max(min_settle, std::chrono::duration_cast<std::chrono::microseconds>(settle * SCANNER_SETTLE_SHRINK));
+        }
+    }
+
+    stats.steps++;
+    auto our_generation = generation;
+    record(channel_in, reading);
+    if (our_generation != generation) return;
+
+    if (reading >= threshold) {
+        start_hold();
+    } else {
+        advance();
+    }
+}
+
+void radio_scanner::hold_read(const size_t& channel_in, const bool& ok_in, const int& strength_in) {
+    auto now = clock_type::now();
+
+    if (ok_in) {
+        auto our_generation = generation;
+        record(channel_in, strength_in);
+        if (our_generation != generation || phase != phase_type::holding) return;
+        if (strength_in >= threshold) last_signal = now;
+    }
+
+    auto quiet = now - last_signal >= resume_delay;
+    auto too_long = max_hold.count() > 0 && now - hold_started >= max_hold;
+
+    if (quiet || too_long) {
+        log_debug("scanner resuming after ", frequencies[channel_in]);
+        advance();
+        return;
+    }
+
+    wait(hold_poll, &radio_scanner::settled);
+}
+
+void radio_scanner::start_hold() {
+    auto now = clock_type::now();
+
+    stats.signals++;
+    phase = phase_type::holding;
+    hold_started = now;
+    last_signal = now;
+
+    log_verbose("scanner holding on ", frequencies[tuned]);
+    wait(hold_poll, &radio_scanner::settled);
+}
+
+void radio_scanner::record(const size_t& channel_in, const int& strength_in) {
+    auto now = clock_type::now();
+
+    strengths[channel_in] = std::max(std::min(strength_in, (int)INT16_MAX), (int)INT16_MIN);
+    heard[channel_in] = now;
+    last_had_signal = strength_in >= threshold;
+
+    scan_result result;
+    result.channel = channel_in;
+    result.freq = frequencies[channel_in];
+    result.strength = strength_in;
+    result.signal = last_had_signal;
+    result.when = now;
+
+    results.deliver(result);
+}
+
+void radio_scanner::wait(const clock_type::duration& wait_in, void (radio_scanner::*next_in)()) {
+    std::weak_ptr<baseobj> weak_us = shared_from_this();
+    auto our_generation = generation;
+
+    timer.expires_after(wait_in);
+    timer.async_wait([this, weak_us, our_generation, next_in](const boost::system::error_code& error_in) {
+        auto strong_us = weak_us.lock();
+        if (strong_us == nullptr || error_in == boost::asio::error::operation_aborted) return;
+        if (error_in) system_fault("scanner timer failed: ", error_in.message());
+        if (our_generation != generation) return;
+        (this->*next_in)();
+    });
+}
+
+}
@@ -0,0 +1,180 @@
+/*
+ * scanner.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "radio.h"
+#include "runloop.h"
+
+namespace oemros {
+
+// strengths are in dB over S9 like radio::read_strength()
+struct scan_result {
+    size_t channel = 0;
+    frequency freq = 0;
+    int strength = 0;
+    bool signal = false;
+    std::chrono::steady_clock::time_point when;
+};
+
+// Steps a radio through a list of channels reading the signal strength on
+// each one. Every step is a retune, a wait for the receiver to settle and a
+// strength read. The retune to the next channel is sent right behind the
+// strength read so the two share a trip to the radio. How long to wait for
+// the receiver is learned as the scan runs by now and then reading a
+// channel twice and seeing if the reading moved.
+//
+// A channel with a signal on it stops the scan until the signal has been
+// gone for resume_delay. Priority channels are looked at every
+// priority_period no matter where the scan is and locked out channels are
+// never looked at. Every reading goes to the subscribers of results.
+//
+// The scanner has to run on the loop of the radio and everything here must
+// only be touched from that loop.
+class radio_scanner : public runloop_item {
+    public:
+        using clock_type = std::chrono::steady_clock;
+        static constexpr size_t no_channel = std::numeric_limits<size_t>::max();
+
+        struct channel_type {
+            frequency freq = 0;
+            // the last reading and when it was taken
+            int strength = 0;
+            clock_type::time_point when;
+            bool priority = false;
+            bool locked = false;
+        };
+
+        struct stats_type {
+            uint64_t steps = 0;
+            uint64_t failures = 0;
+            uint64_t sweeps = 0;
+            uint64_t signals = 0;
+            uint64_t settle_checks = 0;
+            double channels_per_second = 0;
+            std::chrono::microseconds settle{0};
+        };
+
+    private:
+        enum class phase_type {
+            idle,
+            tuning,
+            settling,
+            reading,
+            checking,
+            holding,
+        };
+
+        enum flag_bits : uint8_t {
+            flag_priority = 1 << 0,
+            flag_locked = 1 << 1,
+        };
+
+        // where the scan goes next
+        struct cursor_type {
+            size_t position = 0;
+            size_t priority_position = 0;
+            clock_type::time_point priority_due;
+            uint64_t sweeps = 0;
+        };
+
+        std::shared_ptr<radio> target;
+        boost::asio::steady_timer timer{*get_loop_ioptr()};
+        // one array per field so a sweep over the strengths stays dense
+        std::vector<frequency> frequencies;
+        std::vector<int16_t> strengths;
+        std::vector<clock_type::time_point> heard;
+        std::vector<uint8_t> flags;
+        cursor_type cursor;
+        bool running = false;
+        phase_type phase = phase_type::idle;
+        // bumped on stop so callbacks from an older run do nothing
+        uint64_t generation = 0;
+        // the channel the radio is tuned to or being tuned to
+        size_t tuned = no_channel;
+        // a channel that had a signal while the next one was being tuned
+        size_t hold_channel = no_channel;
+        clock_type::time_point hold_started;
+        clock_type::time_point last_signal;
+        int first_reading = 0;
+        // the next channel was tuned without waiting for this reading
+        bool pipelined = false;
+        bool check_pending = false;
+        bool last_had_signal = false;
+        uint64_t steps_since_check = 0;
+        std::chrono::microseconds settle;
+        clock_type::time_point started;
+        stats_type stats;
+
+        size_t next_channel(const clock_type::time_point& now_in);
+        void tune(const size_t& channel_in);
+        void tuned_done(const uint64_t& generation_in, const size_t& channel_in, const bool& ok_in);
+        void read(const size_t& channel_in, void (radio_scanner::*next_in)(const size_t&, const bool&, const int&));
+        void settled();
+        void first_read(const size_t& channel_in, const bool& ok_in, const int& strength_in);
+        void check_read(const size_t& channel_in, const bool& ok_in, const int& strength_in);
+        void hold_read(const size_t& channel_in, const bool& ok_in, const int& strength_in);
+        void record(const size_t& channel_in, const int& strength_in);
+        void start_hold();
+        void advance();
+        void wait(const clock_type::duration& wait_in, void (radio_scanner::*next_in)());
+
+    public:
+        // in dB over S9; S5 is -24
+        int threshold = -24;
+        std::chrono::microseconds min_settle{2000};
+        std::chrono::microseconds max_settle{500000};
+        // readings this far apart mean the receiver had not settled
+        int settle_tolerance = 6;
+        // a channel is read twice every this many steps
+        uint64_t settle_check_every = 32;
+        std::chrono::milliseconds priority_period{2000};
+        // how long a channel has to be quiet before the scan moves on
+        std::chrono::milliseconds resume_delay{2000};
+        // the scan moves on after this long even with a signal; 0 waits forever
+        std::chrono::milliseconds max_hold{0};
+        std::chrono::milliseconds hold_poll{100};
+        event_source<const scan_result&> results;
+
+        radio_scanner(std::shared_ptr<runloop> loop_in, std::shared_ptr<radio> radio_in,
+                      const std::chrono::microseconds& settle_in = std::chrono::microseconds(30000));
+        size_t add_channel(const frequency& freq_in, const bool& priority_in = false);
+        // every step_in from start_in up to and including stop_in
+        void add_range(const frequency& start_in, const frequency& stop_in, const frequency& step_in);
+        void clear();
+        size_t size() const { return frequencies.size(); }
+        channel_type get_channel(const size_t& channel_in) const;
+        void set_priority(const size_t& channel_in, const bool& priority_in);
+        void set_lockout(const size_t& channel_in, const bool& locked_in);
+        // the channel a signal is holding the scan on or no_channel
+        size_t get_holding() const;
+        stats_type get_stats() const;
+        void stop();
+        virtual void start__child() override;
+};
+
+}
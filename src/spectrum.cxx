@@ -0,0 +1,172 @@
+/*
+ * spectrum.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "spectrum.h"
+#include "system.h"
+
+namespace oemros {
+
+// what an empty bin and a fresh peak hold read as
+#define SPECTRUM_FLOOR_DB -200.0f
+
+spectrum_ring::spectrum_ring(const size_t& frames_in, const size_t& bins_in)
+: bins(bins_in), frames(frames_in), slots(new slot_type[frames_in]), data(frames_in * bins_in * 2, SPECTRUM_FLOOR_DB) {
+    if (frames == 0 || bins == 0) system_fault("spectrum ring needs at least one frame and one bin");
+}
+
+void spectrum_ring::begin(float*& power_out, float*& peak_out) {
+    writing = published.load(std::memory_order_relaxed) + 1;
+
+    auto index = (writing - 1) % frames;
+    auto& slot = slots[index];
+
+    slot.version.store(slot.version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    power_out = data.data() + index * bins * 2;
+    peak_out = power_out + bins;
+}
+
+void spectrum_ring::publish(const clock_type::time_point& when_in) {
+    auto& slot = slots[(writing - 1) % frames];
+
+    slot.sequence.store(writing, std::memory_order_relaxed);
+    slot.when.store(when_in.time_since_epoch().count(), std::memory_order_relaxed);
+    slot.version.store(slot.version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    published.store(writing, std::memory_order_release);
+}
+
+static std::vector<float> spectrum_window(const spectrum_config::window_type& type_in, const size_t& size_in) {
+    std::vector<float> result(size_in, 1.0f);
+
+    for(size_t i = 0; i < size_in; i++) {
+        auto x = 2 * M_PI * i / size_in;
+
+        switch(type_in) {
+            case spectrum_config::window_type::rectangular:
+                break;
+            case spectrum_config::window_type::hann:
+                result[i] = 0.5 - 0.5 * std::cos(x);
+                break;
+            case spectrum_config::window_type::blackman_harris:
+                result[i] = 0.35875 - 0.48829 * std::cos(x) + 0.14128 * std::cos(2 * x) - 0.01168 * std::cos(3 * x);
+                break;
+        }
+    }
+
+    return result;
+}
+
+spectrum::spectrum(const spectrum_config& config_in)
+: config(config_in), bins(config_in.iq ? config_in.size : config_in.size / 2),
+  hop(std::max<size_t>(1, std::lrint(config_in.size * (1 - config_in.overlap)))),
+  frame_samples(config_in.frame_rate > 0 ? config_in.rate / config_in.frame_rate : 0),
+  fft(config_in.size), window(spectrum_window(config_in.window, config_in.size)),
+  history_re(config_in.size, 0), history_im(config_in.size, 0), work_re(config_in.size), work_im(config_in.size),
+  average(bins, 0), peak(bins, SPECTRUM_FLOOR_DB), ring(config_in.ring_frames, bins) {
+    if (config.overlap < 0 || config.overlap >= 1) system_fault("spectrum overlap must be at least 0 and under 1");
+    if (config.frame_rate <= 0) system_fault("spectrum frame rate must be more than 0");
+    if (config.averaging < 0 || config.averaging >= 1) system_fault("spectrum averaging must be at least 0 and under 1");
+
+    // a tone at full scale comes out of the window at its coherent gain and
+    // for audio half of that lands in the positive frequency bin
+    double gain = 0;
+    for(auto i : window) gain += i;
+    if (! config.iq) gain /= 2;
+    scale = 1 / (gain * gain);
+}
+
+void spectrum::process(const float* samples_in, const size_t& frames_in) {
+    auto step = config.iq ? 2 : 1;
+
+    for(size_t i = 0; i < frames_in; i++) {
+        history_re[position] = samples_in[i * step];
+        history_im[position] = config.iq ? samples_in[i * step + 1] : 0;
+        if (++position == config.size) position = 0;
+        if (filled < config.size) filled++;
+
+        if (filled == config.size && ++since_fft >= hop) {
+            since_fft = 0;
+            transform();
+        }
+
+        since_frame += 1;
+        if (since_frame >= frame_samples) {
+            since_frame -= frame_samples;
+            if (fresh) publish();
+        }
+    }
+}
+
+// the window goes on and the samples go into bit reversed order in the
+// same pass
+void spectrum::transform() {
+    auto& reversed = fft.get_reversed();
+
+    for(size_t i = 0; i < config.size; i++) {
+        auto from = position + i < config.size ? position + i : position + i - config.size;
+        work_re[reversed[i]] = history_re[from] * window[i];
+        work_im[reversed[i]] = history_im[from] * window[i];
+    }
+
+    fft.forward_reversed(work_re.data(), work_im.data());
+
+    // IQ is turned around so negative frequencies come first
+    auto shift = config.iq ? config.size / 2 : 0;
+    auto keep = primed ? config.averaging : 0.0f;
+
+    for(size_t bin = 0; bin < bins; bin++) {
+        auto from = bin + shift < config.size ? bin + shift : bin + shift - config.size;
+        auto power = (work_re[from] * work_re[from] + work_im[from] * work_im[from]) * scale;
+        average[bin] = power + (average[bin] - power) * keep;
+    }
+
+    primed = true;
+    fresh = true;
+    ffts++;
+}
+
+void spectrum::publish() {
+    float* power;
+    float* held;
+    auto decay = config.peak_decay_db / config.frame_rate;
+
+    ring.begin(power, held);
+
+    for(size_t bin = 0; bin < bins; bin++) {
+        auto db = average[bin] > 0 ? std::max(SPECTRUM_FLOOR_DB, 10 * std::log10(average[bin])) : SPECTRUM_FLOOR_DB;
+        peak[bin] = std::max(peak[bin] - decay, db);
+        power[bin] = db;
+        held[bin] = peak[bin];
+    }
+
+    ring.publish(spectrum_ring::clock_type::now());
+    fresh = false;
+}
+
+void spectrum::reset_peak() {
+    std::fill(peak.begin(), peak.end(), SPECTRUM_FLOOR_DB);
+}
+
+}
@@ -0,0 +1,182 @@
+/*
+ * spectrum.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "dsp.h"
+#include "object.h"
+
+namespace oemros {
+
+// Frames of spectrum that one writer publishes and any number of viewers
+// look at where they sit. Each slot has a version that is odd while it is
+// being written so a viewer can tell afterwards if the frame changed under
+// it; nothing waits on anything. A viewer has the ring length in frame
+// periods to look before a slot comes around again.
+class spectrum_ring {
+    public:
+        using clock_type = std::chrono::steady_clock;
+
+        struct view_type {
+            // counts up from 1 for each frame published
+            uint64_t sequence = 0;
+            clock_type::time_point when;
+            size_t bins = 0;
+            // in dBFS, bins long, lowest frequency first
+            const float* power = nullptr;
+            const float* peak = nullptr;
+        };
+
+    private:
+        struct slot_type {
+            std::atomic<uint64_t> version{0};
+            std::atomic<uint64_t> sequence{0};
+            std::atomic<clock_type::rep> when{0};
+        };
+
+        const size_t bins;
+        const size_t frames;
+        std::unique_ptr<slot_type[]> slots;
+        // power then peak for each slot
+        std::vector<float> data;
+        std::atomic<uint64_t> published{0};
+        // writer only
+        uint64_t writing = 0;
+
+    public:
+        spectrum_ring(const size_t& frames_in, const size_t& bins_in);
+        size_t get_bins() const { return bins; }
+        size_t get_frames() const { return frames; }
+        // the newest frame or 0 if there has not been one
+        uint64_t latest() const { return published.load(std::memory_order_acquire); }
+
+        // writer only; fill both arrays between begin and publish
+        void begin(float*& power_out, float*& peak_out);
+        void publish(const clock_type::time_point& when_in);
+
+        // Calls viewer_in with the frame if it is still in the ring. False
+        // means the frame was gone or was written over while the viewer
+        // looked and whatever the viewer made of it has to be thrown away.
+        template <typename Viewer>
+        bool view(const uint64_t& sequence_in, Viewer&& viewer_in) const {
+            if (sequence_in == 0) return false;
+
+            auto& slot = slots[(sequence_in - 1) % frames];
+            auto before = slot.version.load(std::memory_order_acquire);
+            if (before & 1 || slot.sequence.load(std::memory_order_relaxed) != sequence_in) return false;
+
+            view_type view;
+            view.sequence = sequence_in;
+            view.when = clock_type::time_point(clock_type::duration(slot.when.load(std::memory_order_relaxed)));
+            view.bins = bins;
+            view.power = data.data() + (sequence_in - 1) % frames * bins * 2;
+            view.peak = view.power + bins;
+
+            viewer_in(static_cast<const view_type&>(view));
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return slot.version.load(std::memory_order_relaxed) == before;
+        }
+};
+
+struct spectrum_config {
+    enum class window_type {
+        rectangular,
+        hann,
+        blackman_harris,
+    };
+
+    // points in each FFT; a power of 2
+    size_t size = 2048;
+    // input is interleaved I and Q instead of a single channel of audio
+    bool iq = false;
+    unsigned int rate = 48000;
+    window_type window = window_type::blackman_harris;
+    // how much of each FFT is shared with the next one, from 0 to under 1
+    float overlap = 0.5;
+    // frames published a second; every FFT in between goes into the average
+    float frame_rate = 25;
+    // 0 shows each FFT as it is and closer to 1 smooths more over FFTs
+    float averaging = 0.7f;
+    // how fast peak hold falls back in dB a second; 0 holds forever
+    float peak_decay_db = 20;
+    size_t ring_frames = 8;
+};
+
+// Turns a stream of audio or IQ into spectrum frames for a panadapter or
+// waterfall. process() takes the samples as they come, runs a windowed FFT
+// every hop, averages the power and now and then publishes a frame into
+// the ring. It does not allocate and is meant to be called from an audio
+// stream handler.
+//
+// Audio gives size / 2 bins from 0 to just under half the rate. IQ gives
+// size bins from minus half the rate to just under half the rate with the
+// center frequency in the middle.
+class spectrum : public baseobj {
+    private:
+        const spectrum_config config;
+        const size_t bins;
+        const size_t hop;
+        const double frame_samples;
+        dsp_fft fft;
+        std::vector<float> window;
+        // normalizes power so a full scale tone reads 0 dBFS
+        float scale;
+        // the last size samples, oldest at position
+        std::vector<float> history_re, history_im;
+        size_t position = 0;
+        size_t filled = 0;
+        size_t since_fft = 0;
+        double since_frame = 0;
+        std::vector<float> work_re, work_im;
+        std::vector<float> average;
+        std::vector<float> peak;
+        bool primed = false;
+        // an FFT went into the average since the last frame
+        bool fresh = false;
+        uint64_t ffts = 0;
+        spectrum_ring ring;
+
+        void transform();
+        void publish();
+
+    public:
+        spectrum(const spectrum_config& config_in);
+        const spectrum_config& get_config() const { return config; }
+        spectrum_ring& get_ring() { return ring; }
+        size_t get_bins() const { return bins; }
+        double get_hertz_per_bin() const { return (double)config.rate / config.size; }
+        // the frequency of bin 0 relative to the center for IQ or 0 for audio
+        double get_first_hertz() const { return config.iq ? -(double)config.rate / 2 : 0; }
+        uint64_t get_ffts() const { return ffts; }
+        // frames_in is in samples for audio and I/Q pairs for IQ
+        void process(const float* samples_in, const size_t& frames_in);
+        // on the same thread as process()
+        void reset_peak();
+};
+
+}
@@ -0,0 +1,316 @@
+/*
+ * station.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+#include "logging.h"
+#include "station.h"
+#include "system.h"
+
+namespace oemros {
+
+// how often repeaters that are waiting on their rigs are looked at
+#define STATION_CHECK_MSEC 250
+// the repeater playback ring sets its latency so it is kept short
+#define STATION_PLAYBACK_BLOCKS 4
+
+// the keys of one section; every value is a scalar
+class station_section {
+    private:
+        const turboini_document& document;
+        const turboini_document::section_id section;
+
+        turboini_error bad(const turboini_value& value_in, const std::string_view& key_in, const std::string& wanted_in) const {
+            return turboini_error(document.get_path(value_in), value_in.line, value_in.column,
+                                  vaargs_to_string(key_in, " should be ", wanted_in));
+        }
+
+        // nullptr if an optional key is not there
+        const turboini_value* find(const std::string_view& key_in, const bool& required_in) const {
+            auto value = document.find(section, key_in);
+
+            if (value == nullptr) {
+                if (! required_in) return nullptr;
+                throw turboini_error(document.get_section_path(section), document.get_section_line(section), 1,
+                                     vaargs_to_string("[", document.get_section_name(section), "] needs ", key_in));
+            }
+
+            if (value->type != turboini_value::type_type::scalar) throw bad(*value, key_in, "a single value");
+            return value;
+        }
+
+    public:
+        station_section(const turboini_document& document_in, const turboini_document::section_id& section_in)
+        : document(document_in), section(section_in) { }
+
+        bool get_string(const std::string_view& key_in, std::string& value_out, const bool& required_in = false) const {
+            auto value = find(key_in, required_in);
+            if (value == nullptr) return false;
+
+            value_out = value->escaped ? turboini_unescape(value->text) : std::string(value->text);
+            return true;
+        }
+
+        bool get_integer(const std::string_view& key_in, int64_t& value_out, const bool& required_in = false) const {
+            auto value = find(key_in, required_in);
+            if (value == nullptr) return false;
+
+            if (! turboini_to_integer(value->text, value_out)) throw bad(*value, key_in, "a whole number");
+            return true;
+        }
+
+        bool get_real(const std::string_view& key_in, double& value_out, const bool& required_in = false) const {
+            auto value = find(key_in, required_in);
+            if (value == nullptr) return false;
+
+            if (! turboini_to_real(value->text, value_out) || ! std::isfinite(value_out)) throw bad(*value, key_in, "a number");
+            return true;
+        }
+
+        // like -30db; the db can be left off
+        bool get_db(const std::string_view& key_in, float& value_out) const {
+            auto value = find(key_in, false);
+            if (value == nullptr) return false;
+
+            auto text = value->text;
+            if (text.size() >= 2 && std::tolower(text[text.size() - 2]) == 'd' && std::tolower(text.back()) == 'b') {
+                text.remove_suffix(2);
+            }
+
+            double level;
+            if (! turboini_to_real(text, level) || ! std::isfinite(level)) throw bad(*value, key_in, "a level like -30db");
+            value_out = level;
+            return true;
+        }
+
+        bool get_mhz(const std::string_view& key_in, frequency& value_out) const {
+            double mhz;
+            if (! get_real(key_in, mhz)) return false;
+
+            if (mhz < 0) throw bad(*document.find(section, key_in), key_in, "a frequency in MHz");
+            value_out = std::llround(mhz * 1000000);
+            return true;
+        }
+
+        bool get_mode(const std::string_view& key_in, radio::mode& value_out) const {
+            std::string text;
+            if (! get_string(key_in, text)) return false;
+
+            std::transform(text.begin(), text.end(), text.begin(), [](const char& char_in) { return std::tolower(char_in); });
+
+            if (text == "am") value_out = radio::mode::am;
+            else if (text == "cw") value_out = radio::mode::cw;
+            else if (text == "usb") value_out = radio::mode::usb;
+            else if (text == "lsb") value_out = radio::mode::lsb;
+            else if (text == "fm") value_out = radio::mode::fm;
+            else throw bad(*document.find(section, key_in), key_in, "one of AM, CW, USB, LSB or FM");
+
+            return true;
+        }
+
+        bool get_seconds(const std::string_view& key_in, std::chrono::milliseconds& value_out) const {
+            double seconds;
+            if (! get_real(key_in, seconds)) return false;
+
+            if (seconds < 0) throw bad(*document.find(section, key_in), key_in, "a time in seconds");
+            value_out = std::chrono::milliseconds(std::llround(seconds * 1000));
+            return true;
+        }
+
+        // the key of a value that has to name something
+        turboini_error missing(const std::string_view& key_in, const std::string& what_in) const {
+            return bad(*document.find(section, key_in), key_in, vaargs_to_string("the name of a ", what_in));
+        }
+};
+
+static transceiver_config load_transceiver(const station_section& section_in) {
+    transceiver_config result;
+    int64_t number;
+
+    section_in.get_string("name", result.rig.name, true);
+    section_in.get_integer("hamlib.rigid", number, true);
+    result.rig.model = number;
+    section_in.get_string("hamlib.serial.port", result.rig.port);
+    if (section_in.get_integer("hamlib.serial.speed", number)) result.rig.speed = number;
+
+    section_in.get_string("audio.engine", result.audio_engine);
+    // the null engine has no device to name
+    if (! result.audio_engine.empty()) section_in.get_string("audio.device", result.audio_device, result.audio_engine != "null");
+    section_in.get_db("audio.input.gain", result.input_gain_db);
+    section_in.get_db("audio.output.gain", result.output_gain_db);
+
+    return result;
+}
+
+static repeater_config load_repeater(const station_section& section_in, const std::vector<transceiver_config>& transceivers_in) {
+    repeater_config result;
+    int64_t number;
+    float gain = 0;
+
+    auto find_transceiver = [&](const std::string_view& key_in, const std::string& name_in) -> const transceiver_config& {
+        for(auto&& i : transceivers_in) {
+            if (i.rig.name == name_in) {
+                if (i.audio_engine.empty()) throw section_in.missing(key_in, "transceiver with audio");
+                return i;
+            }
+        }
+
+        throw section_in.missing(key_in, "transceiver");
+    };
+
+    section_in.get_string("name", result.name, true);
+
+    section_in.get_string("receiver.name", result.receiver_name, true);
+    auto& receiver = find_transceiver("receiver.name", result.receiver_name);
+    // the rig is left as it is unless the section says otherwise
+    result.receiver_mode = radio::mode::unknown;
+    section_in.get_mhz("receiver.freq", result.receiver_freq);
+    section_in.get_mode("receiver.mode", result.receiver_mode);
+
+    section_in.get_string("transmitter.name", result.transmitter_name, true);
+    auto& transmitter = find_transceiver("transmitter.name", result.transmitter_name);
+    result.transmitter_mode = radio::mode::unknown;
+    section_in.get_mhz("transmitter.freq", result.transmitter_freq);
+    section_in.get_mode("transmitter.mode", result.transmitter_mode);
+
+    section_in.get_db("squelch.open", result.open_db);
+    section_in.get_db("squelch.close", result.close_db);
+    if (section_in.get_integer("squelch.blocks", number)) result.open_blocks = std::max<int64_t>(1, number);
+    section_in.get_seconds("hang", result.hang);
+    section_in.get_seconds("key.hold", result.key_hold);
+    section_in.get_seconds("timeout", result.time_out);
+
+    section_in.get_db("gain", gain);
+    result.output_gain_db = receiver.input_gain_db + gain + transmitter.output_gain_db;
+
+    return result;
+}
+
+station_config load_station_config(const turboini_document& document_in) {
+    station_config result;
+
+    for(auto range = document_in.get_sections("transceiver"); range.first != range.second; range.first++) {
+        station_section section(document_in, *range.first);
+        result.transceivers.push_back(load_transceiver(section));
+
+        auto& name = result.transceivers.back().rig.name;
+        for(size_t i = 0; i + 1 < result.transceivers.size(); i++) {
+            if (result.transceivers[i].rig.name == name) throw section.missing("name", "transceiver nothing else has");
+        }
+    }
+
+    for(auto range = document_in.get_sections("repeater"); range.first != range.second; range.first++) {
+        result.repeaters.push_back(load_repeater(station_section(document_in, *range.first), result.transceivers));
+    }
+
+    return result;
+}
+
+station::station(std::shared_ptr<runloop> loop_in, const station_config& config_in, const audio_format& format_in)
+: runloop_item(loop_in), config(config_in) {
+    for(auto&& i : config.transceivers) rigs->add(i.rig);
+
+    for(auto&& i : config.repeaters) {
+        auto& receiver = get_transceiver(i.receiver_name);
+        auto& transmitter = get_transceiver(i.transmitter_name);
+
+        auto capture = audio->add(i.receiver_name, audio_stream::direction::capture, receiver.audio_engine, receiver.audio_device, format_in);
+        auto playback = audio->add(i.transmitter_name, audio_stream::direction::playback, transmitter.audio_engine, transmitter.audio_device,
+                                   format_in, STATION_PLAYBACK_BLOCKS);
+        if (capture == nullptr || playback == nullptr) system_fault("repeater ", i.name, " has an audio engine that is not available");
+
+        repeaters.push_back(std::make_shared<repeater>(loop_in, i, rigs->get_radio(i.receiver_name), rigs->get_radio(i.transmitter_name),
+                                                       capture, playback));
+    }
+
+    started.assign(repeaters.size(), false);
+}
+
+const transceiver_config& station::get_transceiver(const std::string& name_in) const {
+    for(auto&& i : config.transceivers) {
+        if (i.rig.name == name_in) return i;
+    }
+
+    system_fault("no transceiver named ", name_in);
+}
+
+void station::start__child() {
+    running = true;
+    rigs->start();
+    check();
+}
+
+void station::stop() {
+    running = false;
+    timer.cancel();
+
+    for(size_t i = 0; i < repeaters.size(); i++) {
+        if (started[i]) repeaters[i]->stop();
+    }
+
+    audio->stop();
+    rigs->stop();
+}
+
+void station::join() {
+    rigs->join();
+}
+
+void station::check() {
+    if (! running) return;
+
+    auto health = rigs->get_health();
+    auto is_open = [&](const std::string& name_in) {
+        for(auto&& i : health) {
+            if (i.name == name_in) return i.open;
+        }
+
+        return false;
+    };
+
+    for(size_t i = 0; i < repeaters.size(); i++) {
+        if (started[i]) continue;
+
+        auto& wanted = repeaters[i]->get_config();
+        if (! is_open(wanted.receiver_name) || ! is_open(wanted.transmitter_name)) continue;
+
+        started[i] = true;
+        repeaters[i]->start();
+    }
+
+    if (std::find(started.begin(), started.end(), false) != started.end()) arm();
+}
+
+void station::arm() {
+    std::weak_ptr<baseobj> weak_us = shared_from_this();
+
+    timer.expires_after(std::chrono::milliseconds(STATION_CHECK_MSEC));
+    timer.async_wait([this, weak_us](const boost::system::error_code& error_in) {
+        auto strong_us = weak_us.lock();
+        if (strong_us == nullptr || error_in == boost::asio::error::operation_aborted) return;
+        if (error_in) system_fault("station timer failed: ", error_in.message());
+        check();
+    });
+}
+
+}
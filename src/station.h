@@ -0,0 +1,92 @@
+/*
+ * station.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <boost/asio.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "audio.h"
+#include "manager.h"
+#include "repeater.h"
+#include "runloop.h"
+#include "turboini.h"
+
+namespace oemros {
+
+// What a [transceiver] section says. Gains are written like -30db.
+struct transceiver_config {
+    rig_config rig;
+    // empty when the transceiver has no audio
+    std::string audio_engine;
+    std::string audio_device;
+    float input_gain_db = 0;
+    float output_gain_db = 0;
+};
+
+struct station_config {
+    std::vector<transceiver_config> transceivers;
+    std::vector<repeater_config> repeaters;
+};
+
+// Reads every [transceiver] and [repeater] section. Frequencies are in MHz,
+// modes are written like FM and times are in seconds. A [repeater] can also
+// have squelch.open, squelch.close, squelch.blocks, hang, key.hold, timeout
+// and gain; its gain is on top of the receiver's audio.input.gain and the
+// transmitter's audio.output.gain. Throws turboini_error for a value that is
+// missing, not written right or names a transceiver that is not there.
+station_config load_station_config(const turboini_document& document_in);
+
+// Runs what a config describes on the loop it is made on. Each transceiver
+// becomes a rig of its own and each repeater gets the capture side of its
+// receiver's audio and the playback side of its transmitter's. A repeater
+// starts once both of its rigs are open since a rig that is not open can
+// not be tuned or keyed.
+class station : public runloop_item {
+    private:
+        const station_config config;
+        std::shared_ptr<rig_manager> rigs = std::make_shared<rig_manager>();
+        std::shared_ptr<audio_engine> audio = std::make_shared<audio_engine>();
+        std::vector<std::shared_ptr<repeater>> repeaters;
+        std::vector<bool> started;
+        boost::asio::steady_timer timer{*get_loop_ioptr()};
+        bool running = false;
+
+        const transceiver_config& get_transceiver(const std::string& name_in) const;
+        void check();
+        void arm();
+
+    public:
+        station(std::shared_ptr<runloop> loop_in, const station_config& config_in, const audio_format& format_in = audio_format());
+        std::shared_ptr<rig_manager> get_rigs() { return rigs; }
+        std::shared_ptr<audio_engine> get_audio() { return audio; }
+        // made with the station and never changes so any thread can look
+        const std::vector<std::shared_ptr<repeater>>& get_repeaters() const { return repeaters; }
+        // unkeys and stops the repeaters, the audio and the rigs
+        void stop();
+        // returns once every rig thread has exited
+        void join();
+        virtual void start__child() override;
+};
+
+}
@@ -0,0 +1,137 @@
+/*
+ * synthetic.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cmath>
+#include <thread>
+
+#include "synthetic.h"
+
+namespace oemros {
+
+// how many reads one trip through the meter waveforms takes
+#define SYNTHETIC_METER_PERIOD 200
+
+synthetic_radio::synthetic_radio(std::shared_ptr<runloop> loop_in, const config_type& config_in)
+: radio(loop_in), config(config_in), random_state(config_in.seed) {
+    vfo.tuner = config.base;
+}
+
+// 64 bit LCG with Knuth's MMIX constants; the high bits are the good ones
+uint64_t synthetic_radio::next_random() {
+    random_state = random_state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return random_state >> 11;
+}
+
+double synthetic_radio::next_unit() {
+    return next_random() * (1.0 / (1ULL << 53));
+}
+
+bool synthetic_radio::begin_read() {
+    stats.reads++;
+
+    if (config.latency.count() > 0) std::this_thread::sleep_for(config.latency);
+
+    if (config.error_rate > 0 && next_unit() < config.error_rate) {
+        stats.errors++;
+        return false;
+    }
+
+    return true;
+}
+
+bool synthetic_radio::begin_poll(const enum update& field_in) {
+    if (! begin_read()) return false;
+    report_round_trip(field_in, config.latency);
+    return true;
+}
+
+void synthetic_radio::update__alc() {
+    if (! begin_poll(update::alc)) return;
+    auto phase = (meter_step % SYNTHETIC_METER_PERIOD) / (double)SYNTHETIC_METER_PERIOD;
+    meters.alc = 0.5 + 0.5 * std::sin(phase * 2 * M_PI);
+}
+
+void synthetic_radio::update__power() {
+    if (! begin_poll(update::power)) return;
+    meters.power = 90 + 10 * next_unit();
+}
+
+// a triangle from 1 to 3 with a little noise on top
+void synthetic_radio::update__swr() {
+    if (! begin_poll(update::swr)) return;
+    auto step = meter_step++ % SYNTHETIC_METER_PERIOD;
+    auto ramp = step < SYNTHETIC_METER_PERIOD / 2 ? step : SYNTHETIC_METER_PERIOD - step;
+    meters.swr = 1 + 4.0 * ramp / SYNTHETIC_METER_PERIOD + 0.05 * next_unit();
+}
+
+void synthetic_radio::update__tuner() {
+    if (! begin_poll(update::tuner)) return;
+    if (config.retune_rate < 1 && next_unit() >= config.retune_rate) return;
+    vfo.tuner = config.base + (config.span > 0 ? next_random() % config.span : 0);
+}
+
+void synthetic_radio::update__ptt() {
+    if (! begin_poll(update::ptt)) return;
+    if (config.ptt_every == 0) return;
+    ptt = (ptt_reads++ / config.ptt_every) % 2 == 1;
+}
+
+void synthetic_radio::set_frequency(const frequency& freq_in, const set_done<frequency>& done_in) {
+    {
+        batch scope(*this);
+        vfo.tuner = freq_in;
+    }
+
+    if (done_in) done_in(true, freq_in);
+}
+
+void synthetic_radio::set_ptt(const bool& ptt_in, const set_done<bool>& done_in) {
+    {
+        batch scope(*this);
+        ptt = ptt_in;
+    }
+
+    if (done_in) done_in(true, ptt_in);
+}
+
+// which frequencies are busy and how strong they are only depends on the
+// seed so a scan finds the same signals every time
+void synthetic_radio::read_strength(const read_done<int>& done_in) {
+    if (! begin_read()) {
+        if (done_in) done_in(false, 0);
+        return;
+    }
+
+    uint64_t mixed = (vfo.tuner.get() ^ config.seed) * 0x9E3779B97F4A7C15ULL;
+    mixed ^= mixed >> 29;
+    auto busy = (mixed >> 11) * (1.0 / (1ULL << 53));
+    int strength;
+
+    if (busy < config.busy_rate) {
+        strength = -24 + (int)(mixed % 54);
+    } else {
+        strength = -54 + (int)(next_unit() * 6);
+    }
+
+    if (done_in) done_in(true, strength);
+}
+
+}
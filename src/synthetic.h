@@ -0,0 +1,91 @@
+/*
+ * synthetic.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include "radio.h"
+#include "runloop.h"
+
+namespace oemros {
+
+// A radio with no hardware behind it. Every read makes up the next value
+// of a deterministic stream so two radios with the same seed produce the
+// same values in the same order. Reads can be made slow or made to fail to
+// stand in for a real link when load testing.
+class synthetic_radio : public radio {
+    public:
+        struct config_type {
+            uint64_t seed = 1;
+            frequency base = 14074000;
+            // the tuner wanders at most this far from base
+            frequency span = 10000;
+            // chance that the tuner moved since the last read
+            double retune_rate = 1;
+            // reads of ptt see it change every this many reads
+            uint64_t ptt_every = 64;
+            // how long each field read takes
+            std::chrono::microseconds latency{0};
+            // chance that a field read fails and leaves the value alone
+            double error_rate = 0;
+            // share of frequencies with a signal on them
+            double busy_rate = 0.0625;
+        };
+
+        struct stats_type {
+            uint64_t reads = 0;
+            uint64_t errors = 0;
+        };
+
+    private:
+        const config_type config;
+        uint64_t random_state;
+        uint64_t ptt_reads = 0;
+        uint64_t meter_step = 0;
+        stats_type stats;
+
+        uint64_t next_random();
+        double next_unit();
+        // true if the read should go ahead
+        bool begin_read();
+        // same for a poll of one field which reports the simulated round trip
+        bool begin_poll(const enum update& field_in);
+
+    protected:
+        virtual void update__alc() override;
+        virtual void update__power() override;
+        virtual void update__swr() override;
+        virtual void update__tuner() override;
+        virtual void update__ptt() override;
+
+    public:
+        synthetic_radio(std::shared_ptr<runloop> loop_in, const config_type& config_in);
+        stats_type get_stats() const { return stats; }
+        virtual void set_frequency(const frequency& freq_in, const set_done<frequency>& done_in = nullptr) override;
+        virtual void set_ptt(const bool& ptt_in, const set_done<bool>& done_in = nullptr) override;
+        // done_in runs before this returns
+        virtual void read_strength(const read_done<int>& done_in) override;
+};
+
+}
@@ -25,6 +25,8 @@
 namespace oemros_unix {
 
 #include <cassert>
+#include <pthread.h>
+#include <sched.h>
 #include <signal.h>
 #include <unistd.h>
 
@@ -46,7 +48,12 @@ void os_setup_kill_timer(unsigned int seconds_in) {
     assert(alarm_result == 0);
 }
 
-}
-
+// needs CAP_SYS_NICE or an rtprio limit so failing is normal
+bool os_set_thread_realtime(const int& priority_in) {
+    struct sched_param param;
+    param.sched_priority = priority_in;
 
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+}
 
+}
@@ -24,6 +24,8 @@
 namespace oemros_unix {
 
 void os_setup_kill_timer(unsigned int seconds_in);
+// moves the calling thread to the SCHED_FIFO scheduler
+bool os_set_thread_realtime(const int& priority_in);
 
 }
 
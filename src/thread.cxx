@@ -19,14 +19,15 @@
  *
  */
 
+#include <atomic>
+
 #include "thread.h"
 
 namespace oemros {
 
-static thread_queue global_thread_queue;
-
 uint64_t thread_next_jobid() {
-    static uint64_t last_jobid = 0;
+    // jobs are added from any thread
+    static std::atomic<uint64_t> last_jobid = ATOMIC_VAR_INIT(0);
     return ++last_jobid;
 }
 
@@ -41,8 +42,18 @@ boost::unique_lock<boost::mutex> thread_queue::get_lock() {
     return boost::unique_lock<boost::mutex>(mutex);
 }
 
+std::shared_ptr<thread_queue> thread_queue::get_global() {
+    // the workers never exit so the global queue is never destroyed
+    static auto global_thread_queue = new std::shared_ptr<thread_queue>(std::make_shared<thread_queue>());
+    return *global_thread_queue;
+}
+
 std::shared_ptr<thread_queue::job> thread_queue::add(const thread_queue::cb_type& cb_in) {
-    return global_thread_queue.add__priv(cb_in);
+    return get_global()->add__priv(cb_in);
+}
+
+void thread_queue::post(const std::function<void ()>& post_in) {
+    add__priv([post_in](std::shared_ptr<job>) { post_in(); });
 }
 
 std::shared_ptr<thread_queue::job> thread_queue::add__priv(const thread_queue::cb_type& cb_in) {
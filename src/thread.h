@@ -23,6 +23,7 @@
 
 #include <boost/thread.hpp>
 #include <functional>
+#include <list>
 #include <memory>
 
 #include "object.h"
@@ -54,7 +55,11 @@ class thread_queue : public baseobj {
 
     public:
         thread_queue();
+        // the queue used by add()
+        static std::shared_ptr<thread_queue> get_global();
         static std::shared_ptr<job> add(const cb_type& cb_in);
+        // run post_in on one of this queue's workers
+        void post(const std::function<void ()>& post_in);
 };
 
 }
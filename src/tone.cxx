@@ -0,0 +1,386 @@
+/*
+ * tone.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <utility>
+
+#include "system.h"
+#include "tone.h"
+
+namespace oemros {
+
+// the decimated rate is about this; high enough for DCS bits and the top
+// CTCSS tone and low enough that a Goertzel bank over it costs nothing
+#define TONE_DECIMATED_HZ 1600
+// the CIC gain is the decimation squared and that has to fit in 32 bits
+#define TONE_MAX_DECIMATION 255
+// bins of a window this long are 4 Hz wide so the closest tones, 2.3 Hz
+// apart, still leak into each other; each bin sits right on its tone and a
+// tone lands about 5 dB down in its neighbour's bin so the strongest wins
+#define TONE_WINDOW_MSEC 250
+// fourth order filter ahead of the CTCSS bank that keeps voice out and
+// costs the top tone 3 dB
+#define TONE_CTCSS_LOWPASS_HZ 260.0f
+// share of the window energy the strongest tone needs to count
+#define TONE_CTCSS_MIN_FRACTION 0.25f
+// mean square of a window below this is silence
+#define TONE_MIN_ENERGY 1e-7f
+// windows or code words in a row to believe a tone and to let it go
+#define TONE_HITS 2
+#define TONE_MISSES 2
+#define TONE_DCS_BAUD 134.4f
+// Golay(23,12) generator x^11 + x^10 + x^6 + x^5 + x^4 + x^2 + 1
+#define TONE_GOLAY_POLY 0xc75
+// corner of the fourth order DCS bit filter which has to keep voice out
+#define TONE_DCS_LOWPASS_HZ 200.0f
+// how fast the slicer follows DC and the bit clock follows transitions
+#define TONE_DCS_DC_RATE 0.002f
+#define TONE_DCS_PLL_GAIN 0.25f
+// the CIC takes whole blocks of this many samples at a time
+#define TONE_CHUNK 256
+
+tone_code tone_code::ctcss(const float& hertz_in) {
+    tone_code result;
+    result.kind = kind_type::ctcss;
+    result.value = std::lrint(hertz_in * 10);
+    return result;
+}
+
+tone_code tone_code::dcs(const uint16_t& code_in, const bool& inverted_in) {
+    tone_code result;
+    result.kind = kind_type::dcs;
+    result.value = code_in;
+    result.inverted = inverted_in;
+    return result;
+}
+
+bool tone_code::operator==(const tone_code& other_in) const {
+    return kind == other_in.kind && inverted == other_in.inverted && value == other_in.value;
+}
+
+bool tone_code::operator<(const tone_code& other_in) const {
+    if (kind != other_in.kind) return kind < other_in.kind;
+    if (value != other_in.value) return value < other_in.value;
+    return inverted < other_in.inverted;
+}
+
+std::string tone_name(const tone_code& tone_in) {
+    char buffer[16];
+
+    switch(tone_in.kind) {
+        case tone_code::kind_type::ctcss:
+            snprintf(buffer, sizeof(buffer), "%u.%u Hz", tone_in.value / 10, tone_in.value % 10);
+            return buffer;
+        case tone_code::kind_type::dcs:
+            snprintf(buffer, sizeof(buffer), "D%03o%c", tone_in.value, tone_in.inverted ? 'I' : 'N');
+            return buffer;
+        case tone_code::kind_type::none:
+            break;
+    }
+
+    return "none";
+}
+
+const std::vector<float>& ctcss_tones() {
+    static const std::vector<float> tones{
+        67.0, 69.3, 71.9, 74.4, 77.0, 79.7, 82.5, 85.4, 88.5, 91.5,
+        94.8, 97.4, 100.0, 103.5, 107.2, 110.9, 114.8, 118.8, 123.0, 127.3,
+        131.8, 136.5, 141.3, 146.2, 151.4, 156.7, 159.8, 162.2, 165.5, 167.9,
+        171.3, 173.8, 177.3, 179.9, 183.5, 186.2, 189.9, 192.8, 196.6, 199.5,
+        203.5, 206.5, 210.7, 218.1, 225.7, 229.1, 233.6, 241.8, 250.3, 254.1,
+    };
+
+    return tones;
+}
+
+const std::vector<uint16_t>& dcs_codes() {
+    static const std::vector<uint16_t> codes{
+        0023, 0025, 0026, 0031, 0032, 0036, 0043, 0047, 0051, 0053, 0054, 0065, 0071, 0072, 0073, 0074,
+        0114, 0115, 0116, 0122, 0125, 0131, 0132, 0134, 0143, 0145, 0152, 0155, 0156, 0162, 0165, 0172,
+        0174, 0205, 0212, 0223, 0225, 0226, 0243, 0244, 0245, 0246, 0251, 0252, 0255, 0261, 0263, 0265,
+        0266, 0271, 0274, 0306, 0311, 0315, 0325, 0331, 0332, 0343, 0346, 0351, 0356, 0364, 0365, 0371,
+        0411, 0412, 0413, 0423, 0431, 0432, 0445, 0446, 0452, 0454, 0455, 0462, 0464, 0465, 0466, 0503,
+        0506, 0516, 0523, 0526, 0532, 0546, 0565, 0606, 0612, 0624, 0627, 0631, 0632, 0654, 0662, 0664,
+        0703, 0712, 0723, 0731, 0732, 0734, 0743, 0754,
+    };
+
+    return codes;
+}
+
+// the 12 data bits are the 9 bit code then 100 and the 11 Golay parity
+// bits come after them
+uint32_t dcs_word(const uint16_t& code_in) {
+    uint32_t data = (code_in & 0x1ff) | 0x800;
+    uint32_t remainder = data << 11;
+
+    for(int bit = 22; bit >= 11; bit--) {
+        if (remainder & (1u << bit)) remainder ^= TONE_GOLAY_POLY << (bit - 11);
+    }
+
+    return data | (remainder & 0x7ff) << 12;
+}
+
+using dcs_table_type = std::vector<std::pair<uint32_t, tone_code>>;
+
+// every code both ways up sorted by word; if two share a word the first
+// one in the list keeps it
+static const dcs_table_type& dcs_table() {
+    static const dcs_table_type table = [] {
+        dcs_table_type result;
+
+        for(auto inverted : { false, true }) {
+            for(auto code : dcs_codes()) {
+                auto word = dcs_word(code);
+                if (inverted) word = ~word & 0x7fffff;
+                result.emplace_back(word, tone_code::dcs(code, inverted));
+            }
+        }
+
+        std::stable_sort(result.begin(), result.end(), [](const auto& left_in, const auto& right_in) { return left_in.first < right_in.first; });
+        result.erase(std::unique(result.begin(), result.end(), [](const auto& left_in, const auto& right_in) { return left_in.first == right_in.first; }), result.end());
+        return result;
+    }();
+
+    return table;
+}
+
+static const tone_code* dcs_lookup(const uint32_t& word_in) {
+    auto& table = dcs_table();
+    auto found = std::lower_bound(table.begin(), table.end(), word_in, [](const auto& entry_in, const uint32_t& key_in) { return entry_in.first < key_in; });
+    if (found == table.end() || found->first != word_in) return nullptr;
+    return &found->second;
+}
+
+tone_decoder::tone_decoder(const unsigned int& rate_in)
+: kernels(dsp_get_kernels()), rate(rate_in),
+  decimation(std::min(std::max(1u, rate_in / TONE_DECIMATED_HZ), (unsigned int)TONE_MAX_DECIMATION)),
+  decimated_rate((float)rate_in / decimation),
+  ctcss_lowpass1(dsp_biquad::lowpass(decimated_rate, TONE_CTCSS_LOWPASS_HZ, 0.5412f)),
+  ctcss_lowpass2(dsp_biquad::lowpass(decimated_rate, TONE_CTCSS_LOWPASS_HZ, 1.3066f)),
+  dcs_lowpass1(dsp_biquad::lowpass(decimated_rate, TONE_DCS_LOWPASS_HZ, 0.5412f)),
+  dcs_lowpass2(dsp_biquad::lowpass(decimated_rate, TONE_DCS_LOWPASS_HZ, 1.3066f)), bit_step(TONE_DCS_BAUD / decimated_rate) {
+    if (decimated_rate < 2 * TONE_CTCSS_LOWPASS_HZ) system_fault("tone decoder needs more than ", rate, " samples per second");
+
+    window.resize(decimated_rate * TONE_WINDOW_MSEC / 1000);
+    tones = ctcss_tones();
+
+    // the padding bins have a coefficient of 0 and are never looked at
+    auto bins = (tones.size() + dsp_bank_width - 1) / dsp_bank_width * dsp_bank_width;
+    coefficients.resize(bins, 0);
+    s1.resize(bins, 0);
+    s2.resize(bins, 0);
+
+    for(size_t i = 0; i < tones.size(); i++) {
+        coefficients[i] = 2 * std::cos(2 * M_PI * tones[i] / decimated_rate);
+    }
+
+    // builds the table now instead of on the audio thread
+    dcs_table();
+}
+
+void tone_decoder::reset() {
+    integrator1 = integrator2 = comb1 = comb2 = 0;
+    phase = 0;
+
+    window_used = 0;
+    std::fill(s1.begin(), s1.end(), 0.0f);
+    std::fill(s2.begin(), s2.end(), 0.0f);
+    ctcss_candidate = ctcss_found = -1;
+    ctcss_hits = ctcss_misses = 0;
+
+    ctcss_lowpass1.reset();
+    ctcss_lowpass2.reset();
+    dcs_lowpass1.reset();
+    dcs_lowpass2.reset();
+    dc = bit_phase = 0;
+    level = false;
+    bits = 0;
+    bit_count = dcs_seen_at = 0;
+    dcs_history.fill(nullptr);
+    dcs_cycle_best = nullptr;
+    dcs_cycle_confirmed = false;
+    dcs_found = tone_code();
+
+    publish();
+}
+
+void tone_decoder::process(const float* block_in, const size_t& samples_in) {
+    const float scale = 1.0f / (32768.0f * decimation * decimation);
+    int16_t chunk[TONE_CHUNK];
+
+    for(size_t done = 0; done < samples_in; done += TONE_CHUNK) {
+        auto count = std::min<size_t>(TONE_CHUNK, samples_in - done);
+        kernels.f32_to_s16(block_in + done, chunk, count);
+
+        // the integrators wrap and the combs take the wrap back out
+        for(size_t i = 0; i < count; i++) {
+            integrator1 += (uint32_t)(int32_t)chunk[i];
+            integrator2 += integrator1;
+            if (++phase < decimation) continue;
+            phase = 0;
+
+            auto difference1 = integrator2 - comb1;
+            comb1 = integrator2;
+            auto difference2 = difference1 - comb2;
+            comb2 = difference1;
+
+            decimated((int32_t)difference2 * scale);
+        }
+    }
+}
+
+void tone_decoder::decimated(const float& sample_in) {
+    dcs_sample(sample_in);
+
+    window[window_used++] = ctcss_lowpass2.process(ctcss_lowpass1.process(sample_in));
+    if (window_used == window.size()) {
+        ctcss_window();
+        window_used = 0;
+    }
+}
+
+void tone_decoder::ctcss_window() {
+    auto count = window.size();
+    kernels.goertzel(window.data(), count, coefficients.data(), s1.data(), s2.data(), coefficients.size());
+
+    float peak;
+    double sum, squares;
+    kernels.measure(window.data(), count, &peak, &sum, &squares);
+
+    // a tone of amplitude a puts (a n / 2)^2 in its bin out of a^2 n / 2 in
+    // the window so this is the share of the energy in the strongest bin
+    int best = -1;
+    float best_power = 0;
+    for(size_t i = 0; i < tones.size(); i++) {
+        auto power = s1[i] * s1[i] + s2[i] * s2[i] - coefficients[i] * s1[i] * s2[i];
+        if (power > best_power) {
+            best_power = power;
+            best = i;
+        }
+    }
+
+    std::fill(s1.begin(), s1.end(), 0.0f);
+    std::fill(s2.begin(), s2.end(), 0.0f);
+
+    auto loud_enough = squares / count >= TONE_MIN_ENERGY;
+    if (! loud_enough || 2 * best_power < TONE_CTCSS_MIN_FRACTION * count * squares) best = -1;
+
+    if (best >= 0 && best == ctcss_candidate) {
+        ctcss_hits++;
+    } else {
+        ctcss_hits = best >= 0 ? 1 : 0;
+    }
+    ctcss_candidate = best;
+
+    if (best >= 0 && ctcss_hits >= TONE_HITS) {
+        ctcss_found = best;
+        ctcss_misses = 0;
+    } else if (best != ctcss_found && ++ctcss_misses >= TONE_MISSES) {
+        ctcss_found = -1;
+    }
+
+    publish();
+}
+
+// the bits are squared up by their sign after a low pass and the DC is
+// taken out and then a bit clock that is pulled toward the transitions
+// picks them up in the middle
+void tone_decoder::dcs_sample(const float& sample_in) {
+    auto filtered = dcs_lowpass2.process(dcs_lowpass1.process(sample_in));
+    dc += (filtered - dc) * TONE_DCS_DC_RATE;
+    auto now_level = filtered - dc > 0;
+
+    auto was_phase = bit_phase;
+    bit_phase += bit_step;
+    if (bit_phase >= 1) bit_phase -= 1;
+
+    if (now_level != level) {
+        level = now_level;
+        auto error = bit_phase < 0.5f ? bit_phase : bit_phase - 1;
+        bit_phase -= error * TONE_DCS_PLL_GAIN;
+        if (bit_phase < 0) bit_phase += 1;
+    }
+
+    if (was_phase < 0.5f && bit_phase >= 0.5f) dcs_bit(level);
+}
+
+// Some codes are other codes turned around or upside down so one stream
+// can hold more than one of them. When that happens the code sent the
+// right way up and then the lowest one is taken the way radios do.
+static bool dcs_better(const tone_code& left_in, const tone_code& right_in) {
+    if (left_in.inverted != right_in.inverted) return ! left_in.inverted;
+    return left_in.value < right_in.value;
+}
+
+// A code and its aliases each come around once every 23 bits so nothing is
+// decided until a whole cycle has gone by. The best code seen in the cycle
+// wins if it was also seen at the same place in the cycle before; if it was
+// not then the cycle is skipped rather than settling on a worse alias.
+void tone_decoder::dcs_bit(const bool& bit_in) {
+    bits = (bits >> 1) | (bit_in ? 1u << 22 : 0);
+    bit_count++;
+
+    auto& slot = dcs_history[bit_count % dcs_history.size()];
+    auto found = bit_count >= 23 ? dcs_lookup(bits) : nullptr;
+
+    if (found != nullptr) {
+        auto confirmed = found == slot;
+
+        if (dcs_cycle_best == nullptr || dcs_better(*found, *dcs_cycle_best)) {
+            dcs_cycle_best = found;
+            dcs_cycle_confirmed = confirmed;
+        } else if (found == dcs_cycle_best) {
+            dcs_cycle_confirmed = dcs_cycle_confirmed || confirmed;
+        }
+    }
+
+    slot = found;
+
+    if (bit_count % dcs_history.size() != 0) return;
+
+    if (dcs_cycle_best != nullptr && dcs_cycle_confirmed) {
+        dcs_found = *dcs_cycle_best;
+        dcs_seen_at = bit_count;
+        publish();
+    } else if (dcs_found.kind != tone_code::kind_type::none && bit_count - dcs_seen_at >= 23 * TONE_MISSES) {
+        dcs_found = tone_code();
+        publish();
+    }
+
+    dcs_cycle_best = nullptr;
+    dcs_cycle_confirmed = false;
+}
+
+void tone_decoder::publish() {
+    tone_code now;
+
+    if (dcs_found.kind != tone_code::kind_type::none) {
+        now = dcs_found;
+    } else if (ctcss_found >= 0) {
+        now = tone_code::ctcss(tones[ctcss_found]);
+    }
+
+    if (now != detected.get()) detected = now;
+}
+
+}
@@ -0,0 +1,136 @@
+/*
+ * tone.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "dsp.h"
+#include "object.h"
+
+namespace oemros {
+
+// A sub-audible tone on FM. CTCSS tones are kept as tenths of a Hz and DCS
+// codes as the number the octal code reads as so D023 is 023 octal.
+struct tone_code {
+    enum class kind_type : uint8_t {
+        none,
+        ctcss,
+        dcs,
+    };
+
+    kind_type kind = kind_type::none;
+    // DCS sent with the polarity flipped
+    bool inverted = false;
+    uint16_t value = 0;
+
+    static tone_code ctcss(const float& hertz_in);
+    static tone_code dcs(const uint16_t& code_in, const bool& inverted_in = false);
+    bool operator==(const tone_code& other_in) const;
+    bool operator!=(const tone_code& other_in) const { return ! (*this == other_in); }
+    // any fixed order will do; value_source history wants one
+    bool operator<(const tone_code& other_in) const;
+};
+
+// like 88.5 Hz, D023N or D754I
+std::string tone_name(const tone_code& tone_in);
+
+// The standard CTCSS tones in Hz and DCS codes as octal numbers.
+const std::vector<float>& ctcss_tones();
+const std::vector<uint16_t>& dcs_codes();
+// the 23 bit Golay(23,12) word for a DCS code in the order it is sent with
+// the first bit sent in bit 0
+uint32_t dcs_word(const uint16_t& code_in);
+
+// Finds the CTCSS tone or DCS code on receive audio a block at a time.
+//
+// The audio is decimated to a couple of kHz by a CIC filter and low passed
+// to keep voice out. CTCSS runs every tone through one Goertzel bank from
+// the DSP kernels over windows of about a quarter second and takes the
+// strongest tone if enough of the energy is in it. DCS slices the audio
+// into bits at 134.4 baud and looks for a code word in the last 23 bits;
+// a code is only picked once a whole 23 bit cycle has been seen so the
+// right one of a set of aliases is published and not the first one found.
+// Either has to be seen twice in a row before it is believed and missed
+// twice in a row before it goes away; DCS wins if both are found.
+//
+// process() does not allocate. detected is only set when the tone changes
+// and its subscribers run on the thread that called process().
+class tone_decoder : public baseobj {
+    private:
+        const dsp_kernels& kernels;
+        const unsigned int rate;
+        const unsigned int decimation;
+        const float decimated_rate;
+
+        // CIC decimator in wrapping integer math so it never drifts
+        uint32_t integrator1 = 0, integrator2 = 0;
+        uint32_t comb1 = 0, comb2 = 0;
+        unsigned int phase = 0;
+
+        // CTCSS
+        dsp_biquad ctcss_lowpass1, ctcss_lowpass2;
+        std::vector<float> window;
+        size_t window_used = 0;
+        std::vector<float> tones;
+        std::vector<float> coefficients;
+        std::vector<float> s1, s2;
+        int ctcss_candidate = -1;
+        unsigned int ctcss_hits = 0;
+        unsigned int ctcss_misses = 0;
+        int ctcss_found = -1;
+
+        // DCS
+        dsp_biquad dcs_lowpass1, dcs_lowpass2;
+        float dc = 0;
+        bool level = false;
+        float bit_phase = 0;
+        const float bit_step;
+        uint32_t bits = 0;
+        uint64_t bit_count = 0;
+        // what was found at each of the last 23 bits
+        std::array<const tone_code*, 23> dcs_history{};
+        // best code seen so far in this cycle of 23 bits
+        const tone_code* dcs_cycle_best = nullptr;
+        bool dcs_cycle_confirmed = false;
+        tone_code dcs_found;
+        uint64_t dcs_seen_at = 0;
+
+        void decimated(const float& sample_in);
+        void ctcss_window();
+        void dcs_sample(const float& sample_in);
+        void dcs_bit(const bool& bit_in);
+        void publish();
+
+    public:
+        value_source<tone_code> detected{tone_code()};
+
+        tone_decoder(const unsigned int& rate_in);
+        // block_in holds one channel
+        void process(const float* block_in, const size_t& samples_in);
+        // starts over as if no audio had been seen
+        void reset();
+};
+
+}
@@ -0,0 +1,680 @@
+/*
+ * turboini.cxx
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+
+#include "turboini.h"
+
+namespace oemros {
+
+// how deep includes can nest before it is taken to be a loop
+#define TURBOINI_MAX_INCLUDE_DEPTH 16
+// key path components a lookup can have
+#define TURBOINI_MAX_PATH 32
+// longest number the conversions will look at
+#define TURBOINI_MAX_NUMBER 64
+// a guess at the bytes a value takes up so the vectors are sized once
+#define TURBOINI_BYTES_PER_VALUE 24
+
+turboini_error::turboini_error(const std::string& path_in, const uint32_t& line_in, const uint32_t& column_in, const std::string& message_in)
+: exception(vaargs_to_string(path_in, ":", line_in, ":", column_in, ": ", message_in)), path(path_in), line(line_in), column(column_in) { }
+
+static bool turboini_space(const char& char_in) {
+    return char_in == ' ' || char_in == '\t' || char_in == '\r';
+}
+
+// a bare key component ends at any of these
+static bool turboini_key_end(const char& char_in) {
+    return turboini_space(char_in) || std::strchr("\n.=:,\"'[]{}", char_in) != nullptr;
+}
+
+static std::string_view turboini_trim(const char* begin_in, const char* end_in) {
+    while(begin_in < end_in && turboini_space(*begin_in)) begin_in++;
+    while(end_in > begin_in && turboini_space(end_in[-1])) end_in--;
+    return std::string_view(begin_in, end_in - begin_in);
+}
+
+// Walks one mapped file a line at a time and adds what it finds to the
+// document. Values and key paths are kept by their place in the document's
+// vectors since those can move as they grow.
+class turboini_parser {
+    private:
+        turboini_document& document;
+        const uint32_t file;
+        const unsigned int depth;
+        const char* const end;
+        const char* position;
+        const char* line_start;
+        uint32_t line = 1;
+
+        [[noreturn]] void fail_at(const uint32_t& line_in, const uint32_t& column_in, const std::string& message_in) const;
+        // at_in has to be on the current line
+        [[noreturn]] void fail(const char* at_in, const std::string& message_in) const;
+        uint32_t column(const char* at_in) const { return at_in - line_start + 1; }
+        bool at_eol() const { return position == end || *position == '\n'; }
+        void skip_space();
+        // moves past the end of the line the parser is on
+        void skip_line();
+        // spaces, newlines and comment lines between the items of a list or table
+        void skip_gap();
+        void expect_eol();
+        void parse_directive(turboini_document::section_id& section_inout);
+        void parse_section(turboini_document::section_id& section_out);
+        void parse_assignment(const turboini_document::section_id& section_in);
+        // adds the components to the document and returns how many there were
+        uint32_t parse_key();
+        std::string_view parse_quoted(bool& escaped_out);
+        // an item is a value in a list or table; indexed_in is false for
+        // values with no key path like the items of a list
+        uint32_t parse_value(const bool& item_in, const turboini_document::section_id& section_in,
+                             const uint32_t& path_first_in, const uint32_t& path_count_in, const bool& indexed_in);
+        uint32_t parse_container(const turboini_document::section_id& section_in,
+                                 const uint32_t& path_first_in, const uint32_t& path_count_in, const bool& indexed_in);
+
+    public:
+        turboini_parser(turboini_document& document_in, const uint32_t& file_in, const unsigned int& depth_in);
+        // the section carries on past the end of the file for includes
+        void parse(turboini_document::section_id& section_inout);
+};
+
+turboini_parser::turboini_parser(turboini_document& document_in, const uint32_t& file_in, const unsigned int& depth_in)
+: document(document_in), file(file_in), depth(depth_in),
+  end(document_in.files[file_in].data + document_in.files[file_in].size) {
+    position = line_start = document.files[file].data;
+}
+
+void turboini_parser::fail_at(const uint32_t& line_in, const uint32_t& column_in, const std::string& message_in) const {
+    throw turboini_error(document.files[file].path, line_in, column_in, message_in);
+}
+
+void turboini_parser::fail(const char* at_in, const std::string& message_in) const {
+    fail_at(line, column(at_in), message_in);
+}
+
+void turboini_parser::skip_space() {
+    while(position < end && turboini_space(*position)) position++;
+}
+
+void turboini_parser::skip_line() {
+    auto newline = static_cast<const char*>(std::memchr(position, '\n', end - position));
+    if (newline == nullptr) {
+        position = end;
+        return;
+    }
+
+    position = line_start = newline + 1;
+    line++;
+}
+
+void turboini_parser::skip_gap() {
+    while(true) {
+        skip_space();
+        if (position == end) return;
+        if (*position != '\n' && *position != '#') return;
+        skip_line();
+    }
+}
+
+void turboini_parser::expect_eol() {
+    skip_space();
+    if (! at_eol()) fail(position, "expected the end of the line");
+    skip_line();
+}
+
+void turboini_parser::parse(turboini_document::section_id& section_inout) {
+    while(position < end) {
+        skip_space();
+        if (position == end) break;
+
+        switch(*position) {
+        case '\n':
+        case '#':
+            skip_line();
+            break;
+        case '!':
+            parse_directive(section_inout);
+            break;
+        case '[':
+            parse_section(section_inout);
+            break;
+        default:
+            parse_assignment(section_inout);
+        }
+    }
+}
+
+void turboini_parser::parse_directive(turboini_document::section_id& section_inout) {
+    static const std::string_view include("include");
+    auto bang = position++;
+
+    if ((size_t)(end - position) < include.size() || std::string_view(position, include.size()) != include) {
+        fail(bang, "unknown directive");
+    }
+
+    position += include.size();
+    if (! at_eol() && ! turboini_space(*position)) fail(bang, "unknown directive");
+
+    auto newline = static_cast<const char*>(std::memchr(position, '\n', end - position));
+    auto target = turboini_trim(position, newline == nullptr ? end : newline);
+    if (target.size() >= 2 && (target[0] == '"' || target[0] == '\'') && target.back() == target[0]) {
+        target = target.substr(1, target.size() - 2);
+    }
+    if (target.empty()) fail(bang, "!include needs a file");
+    if (depth + 1 >= TURBOINI_MAX_INCLUDE_DEPTH) fail(bang, "includes nest too deeply");
+
+    // relative to the file the directive is in
+    std::string path(target);
+    auto& here = document.files[file].path;
+    auto slash = here.rfind('/');
+    if (path[0] != '/' && slash != std::string::npos) path = here.substr(0, slash + 1) + path;
+
+    std::string error;
+    auto included = document.map(path, error);
+    if (included == turboini_none) fail(bang, vaargs_to_string("could not include ", path, ": ", error));
+
+    skip_line();
+    turboini_parser(document, included, depth + 1).parse(section_inout);
+}
+
+void turboini_parser::parse_section(turboini_document::section_id& section_out) {
+    auto open = position++;
+    while(! at_eol() && *position != ']') position++;
+    if (at_eol()) fail(open, "a section needs a ]");
+
+    auto name = turboini_trim(open + 1, position);
+    if (name.empty()) fail(open, "a section needs a name");
+
+    document.sections.push_back({ name, file, line });
+    section_out = document.sections.size() - 1;
+
+    position++;
+    expect_eol();
+}
+
+void turboini_parser::parse_assignment(const turboini_document::section_id& section_in) {
+    auto first = document.components.size();
+    auto count = parse_key();
+
+    if (at_eol() || *position != '=') fail(position, "expected = after the key");
+    position++;
+    skip_space();
+
+    parse_value(false, section_in, first, count, true);
+    expect_eol();
+}
+
+uint32_t turboini_parser::parse_key() {
+    uint32_t count = 0;
+
+    while(true) {
+        skip_space();
+        auto start = position;
+        std::string_view component;
+
+        if (! at_eol() && (*position == '"' || *position == '\'')) {
+            bool escaped;
+            component = parse_quoted(escaped);
+        } else {
+            while(! at_eol() && ! turboini_key_end(*position)) position++;
+            if (position == start) fail(start, "expected a key");
+            component = std::string_view(start, position - start);
+        }
+
+        document.components.push_back(component);
+        count++;
+
+        skip_space();
+        if (at_eol() || *position != '.') return count;
+        position++;
+    }
+}
+
+std::string_view turboini_parser::parse_quoted(bool& escaped_out) {
+    auto quote = *position;
+    auto open_line = line;
+    auto open_column = column(position);
+    auto start = ++position;
+    escaped_out = false;
+
+    while(true) {
+        if (position == end) fail_at(open_line, open_column, "the string does not end");
+        if (*position == quote) break;
+
+        if (*position == '\n') {
+            line_start = ++position;
+            line++;
+            continue;
+        }
+
+        if (*position == '\\' && quote == '"') {
+            if (position + 1 == end || position[1] == '\0' || std::strchr("nrt\\\"'", position[1]) == nullptr) {
+                fail(position, "unknown escape");
+            }
+            escaped_out = true;
+            position++;
+        }
+
+        position++;
+    }
+
+    return std::string_view(start, position++ - start);
+}
+
+uint32_t turboini_parser::parse_value(const bool& item_in, const turboini_document::section_id& section_in,
+                                      const uint32_t& path_first_in, const uint32_t& path_count_in, const bool& indexed_in) {
+    if (! at_eol() && (*position == '[' || *position == '{')) {
+        return parse_container(section_in, path_first_in, path_count_in, indexed_in);
+    }
+
+    turboini_value value;
+    value.file = file;
+    value.line = line;
+    value.column = column(position);
+
+    if (! at_eol() && (*position == '"' || *position == '\'')) {
+        value.text = parse_quoted(value.escaped);
+    } else {
+        // a backslash lets a bare string start with a bracket or a quote
+        if (! at_eol() && *position == '\\' && position + 1 < end && std::strchr("[{\"'\\", position[1]) != nullptr) {
+            position++;
+        }
+
+        // the rest of the line; in a list or table only up to the next item
+        auto start = position;
+        if (item_in) {
+            while(! at_eol() && *position != ',' && *position != ']' && *position != '}') position++;
+            if (turboini_trim(start, position).empty()) fail(start, "expected a value");
+        } else {
+            while(! at_eol()) position++;
+        }
+
+        value.text = turboini_trim(start, position);
+    }
+
+    uint32_t index = document.values.size();
+    document.values.push_back(value);
+    if (indexed_in) document.index.push_back({ section_in, path_first_in, path_count_in, index });
+
+    return index;
+}
+
+uint32_t turboini_parser::parse_container(const turboini_document::section_id& section_in,
+                                          const uint32_t& path_first_in, const uint32_t& path_count_in, const bool& indexed_in) {
+    auto open = position;
+    auto open_line = line;
+    auto open_column = column(position);
+    bool table = *open == '{';
+    auto close = table ? '}' : ']';
+
+    turboini_value value;
+    value.type = table ? turboini_value::type_type::table : turboini_value::type_type::list;
+    value.file = file;
+    value.line = open_line;
+    value.column = open_column;
+
+    uint32_t container = document.values.size();
+    document.values.push_back(value);
+    if (indexed_in) document.index.push_back({ section_in, path_first_in, path_count_in, container });
+
+    auto last = turboini_none;
+    position++;
+
+    while(true) {
+        skip_gap();
+        if (position == end) fail_at(open_line, open_column, table ? "the table does not end" : "the list does not end");
+        if (*position == close) break;
+
+        uint32_t item;
+
+        if (table) {
+            // a copy of the table's path goes in front of the key so the
+            // whole path of the item is in one run
+            uint32_t first = document.components.size();
+            if (indexed_in) {
+                for(uint32_t i = 0; i < path_count_in; i++) document.components.push_back(document.components[path_first_in + i]);
+            }
+
+            uint32_t key_first = document.components.size();
+            auto key_count = parse_key();
+            if (at_eol() || *position != ':') fail(position, "expected : after the key");
+            position++;
+            skip_space();
+
+            item = parse_value(true, section_in, first, key_first - first + key_count, indexed_in);
+            document.values[item].key_first = key_first;
+            document.values[item].key_count = key_count;
+        } else {
+            item = parse_value(true, section_in, 0, 0, false);
+        }
+
+        if (last == turboini_none) document.values[container].first = item;
+        else document.values[last].next = item;
+        last = item;
+
+        skip_gap();
+        if (position == end) fail_at(open_line, open_column, table ? "the table does not end" : "the list does not end");
+        if (*position == close) break;
+        if (*position == ',') {
+            position++;
+            continue;
+        }
+
+        fail(position, table ? "expected , or }" : "expected , or ]");
+    }
+
+    position++;
+    document.values[container].text = std::string_view(open, position - open);
+    return container;
+}
+
+turboini_document::turboini_document(const std::string& path_in) {
+    // the values before the first section header
+    sections.push_back(section_type());
+
+    std::string error;
+    auto first = map(path_in, error);
+    if (first == turboini_none) throw turboini_error(path_in, 0, 0, error);
+
+    auto guess = files[first].size / TURBOINI_BYTES_PER_VALUE;
+    values.reserve(guess);
+    index.reserve(guess);
+    components.reserve(guess * 2);
+
+    try {
+        section_id section = 0;
+        turboini_parser(*this, first, 0).parse(section);
+        build_index();
+    } catch (...) {
+        unmap();
+        throw;
+    }
+}
+
+turboini_document::~turboini_document() {
+    unmap();
+}
+
+uint32_t turboini_document::map(const std::string& path_in, std::string& error_out) {
+    auto fd = ::open(path_in.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error_out = errno_str(errno);
+        return turboini_none;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        error_out = errno_str(errno);
+        ::close(fd);
+        return turboini_none;
+    }
+
+    file_type mapped;
+    mapped.path = path_in;
+    mapped.size = info.st_size;
+
+    // an empty file can not be mapped and has nothing to read anyway
+    if (mapped.size > 0) {
+        auto data = mmap(nullptr, mapped.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            error_out = errno_str(errno);
+            ::close(fd);
+            return turboini_none;
+        }
+
+        madvise(data, mapped.size, MADV_SEQUENTIAL);
+        mapped.data = static_cast<const char*>(data);
+    }
+
+    ::close(fd);
+    files.push_back(mapped);
+    return files.size() - 1;
+}
+
+void turboini_document::unmap() {
+    for(auto& i : files) {
+        if (i.data != nullptr) munmap(const_cast<char*>(i.data), i.size);
+        i.data = nullptr;
+    }
+}
+
+int turboini_document::compare(const entry_type& entry_in, const section_id& section_in, const std::string_view* path_in, const size_t& count_in) const {
+    if (entry_in.section != section_in) return entry_in.section < section_in ? -1 : 1;
+
+    auto common = std::min<size_t>(entry_in.path_count, count_in);
+    for(size_t i = 0; i < common; i++) {
+        auto order = components[entry_in.path_first + i].compare(path_in[i]);
+        if (order != 0) return order < 0 ? -1 : 1;
+    }
+
+    if (entry_in.path_count == count_in) return 0;
+    return entry_in.path_count < count_in ? -1 : 1;
+}
+
+void turboini_document::build_index() {
+    // ties go to the value read first so a repeated key is found after it
+    auto by_path = [this](const entry_type& left_in, const entry_type& right_in) {
+        auto order = compare(left_in, right_in.section, components.data() + right_in.path_first, right_in.path_count);
+        return order < 0 || (order == 0 && left_in.value < right_in.value);
+    };
+
+    // a section is never gone back to once the next one starts so the
+    // entries are already in section order and only each section needs
+    // sorting
+    for(auto first = index.begin(); first != index.end();) {
+        auto last = first;
+        while(last != index.end() && last->section == first->section) last++;
+        std::sort(first, last, by_path);
+        first = last;
+    }
+
+    for(size_t i = 1; i < index.size(); i++) {
+        auto& previous = index[i - 1];
+        if (compare(index[i], previous.section, components.data() + previous.path_first, previous.path_count) != 0) continue;
+
+        auto& value = values[index[i].value];
+        throw turboini_error(files[value.file].path, value.line, value.column, "the key is already set in this section");
+    }
+
+    by_name.resize(sections.size());
+    for(size_t i = 0; i < by_name.size(); i++) by_name[i] = i;
+    std::stable_sort(by_name.begin(), by_name.end(), [this](const section_id& left_in, const section_id& right_in) {
+        return sections[left_in].name < sections[right_in].name;
+    });
+}
+
+turboini_document::section_range turboini_document::get_sections(const std::string_view& name_in) const {
+    struct by_section_name {
+        const std::vector<section_type>& sections;
+        bool operator()(const section_id& left_in, const std::string_view& right_in) const { return sections[left_in].name < right_in; }
+        bool operator()(const std::string_view& left_in, const section_id& right_in) const { return left_in < sections[right_in].name; }
+    };
+
+    return std::equal_range(by_name.begin(), by_name.end(), name_in, by_section_name{ sections });
+}
+
+// Splits a key path the way the parser would without copying it; 0 if it
+// is not a key path or has too many components.
+static size_t turboini_split(const std::string_view& path_in, std::string_view* parts_out) {
+    size_t count = 0;
+    size_t at = 0;
+
+    while(true) {
+        while(at < path_in.size() && turboini_space(path_in[at])) at++;
+        if (at == path_in.size() || count == TURBOINI_MAX_PATH) return 0;
+
+        auto start = at;
+        if (path_in[at] == '"' || path_in[at] == '\'') {
+            auto quote = path_in[at++];
+            start = at;
+            while(at < path_in.size() && path_in[at] != quote) at += path_in[at] == '\\' && quote == '"' ? 2 : 1;
+            if (at >= path_in.size()) return 0;
+            parts_out[count++] = path_in.substr(start, at++ - start);
+        } else {
+            while(at < path_in.size() && ! turboini_key_end(path_in[at])) at++;
+            if (at == start) return 0;
+            parts_out[count++] = path_in.substr(start, at - start);
+        }
+
+        while(at < path_in.size() && turboini_space(path_in[at])) at++;
+        if (at == path_in.size()) return count;
+        if (path_in[at++] != '.') return 0;
+    }
+}
+
+const turboini_value* turboini_document::find(const section_id& section_in, const std::string_view& path_in) const {
+    std::string_view parts[TURBOINI_MAX_PATH];
+    auto count = turboini_split(path_in, parts);
+    if (count == 0) return nullptr;
+
+    auto found = std::lower_bound(index.begin(), index.end(), 0, [&](const entry_type& entry_in, int) {
+        return compare(entry_in, section_in, parts, count) < 0;
+    });
+
+    if (found == index.end() || compare(*found, section_in, parts, count) != 0) return nullptr;
+    return &values[found->value];
+}
+
+const turboini_value* turboini_document::get_first(const turboini_value& value_in) const {
+    return value_in.first == turboini_none ? nullptr : &values[value_in.first];
+}
+
+const turboini_value* turboini_document::get_next(const turboini_value& value_in) const {
+    return value_in.next == turboini_none ? nullptr : &values[value_in.next];
+}
+
+std::string turboini_document::get_key(const turboini_value& item_in) const {
+    std::string result;
+
+    for(uint32_t i = 0; i < item_in.key_count; i++) {
+        if (i > 0) result += '.';
+        result += components[item_in.key_first + i];
+    }
+
+    return result;
+}
+
+size_t turboini_document::get_bytes() const {
+    size_t result = 0;
+    for(auto& i : files) result += i.size;
+    return result;
+}
+
+std::string turboini_unescape(const std::string_view& text_in) {
+    std::string result;
+    result.reserve(text_in.size());
+
+    for(size_t i = 0; i < text_in.size(); i++) {
+        if (text_in[i] != '\\' || i + 1 == text_in.size()) {
+            result += text_in[i];
+            continue;
+        }
+
+        switch(text_in[++i]) {
+        case 'n': result += '\n'; break;
+        case 'r': result += '\r'; break;
+        case 't': result += '\t'; break;
+        default: result += text_in[i];
+        }
+    }
+
+    return result;
+}
+
+bool turboini_to_bool(const std::string_view& text_in, bool& value_out) {
+    if (text_in == "true") value_out = true;
+    else if (text_in == "false") value_out = false;
+    else return false;
+
+    return true;
+}
+
+bool turboini_to_integer(const std::string_view& text_in, int64_t& value_out) {
+    auto first = text_in.data();
+    auto last = first + text_in.size();
+
+    // from_chars does not take a leading +
+    if (first != last && *first == '+') first++;
+    if (first == last || *first == '+' || (*first == '-' && first != text_in.data())) return false;
+
+    auto result = std::from_chars(first, last, value_out);
+    return result.ec == std::errc() && result.ptr == last;
+}
+
+bool turboini_to_real(const std::string_view& text_in, double& value_out) {
+    char buffer[TURBOINI_MAX_NUMBER];
+    if (text_in.empty() || text_in.size() >= sizeof(buffer) || turboini_space(text_in[0])) return false;
+
+    std::memcpy(buffer, text_in.data(), text_in.size());
+    buffer[text_in.size()] = '\0';
+
+    char* stop;
+    auto value = std::strtod(buffer, &stop);
+    if (stop != buffer + text_in.size()) return false;
+
+    value_out = value;
+    return true;
+}
+
+bool turboini_to_complex(const std::string_view& text_in, std::complex<double>& value_out) {
+    if (text_in.empty()) return false;
+
+    if (text_in.back() != 'i') {
+        double real;
+        if (! turboini_to_real(text_in, real)) return false;
+        value_out = std::complex<double>(real, 0);
+        return true;
+    }
+
+    // the imaginary part starts at the last sign that is not an exponent's
+    auto body = text_in.substr(0, text_in.size() - 1);
+    auto split = std::string_view::npos;
+    for(size_t i = body.size(); i-- > 1;) {
+        if ((body[i] == '+' || body[i] == '-') && body[i - 1] != 'e' && body[i - 1] != 'E') {
+            split = i;
+            break;
+        }
+    }
+
+    double real = 0, imaginary;
+    if (split != std::string_view::npos) {
+        if (! turboini_to_real(body.substr(0, split), real)) return false;
+        body = body.substr(split);
+    }
+
+    // i on its own is 1i
+    if (body.empty() || body == "+") imaginary = 1;
+    else if (body == "-") imaginary = -1;
+    else if (! turboini_to_real(body, imaginary)) return false;
+
+    value_out = std::complex<double>(real, imaginary);
+    return true;
+}
+
+}
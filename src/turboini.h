@@ -0,0 +1,171 @@
+/*
+ * turboini.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tyler
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "system.h"
+
+namespace oemros {
+
+// A parse error somewhere in a file a document was read from. line and
+// column count from 1 and the column is in bytes.
+struct turboini_error : public exception {
+    const std::string path;
+    const uint32_t line;
+    const uint32_t column;
+
+    turboini_error(const std::string& path_in, const uint32_t& line_in, const uint32_t& column_in, const std::string& message_in);
+};
+
+// marks a list or table with no items and the last item of one
+static constexpr uint32_t turboini_none = UINT32_MAX;
+
+struct turboini_value {
+    enum class type_type : uint8_t {
+        scalar,
+        list,
+        table,
+    };
+
+    type_type type = type_type::scalar;
+    // a double quoted string with backslash escapes in it; the text is
+    // left as written and turboini_unescape() takes them out
+    bool escaped = false;
+    // a scalar without its quotes; lists and tables as they are written,
+    // brackets and all
+    std::string_view text;
+    uint32_t file = 0;
+    uint32_t line = 0;
+    uint32_t column = 0;
+    // the items of a list or table are chained from first through next
+    uint32_t first = turboini_none;
+    uint32_t next = turboini_none;
+    // where the key path of an item in a table is kept in the document
+    uint32_t key_first = 0;
+    uint32_t key_count = 0;
+};
+
+// A TurboINI file as laid out in doc/turboini.txt read into memory once.
+//
+// The file is mapped and tokenized in one pass. Every string in the
+// document is a view into the mapping so nothing is copied out of it and
+// the document has to outlive the views it hands out. Each value
+// reachable through key paths goes into a flat index sorted by section
+// and key path so finding one is a binary search. Keys inside a table are
+// indexed under the table's key so complicated.but.this.helps.make finds
+// an item of the table complicated.
+//
+// Values before the first section are in section 0 which has no name.
+// Every section header starts a new section even if the name was used
+// before; keys must be unique within one. An included file is read as if
+// it was pasted in place of the !include line.
+class turboini_document {
+    public:
+        using section_id = uint32_t;
+
+    private:
+        struct file_type {
+            std::string path;
+            const char* data = nullptr;
+            size_t size = 0;
+        };
+
+        struct section_type {
+            std::string_view name;
+            uint32_t file = 0;
+            uint32_t line = 0;
+        };
+
+        struct entry_type {
+            section_id section;
+            uint32_t path_first;
+            uint32_t path_count;
+            uint32_t value;
+        };
+
+        std::vector<file_type> files;
+        std::vector<section_type> sections;
+        // section ids sorted by name and then by where they are in the files
+        std::vector<section_id> by_name;
+        // the components of every key path one after the other
+        std::vector<std::string_view> components;
+        std::vector<turboini_value> values;
+        std::vector<entry_type> index;
+
+        friend class turboini_parser;
+        // turboini_none if the file could not be mapped
+        uint32_t map(const std::string& path_in, std::string& error_out);
+        void unmap();
+        void build_index();
+        int compare(const entry_type& entry_in, const section_id& section_in, const std::string_view* path_in, const size_t& count_in) const;
+
+    public:
+        using section_range = std::pair<std::vector<section_id>::const_iterator, std::vector<section_id>::const_iterator>;
+
+        // throws turboini_error if the file or one it includes can not be
+        // read or is not valid
+        turboini_document(const std::string& path_in);
+        ~turboini_document();
+        turboini_document(const turboini_document&) = delete;
+        turboini_document& operator=(const turboini_document&) = delete;
+
+        size_t get_section_count() const { return sections.size(); }
+        std::string_view get_section_name(const section_id& section_in) const { return sections.at(section_in).name; }
+        // where the header of a section is for an error about the whole section
+        const std::string& get_section_path(const section_id& section_in) const { return files.at(sections.at(section_in).file).path; }
+        uint32_t get_section_line(const section_id& section_in) const { return sections.at(section_in).line; }
+        // every section with this name in the order they were read
+        section_range get_sections(const std::string_view& name_in) const;
+        // path_in is a key path written the way it would be in the file
+        // and a quoted component only matches one quoted the same way;
+        // nullptr if the section does not have it
+        const turboini_value* find(const section_id& section_in, const std::string_view& path_in) const;
+        // the items of a list or table; nullptr after the last
+        const turboini_value* get_first(const turboini_value& value_in) const;
+        const turboini_value* get_next(const turboini_value& value_in) const;
+        // the key of an item in a table joined back up with dots
+        std::string get_key(const turboini_value& item_in) const;
+        const std::string& get_path(const turboini_value& value_in) const { return files.at(value_in.file).path; }
+        size_t get_value_count() const { return values.size(); }
+        size_t get_index_size() const { return index.size(); }
+        size_t get_bytes() const;
+};
+
+// a string with its backslash escapes taken out
+std::string turboini_unescape(const std::string_view& text_in);
+
+// Scalars are only strings until something asks for them as another type;
+// each of these is false if the text is not written that way.
+bool turboini_to_bool(const std::string_view& text_in, bool& value_out);
+bool turboini_to_integer(const std::string_view& text_in, int64_t& value_out);
+// inf, -inf and nan are allowed
+bool turboini_to_real(const std::string_view& text_in, double& value_out);
+// 1+1i, 2-i, 1.1i and plain reals
+bool turboini_to_complex(const std::string_view& text_in, std::complex<double>& value_out);
+
+}